@@ -24,9 +24,13 @@ mkdir -p -v $buildDir
 
 t=0.25
 # -g = debug, -Os = Optimize Size
-Compile=(avr-gcc -Wall -g -Os -I "includes/fat" -I "includes/sd" -I "includes/avrio" -I "includes/hlpr" -mmcu=atmega1280 -c -o)
+# run as FAT_DISK_STATS=1 SD_STATS=1 ./MAKE.sh to build with the read counters
+# and set FAT_ASYNC_READ=1 the same way to build the async file read
+Compile=(avr-gcc -Wall -g -Os -DFAT_DISK_STATS=${FAT_DISK_STATS:-0} -DSD_STATS=${SD_STATS:-0} -DFAT_ASYNC_READ=${FAT_ASYNC_READ:-0} -I "includes/fat" -I "includes/sd" -I "includes/avrio" -I "includes/hlpr" -mmcu=atmega1280 -c -o)
 Link=(avr-gcc -Wall -g -mmcu=atmega1280 -o)
 IHex=(avr-objcopy -j .text -j .data -O ihex)
+# the benchmark counts disk reads and SD commands by wrapping these functions
+BenchLink=(avr-gcc -Wall -g -mmcu=atmega1280 -Wl,--wrap=FATtoDisk_ReadSingleSector -Wl,--wrap=FATtoDisk_ReadSectorRange -Wl,--wrap=FATtoDisk_ReadMultipleSectors -Wl,--wrap=sd_SendCommand -o)
 
 
 echo -e ">> COMPILE: "${Compile[@]}" "$buildDir"/avr_fat_test.o " $testDir"/avr_fat_test.c"
@@ -71,6 +75,62 @@ else
 fi
 
 
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_cache.o "$fatDir"/fat_cache.c"
+"${Compile[@]}" $buildDir/fat_cache.o $fatDir/fat_cache.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_CACHE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_CACHE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_file.o "$fatDir"/fat_file.c"
+"${Compile[@]}" $buildDir/fat_file.o $fatDir/fat_file.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_FILE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_FILE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_handle.o "$fatDir"/fat_handle.c"
+"${Compile[@]}" $buildDir/fat_handle.o $fatDir/fat_handle.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_HANDLE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_HANDLE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_log.o "$fatDir"/fat_log.c"
+"${Compile[@]}" $buildDir/fat_log.o $fatDir/fat_log.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_LOG.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_LOG.C successful"
+fi
+
+
 echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_to_sd.o "$fatDir"/fat_to_sd.c"
 "${Compile[@]}" $buildDir/fat_to_sd.o $fatDir/fat_to_sd.c
 status=$?
@@ -155,8 +215,8 @@ else
 fi
 
 
-echo -e "\n\r>> LINK: "${Link[@]}" "$buildDir"/avr_fat_test.elf "$buildDir"/avr_fat_test.o  "$buildDir"/avr_spi.o "$buildDir"/sd_spi_base.o "$buildDir"/sd_spi_rwe.o "$buildDir"/avr_usart.o "$buildDir"/prints.o "$buildDir"/fat_bpb.o "$buildDir"/fat.o "$buildDir"/fat_to_sd.o"
-"${Link[@]}" $buildDir/avr_fat_test.elf $buildDir/avr_fat_test.o $buildDir/avr_spi.o $buildDir/sd_spi_base.o $buildDir/sd_spi_rwe.o $buildDir/avr_usart.o $buildDir/prints.o $buildDir/fat.o $buildDir/fat_bpb.o $buildDir/fat_to_sd.o
+echo -e "\n\r>> LINK: "${Link[@]}" "$buildDir"/avr_fat_test.elf "$buildDir"/avr_fat_test.o  "$buildDir"/avr_spi.o "$buildDir"/sd_spi_base.o "$buildDir"/sd_spi_rwe.o "$buildDir"/avr_usart.o "$buildDir"/prints.o "$buildDir"/fat_bpb.o "$buildDir"/fat.o "$buildDir"/fat_cache.o "$buildDir"/fat_file.o "$buildDir"/fat_handle.o "$buildDir"/fat_log.o "$buildDir"/fat_to_sd.o"
+"${Link[@]}" $buildDir/avr_fat_test.elf $buildDir/avr_fat_test.o $buildDir/avr_spi.o $buildDir/sd_spi_base.o $buildDir/sd_spi_rwe.o $buildDir/avr_usart.o $buildDir/prints.o $buildDir/fat.o $buildDir/fat_bpb.o $buildDir/fat_cache.o $buildDir/fat_file.o $buildDir/fat_handle.o $buildDir/fat_log.o $buildDir/fat_to_sd.o
 status=$?
 sleep $t
 if [ $status -gt 0 ]
@@ -185,6 +245,49 @@ fi
 
 
 
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/avr_fat_bench.o " $testDir"/avr_fat_bench.c"
+"${Compile[@]}" $buildDir/avr_fat_bench.o $testDir/avr_fat_bench.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling AVR_FAT_BENCH.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling AVR_FAT_BENCH.C successful"
+fi
+
+
+echo -e "\n\r>> LINK: "${BenchLink[@]}" "$buildDir"/avr_fat_bench.elf "$buildDir"/avr_fat_bench.o "$buildDir"/avr_spi.o "$buildDir"/sd_spi_base.o "$buildDir"/sd_spi_rwe.o "$buildDir"/avr_usart.o "$buildDir"/prints.o "$buildDir"/fat.o "$buildDir"/fat_bpb.o "$buildDir"/fat_cache.o "$buildDir"/fat_file.o "$buildDir"/fat_handle.o "$buildDir"/fat_log.o "$buildDir"/fat_to_sd.o"
+"${BenchLink[@]}" $buildDir/avr_fat_bench.elf $buildDir/avr_fat_bench.o $buildDir/avr_spi.o $buildDir/sd_spi_base.o $buildDir/sd_spi_rwe.o $buildDir/avr_usart.o $buildDir/prints.o $buildDir/fat.o $buildDir/fat_bpb.o $buildDir/fat_cache.o $buildDir/fat_file.o $buildDir/fat_handle.o $buildDir/fat_log.o $buildDir/fat_to_sd.o
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error during linking"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Linking successful. Output in AVR_FAT_BENCH.ELF"
+fi
+
+
+echo -e "\n\r>> GENERATE INTEL HEX File: "${IHex[@]}" "$buildDir"/avr_fat_bench.elf "$buildDir"/avr_fat_bench.hex"
+"${IHex[@]}" $buildDir/avr_fat_bench.elf $buildDir/avr_fat_bench.hex
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error generating HEX file"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "HEX file successfully generated. Output in AVR_FAT_BENCH.HEX"
+fi
+
+
+
 echo -e "\n\r>> DOWNLOAD HEX FILE TO AVR"
 echo "avrdude -p atmega1280 -c dragon_jtag -U flash:w:avr_fat_test.hex:i -P usb"
 avrdude -p atmega1280 -c dragon_jtag -U flash:w:$buildDir/avr_fat_test.hex:i -P usb
@@ -0,0 +1,210 @@
+clear
+
+#
+# Builds the AVR-FAT module for the host computer (x86 / Linux) with gcc, with
+# FAT_TO_IMAGE.C as the physical disk layer, so that the module can be run and
+# profiled against an image file of a FAT32 formatted disk. The objects are
+# archived in libavrfat_host.a, which is linked with the benchmark program,
+# AVR_FAT_BENCH.C, into avr_fat_bench. Run it as
+#   ../untracked/host_build/avr_fat_bench <FAT32 image file>
+#
+# The image is accessed with stdio by default. Run as
+#   FAT_IMAGE_MMAP=1 ./MAKE_HOST.sh
+# to memory map the image instead. Set FAT_DISK_STATS=1 the same way to
+# build with the disk read counters of fat_GetStats, and FAT_ASYNC_READ=1 to
+# build the async file read.
+#
+
+#directory to store build/compiled files
+buildDir=../untracked/host_build
+
+#directory for avr-fat source files
+fatDir=source/fat
+
+#directory for host versions of the avr-io source files
+hostDir=source/host
+
+#directory for helper files
+hlprDir=source/hlpr
+
+#directory for test files
+testDir=test
+
+#make build directory if it doesn't exist
+mkdir -p -v $buildDir
+
+
+t=0.25
+# -g = debug, -O2 = Optimize for speed, as the host build is for profiling
+Compile=(gcc -Wall -g -O2 -std=gnu99 -DFAT_IMAGE_MMAP=${FAT_IMAGE_MMAP:-0} -DFAT_DISK_STATS=${FAT_DISK_STATS:-0} -DFAT_ASYNC_READ=${FAT_ASYNC_READ:-0} -I "includes/fat" -I "includes/avrio" -I "includes/hlpr" -c -o)
+Archive=(ar rcs)
+# the benchmark counts disk reads by wrapping the FATtoDisk read functions
+Link=(gcc -Wall -g -Wl,--wrap=FATtoDisk_ReadSingleSector -Wl,--wrap=FATtoDisk_ReadSectorRange -Wl,--wrap=FATtoDisk_ReadMultipleSectors -o)
+
+
+echo -e ">> COMPILE: "${Compile[@]}" "$buildDir"/fat.o "$fatDir"/fat.c"
+"${Compile[@]}" $buildDir/fat.o $fatDir/fat.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_bpb.o "$fatDir"/fat_bpb.c"
+"${Compile[@]}" $buildDir/fat_bpb.o $fatDir/fat_bpb.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_BPB.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_BPB.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_cache.o "$fatDir"/fat_cache.c"
+"${Compile[@]}" $buildDir/fat_cache.o $fatDir/fat_cache.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_CACHE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_CACHE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_file.o "$fatDir"/fat_file.c"
+"${Compile[@]}" $buildDir/fat_file.o $fatDir/fat_file.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_FILE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_FILE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_handle.o "$fatDir"/fat_handle.c"
+"${Compile[@]}" $buildDir/fat_handle.o $fatDir/fat_handle.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_HANDLE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_HANDLE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_log.o "$fatDir"/fat_log.c"
+"${Compile[@]}" $buildDir/fat_log.o $fatDir/fat_log.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_LOG.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_LOG.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/fat_to_image.o "$fatDir"/fat_to_image.c"
+"${Compile[@]}" $buildDir/fat_to_image.o $fatDir/fat_to_image.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling FAT_TO_IMAGE.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling FAT_TO_IMAGE.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/prints.o "$hlprDir"/prints.c"
+"${Compile[@]}" $buildDir/prints.o $hlprDir/prints.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling PRINTS.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling PRINTS.C successful"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/host_usart.o "$hostDir"/host_usart.c"
+"${Compile[@]}" $buildDir/host_usart.o $hostDir/host_usart.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling HOST_USART.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling HOST_USART.C successful"
+fi
+
+
+echo -e "\n\r>> ARCHIVE: "${Archive[@]}" "$buildDir"/libavrfat_host.a "$buildDir"/fat.o "$buildDir"/fat_bpb.o "$buildDir"/fat_cache.o "$buildDir"/fat_file.o "$buildDir"/fat_handle.o "$buildDir"/fat_log.o "$buildDir"/fat_to_image.o "$buildDir"/prints.o "$buildDir"/host_usart.o"
+"${Archive[@]}" $buildDir/libavrfat_host.a $buildDir/fat.o $buildDir/fat_bpb.o $buildDir/fat_cache.o $buildDir/fat_file.o $buildDir/fat_handle.o $buildDir/fat_log.o $buildDir/fat_to_image.o $buildDir/prints.o $buildDir/host_usart.o
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error during archiving"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Archiving successful. Output in LIBAVRFAT_HOST.A"
+fi
+
+
+echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/avr_fat_bench.o "$testDir"/avr_fat_bench.c"
+"${Compile[@]}" $buildDir/avr_fat_bench.o $testDir/avr_fat_bench.c
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error compiling AVR_FAT_BENCH.C"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Compiling AVR_FAT_BENCH.C successful"
+fi
+
+
+echo -e "\n\r>> LINK: "${Link[@]}" "$buildDir"/avr_fat_bench "$buildDir"/avr_fat_bench.o "$buildDir"/libavrfat_host.a"
+"${Link[@]}" $buildDir/avr_fat_bench $buildDir/avr_fat_bench.o $buildDir/libavrfat_host.a
+status=$?
+sleep $t
+if [ $status -gt 0 ]
+then
+    echo -e "error during linking"
+    echo -e "program exiting with code $status"
+    exit $status
+else
+    echo -e "Linking successful. Output in AVR_FAT_BENCH"
+fi
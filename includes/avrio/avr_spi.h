@@ -37,6 +37,31 @@
 
 #define SPI_REG_BIT_LEN      8
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             SPI CLOCK RATES
+ *
+ * Description : SPI clock rate settings that can be passed to 
+ *               spi_SetClockRate. Each is the divisor of the CPU clock, e.g.
+ *               SPI_CLK_DIV_2 is 8MHz when the CPU clock is 16MHz.
+ *
+ * Notes       : Each setting is the next slower rate of the one before it, 
+ *               so a rate can be lowered by incrementing it.
+ * ----------------------------------------------------------------------------
+ */
+#define SPI_CLK_DIV_2        0              // SPI2X = 1, SPR1:0 = 00
+#define SPI_CLK_DIV_4        1              // SPI2X = 0, SPR1:0 = 00
+#define SPI_CLK_DIV_8        2              // SPI2X = 1, SPR1:0 = 01
+#define SPI_CLK_DIV_16       3              // SPI2X = 0, SPR1:0 = 01
+#define SPI_CLK_DIV_32       4              // SPI2X = 1, SPR1:0 = 10
+#define SPI_CLK_DIV_64       5              // SPI2X = 0, SPR1:0 = 10
+#define SPI_CLK_DIV_128      6              // SPI2X = 0, SPR1:0 = 11
+
+#define SPI_CLK_SLOWEST      SPI_CLK_DIV_128
+
+// byte sent by spi_ReceiveBlock to clock in each received byte.
+#define SPI_FILL_BYTE        0xFF
+
 /*
  ******************************************************************************
  *                              FUNCTION PROTOTYPES
@@ -47,7 +72,8 @@
  * ----------------------------------------------------------------------------
  *                                         INITIALIZE SPI PORT INTO MASTER MODE
  * 
- * Description : Initialize the AVR's SPI port into master mode.
+ * Description : Initialize the AVR's SPI port into master mode. The clock rate
+ *               is set to SPI_CLK_DIV_64 (250KHz with a 16MHz CPU clock).
  * 
  * Note        : If an application is using a different pin for Chip Select
  *               other than the SS pin of the AVR'S SPI port, then that
@@ -59,6 +85,30 @@
  */
 void spi_MasterInit(void);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SET SPI CLOCK RATE
+ * 
+ * Description : Sets the clock rate of the SPI port.
+ *
+ * Arguments   : clkRate   - One of the SPI CLOCK RATES, e.g. SPI_CLK_DIV_2.
+ *                           Values slower than SPI_CLK_SLOWEST are set to
+ *                           SPI_CLK_SLOWEST.
+ * ----------------------------------------------------------------------------
+ */
+void spi_SetClockRate(uint8_t clkRate);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          GET SPI CLOCK RATE
+ * 
+ * Description : Gets the current clock rate setting of the SPI port.
+ *
+ * Returns     : One of the SPI CLOCK RATES.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t spi_GetClockRate(void);
+
 /*
  * ----------------------------------------------------------------------------
  *                                                             SPI RECEIVE BYTE
@@ -81,4 +131,113 @@ uint8_t spi_MasterReceive(void);
  */
 void spi_MasterTransmit(uint8_t byte);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           SPI RECEIVE BLOCK
+ * 
+ * Description : Receives len bytes via the SPI port into buf. SPI_FILL_BYTE 
+ *               is sent for each byte received.
+ * 
+ * Arguments   : buf   - array the received bytes are loaded into. Must be at
+ *                       least len bytes.
+ *               len   - number of bytes to receive.
+ *
+ * Notes       : The transfer of each byte is started before the previously 
+ *               received byte is stored, so that the port is not idle while
+ *               the bytes are stored and the loop is maintained.
+ * ----------------------------------------------------------------------------
+ */
+void spi_ReceiveBlock(uint8_t buf[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SPI TRANSMIT BLOCK
+ * 
+ * Description : Sends len bytes from buf via the SPI port. Received bytes are
+ *               discarded.
+ * 
+ * Arguments   : buf   - array holding the bytes to send.
+ *               len   - number of bytes to send.
+ *
+ * Notes       : The next byte is loaded from buf while the previous byte is
+ *               being shifted out, so that it can be written to SPDR as soon
+ *               as the port is ready.
+ * ----------------------------------------------------------------------------
+ */
+void spi_TransmitBlock(const uint8_t buf[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              SPI SKIP BLOCK
+ * 
+ * Description : Receives len bytes via the SPI port without storing them.
+ *               SPI_FILL_BYTE is sent for each byte received.
+ * 
+ * Arguments   : len   - number of bytes to receive and discard.
+ *
+ * Notes       : Used to clock past the bytes of an SD card data block that 
+ *               are not needed. The received bytes are never read from SPDR,
+ *               so the next transfer is started as soon as the port is ready.
+ * ----------------------------------------------------------------------------
+ */
+void spi_SkipBlock(uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 SPI RECEIVE BLOCK WITH CRC16
+ * 
+ * Description : Same as spi_ReceiveBlock, but also calculates the CRC16-CCITT
+ *               (polynomial 0x1021) of the received bytes, e.g. to verify the
+ *               CRC of an SD card data block.
+ * 
+ * Arguments   : buf   - array the received bytes are loaded into. Must be at
+ *                       least len bytes.
+ *               len   - number of bytes to receive.
+ *               crc   - initial value of the CRC. 0 to begin a new CRC, or 
+ *                       the CRC returned for the previous part of the data, 
+ *                       if the data is received in parts.
+ * 
+ * Returns     : CRC16 of the len bytes received, continued from crc.
+ *
+ * Notes       : The CRC of each byte is calculated while the next byte is 
+ *               being shifted in, using a 16 entry nibble table.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t spi_ReceiveBlockCRC16(uint8_t buf[], uint16_t len, uint16_t crc);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    SPI SKIP BLOCK WITH CRC16
+ * 
+ * Description : Same as spi_SkipBlock, but the discarded bytes are added to
+ *               the CRC16-CCITT, so that the CRC of a data block can still be
+ *               checked when only part of it is stored.
+ * 
+ * Arguments   : len   - number of bytes to receive and discard.
+ *               crc   - initial value of the CRC, as for 
+ *                       spi_ReceiveBlockCRC16.
+ * 
+ * Returns     : CRC16 of the len bytes received, continued from crc.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t spi_SkipBlockCRC16(uint16_t len, uint16_t crc);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                SPI TRANSMIT BLOCK WITH CRC16
+ * 
+ * Description : Same as spi_TransmitBlock, but also calculates the 
+ *               CRC16-CCITT (polynomial 0x1021) of the bytes sent.
+ * 
+ * Arguments   : buf   - array holding the bytes to send.
+ *               len   - number of bytes to send.
+ * 
+ * Returns     : CRC16 of the len bytes sent, with an initial value of 0.
+ *
+ * Notes       : The CRC of each byte is calculated while the previous byte is
+ *               being shifted out.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t spi_TransmitBlockCRC16(const uint8_t buf[], uint16_t len);
+
 #endif  //SPI_H
@@ -26,6 +26,29 @@
 #define BAUD        9600U                        // decimal baud rate
 #define UBRR_VALUE  ((F_CPU) / 16 / (BAUD) - 1)  // calculate value for UBRR
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      TRANSMIT BUFFER LENGTH
+ *
+ * Description : Length of the transmit ring buffer. Bytes passed to 
+ *               usart_Write and usart_Transmit are loaded into this buffer and
+ *               sent by the USART Data Register Empty interrupt, so the caller
+ *               can continue, e.g. reading the next sector from a disk, while
+ *               the bytes are being sent.
+ *
+ * Notes       : 1) Must be a power of 2, no greater than 256.
+ *               2) Set to 0 to send each byte directly without interrupts, in
+ *                  which case usart_Write blocks until all bytes are sent.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef USART_TX_BUF_LEN
+#define USART_TX_BUF_LEN    64
+#endif//USART_TX_BUF_LEN
+
+#if USART_TX_BUF_LEN > 256 || (USART_TX_BUF_LEN & (USART_TX_BUF_LEN - 1))
+#error "USART_TX_BUF_LEN must be 0 or a power of 2 no greater than 256"
+#endif
+
 /*
  *******************************************************************************
  *                             FUNCTION PROTOTYPES
@@ -39,6 +62,9 @@
  * Description : Initializes USART0 of the ATMega target device.
  * 
  * Arguments   : void 
+ * 
+ * Notes       : If USART_TX_BUF_LEN is not 0, global interrupts are enabled,
+ *               as they are required to send the buffered bytes.
  * ----------------------------------------------------------------------------
  */
 void usart_Init(void);
@@ -65,8 +91,40 @@ uint8_t usart_Receive(void);
  * Description : Sends a byte to another device via the USART.
  * 
  * Arguments   : data   - byte to sent via USART.
+ * 
+ * Notes       : The byte is loaded into the transmit buffer. This only blocks
+ *               if the buffer is full, until there is room for the byte, so it
+ *               must not be called while interrupts are disabled.
  * ----------------------------------------------------------------------------
  */
 void usart_Transmit(uint8_t data);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 USART WRITE
+ *                                       
+ * Description : Loads as many bytes from an array as will fit into the 
+ *               transmit buffer, without waiting, to be sent via the USART.
+ * 
+ * Arguments   : data   - pointer to the array of bytes to send.
+ *               len    - number of bytes in data to send.
+ * 
+ * Returns     : Number of bytes loaded into the transmit buffer, which may be
+ *               less than len if the buffer became full. The remaining bytes
+ *               should be passed again.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t usart_Write(const uint8_t data[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 USART FLUSH
+ *                                       
+ * Description : Waits until all bytes in the transmit buffer have been sent.
+ * 
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+void usart_Flush(void);
+
 #endif //AVR_USART_H
@@ -190,6 +190,10 @@
 // Value in the last FAT cluster index of a directory or file.
 #define END_CLUSTER             0x0FFFFFFF
 
+// returned in place of a cluster index when the FAT sector holding the link 
+// could not be read. Cluster 1 is reserved, so this is never a valid link.
+#define FAILED_CLUS_INDX        0x00000001
+
 // value of the last char in std ASCII char set.
 #define LAST_STD_ASCII_CHAR     127  
 
@@ -199,15 +203,27 @@
 // unit used when printing an entry's file size. Set to BYTE or KB 
 #define FS_UNIT                 BYTE   
 
+// file sizes are right aligned to this many chars when printed, per FS_UNIT.
+#define FS_FIELD_WIDTH          ((FS_UNIT == KILO) ? 7 : 10)
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                              FAT ERROR FLAGS
  *
  * Description : Error Flags returned by various FAT functions.
+ *
+ * Notes       : NO_FREE_CLUSTER and NO_FREE_HANDLE are not single bits, since 
+ *               all of the bits are used, and so are never combined with
+ *               other flags.
  * ----------------------------------------------------------------------------
  */
 #define SUCCESS                0x00
 #define INVALID_NAME           0x01
+#define NO_FREE_CLUSTER        0x03
+#define NO_FREE_HANDLE         0x05
+#ifndef FAILED_WRITE_SECTOR     
+#define FAILED_WRITE_SECTOR    0x02 // also defined in fat_to_disk.h
+#endif//FAILED_WRITE_SECTOR
 #define FILE_NOT_FOUND         0x04
 #define DIR_NOT_FOUND          0x08
 #define END_OF_FILE            0x10
@@ -242,10 +258,22 @@
  *
  * Description : These values are used to specify the max length of strings and
  *               character arrays associated with long / short names and paths.             
+ *
+ * Notes       : 1) LN_STR_LEN_MAX sets the size of the lnStr members of FatDir
+ *                  and FatEntry. Entries with long names that do not fit can
+ *                  not be found by name, and are truncated when listed.
+ *               2) LN_STR_LEN_MAX must be large enough to hold a short name,
+ *                  as the short name is stored as lnStr if an entry does not
+ *                  have a long name.
  * ----------------------------------------------------------------------------
  */
+#ifndef PATH_STR_LEN_MAX
 #define PATH_STR_LEN_MAX     100       // max len of path string + null
+#endif//PATH_STR_LEN_MAX
+
+#ifndef LN_STR_LEN_MAX
 #define LN_STR_LEN_MAX       100       // max len of ln string + null
+#endif//LN_STR_LEN_MAX
 
 // for the 8.3 format of a short name.
 #define SN_NAME_CHAR_LEN       8       // max num chars in name of sn
@@ -254,6 +282,64 @@
 // + 1 for '.' short name / extension separator.
 #define SN_CHAR_LEN           SN_NAME_CHAR_LEN + SN_EXT_CHAR_LEN + 1      
 
+#if LN_STR_LEN_MAX < SN_CHAR_LEN + 1
+#error "LN_STR_LEN_MAX must be large enough to hold a short name"
+#endif
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                        STRUCT LAYOUT OPTIONS
+ *
+ * Description : Compile-time options that remove or shrink members of the 
+ *               FatDir and FatEntry structs to reduce their use of SRAM.
+ *
+ *               FAT_PATH_TRACKING - If 1 (default), a FatDir holds the names
+ *                                   and long / short name paths of its 
+ *                                   directory, about 310 bytes. If 0, the 
+ *                                   FatDir only holds the directory's first 
+ *                                   cluster index.
+ *               FAT_COMPACT_ENTRY - If 0 (default), a FatEntry also holds a
+ *                                   copy of the raw 32 byte short name entry,
+ *                                   snEnt. If 1, it only holds the decoded 
+ *                                   fields of the entry, see FatEntryFields.
+ *
+ * Notes       : The fields of a FatEntry should be read using the FAT ENTRY 
+ *               FIELD ACCESSORS below, which work with either layout.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_PATH_TRACKING
+#define FAT_PATH_TRACKING    1
+#endif//FAT_PATH_TRACKING
+
+#ifndef FAT_COMPACT_ENTRY
+#define FAT_COMPACT_ENTRY    0
+#endif//FAT_COMPACT_ENTRY
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                    FAT ENTRY FIELD ACCESSORS
+ *
+ * Description : Macros that return the value of a field of the short name
+ *               entry held by a FatEntry instance. ENT is a pointer to the 
+ *               FatEntry instance.
+ *
+ * Notes       : 1) The fields are decoded once, when the FatEntry is set to 
+ *                  the entry, so these only read the FatEntryFields member.
+ *               2) The date and time fields are returned as the 16-bit values
+ *                  stored in the entry. Use the CALC macros to decode them.
+ *               3) FAT_ENT_FST_CLUS_INDX returns 0 for the ".." entry of a 
+ *                  directory whose parent is the root directory.
+ * ----------------------------------------------------------------------------
+ */
+#define FAT_ENT_ATTR(ENT)               ((ENT)->fld.attr)
+#define FAT_ENT_FST_CLUS_INDX(ENT)      ((ENT)->fld.fstClusIndx)
+#define FAT_ENT_FILE_SIZE(ENT)          ((ENT)->fld.fileSize)
+#define FAT_ENT_CREATION_TIME(ENT)      ((ENT)->fld.crtTime)
+#define FAT_ENT_CREATION_DATE(ENT)      ((ENT)->fld.crtDate)
+#define FAT_ENT_LAST_ACCESS_DATE(ENT)   ((ENT)->fld.lstAccDate)
+#define FAT_ENT_WRITE_TIME(ENT)         ((ENT)->fld.wrtTime)
+#define FAT_ENT_WRITE_DATE(ENT)         ((ENT)->fld.wrtDate)
+
 /*
  ******************************************************************************     
  *                                 STRUCTS      
@@ -272,6 +358,8 @@
  *                  passing it to fat_SetDirToRoot.
  *               2) Most FAT functions require an instance of this struct to be
  *                  previously set and passed to it.
+ *               3) The name and path string members are only present if 
+ *                  FAT_PATH_TRACKING is set.
  * 
  * Warnings    : All members of an instance of this struct must correspond to
  *               the same valid FAT directory. If not, then unexpected results 
@@ -283,14 +371,38 @@
  */
 typedef struct
 {
+#if FAT_PATH_TRACKING
   char lnStr[LN_STR_LEN_MAX];          // directory long name
   char lnPathStr[PATH_STR_LEN_MAX];    // directory long name path
   char snStr[SN_NAME_CHAR_LEN + 1];    // directory short name. Add 1 for null
   char snPathStr[PATH_STR_LEN_MAX];    // directory short name path
+#endif//FAT_PATH_TRACKING
   uint32_t fstClusIndx;                // index of directory's first cluster
 } 
 FatDir;
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                      FAT ENTRY FIELDS STRUCT
+ *
+ * Description : The fields of a short name entry, decoded from its little 
+ *               endian bytes. Held by a FatEntry instance and read with the 
+ *               FAT ENTRY FIELD ACCESSORS.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint32_t fstClusIndx;                // first cluster index of the entry
+  uint32_t fileSize;                   // file size in bytes
+  uint16_t crtTime;                    // creation time
+  uint16_t crtDate;                    // creation date
+  uint16_t lstAccDate;                 // last access date
+  uint16_t wrtTime;                    // last modified (write) time
+  uint16_t wrtDate;                    // last modified (write) date
+  uint8_t  attr;                       // attribute byte
+}
+FatEntryFields;
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                             FAT ENTRY STRUCT
@@ -298,9 +410,14 @@ FatDir;
  * Description : Instances of this struct are used to locate entries within a 
  *               FAT directory.
  *       
- * Notes       : Any instance of this struct should first be initialized by
- *               passing it to fat_InitEntry, after which, fat_SetNextEntry
- *               should be the only function that updates the instance.
+ * Notes       : 1) Any instance of this struct should first be initialized
+ *                  by passing it to fat_InitEntry, after which, 
+ *                  fat_SetNextEntry should be the only function that updates
+ *                  the instance. Instances set by fat_NextDirEntry do not
+ *                  need to be initialized.
+ *               2) The raw short name entry, snEnt, is only held if 
+ *                  FAT_COMPACT_ENTRY is 0. Use the FAT ENTRY FIELD ACCESSORS
+ *                  to read the fields of the entry.
  * 
  * Warnings    : Members of an instance of this struct should never be set
  *               manually, but only by passing it to the FAT functions.
@@ -310,13 +427,71 @@ typedef struct
 {
   char lnStr[LN_STR_LEN_MAX];          // entry long name
   char snStr[SN_CHAR_LEN + 1];         // entry short name. Add 1 for null
+  FatEntryFields fld;                  // decoded fields of the sn entry
+#if !FAT_COMPACT_ENTRY
   uint8_t snEnt[ENTRY_LEN];            // the 32 bytes of the short name entry
+#endif//FAT_COMPACT_ENTRY
   uint32_t snEntClusIndx;              // cluster index of the sn entry
   uint8_t  snEntSecNumInClus;          // sector number in cluster of sn entry
   uint16_t nextEntPos;
 } 
 FatEntry;
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                FAT DIRECTORY ITERATOR STRUCT
+ *
+ * Description : Instances of this struct are used to step through the entries
+ *               of a directory. The iterator holds the directory sector that
+ *               it is currently in, so the disk is only read when it crosses
+ *               into the next sector or cluster of the directory.
+ *
+ * Members     : bpb            - The BPB of the volume the directory is on.
+ *               clusIndx       - FAT index of the current cluster of the 
+ *                                directory, or END_CLUSTER.
+ *               secNumInClus   - Number of the current sector in the cluster.
+ *               entPos         - Position in the current sector of the next
+ *                                entry to be checked.
+ *               secArr         - Sector pool buffer holding the current 
+ *                                sector, or NULL if it is not loaded yet.
+ *
+ * Notes       : 1) An instance must be set by fat_OpenDirIter and, when it is
+ *                  no longer needed, closed with fat_CloseDirIter.
+ *               2) While open, an iterator holds one buffer of the sector
+ *                  pool (see FAT_CACHE.H).
+ * 
+ * Warnings    : Members of an instance of this struct should never be set
+ *               manually, but only by passing it to the FAT functions.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  const BPB *bpb;
+  uint32_t clusIndx;
+  uint8_t  secNumInClus;
+  uint16_t entPos;
+  const uint8_t *secArr;
+}
+FatDirIter;
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        ENTRY HANDLER POINTER
+ *                                 
+ * Description : Pointer to a function that is called by fat_FindEntries for
+ *               each entry that matches its pattern and attribute mask.
+ * 
+ * Arguments   : ent          - Pointer to the FatEntry instance set to the
+ *                              matching entry.
+ *               handlerArg   - The handlerArg pointer that was passed to
+ *                              fat_FindEntries.
+ * 
+ * Returns     : SUCCESS to continue the search. Any other value ends the 
+ *               search and is returned by fat_FindEntries.
+ * ----------------------------------------------------------------------------
+ */
+typedef uint8_t (*EntryHandler)(const FatEntry *ent, void *handlerArg);
+
 /*
  ******************************************************************************
  *                           FUNCTION PROTOTYPES
@@ -365,10 +540,198 @@ void fat_InitEntry(FatEntry *ent, const BPB *bpb);
  *
  * Returns     : A FAT Error Flag. If any value other than SUCCESS is returned 
  *               then the function was unable to update the FatEntry.
+ *
+ * Notes       : Each call resumes from the entry's position in its directory.
+ *               To step through a whole directory use a FatDirIter instead,
+ *               which keeps its current sector between calls.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_SetNextEntry(FatEntry *currEntry, const BPB *bpb);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    OPEN A DIRECTORY ITERATOR
+ *                                      
+ * Description : Sets a FatDirIter instance to the first entry of a directory.
+ * 
+ * Arguments   : iter   - Pointer to the FatDirIter instance to be set.
+ *               dir    - Pointer to a FatDir instance. This is the directory
+ *                        whose entries will be iterated over.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : void
+ *
+ * Notes       : No sector is read until fat_NextDirEntry is called.
+ * ----------------------------------------------------------------------------
+ */
+void fat_OpenDirIter(FatDirIter *iter, const FatDir *dir, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         SET FAT ENTRY TO NEXT ITERATOR ENTRY
+ *                                      
+ * Description : Sets a FatEntry instance to the next entry of the directory
+ *               and advances the iterator past it.
+ * 
+ * Arguments   : iter   - Pointer to an open FatDirIter instance.
+ *               ent    - Pointer to the FatEntry instance that will be set
+ *                        to the next entry.
+ *
+ * Returns     : SUCCESS if ent was set to the next entry. END_OF_DIRECTORY if
+ *               there are no more entries, otherwise any other FAT Error Flag
+ *               returned while reading the directory.
+ *
+ * Notes       : 1) The sector holding the next entry is only read from the
+ *                  disk when the iterator moves into a new sector, so that
+ *                  listing a directory reads each of its sectors once.
+ *               2) ent is set as by fat_SetNextEntry, so it may afterwards be
+ *                  passed to fat_SetNextEntry or fat_FindNextEntry.
+ *               3) If an error is returned, the iterator should be closed.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_NextDirEntry(FatDirIter *iter, FatEntry *ent);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   CLOSE A DIRECTORY ITERATOR
+ *                                      
+ * Description : Closes a FatDirIter instance, returning the sector buffer it
+ *               holds to the sector pool.
+ * 
+ * Arguments   : iter   - Pointer to an open FatDirIter instance.
+ *
+ * Returns     : void
+ *
+ * Notes       : The iterator keeps its position. If it is passed to 
+ *               fat_NextDirEntry again, its sector is borrowed from the pool
+ *               again, and continues from the next entry.
+ * ----------------------------------------------------------------------------
+ */
+void fat_CloseDirIter(FatDirIter *iter);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              FIND NEXT ENTRY MATCHING A NAME
+ *                                      
+ * Description : Updates a FatEntry instance to point to the next entry in its
+ *               directory whose name matches nameStr.
+ * 
+ * Arguments   : currEnt   - Pointer to a FatEntry instance. Its members will 
+ *                           be updated to point to the matching entry. 
+ *               nameStr   - Pointer to a string. This is the name to find.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS if a matching entry was found. END_OF_DIRECTORY if 
+ *               there is no matching entry after currEnt, otherwise any other
+ *               FAT Error Flag returned while reading the directory.
+ * 
+ * Notes       : 1) This is equivalent to calling fat_SetNextEntry until the
+ *                  lnStr member of currEnt matches nameStr, but entries that
+ *                  cannot match are skipped without decoding their long name.
+ *                  Entries with a long name are rejected by their number of
+ *                  long name entries and by the characters in the first of 
+ *                  their long name entries. Entries without a long name are
+ *                  rejected by comparing their short name to the 8.3 form of
+ *                  nameStr.
+ *               2) nameStr must be a long name unless a long name for a given
+ *                  entry does not exist, in which case it must be a short 
+ *                  name. nameStr is case-sensitive.
+ *               3) As with fat_SetNextEntry, currEnt can be passed again to
+ *                  continue the search after the matching entry.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_FindNextEntry(FatEntry *currEnt, const char nameStr[], 
+                          const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                   FIND ENTRIES MATCHING A PATTERN AND FILTER
+ *                                      
+ * Description : Scans a directory once, calling entHandler for each entry 
+ *               whose name matches a wildcard pattern and whose attributes 
+ *               pass attrMask.
+ * 
+ * Arguments   : dir          - Pointer to a FatDir instance. This is the 
+ *                              directory that will be scanned.
+ *               patStr       - Pointer to the pattern string, or NULL to 
+ *                              match every name. See Notes.
+ *               attrMask     - The HIDDEN_ATTR, SYSTEM_ATTR, VOLUME_ID_ATTR
+ *                              and DIR_ENTRY_ATTR attributes an entry may 
+ *                              have. Entries with any of these attributes 
+ *                              that are not in attrMask are skipped. 
+ *               entHandler   - Pointer to the EntryHandler function called 
+ *                              for each matching entry.
+ *               handlerArg   - Passed to entHandler each time it is called.
+ *               bpb          - Pointer to the BPB struct instance.
+ *
+ * Returns     : END_OF_DIRECTORY if the whole directory was scanned. If 
+ *               entHandler returns a value other than SUCCESS, the scan stops
+ *               and that value is returned. Otherwise any other FAT Error Flag
+ *               returned while reading the directory.
+ * 
+ * Notes       : 1) '*' in the pattern matches any number of characters, and 
+ *                  '?' matches any single character, e.g. "*.LOG". An entry 
+ *                  matches if its long name or its short name matches. The
+ *                  comparison is case-sensitive.
+ *               2) Deleted entries, and entries rejected by attrMask, are 
+ *                  skipped on the raw entries in the directory sector, before
+ *                  their long names are loaded. With attrMask set to 0 only
+ *                  files that are not hidden or system files are returned, 
+ *                  and the long names of the other entries are never built.
+ *               3) The FatEntry passed to entHandler is only valid for the
+ *                  duration of the call. It is set as by fat_NextDirEntry.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_FindEntries(const FatDir *dir, const char patStr[], 
+                        uint8_t attrMask, EntryHandler entHandler,
+                        void *handlerArg, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        RESOLVE A PATH STRING
+ *                                      
+ * Description : Follows the path, pathStr, one component at a time and sets a
+ *               FatEntry instance to the entry of its last component.
+ * 
+ * Arguments   : dir       - Pointer to a FatDir instance. A relative path 
+ *                           begins at this directory.
+ *               pathStr   - Pointer to the path string.
+ *               ent       - Pointer to the FatEntry instance that will be set
+ *                           to the entry of the last component of the path.
+ *               pathDir   - Pointer to a FatDir instance that will be set to
+ *                           the directory holding the entry, or NULL.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, DIR_NOT_FOUND if any component other than the last 
+ *               is not a directory in the path, FILE_NOT_FOUND if the last 
+ *               component was not found, INVALID_NAME, or any other FAT Error
+ *               Flag returned while reading a directory.
+ * 
+ * Notes       : 1) A path beginning with '/' is absolute, otherwise it is
+ *                  relative to dir. Components are separated by '/', and may
+ *                  be "." or "..". The parent of the root directory is the 
+ *                  root directory.
+ *               2) Each component is found with fat_FindNextEntry, so only the
+ *                  directory sectors up to each matching entry are read, and
+ *                  components found in the directory entry cache are not read
+ *                  at all. The same FatEntry instance, ent, is used for every
+ *                  component.
+ *               3) The path strings of a FatDir are only built if pathDir is
+ *                  not NULL. pathDir may point to the same instance as dir. 
+ *                  If an error is returned then pathDir may have been set to
+ *                  any directory in the path.
+ *               4) If the path ends in a directory that is not found by an
+ *                  entry in its parent, e.g. "/", ".", or "dir/.", then ent is
+ *                  set to a "." entry of that directory. This entry has only
+ *                  the DIR_ENTRY_ATTR attribute and its first cluster index.
+ *               5) Names are case-sensitive, and must be a long name unless a
+ *                  long name for the entry does not exist, in which case it 
+ *                  must be a short name.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_ResolvePath(const FatDir *dir, const char pathStr[], FatEntry *ent,
+                        FatDir *pathDir, const BPB *bpb);
+
 /*
  * ----------------------------------------------------------------------------
  *                                                            SET FAT DIRECTORY
@@ -377,25 +740,28 @@ uint8_t fat_SetNextEntry(FatEntry *currEntry, const BPB *bpb);
  * 
  * Arguments   : dir         - Pointer to the FatDir instance to be set to the
  *                             new directory.             
- *               newDirStr   - Pointer to a string that specifies the name of 
+ *               newDirStr   - Pointer to a string that specifies the path of
  *                             the new directory.
  *               bpb         - Pointer to the BPB struct instance.
  * 
  * Returns     : A FAT Error Flag. If any value other than SUCCESS is returned 
- *               then the function was unable to update the FatEntry. 
+ *               then the function was unable to update the FatDir. 
+ *               DIR_NOT_FOUND is returned if the path does not lead to a
+ *               directory.
  *  
- * Notes       : 1) This function can only set the directory to a child or the
- *                  parent of the FatDir instance (dir) when the function is
- *                  called, or reset the instance to the root directory.
- *               2) Paths (relative or absolute) should not be included in the 
- *                  newDirStr. newDirStr must be only be a directory name which
- *                  must be the name of a child, or the parent, directory of
- *                  the current directory.
- *               3) If ".." is passed as the newDirStr then the new directory
- *                  will be set to the parent of the current directory.               
+ * Notes       : 1) newDirStr can be a directory name, or a relative or 
+ *                  absolute path, e.g. "../docs" or "/docs/2021". See 
+ *                  fat_ResolvePath.
+ *               2) If ".." is passed as the newDirStr then the new directory
+ *                  will be set to the parent of the current directory.
+ *               3) If "~" is passed as the newDirStr then the new directory
+ *                  will be set to the root directory.
  *               4) newDirStr is case-sensitive.
- *               5) newDirStr must be a long name, unless a long name does not
- *                  exist for a directory, only then can it be a short name.
+ *               5) Each name in newDirStr must be a long name, unless a long
+ *                  name does not exist for a directory, only then can it be a
+ *                  short name.
+ *               6) dir is unchanged if any value other than SUCCESS is
+ *                  returned.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_SetDir(FatDir *dir, const char newDirStr[], const BPB *bpb);
@@ -436,17 +802,18 @@ uint8_t fat_PrintDir(const FatDir *dir, uint8_t entFlds, const BPB *bpb);
  *                                       
  * Description : Prints the contents of any file entry to the screen. 
  * 
- * Arguments   : dir        - Pointer to a FatDir instance. This directory must
- *                            contain the entry for the file to be printed.
- *               fileStr    - Pointer to a string. This is the name of the file
- *                            who's contents will be printed.
+ * Arguments   : dir        - Pointer to a FatDir instance. A relative path in
+ *                            fileStr begins at this directory.
+ *               fileStr    - Pointer to a string. This is the name, or path, 
+ *                            of the file who's contents will be printed.
  *               bpb        - Pointer to the BPB struct instance.
  *
  * Returns     : FAT Error Flag. If any value other than END_OF_FILE is 
  *               returned, then an issue has occurred.
  *  
- * Notes       : fileStr must be a long name unless a long name for a given
- *               entry does not exist, in which case it must be a short name.
+ * Notes       : Each name in fileStr must be a long name unless a long name 
+ *               for a given entry does not exist, in which case it must be a 
+ *               short name. See fat_ResolvePath.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_PrintFile(const FatDir *dir, const char fileStr[], const BPB *bpb);
@@ -50,6 +50,7 @@
 #define BPB_NOT_FOUND                   0x10
 #define BPB_VALID                       0x20
 #define FAILED_READ_BPB                 0x40
+#define INVALID_BPB_SNAPSHOT            0x80
 
 /* 
  * ----------------------------------------------------------------------------
@@ -65,6 +66,10 @@
 #define RSVD_SEC_CNT_POS_LSB   14
 #define RSVD_SEC_CNT_POS_MSB   15
 #define NUM_FATS_POS           16
+#define TOT_SEC32_POS1         32
+#define TOT_SEC32_POS2         33
+#define TOT_SEC32_POS3         34
+#define TOT_SEC32_POS4         35
 #define FAT32_SIZE_POS1        36
 #define FAT32_SIZE_POS2        37
 #define FAT32_SIZE_POS3        38
@@ -73,8 +78,33 @@
 #define ROOT_CLUS_POS2         45
 #define ROOT_CLUS_POS3         46
 #define ROOT_CLUS_POS4         47
+#define FS_INFO_POS_LSB        48
+#define FS_INFO_POS_MSB        49
+#define VOL_ID_POS             67           // 4 bytes, little endian
 
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                   FSINFO SECTOR FIELD VALUES
+ *
+ * Description : Positions of the fields of the FSInfo sector, and the values
+ *               of its signatures. The FSInfo sector holds the last known 
+ *               count of free clusters and the index of a cluster to begin 
+ *               searching for a free cluster at.
+ *
+ * Notes       : FSI_UNKNOWN in either field means the value is not known.
+ * ----------------------------------------------------------------------------
+ */
+#define FSI_LEAD_SIG_POS       0
+#define FSI_STRUC_SIG_POS      484
+#define FSI_FREE_COUNT_POS     488
+#define FSI_NXT_FREE_POS       492
+#define FSI_TRAIL_SIG_POS      508
+#define FSI_LEAD_SIG           0x41615252
+#define FSI_STRUC_SIG          0x61417272
+#define FSI_TRAIL_SIG          0xAA550000
+#define FSI_UNKNOWN            0xFFFFFFFF
+
 // Returns True if Sectors Per Cluster is a valid value and false otherwise.
 #define CHK_VLD_SEC_PER_CLUS(SPC)  ((SPC == 1)  || (SPC == 2)  || (SPC == 4)  \
                                  || (SPC == 8)  || (SPC == 16) || (SPC == 32) \
@@ -93,8 +123,15 @@
  * Description : The members of this struct correspond to the Bios Parameter 
  *               Block fields needed by this module.
  * 
- * Notes       : dataRegionFirstSector is not a BPB field is a value calculated
- *               from the BPB values that is used frequently.
+ * Notes       : 1) dataRegionFirstSector and clusCnt are not BPB fields but
+ *                  are values calculated from the BPB values that are used 
+ *                  frequently. clusCnt is the number of clusters in the Data
+ *                  Region, so valid cluster indices are 2 to clusCnt + 1.
+ *               2) fsInfoSecNum is the address on the disk of the FSInfo
+ *                  sector, or 0 if the volume does not have one.
+ *               3) volId is the volume serial number, set when the volume is
+ *                  formatted. It is used to check that a BPBSnapshot is of 
+ *                  the volume on the disk.
  * ----------------------------------------------------------------------------
  */
 typedef struct
@@ -106,9 +143,37 @@ typedef struct
   uint32_t fatSize32;
   uint32_t rootClus;
   uint32_t dataRegionFirstSector;
+  uint32_t clusCnt;
+  uint32_t fsInfoSecNum;
+  uint32_t volId;
 } 
 BPB;
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                          BPB SNAPSHOT STRUCT
+ *
+ * Description : A copy of a BPB struct instance, with the address of the boot
+ *               sector and a checksum, that can be kept in non-volatile 
+ *               memory, e.g. EEPROM, so that a volume can be mounted again
+ *               without locating and loading its boot sector.
+ * 
+ * Members     : bpb           - The BPB struct instance of the volume.
+ *               bootSecAddr   - Address of the volume's boot sector.
+ *               chkSum        - Checksum of the other members.
+ *
+ * Notes       : An instance should only be set by fat_SaveBPB and read by
+ *               fat_RestoreBPB.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  BPB      bpb;
+  uint32_t bootSecAddr;
+  uint16_t chkSum;
+}
+BPBSnapshot;
+
 /*
  ******************************************************************************
  *                             FUNCTION PROTOTYPES      
@@ -130,12 +195,15 @@ BPB;
  *               returned then setting the BPB instance failed. To print, pass
  *               the returned value to fat_PrintErrorBPB().
  * 
- * Notes       : A valid BPB struct instance is a required argument of many 
- *               functions that access the FAT volume, therefore this function 
- *               should be called first, before implementing any other parts of
- *               the FAT module.
+ * Notes       : 1) A valid BPB struct instance is a required argument of many
+ *                  functions that access the FAT volume, therefore this 
+ *                  function should be called first, before implementing any
+ *                  other parts of the FAT module.
+ *               2) The free cluster count and next free cluster hint are 
+ *                  read from the FSInfo sector and passed to fat_InitAlloc.
+ *                  A missing or invalid FSInfo sector does not fail the 
+ *                  mount, the values are then unknown.
  * 
- * Limitation  : Currently will only work if Boot Sector is block 0 on SD Card.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_SetBPB(BPB *bpb);
@@ -153,4 +221,51 @@ uint8_t fat_SetBPB(BPB *bpb);
  */
 void fat_PrintErrorBPB(uint8_t err);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SAVE A BPB SNAPSHOT
+ *
+ * Description : Sets a BPBSnapshot instance from a valid BPB struct instance.
+ * 
+ * Arguments   : bpb    - Pointer to a BPB struct instance set by fat_SetBPB.
+ *               snap   - Pointer to the BPBSnapshot instance to set.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : The snapshot is only set in SRAM. It is for the caller to 
+ *               copy it to non-volatile memory, e.g. with eeprom_update_block.
+ * ----------------------------------------------------------------------------
+ */
+void fat_SaveBPB(const BPB *bpb, BPBSnapshot *snap);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  RESTORE BPB FROM A SNAPSHOT
+ *
+ * Description : Sets a BPB struct instance from a BPBSnapshot instance if the
+ *               snapshot is of the volume on the disk. This replaces 
+ *               fat_SetBPB when the volume is mounted again, e.g. after the
+ *               device has been powered down.
+ * 
+ * Arguments   : bpb    - Pointer to the BPB struct instance to set.
+ *               snap   - Pointer to a BPBSnapshot instance, e.g. read from
+ *                        EEPROM, that was set by fat_SaveBPB.
+ * 
+ * Returns     : BPB_VALID if the BPB instance was set, FAILED_READ_BPB, or 
+ *               INVALID_BPB_SNAPSHOT if the checksum of the snapshot is not
+ *               valid or the serial number of the volume is not that of the 
+ *               snapshot. If BPB_VALID is not returned, fat_SetBPB should be
+ *               used to set the BPB instance.
+ * 
+ * Notes       : 1) Only the boot sector at the address in the snapshot, to
+ *                  check the volume serial number, and the FSInfo sector are
+ *                  read from the disk. 
+ *               2) The disk's parameters, e.g. the SD card addressing mode, 
+ *                  are not determined again by FATtoDisk_FindBootSector. If 
+ *                  the disk may have been replaced without the device being 
+ *                  reset, fat_SetBPB should be used.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_RestoreBPB(BPB *bpb, const BPBSnapshot *snap);
+
 #endif // FAT_BPB_H
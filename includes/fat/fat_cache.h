@@ -0,0 +1,697 @@
+/*
+ * File       : FAT_CACHE.H
+ * Version    : 2.0
+ * Target     : ATMega1280
+ * Compiler   : AVR-GCC 9.3.0
+ * Downloader : AVRDUDE 6.3
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for the sector pool and the directory entry cache. The sector pool
+ * is a fixed set of statically allocated sector buffers that is shared by all
+ * of the FAT module's functions in place of sector arrays on the stack. Each
+ * buffer is tagged with the disk sector it holds, so that a sector that is
+ * requested again, e.g. a FAT sector while following a cluster chain, or a
+ * directory sector on the next call to fat_SetNextEntry, is returned from the
+ * pool without being read from the disk. The directory entry cache holds
+ * recently found directory entries so that looking up the same name in the
+ * same directory again does not require the directory to be read.
+ */
+
+#ifndef FAT_CACHE_H
+#define FAT_CACHE_H
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      SECTOR POOL SLOT COUNT
+ *
+ * Description : The number of sector buffers in the sector pool.
+ *
+ * Notes       : 1) Each slot requires SECTOR_LEN + 8 bytes of SRAM. This is
+ *                  the only SRAM used by the FAT module for sector buffers,
+ *                  so peak stack use does not depend on the sector size.
+ *               2) At most two buffers are held at one time by the FAT 
+ *                  functions, e.g. by fat_SetNextEntry when a long name
+ *                  crosses a sector boundary, so this must be at least 2.
+ *                  Each FatDirIter that is left open by the caller holds one
+ *                  more. Additional slots keep more recently used sectors, 
+ *                  such as FAT and directory sectors, in the pool. Must be 
+ *                  less than 255.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_SEC_POOL_SLOTS
+#define FAT_SEC_POOL_SLOTS              4
+#endif//FAT_SEC_POOL_SLOTS
+
+#if FAT_SEC_POOL_SLOTS < 2
+#error "FAT_SEC_POOL_SLOTS must be at least 2"
+#endif
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  DIRECTORY CACHE SLOT COUNT
+ *
+ * Description : The number of directory entries that can be held in the 
+ *               directory entry cache at one time.
+ *
+ * Notes       : 1) Each slot requires sizeof(FatDirCacheEntry), 46 bytes 
+ *                  plus FAT_DIR_CACHE_NAME_LEN, of SRAM.
+ *               2) Set to 0 to remove the directory entry cache. Must be less
+ *                  than 255.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_DIR_CACHE_SLOTS
+#define FAT_DIR_CACHE_SLOTS             4
+#endif//FAT_DIR_CACHE_SLOTS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 DIRECTORY CACHE NAME LENGTH
+ *
+ * Description : The longest name that is held in a slot of the directory 
+ *               entry cache. Entries found by a longer name are not cached.
+ *
+ * Notes       : The name is stored in the slot, so that a cached entry is 
+ *               only returned for the exact name it was found by.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_DIR_CACHE_NAME_LEN
+#define FAT_DIR_CACHE_NAME_LEN          31
+#endif//FAT_DIR_CACHE_NAME_LEN
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  FULL REGION MAP BYTE COUNT
+ *
+ * Description : Number of bytes of the map used by the cluster allocator to
+ *               record which regions of the FAT hold no free clusters.
+ *
+ * Notes       : 1) Each bit of the map covers an equal region of the FAT, so
+ *                  that the whole FAT is covered by FAT_FREE_MAP_LEN * 8 bits.
+ *                  A bit is set the first time its region is searched without
+ *                  finding a free cluster, and is cleared when a cluster of
+ *                  the region is freed. The free cluster search skips over 
+ *                  the regions that are set, so the full part of the FAT is
+ *                  only read the first time it is searched.
+ *               2) Set to 0 to remove the map. Uses FAT_FREE_MAP_LEN bytes of
+ *                  SRAM.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_FREE_MAP_LEN
+#define FAT_FREE_MAP_LEN                32
+#endif//FAT_FREE_MAP_LEN
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    CLUSTER LINK RANGE READS
+ *
+ * Description : Set to 1 so that fat_GetNextClusIndex only reads the 4 bytes
+ *               of a cluster link from the disk, with fat_GetSectorBytes, 
+ *               when its FAT sector is not in the sector pool, instead of 
+ *               loading the FAT sector into the pool.
+ *
+ * Notes       : 1) Suits builds with a small FAT_SEC_POOL_SLOTS, where the FAT
+ *                  sector would replace the directory or file sector that is 
+ *                  being read.
+ *               2) The FAT sector is then never pooled by fat_GetNextClusIndex
+ *                  so each link of a chain whose FAT sector is not otherwise 
+ *                  pooled is a separate disk read.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_LINK_RANGE_READ
+#define FAT_LINK_RANGE_READ             0
+#endif//FAT_LINK_RANGE_READ
+
+// pass to fat_InvalidateDirCache to invalidate entries of all directories.
+#define DIR_CACHE_ALL                   0xFFFFFFFF
+
+/*
+ ******************************************************************************
+ *                                 STRUCTS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                DIRECTORY CACHE ENTRY STRUCT
+ *
+ * Description : A single slot of the directory entry cache. Holds the short 
+ *               name entry of a directory entry that was found by name, and
+ *               the entry's location in its directory.
+ *
+ * Members     : dirClusIndx         - First cluster index of the directory 
+ *                                     that holds the entry.
+ *               nameStr             - The name the entry was found by.
+ *               snEnt               - The 32 bytes of the short name entry. 
+ *                                     This holds the entry's attributes, 
+ *                                     first cluster index and size.
+ *               snEntClusIndx       - Cluster index of the sn entry.
+ *               snEntSecNumInClus   - Sector number in cluster of sn entry.
+ *               snEntPos            - Position of the sn entry in its sector.
+ *               lastUse             - Used to find least recently used slot.
+ *               valid               - 1 if the slot holds an entry.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint32_t dirClusIndx;
+  char     nameStr[FAT_DIR_CACHE_NAME_LEN + 1];
+  uint8_t  snEnt[ENTRY_LEN];
+  uint32_t snEntClusIndx;
+  uint8_t  snEntSecNumInClus;
+  uint16_t snEntPos;
+  uint8_t  lastUse;
+  uint8_t  valid;
+}
+FatDirCacheEntry;
+
+/*
+ ******************************************************************************
+ *                             FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               BORROW A SECTOR FROM THE POOL
+ *
+ * Description : Returns a pointer to a sector pool buffer holding the contents
+ *               of the disk sector at secNum. If the sector is not already in
+ *               the pool, it is read from the disk into an empty or the least
+ *               recently used unlocked slot.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *
+ * Returns     : Pointer to the buffer holding the sector, or NULL if the 
+ *               sector could not be read from the disk or all slots are 
+ *               locked.
+ *
+ * Notes       : 1) The buffer is locked until it is returned to the pool with
+ *                  fat_ReleaseSector, which must be called once for each
+ *                  successful call to this function.
+ *               2) The buffer holds a copy of the sector. If the borrower
+ *                  modifies it, it must call fat_MarkSectorDirty before the
+ *                  buffer is released so that the change is written back.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_GetSector(uint32_t secNum);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         BORROW A BLANK SECTOR FROM THE POOL
+ *
+ * Description : Returns a pointer to a sector pool buffer that is tagged with
+ *               the sector at secNum, but is filled with zeros instead of 
+ *               being read from the disk.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *
+ * Returns     : Pointer to the buffer, or NULL if all slots are locked.
+ *
+ * Notes       : 1) Used when a sector is about to be written whose contents
+ *                  on the disk are not needed, e.g. the next sector past the
+ *                  end of a file being appended to, so that it is not read.
+ *               2) As for fat_GetSector, the buffer must be released with 
+ *                  fat_ReleaseSector, and marked dirty if it is to be written.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_GetBlankSector(uint32_t secNum);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               BORROW A BUFFER FROM THE POOL
+ *
+ * Description : Returns a pointer to a sector pool buffer that is not tagged
+ *               with a sector, for use as a scratch buffer.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Pointer to the buffer, or NULL if all slots are locked.
+ *
+ * Notes       : 1) The buffer is SECTOR_LEN bytes and is locked until it is
+ *                  returned to the pool with fat_ReleaseSector.
+ *               2) Used where sectors are streamed through a buffer, e.g. by
+ *                  FATtoDisk_ReadMultipleSectors, and so will not be 
+ *                  requested again.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_GetSectorBuffer(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        BORROW A SECTOR ONLY IF IT IS POOLED
+ *
+ * Description : Returns a pointer to the sector pool buffer holding the disk
+ *               sector at secNum, if the sector is in the pool. Unlike 
+ *               fat_GetSector, the sector is never read from the disk.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *
+ * Returns     : Pointer to the buffer holding the sector, or NULL if the 
+ *               sector is not in the pool.
+ *
+ * Notes       : Used by the async file read, which can not wait for a sector
+ *               to be read by fat_GetSector. As for fat_GetSector, the buffer
+ *               must be released with fat_ReleaseSector.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_FindPooledSector(uint32_t secNum);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               TAG A BORROWED SCRATCH BUFFER
+ *
+ * Description : Tags a buffer returned by fat_GetSectorBuffer with the disk
+ *               sector at secNum, after the sector has been loaded into it, 
+ *               so that it stays in the pool when the buffer is released.
+ *
+ * Arguments   : secArr   - Pointer returned by fat_GetSectorBuffer, holding 
+ *                          the contents of the sector at secNum.
+ *               secNum   - Address of the sector on the disk.
+ *
+ * Returns     : void
+ *
+ * Notes       : Used when a sector is read into a scratch buffer without 
+ *               going through fat_GetSector, e.g. by an async read. If the 
+ *               sector is already in another slot, the buffer is not tagged.
+ * ----------------------------------------------------------------------------
+ */
+void fat_TagSectorBuffer(const uint8_t secArr[], uint32_t secNum);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           COPY A RANGE OF BYTES OF A SECTOR
+ *
+ * Description : Loads len bytes, beginning at offset, of the disk sector at
+ *               secNum into buf. The bytes are copied from the sector pool if
+ *               the sector is pooled, otherwise only the range is read from 
+ *               the disk with FATtoDisk_ReadSectorRange.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *               offset   - Position in the sector of the first byte to load.
+ *               len      - Number of bytes to load. offset + len must not be
+ *                          greater than SECTOR_LEN.
+ *               buf      - Pointer to the array that will be loaded with the
+ *                          len bytes.
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ *
+ * Notes       : No slot of the pool is used when the sector is not pooled, so
+ *               this does not replace any pooled sector, and the sector is 
+ *               not pooled afterwards.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_GetSectorBytes(uint32_t secNum, uint16_t offset, uint16_t len,
+                           uint8_t buf[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        RETURN A BORROWED BUFFER TO THE POOL
+ *
+ * Description : Releases a buffer returned by fat_GetSector or 
+ *               fat_GetSectorBuffer so that its slot can be reused.
+ *
+ * Arguments   : secArr   - Pointer returned by fat_GetSector or 
+ *                          fat_GetSectorBuffer.
+ *
+ * Returns     : void
+ *
+ * Notes       : A sector returned by fat_GetSector stays in the pool after it
+ *               is released, until its slot is reused for another sector.
+ * ----------------------------------------------------------------------------
+ */
+void fat_ReleaseSector(const uint8_t secArr[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  INVALIDATE THE SECTOR POOL
+ *
+ * Description : Marks all slots of the sector pool as empty and unlocked.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ *
+ * Notes       : 1) This is called by fat_SetBPB when a volume is mounted, so
+ *                  that sectors pooled from a previously mounted volume are 
+ *                  not used.
+ *               2) Dirty sectors are discarded without being written. Call
+ *                  fat_SyncSecPool first to keep the changes.
+ * ----------------------------------------------------------------------------
+ */
+void fat_InvalidateSecPool(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               INVALIDATE A RANGE OF SECTORS
+ *
+ * Description : Removes any of the secCnt sectors beginning at fstSecNum from
+ *               the sector pool.
+ *
+ * Arguments   : fstSecNum   - Address of the first sector of the range.
+ *               secCnt      - Number of sectors in the range.
+ *
+ * Returns     : void
+ *
+ * Notes       : This must be called before sectors are written to the disk 
+ *               without going through the pool, e.g. with 
+ *               FATtoDisk_WriteMultipleSectors, so that a pooled copy of a
+ *               sector is not returned, or written back, in place of the 
+ *               sector that was written.
+ * ----------------------------------------------------------------------------
+ */
+void fat_InvalidateSectors(uint32_t fstSecNum, uint32_t secCnt);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  MARK A POOLED SECTOR DIRTY
+ *
+ * Description : Marks the sector held in a buffer returned by fat_GetSector
+ *               as modified, so that it is written back to the disk before
+ *               its slot is reused, or by fat_SyncSecPool.
+ *
+ * Arguments   : secArr   - Pointer returned by fat_GetSector.
+ *
+ * Returns     : void
+ *
+ * Notes       : Buffers returned by fat_GetSectorBuffer are not tagged with a
+ *               sector and cannot be marked dirty.
+ * ----------------------------------------------------------------------------
+ */
+void fat_MarkSectorDirty(const uint8_t secArr[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                            WRITE DIRTY SECTORS BACK TO DISK
+ *
+ * Description : Writes every dirty sector of the sector pool to the disk. A
+ *               dirty FAT sector is written to each copy of the FAT.
+ *
+ * Arguments   : void
+ *
+ * Returns     : SUCCESS or FAILED_WRITE_SECTOR.
+ *
+ * Notes       : 1) Sectors stay in the pool, clean, after they are written.
+ *               2) Until this is called, changes made to pooled sectors only
+ *                  reach the disk when their slot is reused. It should be 
+ *                  called at points where the volume must be consistent on 
+ *                  the disk, e.g. when a file being written is closed.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SyncSecPool(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           GET THE INDEX OF THE NEXT CLUSTER
+ *
+ * Description : Finds and returns the FAT index of the cluster that follows
+ *               clusIndx in its cluster chain. The FAT sector holding the
+ *               index is borrowed from the sector pool, so it is only read
+ *               from the disk if it is not already in the pool.
+ *
+ * Arguments   : clusIndx    - The current cluster's FAT index.
+ *               bpb         - Pointer to the BPB struct instance.
+ *
+ * Returns     : A file or dir's next FAT cluster index. If END_CLUSTER is
+ *               returned, the current cluster is the last of the file or dir.
+ *
+ * Notes       : 1) The returned value locates the index in the FAT. The index
+ *                  is offset (typically by -2) from the actual cluster number
+ *                  in the data region.
+ *               2) If the FAT sector could not be read from the disk then
+ *                  FAILED_CLUS_INDX is returned, so that a failed read is not
+ *                  taken for the end of the chain. Callers should then return
+ *                  FAILED_READ_SECTOR.
+ *               3) If FAT_LINK_RANGE_READ is set, only the link is read when
+ *                  the FAT sector is not pooled. See fat_GetSectorBytes.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_GetNextClusIndex(uint32_t clusIndx, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           SET THE INDEX OF THE NEXT CLUSTER
+ *
+ * Description : Links the cluster at clusIndx to nextClusIndx by setting its
+ *               entry in the FAT. The entry is only set in the pooled FAT
+ *               sector, which is marked dirty, and is written to each copy of
+ *               the FAT when the sector is written back.
+ *
+ * Arguments   : clusIndx       - FAT index of the cluster to link.
+ *               nextClusIndx   - FAT index of the cluster that will follow 
+ *                                clusIndx, or END_CLUSTER.
+ *               bpb            - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ *
+ * Notes       : 1) Links that fall in the same FAT sector are batched in the
+ *                  pooled sector, so allocating a chain of clusters costs one
+ *                  write per FAT sector and FAT copy, made when the sector is
+ *                  written back, instead of one per link. 
+ *               2) The reserved upper 4 bits of the FAT32 entry are kept.
+ *               3) Pass 0 as nextClusIndx to mark the cluster free.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SetNextClusIndex(uint32_t clusIndx, uint32_t nextClusIndx,
+                             const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                            GET A RUN OF CONTIGUOUS CLUSTERS
+ *
+ * Description : Follows the cluster chain beginning at fstClusIndx for as long
+ *               as each cluster is linked to the cluster that physically
+ *               follows it, up to maxCnt clusters, and returns the number of
+ *               clusters in this run.
+ *
+ * Arguments   : fstClusIndx    - FAT index of the first cluster of the run.
+ *               nextClusIndx   - Pointer to a uint32_t that will be set to
+ *                                the FAT index of the cluster that follows 
+ *                                the run, i.e. the first cluster of the next
+ *                                run, END_CLUSTER, or FAILED_CLUS_INDX if a 
+ *                                FAT sector could not be read.
+ *               maxCnt         - Maximum number of clusters to return. Must 
+ *                                be at least 1.
+ *               bpb            - Pointer to the BPB struct instance.
+ *
+ * Returns     : Number of clusters in the run. This is always at least 1.
+ *
+ * Notes       : 1) The links are scanned directly in the pooled FAT sector, so
+ *                  a run of up to 128 clusters costs at most one FAT sector
+ *                  read, rather than one lookup per cluster.
+ *               2) The sectors of the run are consecutive on the disk and can
+ *                  therefore be read with FATtoDisk_ReadMultipleSectors.
+ *               3) If a FAT sector could not be read, the run ends there and
+ *                  nextClusIndx is set to FAILED_CLUS_INDX.
+ *               4) The scan stops once maxCnt clusters have been counted, so
+ *                  a caller that only needs the next few clusters does not 
+ *                  scan the rest of a long run. nextClusIndx is then the 
+ *                  cluster that follows the last one returned, which may be
+ *                  the next cluster of the same run.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_GetClusRun(uint32_t fstClusIndx, uint32_t *nextClusIndx,
+                        uint32_t maxCnt, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 FIND A RUN OF FREE CLUSTERS
+ *
+ * Description : Searches the FAT, beginning at startClusIndx, for a run of 
+ *               up to maxCnt contiguous free clusters.
+ *
+ * Arguments   : startClusIndx   - FAT index of the cluster the search begins
+ *                                 at. The search wraps around to cluster 2
+ *                                 at the end of the FAT.
+ *               maxCnt          - Number of clusters wanted. Must be at 
+ *                                 least 1.
+ *               runCnt          - Pointer to a uint32_t that will be set to
+ *                                 the number of clusters in the run found.
+ *               bpb             - Pointer to the BPB struct instance.
+ *
+ * Returns     : FAT index of the first cluster of the run, END_CLUSTER if
+ *               there are no free clusters, or FAILED_CLUS_INDX if a FAT 
+ *               sector could not be read.
+ *
+ * Notes       : 1) The run begins at the first free cluster found, and so may
+ *                  be shorter than maxCnt, so that the search ends as soon as
+ *                  a free cluster is found.
+ *               2) The clusters are not marked as used in the FAT. They must
+ *                  be linked with fat_SetNextClusIndex to be allocated.
+ *               3) Regions of the FAT that are set in the full region map 
+ *                  are skipped, and regions found to be full are set. See 
+ *                  FAT_FREE_MAP_LEN.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_FindFreeRun(uint32_t startClusIndx, uint32_t maxCnt,
+                         uint32_t *runCnt, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                            INITIALIZE THE CLUSTER ALLOCATOR
+ *
+ * Description : Sets the free cluster count and next free cluster hint of the
+ *               cluster allocator for a newly mounted volume, and clears the
+ *               map of full FAT regions.
+ *
+ * Arguments   : freeCnt    - Free cluster count from the FSInfo sector, or
+ *                            FSI_UNKNOWN.
+ *               nextFree   - Next free cluster hint from the FSInfo sector, 
+ *                            or FSI_UNKNOWN.
+ *               bpb        - Pointer to the BPB struct instance.
+ *
+ * Returns     : void
+ *
+ * Notes       : This is called by fat_SetBPB with the values read from the
+ *               FSInfo sector.
+ * ----------------------------------------------------------------------------
+ */
+void fat_InitAlloc(uint32_t freeCnt, uint32_t nextFree, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  ALLOCATE A RUN OF CLUSTERS
+ *
+ * Description : Hands out a run of up to maxCnt contiguous free clusters. If
+ *               the cluster at prefClusIndx is free the run begins there,
+ *               otherwise the search begins at the next free cluster hint.
+ *
+ * Arguments   : prefClusIndx   - FAT index of the cluster the run should 
+ *                                begin at, e.g. the cluster following the
+ *                                last cluster of a file, or 0 for none.
+ *               maxCnt         - Number of clusters wanted. Must be at 
+ *                                least 1.
+ *               runCnt         - Pointer to a uint32_t that will be set to
+ *                                the number of clusters in the run.
+ *               bpb            - Pointer to the BPB struct instance.
+ *
+ * Returns     : FAT index of the first cluster of the run, END_CLUSTER if
+ *               there are no free clusters, or FAILED_CLUS_INDX if a FAT 
+ *               sector could not be read.
+ *
+ * Notes       : 1) The hint is moved past the run, so the next call does not
+ *                  hand out the same clusters even though they are not marked
+ *                  in the FAT until they are linked with fat_SetNextClusIndex.
+ *               2) With the hint from the FSInfo sector, the first allocation
+ *                  on a nearly full volume begins at the end of the used part
+ *                  of the FAT, instead of scanning it from the start.
+ *               3) The free cluster count is not changed when a run is handed
+ *                  out. It is changed by fat_SetNextClusIndex as clusters are
+ *                  linked or freed. The count from the FSInfo
+ *                  sector is only a hint, so the FAT is searched even if it
+ *                  is 0. It is set to 0 when the search finds no free 
+ *                  cluster, and a count of 0 is set to FSI_UNKNOWN when one
+ *                  is found.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_AllocRun(uint32_t prefClusIndx, uint32_t maxCnt, 
+                      uint32_t *runCnt, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  GET THE FREE CLUSTER COUNT
+ *
+ * Description : Returns the number of free clusters on the volume.
+ *
+ * Arguments   : void
+ *
+ * Returns     : The count of free clusters, or FSI_UNKNOWN if not known.
+ *
+ * Notes       : The count is read from the FSInfo sector when the volume is 
+ *               mounted and is not checked against the FAT.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_GetFreeClusCnt(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    UPDATE THE FSINFO SECTOR
+ *
+ * Description : Sets the free cluster count and next free cluster fields of
+ *               the pooled FSInfo sector, if they have changed, and marks it
+ *               dirty.
+ *
+ * Arguments   : void
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ *
+ * Notes       : The sector is written to the disk by fat_SyncSecPool. Since 
+ *               the FSInfo fields are only hints, this need not be called on
+ *               every sync, e.g. FAT_LOG only calls it when a log is closed.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SyncFSInfo(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  FIND DIRECTORY CACHE ENTRY
+ *
+ * Description : Searches the directory entry cache for an entry that was 
+ *               found by the name, nameStr, in the directory whose first
+ *               cluster index is dirClusIndx.
+ *
+ * Arguments   : dirClusIndx   - First cluster index of the directory.
+ *               nameStr       - Pointer to the name string.
+ *
+ * Returns     : Pointer to the cached entry, or NULL if it is not cached.
+ *
+ * Notes       : 1) Entries are matched by comparing nameStr to the stored
+ *                  name, so a name longer than FAT_DIR_CACHE_NAME_LEN is 
+ *                  never found.
+ *               2) The returned pointer is only valid until the next call to 
+ *                  fat_AddDirCacheEntry or fat_InvalidateDirCache.
+ * ----------------------------------------------------------------------------
+ */
+const FatDirCacheEntry *fat_FindDirCacheEntry(uint32_t dirClusIndx,
+                                              const char nameStr[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   ADD DIRECTORY CACHE ENTRY
+ *
+ * Description : Adds a directory entry that was found by name to the directory
+ *               entry cache. If the cache is full, the least recently used 
+ *               slot is replaced.
+ *
+ * Arguments   : dirClusIndx         - First cluster index of the directory.
+ *               nameStr             - Name the entry was found by.
+ *               snEnt               - The 32 bytes of the sn entry.
+ *               snEntClusIndx       - Cluster index of the sn entry.
+ *               snEntSecNumInClus   - Sector number in cluster of sn entry.
+ *               snEntPos            - Position of the sn entry in its sector.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_AddDirCacheEntry(uint32_t dirClusIndx, const char nameStr[],
+                          const uint8_t snEnt[], uint32_t snEntClusIndx,
+                          uint8_t snEntSecNumInClus, uint16_t snEntPos);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              INVALIDATE THE DIRECTORY CACHE
+ *
+ * Description : Removes the cached entries of a directory from the directory
+ *               entry cache.
+ *
+ * Arguments   : dirClusIndx   - First cluster index of the directory, or 
+ *                               DIR_CACHE_ALL to remove all cached entries.
+ *
+ * Returns     : void
+ *
+ * Notes       : 1) This is called with DIR_CACHE_ALL by fat_SetBPB when a 
+ *                  volume is mounted.
+ *               2) Any function that modifies the entries of a directory must
+ *                  call this for that directory.
+ * ----------------------------------------------------------------------------
+ */
+void fat_InvalidateDirCache(uint32_t dirClusIndx);
+
+#endif // FAT_CACHE_H
@@ -0,0 +1,506 @@
+/*
+ * File       : FAT_FILE.H
+ * Version    : 2.0
+ * Target     : ATMega1280
+ * Compiler   : AVR-GCC 9.3.0
+ * Downloader : AVRDUDE 6.3
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for reading the contents of files on a FAT32 formatted volume into
+ * caller supplied buffers. A file is first opened to get a FatFile handle,
+ * which is then passed to fat_ReadFile to read the file sequentially, and to
+ * fat_Seek to move to any other position in the file.
+ */
+
+#ifndef FAT_FILE_H
+#define FAT_FILE_H
+
+/*
+ ******************************************************************************
+ *                                  MACROS
+ ******************************************************************************
+ */
+
+// returned by fat_FillReadAhead while the async load is in progress. This is 
+// never combined with the FAT Error Flags.
+#define READ_AHEAD_BUSY        0xFF
+
+// sets the members of FatReadAhead, so must be set the same for every file
+// that includes this. See FAT_TO_DISK_IF.H.
+#ifndef FAT_ASYNC_READ
+#define FAT_ASYNC_READ         0    // also defined in fat_to_disk_if.h
+#endif//FAT_ASYNC_READ
+
+/*
+ ******************************************************************************
+ *                                 STRUCTS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             FAT FILE STRUCT
+ *
+ * Description : Handle for an open file. This holds the location of the file
+ *               on the volume and the current read position (cursor).
+ *
+ * Members     : bpb           - The BPB of the volume the file is on.
+ *               fstClusIndx   - FAT index of the file's first cluster.
+ *               fileSize      - File size in bytes, from the sn entry.
+ *               pos           - Byte offset of the cursor in the file. This
+ *                               is the next byte that will be read.
+ *               clusIndx      - FAT index of a cluster of the file.
+ *               clusNum       - Position of the clusIndx cluster in the
+ *                               file's chain. 0 is the first cluster.
+ *               runEndNum     - Position in the file's chain of the last 
+ *                               cluster known to be contiguous with clusIndx.
+ *               nextRunIndx   - FAT index of the cluster that follows the
+ *                               runEndNum cluster, END_CLUSTER, or 0 if the
+ *                               run at clusIndx has not been scanned.
+ *               err           - FAT Error Flag of the last read.
+ *               ckptTbl       - Caller supplied seek checkpoint table, or NULL.
+ *                               See fat_SetSeekTable.
+ *               ckptIntvl     - Number of clusters between checkpoints.
+ *               ckptLen       - Number of checkpoints ckptTbl can hold.
+ *               ckptCnt       - Number of checkpoints recorded in ckptTbl.
+ *
+ * Notes       : 1) An instance of this struct must be set by fat_OpenFile
+ *                  before it is passed to any other FAT_FILE function.
+ *               2) clusIndx / clusNum is only ever moved forward along the
+ *                  chain as the file is read, so that sequential reads never
+ *                  follow the chain from the first cluster again. It is only
+ *                  moved backwards by fat_Seek.
+ *               3) The run of contiguous clusters at the cluster cursor is
+ *                  kept, so the FAT is only read again when the cursor moves
+ *                  past the end of the run.
+ *               4) Instances do not hold a sector buffer. When a read does
+ *                  not begin or end on a sector boundary, the sector holding
+ *                  the cursor is borrowed from the sector pool, so that 
+ *                  consecutive small reads from one sector read it only once.
+ *
+ * Warnings    : Members of an instance of this struct should never be set
+ *               manually, but only by passing it to the FAT_FILE functions.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  const BPB *bpb;
+  uint32_t fstClusIndx;
+  uint32_t fileSize;
+  uint32_t pos;
+  uint32_t clusIndx;
+  uint32_t clusNum;
+  uint32_t runEndNum;
+  uint32_t nextRunIndx;
+  uint8_t  err;
+  uint32_t *ckptTbl;
+  uint16_t ckptIntvl;
+  uint8_t  ckptLen;
+  uint8_t  ckptCnt;
+}
+FatFile;
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        FAT ASYNC READ STRUCT
+ *
+ * Description : State of a read of an open file that is performed a sector at
+ *               a time, without blocking, by fat_PollReadFile.
+ *
+ * Members     : file      - The open FatFile that is read.
+ *               buf       - The caller supplied buffer being loaded.
+ *               len       - Number of bytes to load into buf, limited to the
+ *                           end of the file.
+ *               readCnt   - Number of bytes loaded into buf.
+ *               secArr    - Sector pool buffer the sector being read is 
+ *                           loaded into, or NULL if it is loaded directly 
+ *                           into buf.
+ *               secNum    - Address on the disk of the sector in secArr.
+ *               secPos    - Offset in secArr of the first byte to copy.
+ *               cpyCnt    - Number of bytes of the sector being read that 
+ *                           will be loaded into buf.
+ *               busy      - 1 while a sector read is in progress.
+ *
+ * Notes       : Only built if FAT_ASYNC_READ is set. See FAT_TO_DISK_IF.H.
+ *
+ * Warnings    : Members of an instance of this struct should never be set
+ *               manually, but only by passing it to the FAT_FILE functions.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  FatFile  *file;
+  uint8_t  *buf;
+  uint16_t len;
+  uint16_t readCnt;
+  uint8_t  *secArr;
+  uint32_t secNum;
+  uint16_t secPos;
+  uint16_t cpyCnt;
+  uint8_t  busy;
+}
+FatAsyncRead;
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      FAT READ AHEAD STRUCT
+ *
+ * Description : Double buffered sequential reader of an open file. The next
+ *               part of the file is loaded into one buffer while the 
+ *               application holds the data in the other. If FAT_ASYNC_READ is
+ *               set the load is made by the async file read, a step at a time
+ *               by fat_FillReadAhead, so that the disk access latency can be
+ *               hidden behind the application's work. Otherwise each buffer 
+ *               is loaded by a single blocking call to fat_ReadFile.
+ *
+ * Members     : file     - The open FatFile that is read.
+ *               bufArr   - The two caller supplied buffers.
+ *               bufLen   - Length of each buffer.
+ *               dataLen  - Number of bytes of the file loaded into each 
+ *                          buffer. 0 if the buffer is empty.
+ *               curr     - Index in bufArr of the buffer that was last 
+ *                          returned by fat_NextReadAhead.
+ *               ard      - The async read loading the other buffer. Only if 
+ *                          FAT_ASYNC_READ is set.
+ *               loading  - 1 while ard is loading the other buffer. Only if
+ *                          FAT_ASYNC_READ is set.
+ *
+ * Notes       : An instance must be set by fat_OpenReadAhead before it is 
+ *               passed to the other read ahead functions. 
+ *
+ * Warnings    : Members of an instance of this struct should never be set
+ *               manually, but only by passing it to the FAT_FILE functions.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  FatFile  *file;
+  uint8_t  *bufArr[2];
+  uint16_t bufLen;
+  uint16_t dataLen[2];
+  uint8_t  curr;
+#if FAT_ASYNC_READ
+  FatAsyncRead ard;
+  uint8_t  loading;
+#endif//FAT_ASYNC_READ
+}
+FatReadAhead;
+
+/*
+ ******************************************************************************
+ *                             FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    OPEN FILE
+ *
+ * Description : Finds a file by its name or path and, if found, sets a 
+ *               FatFile instance to the file with its cursor at the first 
+ *               byte.
+ *
+ * Arguments   : file      - Pointer to the FatFile instance to be set.
+ *               dir       - Pointer to a FatDir instance. A relative path in
+ *                           fileStr begins at this directory.
+ *               fileStr   - Pointer to a string. This is the name, or path, 
+ *                           of the file to open.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS if the file was opened, FILE_NOT_FOUND if there is no
+ *               file matching fileStr, or any other FAT Error Flag returned
+ *               by fat_ResolvePath.
+ *
+ * Notes       : 1) The file is found with fat_ResolvePath, so only the 
+ *                  directory sectors up to each entry in the path are read.
+ *               2) Each name in fileStr must be a long name unless a long 
+ *                  name for a given entry does not exist, in which case it 
+ *                  must be a short name.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenFile(FatFile *file, const FatDir *dir, const char fileStr[],
+                     const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             OPEN FILE ENTRY
+ *
+ * Description : Sets a FatFile instance to the file of a FatEntry instance,
+ *               with its cursor at the first byte.
+ *
+ * Arguments   : file   - Pointer to the FatFile instance to be set.
+ *               ent    - Pointer to a FatEntry instance set to a file entry,
+ *                        e.g. by fat_ResolvePath or fat_FindNextEntry.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, or FILE_NOT_FOUND if the entry is not a file.
+ *
+ * Notes       : No sectors are read. This can be used to open a file entry 
+ *               that has already been found without searching for it again.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenEntry(FatFile *file, const FatEntry *ent, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    READ FILE
+ *
+ * Description : Reads up to len bytes from the file, starting at its cursor,
+ *               into buf. The cursor is then advanced past the bytes read.
+ *
+ * Arguments   : file   - Pointer to an open FatFile instance.
+ *               buf    - Pointer to the array the bytes will be loaded into.
+ *                        Must be at least len bytes long.
+ *               len    - Maximum number of bytes to read.
+ *
+ * Returns     : The number of bytes loaded into buf.
+ *
+ * Notes       : 1) Fewer than len bytes are returned only if the end of the
+ *                  file was reached, or an error occurred. The err member of
+ *                  the FatFile instance is set to SUCCESS, END_OF_FILE if the
+ *                  cursor is at the end of the file, or FAILED_READ_SECTOR or
+ *                  CORRUPT_FAT_ENTRY if the read could not be completed.
+ *               2) The end of the file is determined by the file size in the
+ *                  file's short name entry.
+ *               3) Whole sectors that are aligned with the cursor are loaded
+ *                  directly into buf, and a run of such sectors on
+ *                  contiguous clusters is read as one multi-sector read. Only
+ *                  a partial sector is first loaded into a pool buffer.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_ReadFile(FatFile *file, uint8_t buf[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   SEEK FILE
+ *
+ * Description : Moves the cursor of an open file to the byte at offset. The
+ *               next fat_ReadFile will begin reading at this byte.
+ *
+ * Arguments   : file     - Pointer to an open FatFile instance.
+ *               offset   - Byte offset in the file to move the cursor to.
+ *
+ * Returns     : SUCCESS, END_OF_FILE if offset is not less than the file size
+ *               (the cursor is then set to the end of the file),
+ *               CORRUPT_FAT_ENTRY if the cluster chain could not be followed 
+ *               to the offset, or FAILED_READ_SECTOR if the FAT could not be
+ *               read. FILE_NOT_FOUND is returned if file is closed.
+ *
+ * Notes       : 1) The cluster chain is followed from the nearest known 
+ *                  cluster at or before the offset. This is the current 
+ *                  cluster of the cursor if seeking forward, otherwise it is
+ *                  the first cluster of the file, unless a seek checkpoint
+ *                  table has been set with fat_SetSeekTable.
+ *               2) Runs of contiguous clusters are skipped over with a 
+ *                  single scan of the FAT sector (see fat_GetClusRun), so the
+ *                  cost of a seek on an unfragmented file does not depend on
+ *                  the number of clusters skipped.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_Seek(FatFile *file, uint32_t offset);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   SET SEEK CHECKPOINT TABLE
+ *
+ * Description : Gives a file a table in which to record a checkpoint every 
+ *               ckptIntvl clusters as its cluster chain is followed. A seek
+ *               then only needs to follow the chain from the nearest
+ *               checkpoint before the offset.
+ *
+ * Arguments   : file        - Pointer to an open FatFile instance.
+ *               ckptTbl     - Pointer to a caller supplied array. It is used by
+ *                             the file until it is closed or reopened.
+ *               tblLen      - Number of elements in ckptTbl.
+ *               ckptIntvl   - Number of clusters between checkpoints.
+ *
+ * Returns     : void
+ *
+ * Notes       : 1) Element i of ckptTbl is the FAT index of cluster number
+ *                  (i + 1) * ckptIntvl of the file. Checkpoints are recorded
+ *                  the first time the chain is followed past them, by either
+ *                  fat_ReadFile or fat_Seek.
+ *               2) For a file of N clusters, a ckptIntvl of N / tblLen, or
+ *                  more, allows the whole file to be covered by the table.
+ *                  No checkpoints are recorded beyond the end of the table.
+ *               3) Passing a NULL ckptTbl, or 0 for tblLen or ckptIntvl,
+ *                  removes the table from the file.
+ * ----------------------------------------------------------------------------
+ */
+void fat_SetSeekTable(FatFile *file, uint32_t ckptTbl[], uint8_t tblLen,
+                      uint16_t ckptIntvl);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            OPEN READ AHEAD
+ *
+ * Description : Sets a FatReadAhead instance to read an open file, beginning
+ *               at the file's cursor, into two caller supplied buffers.
+ *
+ * Arguments   : ra       - Pointer to the FatReadAhead instance to be set.
+ *               file     - Pointer to an open FatFile instance.
+ *               bufA     - Pointer to the first buffer.
+ *               bufB     - Pointer to the second buffer.
+ *               bufLen   - Length of each buffer. Should be a multiple of 
+ *                          SECTOR_LEN, e.g. the length of a cluster, so that
+ *                          each buffer is loaded directly from the disk.
+ *
+ * Returns     : void
+ *
+ * Notes       : 1) No sectors are read until fat_FillReadAhead or 
+ *                  fat_NextReadAhead is called.
+ *               2) The file must not be read or seeked other than through 
+ *                  the read ahead functions while it is being used. To move
+ *                  to another position, call fat_Seek and then open the read
+ *                  ahead again.
+ * ----------------------------------------------------------------------------
+ */
+void fat_OpenReadAhead(FatReadAhead *ra, FatFile *file, uint8_t bufA[], 
+                       uint8_t bufB[], uint16_t bufLen);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            FILL READ AHEAD
+ *
+ * Description : Loads the next part of the file into the buffer that is not
+ *               held by the application, if it is empty.
+ *
+ * Arguments   : ra   - Pointer to a FatReadAhead instance.
+ *
+ * Returns     : SUCCESS if the buffer is loaded, or was already loaded, 
+ *               READ_AHEAD_BUSY if the load is still in progress, END_OF_FILE
+ *               if there is no more of the file to read, or the FAT Error 
+ *               Flag of the read, i.e. the err member of the file.
+ *
+ * Notes       : 1) If FAT_ASYNC_READ is set, each call advances the load by
+ *                  one step of fat_PollReadFile and returns READ_AHEAD_BUSY 
+ *                  until it is done. It should be called repeatedly while the
+ *                  application is consuming the buffer returned by 
+ *                  fat_NextReadAhead, e.g. from the main loop while an ISR is
+ *                  draining the buffer to a DAC, so that the wait for the 
+ *                  disk is spread between the application's work. No other
+ *                  FAT function may be called while the load is in progress.
+ *               2) If FAT_ASYNC_READ is not set, the buffer is loaded before
+ *                  this returns, and READ_AHEAD_BUSY is never returned.
+ *               3) The location of the next sectors is taken from the file's
+ *                  current cluster, so the FAT is only read when the end of a
+ *                  run of contiguous clusters is reached.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_FillReadAhead(FatReadAhead *ra);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            NEXT READ AHEAD
+ *
+ * Description : Gets the buffer holding the next part of the file. The buffer
+ *               that was returned by the previous call is given back to be 
+ *               loaded by fat_FillReadAhead.
+ *
+ * Arguments   : ra    - Pointer to a FatReadAhead instance.
+ *               buf   - Set to point to the buffer holding the next bytes of
+ *                       the file.
+ *
+ * Returns     : The number of bytes of the file in buf. 0 if the end of the 
+ *               file has been reached or the read failed, see the err member
+ *               of the file.
+ *
+ * Notes       : If fat_FillReadAhead has not already loaded the buffer, or 
+ *               its load is still in progress, it is completed before this 
+ *               returns.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_NextReadAhead(FatReadAhead *ra, const uint8_t **buf);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             START ASYNC READ
+ *
+ * Description : Sets a FatAsyncRead instance to read up to len bytes from an
+ *               open file, starting at its cursor, into buf. The read is then
+ *               performed by calls to fat_PollReadFile.
+ *
+ * Arguments   : ard    - Pointer to the FatAsyncRead instance to be set.
+ *               file   - Pointer to an open FatFile instance.
+ *               buf    - Pointer to the array the bytes will be loaded into.
+ *                        Must be at least len bytes long.
+ *               len    - Maximum number of bytes to read.
+ *
+ * Returns     : void
+ *
+ * Notes       : 1) Only built if FAT_ASYNC_READ is set.
+ *               2) No sectors are read until fat_PollReadFile is called.
+ *               3) Until the read is done, neither buf nor the file may be 
+ *                  used, and no other FAT function may be called, as the disk
+ *                  can only perform one read at a time.
+ * ----------------------------------------------------------------------------
+ */
+void fat_StartReadFile(FatAsyncRead *ard, FatFile *file, uint8_t buf[], 
+                       uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              POLL ASYNC READ
+ *
+ * Description : Advances a read started by fat_StartReadFile. Each call 
+ *               advances the disk read of the current sector by one step, and
+ *               starts the read of the next sector when a sector is done.
+ *
+ * Arguments   : ard   - Pointer to a FatAsyncRead instance set by 
+ *                       fat_StartReadFile.
+ *
+ * Returns     : 1 if the read is still in progress, 0 when it is done. The
+ *               number of bytes read is then returned by fat_CompleteReadFile.
+ *
+ * Notes       : 1) This is intended to be called from the application's main
+ *                  loop between its other tasks, e.g. servicing sensors and 
+ *                  the USART, so that they are not stalled while the disk 
+ *                  sends the data.
+ *               2) Whole sectors are loaded directly into buf. A sector that 
+ *                  is only partly read is loaded into a sector pool buffer,
+ *                  and is not read again if it is still pooled.
+ *               3) Following the cluster chain to the next cluster may read a
+ *                  FAT sector, which is not done asynchronously. These reads 
+ *                  are only made at the end of a run of contiguous clusters.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_PollReadFile(FatAsyncRead *ard);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          COMPLETE ASYNC READ
+ *
+ * Description : Ends a read started by fat_StartReadFile. If the read is not
+ *               yet done, it is first polled until it is.
+ *
+ * Arguments   : ard   - Pointer to a FatAsyncRead instance set by 
+ *                       fat_StartReadFile.
+ *
+ * Returns     : The number of bytes loaded into buf.
+ *
+ * Notes       : The FAT Error Flag of the read is the err member of the file,
+ *               the same as for fat_ReadFile.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_CompleteReadFile(FatAsyncRead *ard);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   CLOSE FILE
+ *
+ * Description : Closes an open file.
+ *
+ * Arguments   : file   - Pointer to an open FatFile instance.
+ *
+ * Returns     : SUCCESS
+ *
+ * Notes       : The FatFile instance must be reopened with fat_OpenFile before
+ *               it can be used again. fat_ReadFile will return 0 bytes for a
+ *               closed file.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_Close(FatFile *file);
+
+#endif // FAT_FILE_H
@@ -0,0 +1,233 @@
+/*
+ * File       : FAT_HANDLE.H
+ * Version    : 2.0
+ * Target     : ATMega1280
+ * Compiler   : AVR-GCC 9.3.0
+ * Downloader : AVRDUDE 6.3
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for a table of open file and directory handles, so that several
+ * files and directories can be read at the same time, e.g. a config file, an
+ * audio stream and a directory scan interleaved in the application's loop.
+ * Each handle has its own cursor, and all handles read through the one
+ * sector pool. Handles that are open on the same file share a seek
+ * checkpoint table and each other's cluster cursors, so a cluster chain that
+ * has been followed by one handle is not followed again by the others.
+ */
+
+#ifndef FAT_HANDLE_H
+#define FAT_HANDLE_H
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            HANDLE SLOT COUNT
+ *
+ * Description : The number of file and directory handles that can be open at
+ *               one time.
+ *
+ * Notes       : 1) Each slot requires sizeof(FatFile) + 2 bytes of SRAM, and
+ *                  each file open on a different file requires
+ *                  FAT_HANDLE_CKPT_LEN * 4 + 8 bytes more. The SRAM is
+ *                  allocated statically in FAT_HANDLE.C.
+ *               2) Handles do not hold a sector pool buffer between calls.
+ *                  For the sectors of interleaved handles to stay in the pool
+ *                  between their reads, FAT_SEC_POOL_SLOTS should be at least
+ *                  FAT_HANDLE_SLOTS + 2, see FAT_CACHE.H.
+ *               3) Must be less than 255.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_HANDLE_SLOTS
+#define FAT_HANDLE_SLOTS                4
+#endif//FAT_HANDLE_SLOTS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  SHARED CHECKPOINT TABLE LEN
+ *
+ * Description : The number of seek checkpoints in the table that is shared
+ *               by the handles open on the same file. See fat_SetSeekTable.
+ *
+ * Notes       : The checkpoint interval is set when the file is first opened
+ *               so that the table covers the whole file. Any seek then only
+ *               follows the chain from at most 1 / FAT_HANDLE_CKPT_LEN of the
+ *               file before the offset.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_HANDLE_CKPT_LEN
+#define FAT_HANDLE_CKPT_LEN             8
+#endif//FAT_HANDLE_CKPT_LEN
+
+/*
+ ******************************************************************************
+ *                             FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             OPEN FILE HANDLE
+ *
+ * Description : Finds a file by its name or path and, if found, opens a
+ *               handle to it with its cursor at the first byte.
+ *
+ * Arguments   : hndl      - Set to the handle of the open file.
+ *               dir       - Pointer to a FatDir instance. A relative path in
+ *                           fileStr begins at this directory.
+ *               fileStr   - Pointer to a string. This is the name, or path,
+ *                           of the file to open.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS if the file was opened, NO_FREE_HANDLE if all handle
+ *               slots are open, or any FAT Error Flag returned by
+ *               fat_OpenFile.
+ *
+ * Notes       : If another handle is already open on the file, the new handle
+ *               shares its seek checkpoint table.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenFileHandle(uint8_t *hndl, const FatDir *dir,
+                           const char fileStr[], const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        OPEN DIRECTORY HANDLE
+ *
+ * Description : Opens a handle to a directory with its cursor at the first
+ *               entry.
+ *
+ * Arguments   : hndl   - Set to the handle of the open directory.
+ *               dir    - Pointer to a FatDir instance. This is the directory
+ *                        whose entries will be read.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, or NO_FREE_HANDLE if all handle slots are open.
+ *
+ * Notes       : No sector is read until fat_NextHandleEntry is called.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenDirHandle(uint8_t *hndl, const FatDir *dir, const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             READ FILE HANDLE
+ *
+ * Description : Reads up to len bytes from the file of a handle, starting at
+ *               its cursor, into buf. See fat_ReadFile.
+ *
+ * Arguments   : hndl   - Handle of an open file.
+ *               buf    - Pointer to the array the bytes will be loaded into.
+ *                        Must be at least len bytes long.
+ *               len    - Maximum number of bytes to read.
+ *
+ * Returns     : The number of bytes loaded into buf. 0 if hndl is not the
+ *               handle of an open file.
+ *
+ * Notes       : The FAT Error Flag of the read is the err member of the
+ *               handle's FatFile, see fat_GetHandleFile.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_ReadHandle(uint8_t hndl, uint8_t buf[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             SEEK FILE HANDLE
+ *
+ * Description : Moves the cursor of the file of a handle to the byte at
+ *               offset. See fat_Seek.
+ *
+ * Arguments   : hndl     - Handle of an open file.
+ *               offset   - Byte offset in the file to move the cursor to.
+ *
+ * Returns     : Any FAT Error Flag returned by fat_Seek, or FILE_NOT_FOUND if
+ *               hndl is not the handle of an open file.
+ *
+ * Notes       : The chain is followed from the nearest cluster before the
+ *               offset that is known to any handle open on the file, i.e.
+ *               their cluster cursors and the shared checkpoint table.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SeekHandle(uint8_t hndl, uint32_t offset);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    GET FILE OF A FILE HANDLE
+ *
+ * Description : Returns the FatFile instance of the handle of an open file.
+ *
+ * Arguments   : hndl   - Handle of an open file.
+ *
+ * Returns     : Pointer to the handle's FatFile instance, or NULL if hndl is
+ *               not the handle of an open file.
+ *
+ * Notes       : 1) The instance may be passed to the FAT_FILE functions, e.g.
+ *                  to read the file with a FatReadAhead, or to read the err
+ *                  member after fat_ReadHandle.
+ *               2) It must not be passed to fat_Close, fat_OpenFile or
+ *                  fat_SetSeekTable. Close the handle with fat_CloseHandle.
+ * ----------------------------------------------------------------------------
+ */
+FatFile *fat_GetHandleFile(uint8_t hndl);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  NEXT DIRECTORY HANDLE ENTRY
+ *
+ * Description : Sets a FatEntry instance to the next entry of the directory
+ *               of a handle, and advances the handle's cursor past it.
+ *
+ * Arguments   : hndl   - Handle of an open directory.
+ *               ent    - Pointer to the FatEntry instance that will be set
+ *                        to the next entry.
+ *
+ * Returns     : SUCCESS if ent was set to the next entry. END_OF_DIRECTORY if
+ *               there are no more entries, DIR_NOT_FOUND if hndl is not the
+ *               handle of an open directory, otherwise any other FAT Error
+ *               Flag returned while reading the directory.
+ *
+ * Notes       : The directory sector is returned to the sector pool before
+ *               this returns. It is normally still in the pool on the next
+ *               call, so each sector of the directory is read only once.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_NextHandleEntry(uint8_t hndl, FatEntry *ent);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 CLOSE HANDLE
+ *
+ * Description : Closes an open file or directory handle, so that its slot
+ *               can be used by another handle.
+ *
+ * Arguments   : hndl   - Handle of an open file or directory.
+ *
+ * Returns     : SUCCESS, or FILE_NOT_FOUND if hndl is not an open handle.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_CloseHandle(uint8_t hndl);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            CLOSE ALL HANDLES
+ *
+ * Description : Closes every open file and directory handle.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ *
+ * Notes       : This should be called before another volume is mounted, as
+ *               the handles refer to the BPB of the volume they were opened
+ *               on.
+ * ----------------------------------------------------------------------------
+ */
+void fat_CloseAllHandles(void);
+
+#endif // FAT_HANDLE_H
@@ -0,0 +1,217 @@
+/*
+ * File       : FAT_LOG.H
+ * Version    : 2.0
+ * Target     : ATMega1280
+ * Compiler   : AVR-GCC 9.3.0
+ * Downloader : AVRDUDE 6.3
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for appending data to a file on a FAT32 formatted volume, e.g. to
+ * log sensor data. A run of contiguous free clusters is reserved for the file
+ * when it is opened, and the write cursor is kept in the FatLog instance, so
+ * that whole sectors are streamed to the disk with a single multi-sector
+ * write. The FAT chain and the size in the file's directory entry are only
+ * updated at checkpoints, and when the log is closed.
+ */
+
+#ifndef FAT_LOG_H
+#define FAT_LOG_H
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   PREALLOCATED CLUSTER COUNT
+ *
+ * Description : Number of contiguous free clusters that are searched for and
+ *               reserved for a log each time it needs more clusters.
+ *
+ * Notes       : 1) The clusters are only reserved in the FatLog instance. They
+ *                  are not marked as used in the FAT until data has been
+ *                  written to them and a checkpoint is made, so a power loss
+ *                  does not leave unused clusters allocated to the file.
+ *               2) Clusters are taken from fat_AllocRun, so if the first
+ *                  free run found is shorter, only that run is reserved, and
+ *                  another is reserved when it has been written to.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_LOG_PREALLOC_CLUS
+#define FAT_LOG_PREALLOC_CLUS           64
+#endif//FAT_LOG_PREALLOC_CLUS
+
+/*
+ ******************************************************************************
+ *                                 STRUCTS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              FAT LOG STRUCT
+ *
+ * Description : Handle for a file that is open to be appended to.
+ *
+ * Members     : bpb            - The BPB of the volume the file is on.
+ *               entSecNum      - Address on the disk of the sector holding
+ *                                the file's short name entry.
+ *               entPos         - Position of the sn entry in that sector.
+ *               fstClusIndx    - FAT index of the file's first cluster, or 0
+ *                                if the file has no clusters yet.
+ *               fileSize       - Number of bytes in the file. The next byte
+ *                                written is appended at this offset.
+ *               ckptSize       - File size at the last checkpoint, i.e. the
+ *                                file size in the sn entry on the disk.
+ *               ckptIntvl      - Bytes written between checkpoints, or 0.
+ *               linkCnt        - Number of clusters of the file that are
+ *                                linked in the FAT.
+ *               tailClusIndx   - FAT index of the last linked cluster.
+ *               runClusIndx    - FAT index of the first cluster of the run of
+ *                                reserved clusters. These follow the linked
+ *                                clusters in the file.
+ *               runClusCnt     - Number of clusters in the reserved run.
+ *               clusIndx       - FAT index of the cluster holding the last
+ *                                byte written.
+ *               clusNum        - Position of the clusIndx cluster in the
+ *                                file. NO_LOG_CLUS if the file is empty.
+ *               err            - FAT Error Flag of the last write.
+ *
+ * Notes       : An instance of this struct must be set by fat_OpenLog before
+ *               it is passed to any other FAT_LOG function.
+ *
+ * Warnings    : Members of an instance of this struct should never be set
+ *               manually, but only by passing it to the FAT_LOG functions.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  const BPB *bpb;
+  uint32_t entSecNum;
+  uint16_t entPos;
+  uint32_t fstClusIndx;
+  uint32_t fileSize;
+  uint32_t ckptSize;
+  uint32_t ckptIntvl;
+  uint32_t linkCnt;
+  uint32_t tailClusIndx;
+  uint32_t runClusIndx;
+  uint32_t runClusCnt;
+  uint32_t clusIndx;
+  uint32_t clusNum;
+  uint8_t  err;
+}
+FatLog;
+
+// value of the clusNum member of a FatLog instance for an empty file.
+#define NO_LOG_CLUS                     0xFFFFFFFF
+
+/*
+ ******************************************************************************
+ *                             FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                     OPEN LOG
+ *
+ * Description : Sets a FatLog instance to append to the file of a FatEntry
+ *               instance, and reserves a run of free clusters for it.
+ *
+ * Arguments   : log         - Pointer to the FatLog instance to be set.
+ *               ent         - Pointer to a FatEntry instance set to a file
+ *                             entry, e.g. by fat_ResolvePath.
+ *               ckptIntvl   - Number of bytes written between checkpoints.
+ *                             0 if checkpoints are only made by
+ *                             fat_SyncLog and fat_CloseLog.
+ *               bpb         - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, FILE_NOT_FOUND if the entry is not a file,
+ *               CORRUPT_FAT_ENTRY if the file's cluster chain is shorter than
+ *               its size, FAILED_READ_SECTOR if the FAT could not be read, or
+ *               NO_FREE_CLUSTER if the volume is full. The log is only open
+ *               if SUCCESS is returned.
+ *
+ * Notes       : 1) The file's cluster chain is followed to its last cluster,
+ *                  and the free cluster search begins after it, so that the
+ *                  reserved run usually continues the file contiguously.
+ *               2) ckptIntvl sets how much data can be lost on a power loss.
+ *                  Data written since the last checkpoint is on the disk but
+ *                  is not part of the file until the next checkpoint.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenLog(FatLog *log, const FatEntry *ent, uint32_t ckptIntvl,
+                    const BPB *bpb);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    WRITE LOG
+ *
+ * Description : Appends len bytes from buf to the end of the file.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *               buf   - Pointer to the array holding the bytes to write.
+ *               len   - Number of bytes to write.
+ *
+ * Returns     : The number of bytes written.
+ *
+ * Notes       : 1) Fewer than len bytes are written only if an error occurred.
+ *                  The err member of the FatLog instance is set to SUCCESS,
+ *                  NO_FREE_CLUSTER, FAILED_READ_SECTOR or FAILED_WRITE_SECTOR.
+ *               2) Whole sectors that are aligned with the end of the file are
+ *                  written directly from buf, and those on the reserved run
+ *                  of clusters are written as one multi-sector write. A
+ *                  partial sector is written to the sector pool, and is only
+ *                  written to the disk once it is full or at a checkpoint, so
+ *                  that small records do not each require a sector write.
+ *               3) A checkpoint is made once ckptIntvl bytes have been written
+ *                  since the last one.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_WriteLog(FatLog *log, const uint8_t buf[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                     SYNC LOG
+ *
+ * Description : Makes a checkpoint. The clusters written since the last
+ *               checkpoint are linked into the file's cluster chain, and the
+ *               file size in its directory entry is updated, so that all of
+ *               the data written is part of the file on the disk.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS, FAILED_READ_SECTOR or FAILED_WRITE_SECTOR.
+ *
+ * Notes       : 1) The data and FAT sectors are written to the disk before the
+ *                  directory entry, so the entry never claims clusters that
+ *                  are not linked.
+ *               2) This calls fat_SyncSecPool, so any other dirty sectors in
+ *                  the pool are also written.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SyncLog(FatLog *log);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    CLOSE LOG
+ *
+ * Description : Makes a final checkpoint and closes the log.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS, FAILED_READ_SECTOR or FAILED_WRITE_SECTOR.
+ *
+ * Notes       : 1) Reserved clusters that were not written to are left free.
+ *               2) The free cluster count and next free cluster hint in the
+ *                  FSInfo sector are also updated.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_CloseLog(FatLog *log);
+
+#endif // FAT_LOG_H
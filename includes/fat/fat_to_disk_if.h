@@ -43,6 +43,15 @@
 #define FAILED_READ_SECTOR      0x08        // This should be defined in fat.h
 #endif//FAILED_READ_SECTOR
 
+// returned by FATtoDisk_PollReadSector while the read is in progress.
+#define READ_SECTOR_BUSY        1
+
+// values that can be returned by FATtoDisk_WriteSingleSector. 
+#define WRITE_SECTOR_SUCCESS    0     
+#ifndef FAILED_WRITE_SECTOR
+#define FAILED_WRITE_SECTOR     0x02        // This should be defined in fat.h
+#endif//FAILED_WRITE_SECTOR
+
 // Boot sector signature bytes. The last two bytes of BS should be these.
 #define BS_SIGN_1     0x55
 #define BS_SIGN_2     0xAA
@@ -57,6 +66,128 @@
 #define JMP_BOOT_3A     0x90
 #define JMP_BOOT_1B     0xE9
 
+//
+// Master Boot Record partition table. The table holds MBR_PART_CNT entries
+// of MBR_PART_ENT_LEN bytes, starting at MBR_PART_TBL_POS in the MBR. In each
+// entry is the partition type byte and the little endian 32-bit block address
+// of the first block of the partition. FAT32 partitions are of type 
+// MBR_TYPE_FAT32_CHS or MBR_TYPE_FAT32_LBA. The MBR ends with the same 
+// signature bytes as the boot sector.
+//
+#define MBR_PART_TBL_POS       446
+#define MBR_PART_ENT_LEN       16
+#define MBR_PART_CNT           4
+#define MBR_PART_TYPE_POS      4
+#define MBR_PART_LBA_POS       8
+#define MBR_TYPE_FAT32_CHS     0x0B
+#define MBR_TYPE_FAT32_LBA     0x0C
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             DISK READ STATS
+ *
+ * Description : Set FAT_DISK_STATS to 1 to count the disk reads made by the
+ *               AVR-FAT module and the time spent in them. See DiskStats.
+ *
+ * Notes       : 1) Before each sector read, the FAT module sets the category
+ *                  of what is being read with FAT_SET_READ_CAT. The disk
+ *                  implementation counts the sectors read in each category.
+ *               2) With FAT_DISK_STATS set to 0, FAT_SET_READ_CAT is empty
+ *                  and nothing is counted.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_DISK_STATS
+#define FAT_DISK_STATS         0
+#endif//FAT_DISK_STATS
+
+// read categories
+#define READ_CAT_BOOT          0    // MBR, boot sector and FSInfo sector
+#define READ_CAT_FAT           1    // FAT sectors
+#define READ_CAT_DIR           2    // directory sectors
+#define READ_CAT_FILE          3    // file data sectors
+#define READ_CAT_CNT           4    // number of categories
+
+#if FAT_DISK_STATS
+#define FAT_SET_READ_CAT(cat)  FATtoDisk_SetReadCategory(cat)
+#else
+#define FAT_SET_READ_CAT(cat)
+#endif//FAT_DISK_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          ASYNC SECTOR READS
+ *
+ * Description : Set FAT_ASYNC_READ to 1 to build the async file read of
+ *               FAT_FILE.C, i.e. fat_StartReadFile. The disk implementation 
+ *               must then also implement FATtoDisk_StartReadSector, 
+ *               FATtoDisk_PollReadSector and FATtoDisk_CompleteReadSector.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_ASYNC_READ
+#define FAT_ASYNC_READ         0
+#endif//FAT_ASYNC_READ
+
+/*
+ ******************************************************************************
+ *                                 TYPEDEFS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      SECTOR HANDLER POINTER
+ *                                 
+ * Description : Pointer to a function that is called by 
+ *               FATtoDisk_ReadMultipleSectors each time a sector has been
+ *               loaded into the sector array.
+ * 
+ * Arguments   : blkArr       - Pointer to the array holding the contents of
+ *                              the sector that was just read.
+ *               handlerArg   - The handlerArg pointer that was passed to
+ *                              FATtoDisk_ReadMultipleSectors.
+ * 
+ * Returns     : 0 to continue reading sectors. Any other value will end the
+ *               read after the current sector.
+ * ----------------------------------------------------------------------------
+ */
+typedef uint8_t (*SectorHandler)(uint8_t blkArr[], void *handlerArg);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             DISK READ STATS
+ *
+ * Description : Counters returned by fat_GetStats when FAT_DISK_STATS is set.
+ *
+ * Members     : secReadCnt      - Sectors read from the disk, per category,
+ *                                 indexed by the READ_CAT_ values.
+ *               poolHits        - fat_GetSector calls that found the sector
+ *                                 in the sector pool.
+ *               poolMisses      - fat_GetSector calls that read the sector.
+ *               dirCacheHits    - Entries found in the directory cache.
+ *               dirCacheMisses  - Names that were not in the directory
+ *                                 cache.
+ *               tokenWaits      - Bytes received while waiting for the start
+ *                                 block token of each block read.
+ *               retries         - Block reads that were retried.
+ *               cycles          - CPU cycles spent in the block reads.
+ *
+ * Notes       : tokenWaits, retries and cycles are from the disk 
+ *               implementation, and are 0 if it does not measure them.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint32_t secReadCnt[READ_CAT_CNT];
+  uint32_t poolHits;
+  uint32_t poolMisses;
+  uint32_t dirCacheHits;
+  uint32_t dirCacheMisses;
+  uint32_t tokenWaits;
+  uint32_t retries;
+  uint32_t cycles;
+}
+DiskStats;
+
 /*
  ******************************************************************************
  *                            FUNCTION PROTOTYPES
@@ -74,9 +205,17 @@
  * 
  * Returns     : Address of the boot sector on the SD card.
  * 
- * Notes       : The search for the boot sector will begin at
- *               FBS_SEARCH_START_BLOCK, and search a total of 
- *               FBS_MAX_NUM_BLKS_SEARCH_MAX blocks. 
+ * Notes       : 1) If block 0 is not the boot sector, it should be checked for
+ *                  a Master Boot Record, and the boot sector read from the 
+ *                  start of the first FAT32 partition in its partition table.
+ *                  Only if there is no such partition, the search for the 
+ *                  boot sector will begin at FBS_SEARCH_START_BLOCK, and 
+ *                  search a total of FBS_MAX_NUM_BLKS_SEARCH_MAX blocks. 
+ *               2) This is called by fat_SetBPB when the volume is mounted. An
+ *                  implementation should determine any disk parameters that 
+ *                  are required for every sector access (e.g. the SD card
+ *                  addressing mode) here, and store them for use by the other
+ *                  functions, so that they are not re-determined on each read.
  * ----------------------------------------------------------------------------
  */
 uint32_t FATtoDisk_FindBootSector(void);
@@ -101,4 +240,240 @@ uint32_t FATtoDisk_FindBootSector(void);
  */
 uint8_t FATtoDisk_ReadSingleSector(uint32_t blkNum, uint8_t blkArr[]);
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                       READ RANGE OF SINGLE SECTOR FROM DISK
+ *                                       
+ * Description : Loads len bytes, beginning at offset, of the sector/block at
+ *               the specified address on the disk into the array, buf.
+ *
+ * Arguments   : blkNum    - Block number address of the sector/block on the
+ *                           disk.
+ *               offset    - Position in the sector of the first byte to load.
+ *               len       - Number of bytes to load. offset + len must not be
+ *                           greater than SECTOR_LEN.
+ *               buf       - Pointer to the array that will be loaded with the
+ *                           len bytes.
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * 
+ * Notes       : Used to read a few bytes of a sector, e.g. a FAT entry, 
+ *               without a SECTOR_LEN array, so that no sector pool buffer is
+ *               taken for it. See fat_GetSectorBytes.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadSectorRange(uint32_t blkNum, uint16_t offset, 
+                                  uint16_t len, uint8_t buf[]);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                             READ MULTIPLE SECTORS FROM DISK
+ *                                       
+ * Description : Reads numOfBlks consecutive sectors/blocks, beginning at the
+ *               specified address, as a single sequential transfer.
+ *
+ * Arguments   : startBlkNum   - Block number address of the first sector to
+ *                               be read.
+ *               numOfBlks     - Number of consecutive sectors to read.
+ *               blkArr        - Pointer to the array that will be loaded with
+ *                               the contents of the sectors. See notes.
+ *               blkHandler    - Pointer to a SectorHandler function, or NULL.
+ *               handlerArg    - Passed to blkHandler each time it is called.
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * 
+ * Notes       : 1) If blkHandler is NULL, the sectors are loaded into blkArr 
+ *                  one after the other, so blkArr must be at least numOfBlks
+ *                  * SECTOR_LEN bytes long.
+ *               2) If blkHandler is not NULL, blkArr must be SECTOR_LEN bytes
+ *                  long. Each sector is loaded into blkArr and then passed to 
+ *                  blkHandler before the next sector is read. If blkHandler
+ *                  returns a non-zero value, then the remaining sectors are 
+ *                  not read. This is not a failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadMultipleSectors(uint32_t startBlkNum, uint32_t numOfBlks,
+                                      uint8_t blkArr[], SectorHandler blkHandler,
+                                      void *handlerArg);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE SINGLE SECTOR TO DISK
+ *                                       
+ * Description : Writes the contents of an array to the sector/block at the 
+ *               specified address on the disk.
+ *
+ * Arguments   : blkNum    - Block number address of the sector/block on the 
+ *                           disk that will be written.
+ *               blkArr    - Pointer to the array holding the SECTOR_LEN bytes
+ *                           that will be written to the sector.
+ * 
+ * Returns     : WRITE_SECTOR_SUCCESS if successful.
+ *               FAILED_WRITE_SECTOR if failure.
+ * 
+ * Notes       : The function should not return until the sector has been 
+ *               written, or the write has failed.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_WriteSingleSector(uint32_t blkNum, const uint8_t blkArr[]);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                              WRITE MULTIPLE SECTORS TO DISK
+ *                                       
+ * Description : Writes numOfBlks consecutive sectors/blocks, beginning at the
+ *               specified address, as a single sequential transfer.
+ *
+ * Arguments   : startBlkNum   - Block number address of the first sector to
+ *                               be written.
+ *               numOfBlks     - Number of consecutive sectors to write.
+ *               blkArr        - Pointer to the array holding the contents of
+ *                               the sectors, one after the other. Must be at
+ *                               least numOfBlks * SECTOR_LEN bytes long.
+ * 
+ * Returns     : WRITE_SECTOR_SUCCESS if successful.
+ *               FAILED_WRITE_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_WriteMultipleSectors(uint32_t startBlkNum, 
+                                       uint32_t numOfBlks, 
+                                       const uint8_t blkArr[]);
+
+#if FAT_ASYNC_READ
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                     START ASYNC SECTOR READ
+ *                                       
+ * Description : Starts a read of a single sector into an array, that is 
+ *               performed by later calls to FATtoDisk_PollReadSector.
+ *
+ * Arguments   : blkNum    - Block number address of the sector/block on the 
+ *                           disk that should be read into blkArr.
+ *               blkArr    - Pointer to the array that will be loaded with the
+ *                           contents of the sector. Must be SECTOR_LEN bytes.
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if the read was started.
+ *               FAILED_READ_SECTOR if failure.
+ * 
+ * Notes       : 1) Only one async read is in progress at a time. The disk 
+ *                  must not be accessed by any other function until it has 
+ *                  been completed by FATtoDisk_CompleteReadSector.
+ *               2) A disk that can not read without blocking may read the 
+ *                  sector here, and return READ_SECTOR_SUCCESS from the first
+ *                  call to FATtoDisk_PollReadSector.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_StartReadSector(uint32_t blkNum, uint8_t blkArr[]);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                      POLL ASYNC SECTOR READ
+ *                                       
+ * Description : Advances the read started by FATtoDisk_StartReadSector, and
+ *               returns without waiting on the disk.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : READ_SECTOR_BUSY if the read is still in progress, else 
+ *               READ_SECTOR_SUCCESS. The result of the read is then returned 
+ *               by FATtoDisk_CompleteReadSector.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_PollReadSector(void);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                  COMPLETE ASYNC SECTOR READ
+ *                                       
+ * Description : Ends the read started by FATtoDisk_StartReadSector, waiting 
+ *               for it if it is still in progress.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if the sector was read.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_CompleteReadSector(void);
+
+#endif//FAT_ASYNC_READ
+
+#if FAT_DISK_STATS
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       SET THE READ CATEGORY
+ *                                       
+ * Description : Sets the category that the following sector reads are counted
+ *               in. Called through FAT_SET_READ_CAT.
+ *
+ * Arguments   : cat   - One of the READ_CAT_ values.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_SetReadCategory(uint8_t cat);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                         GET DISK READ STATS
+ *                                       
+ * Description : Loads the disk implementation's counters into stats, i.e. 
+ *               secReadCnt, tokenWaits, retries and cycles. The other members
+ *               are not changed.
+ *
+ * Arguments   : stats   - Pointer to the DiskStats instance to load.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_GetStats(DiskStats *stats);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       RESET DISK READ STATS
+ *                                       
+ * Description : Sets the disk implementation's counters to 0.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_ResetStats(void);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                          GET FAT READ STATS
+ *                                       
+ * Description : Loads all of the DiskStats counters, i.e. those of the disk
+ *               implementation and the sector pool and directory cache 
+ *               counters, into stats. Implemented in FAT_CACHE.C.
+ *
+ * Arguments   : stats   - Pointer to the DiskStats instance to load.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_GetStats(DiskStats *stats);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                        RESET FAT READ STATS
+ *                                       
+ * Description : Sets all of the DiskStats counters to 0. Implemented in 
+ *               FAT_CACHE.C.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_ResetStats(void);
+
+#endif//FAT_DISK_STATS
+
 #endif //FAT_TO_DISK_IF_
@@ -0,0 +1,91 @@
+/*
+ * File       : FAT_TO_IMAGE.H
+ * Version    : 2.0
+ * Target     : Host (x86 / Linux)
+ * Compiler   : GCC
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for the disk image implementation of FAT_TO_DISK_IF.H. This is
+ * used to run the AVR-FAT module on a host computer against an image file of
+ * a FAT32 formatted disk, e.g. one copied from an SD card with dd, instead of
+ * the SD card itself.
+ */
+
+#ifndef FAT_TO_IMAGE_H
+#define FAT_TO_IMAGE_H
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          MEMORY MAPPED IMAGE
+ *
+ * Description : Set to 1 to access the image through a memory mapping of the
+ *               whole file, instead of reading and writing it with stdio.
+ *
+ * Notes       : With the mapping, a sector read is a copy from memory, so the
+ *               time measured for the FAT functions does not include the
+ *               host's file system calls.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef FAT_IMAGE_MMAP
+#define FAT_IMAGE_MMAP                  0
+#endif//FAT_IMAGE_MMAP
+
+// values returned by FATtoImage_Open
+#define IMAGE_OPEN_SUCCESS              0
+#define FAILED_OPEN_IMAGE               1
+
+// flags that can be passed to FATtoImage_Open
+#define IMAGE_READ_ONLY                 0
+#define IMAGE_WRITABLE                  1
+
+/*
+ ******************************************************************************
+ *                             FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              OPEN DISK IMAGE
+ *
+ * Description : Opens the image file that the FATtoDisk functions will access
+ *               as the disk.
+ *
+ * Arguments   : path    - Path of the image file.
+ *               mode    - IMAGE_READ_ONLY or IMAGE_WRITABLE.
+ *
+ * Returns     : IMAGE_OPEN_SUCCESS or FAILED_OPEN_IMAGE.
+ *
+ * Notes       : 1) This must be called before fat_SetBPB. An image that is
+ *                  already open is closed first.
+ *               2) If the image is opened IMAGE_READ_ONLY, the FATtoDisk
+ *                  write functions return FAILED_WRITE_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoImage_Open(const char path[], uint8_t mode);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             CLOSE DISK IMAGE
+ *
+ * Description : Closes the image file opened by FATtoImage_Open.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ *
+ * Notes       : Dirty sectors in the sector pool are not written. Call
+ *               fat_SyncSecPool first if the volume has been modified.
+ * ----------------------------------------------------------------------------
+ */
+void FATtoImage_Close(void);
+
+#endif //FAT_TO_IMAGE_H
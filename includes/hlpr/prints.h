@@ -13,6 +13,67 @@
 #ifndef PRINTS_H
 #define PRINTS_H
 
+/*
+ ******************************************************************************
+ *                                   MACROS   
+ ******************************************************************************
+ */
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             PRINT LINE LENGTH
+ *
+ * Description : Size of the buffer of a PrintLine instance. When a PrintLine
+ *               is full it is passed to the output sink and then emptied, so 
+ *               this only limits how much is sent to the sink in one call.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef PRINT_LINE_LEN
+#define PRINT_LINE_LEN     100
+#endif//PRINT_LINE_LEN
+
+/*
+ ******************************************************************************
+ *                                  TYPEDEFS   
+ ******************************************************************************
+ */
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                           OUTPUT SINK POINTER
+ *
+ * Description : Pointer to a function that all of the print functions pass 
+ *               their output to. By default this sends the chars out of the 
+ *               USART, but it can be replaced with print_SetSink, e.g. to 
+ *               load the output into a buffer.
+ * 
+ * Arguments   : buf   - pointer to the chars to be output.
+ *               len   - number of chars in buf to be output.
+ * ----------------------------------------------------------------------------
+ */
+typedef void (*PrintSink)(const char buf[], uint16_t len);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                                    PRINT LINE
+ *
+ * Description : Line buffer used to build up formatted output, e.g. one line
+ *               of a directory listing, so that it can be passed to the output
+ *               sink in one go instead of a char or field at a time.
+ * 
+ * Members     : buf   - the chars of the line that have not yet been output.
+ *               len   - number of chars in buf.
+ *
+ * Notes       : Set len to 0 before first use, or call print_LineFlush.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct 
+{
+  char buf[PRINT_LINE_LEN];
+  uint8_t len;
+} 
+PrintLine;
+
 /*
  ******************************************************************************
  *                            FUNCTION PROTOTYPES   
@@ -72,4 +133,77 @@ void print_Hex(uint32_t num);
  */
 void print_Str(char *str);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              SET OUTPUT SINK
+ *                                       
+ * Description : Sets the function that the output of all print functions is 
+ *               passed to.
+ * 
+ * Argument    : sink   - pointer to a PrintSink function, or NULL to restore
+ *                        the default USART output.
+ * ----------------------------------------------------------------------------
+ */
+void print_SetSink(PrintSink sink);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 PRINT BUFFER
+ *                                       
+ * Description : Passes len chars of buf to the output sink in a single call.
+ * 
+ * Argument    : buf   - pointer to the chars to be printed.
+ *               len   - number of chars in buf to print.
+ * ----------------------------------------------------------------------------
+ */
+void print_Buf(const char buf[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     ADD C-STRING TO A LINE
+ *                                       
+ * Description : Adds the chars of a C-string to the end of a PrintLine. 
+ * 
+ * Argument    : line   - pointer to the PrintLine instance.
+ *               str    - pointer to the null-terminated string to add.
+ *
+ * Notes       : If the line becomes full, it is output with print_LineFlush
+ *               and the remaining chars are added to the emptied line.
+ * ----------------------------------------------------------------------------
+ */
+void print_LineStr(PrintLine *line, const char str[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              ADD DECIMAL INTEGER TO A LINE
+ *                                       
+ * Description : Adds the unsigned decimal form of num to the end of a 
+ *               PrintLine, padded on the left to a fixed width.
+ * 
+ * Argument    : line    - pointer to the PrintLine instance.
+ *               num     - unsigned integer to add.
+ *               width   - minimum number of chars to add, up to 10. If num
+ *                         has fewer digits then it is padded on the left with
+ *                         pad.
+ *               pad     - char used for padding, e.g. '0' or ' '.
+ *
+ * Notes       : The digits are found by subtracting the powers of ten from a
+ *               table, instead of dividing by 10 for each digit, as the AVR 
+ *               does not have a hardware divide.
+ * ----------------------------------------------------------------------------
+ */
+void print_LineDec(PrintLine *line, uint32_t num, uint8_t width, char pad);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 FLUSH A LINE
+ *                                       
+ * Description : Passes the chars of a PrintLine to the output sink in one 
+ *               call, and empties the line.
+ * 
+ * Argument    : line   - pointer to the PrintLine instance.
+ * ----------------------------------------------------------------------------
+ */
+void print_LineFlush(PrintLine *line);
+
 #endif //PRINTS_H
@@ -72,6 +72,65 @@
  */
 #define BLOCK_LEN       512
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                              SPI CLOCK RATES
+ *
+ * Description : The SPI clock rates used for the SD card. These are SPI CLOCK
+ *               RATES defined in AVR_SPI.H.
+ *
+ *               SD_INIT_CLK_RATE    - Used during initialization. The card
+ *                                     requires a clock between 100 and 400KHz
+ *                                     until it has been initialized.
+ *               SD_DATA_CLK_RATE    - Default rate used after initialization.
+ *                                     fosc/2 (8MHz at 16MHz) is the fastest 
+ *                                     rate of the SPI port, and is below the 
+ *                                     25MHz default speed of the card.
+ *
+ * Notes       : The data rate can be changed with sd_SetClockRate, and is 
+ *               lowered automatically by sd_LowerClockRate when block reads
+ *               keep failing the CRC check. It is not lowered when the card
+ *               is only slow to send a block.
+ * ----------------------------------------------------------------------------
+ */
+#define SD_INIT_CLK_RATE      SPI_CLK_DIV_64
+
+#ifndef SD_DATA_CLK_RATE
+#define SD_DATA_CLK_RATE      SPI_CLK_DIV_2
+#endif//SD_DATA_CLK_RATE
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                           DATA CRC CHECKING
+ *
+ * Description : SD_DATA_CRC set to 1 turns on CRC checking in the card with 
+ *               CRC_ON_OFF (CMD59) during initialization. The CRC16 of each 
+ *               data block read is then verified against the CRC sent by the
+ *               card, and the CRC16 of each block written is sent to the card.
+ *
+ *               SD_CRC_RETRIES      - Number of times a block read that fails
+ *                                     the CRC check is retried at the same 
+ *                                     clock rate before the rate is lowered.
+ *               SD_TOKEN_RETRIES    - Number of times a block read that timed
+ *                                     out waiting for the start block token
+ *                                     is retried. The rate is not changed.
+ *
+ * Notes       : With CRC checking on, a corrupted block is detected when the
+ *               bus is run at a fast rate, instead of being returned as read.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef SD_DATA_CRC
+#define SD_DATA_CRC           0
+#endif//SD_DATA_CRC
+
+#ifndef SD_CRC_RETRIES
+#define SD_CRC_RETRIES        2
+#endif//SD_CRC_RETRIES
+
+#ifndef SD_TOKEN_RETRIES
+#define SD_TOKEN_RETRIES      2
+#endif//SD_TOKEN_RETRIES
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                                  CHIP SELECT
@@ -182,6 +241,59 @@ typedef struct CardTypeVersion{
  */
 uint32_t sd_InitModeSPI(CTV *ctv);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  SET DATA TRANSFER CLOCK RATE
+ *
+ * Description : Sets the SPI clock rate used for accessing the SD card after
+ *               it has been initialized.
+ *
+ * Arguments   : clkRate   - One of the SPI CLOCK RATES in AVR_SPI.H, e.g. 
+ *                           SPI_CLK_DIV_2. Must not be slower than 
+ *                           SD_INIT_CLK_RATE.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : If the card has already been initialized, the SPI port is set
+ *               to the new rate immediately, otherwise it is set when 
+ *               sd_InitModeSPI completes.
+ * ----------------------------------------------------------------------------
+ */
+void sd_SetClockRate(uint8_t clkRate);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  GET DATA TRANSFER CLOCK RATE
+ *
+ * Description : Gets the SPI clock rate used for accessing the SD card after
+ *               it has been initialized.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : One of the SPI CLOCK RATES in AVR_SPI.H.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t sd_GetClockRate(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                LOWER DATA TRANSFER CLOCK RATE
+ *
+ * Description : Lowers the data transfer clock rate to the next slower SPI 
+ *               clock rate, down to SD_INIT_CLK_RATE.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : 1 if the rate was lowered, or 0 if it is already at 
+ *               SD_INIT_CLK_RATE.
+ * 
+ * Notes       : This is called by the read functions in SD_SPI_RWE when a 
+ *               transfer fails, which then retry the transfer at the lower
+ *               rate. The rate is not raised again automatically.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t sd_LowerClockRate(void);
+
 /*
  * ----------------------------------------------------------------------------
  *                                                                    SEND BYTE
@@ -194,8 +306,10 @@ uint32_t sd_InitModeSPI(CTV *ctv);
  * 
  * Notes       : 1) Call as many times as required to send the complete data 
  *                  packet, token, command, etc...
- *               2) This function and sd_ReceiveByteSPI(), are the only direct
- *                  SPI interfacing functions in the SD card module.
+ *               2) This function, sd_ReceiveByteSPI(), and the block 
+ *                  functions sd_SendBlockSPI(), sd_ReceiveBlockSPI() and
+ *                  sd_SkipBlockSPI(), are the only direct SPI interfacing 
+ *                  functions in the SD card module.
  * ----------------------------------------------------------------------------
  */
 void sd_SendByteSPI(uint8_t byte);
@@ -212,12 +326,78 @@ void sd_SendByteSPI(uint8_t byte);
  * 
  * Notes       : 1) Call as many times as necessary to get the complete data
  *                  packet, token, error response, etc... from the SD card.
- *               2) This function and sd_SendByteSPI(), are the only direct
- *                  SPI interfacing functions in the SD card module.
+ *               2) This function, sd_SendByteSPI(), and the block functions
+ *                  sd_SendBlockSPI(), sd_ReceiveBlockSPI() and 
+ *                  sd_SkipBlockSPI(), are the only direct SPI interfacing 
+ *                  functions in the SD card module.
  * ----------------------------------------------------------------------------
  */
 uint8_t sd_ReceiveByteSPI(void);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   SEND BLOCK
+ * 
+ * Description : Sends len bytes from an array to the SD card via SPI.
+ * 
+ * Arguments   : byteArr   - pointer to the array holding the bytes to send.
+ *               len       - number of bytes to send.
+ * 
+ * Returns     : CRC16 of the bytes sent if SD_DATA_CRC is set, else 0.
+ * 
+ * Notes       : Use in place of calling sd_SendByteSPI() for each byte of a
+ *               data block. The bytes are sent back to back by 
+ *               spi_TransmitBlock(), or by spi_TransmitBlockCRC16() when
+ *               SD_DATA_CRC is set.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_SendBlockSPI(const uint8_t byteArr[], uint16_t len);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                RECEIVE BLOCK
+ * 
+ * Description : Receives len bytes from the SD card via SPI into an array.
+ * 
+ * Arguments   : byteArr   - pointer to the array that will be loaded with the
+ *                           received bytes. Must be at least len bytes.
+ *               len       - number of bytes to receive.
+ *               crc       - initial value of the CRC. 0 for the first part of
+ *                           a data block, else the value returned for the 
+ *                           previous part.
+ * 
+ * Returns     : CRC16 of the bytes received, continued from crc, if 
+ *               SD_DATA_CRC is set, else 0.
+ * 
+ * Notes       : Use in place of calling sd_ReceiveByteSPI() for each byte of a
+ *               data block. The bytes are received back to back by 
+ *               spi_ReceiveBlock(), or by spi_ReceiveBlockCRC16() when
+ *               SD_DATA_CRC is set, in which case the CRC is calculated as the
+ *               bytes are received.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_ReceiveBlockSPI(uint8_t byteArr[], uint16_t len, uint16_t crc);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   SKIP BLOCK
+ * 
+ * Description : Receives len bytes from the SD card via SPI without storing
+ *               them, e.g. the bytes of a data block that are not needed.
+ * 
+ * Arguments   : len   - number of bytes to receive and discard.
+ *               crc   - initial value of the CRC, as for sd_ReceiveBlockSPI.
+ * 
+ * Returns     : CRC16 of the bytes received, continued from crc, if 
+ *               SD_DATA_CRC is set, else 0.
+ * 
+ * Notes       : The bytes are clocked in back to back by spi_SkipBlock(), or
+ *               by spi_SkipBlockCRC16() when SD_DATA_CRC is set, so that the
+ *               CRC of the whole block can still be checked.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_SkipBlockSPI(uint16_t len, uint16_t crc);
+
 /*
  * ----------------------------------------------------------------------------
  *                                                                 SEND COMMAND
@@ -42,6 +42,18 @@
  */
 #define START_BLOCK_TKN                0xFE
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                 MULTIPLE BLOCK WRITE TOKENS
+ *
+ * Description : Tokens sent to the SD card during a WRITE_MULTIPLE_BLOCK 
+ *               transfer. Each block is preceded by the start token, and the
+ *               transfer is ended by the stop token.
+ * ----------------------------------------------------------------------------
+ */
+#define START_MULTI_BLOCK_TKN          0xFC
+#define STOP_TRAN_TKN                  0xFD
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                         DATA RESPONSE TOKENS
@@ -82,6 +94,8 @@
  */
 #define START_TOKEN_TIMEOUT            0x0200
 #define READ_SUCCESS                   0x0400
+#define DATA_CRC_ERROR                 0x0800
+#define START_TOKEN_ERROR              0x1000
 
 /* 
  * ----------------------------------------------------------------------------
@@ -118,6 +132,173 @@
 #define ERASE_ERROR                    0x0400
 #define ERASE_BUSY_TIMEOUT             0x0800
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                           STOP TRANSMISSION
+ *
+ * Description : Used to limit the number of attempts to read the R1b busy 
+ *               signal after a STOP_TRANSMISSION command has ended a multiple
+ *               block read.
+ * ----------------------------------------------------------------------------
+ */
+#define STOP_TRAN_BUSY_TIMEOUT_LIMIT   (4 * TIMEOUT_LIMIT)
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                     START BLOCK TOKEN WAIT
+ *
+ * Description : Time, in milliseconds, that a block read waits for the start
+ *               block token before returning START_TOKEN_TIMEOUT. The wait is
+ *               counted in bytes received, so the number of bytes is scaled
+ *               by the current SPI clock rate to give the same time at any 
+ *               rate.
+ *
+ * Notes       : The SD standard gives 100ms as the maximum read access time
+ *               of a standard or high capacity card.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef START_TOKEN_TIMEOUT_MS
+#define START_TOKEN_TIMEOUT_MS         100
+#endif//START_TOKEN_TIMEOUT_MS
+
+#ifndef F_CPU
+#define F_CPU                          16000000UL
+#endif//F_CPU
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             BLOCK READ STATS
+ *
+ * Description : Set SD_STATS to 1 to count the start block token wait loop
+ *               iterations, retries and CPU cycles of the block reads. They
+ *               are returned by sd_GetStats.
+ *
+ * Notes       : The cycles are measured with the 16-bit Timer 3, which is
+ *               started by sd_ResetStats running free at F_CPU / 8. Timer 3
+ *               must not be used for anything else while SD_STATS is set.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef SD_STATS
+#define SD_STATS                       0
+#endif//SD_STATS
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                         ASYNC READ CHUNK LEN
+ *
+ * Description : Maximum number of bytes transferred by each call to 
+ *               sd_PollRead, both while waiting for the start block token and
+ *               while receiving the data block.
+ *
+ * Notes       : A smaller value returns to the application sooner, but 
+ *               requires more calls to read the block. At the fastest SPI 
+ *               clock of F_CPU / 2, each byte takes 16 CPU cycles.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef SD_ASYNC_CHUNK_LEN
+#define SD_ASYNC_CHUNK_LEN             64
+#endif//SD_ASYNC_CHUNK_LEN
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                            ASYNC READ STATUS
+ *
+ * Description : Returned by sd_PollRead to indicate if the read is still in
+ *               progress.
+ * ----------------------------------------------------------------------------
+ */
+#define SD_READ_DONE                   0
+#define SD_READ_BUSY                   1
+
+/*
+ ******************************************************************************
+ *                                  TYPEDEFS   
+ ******************************************************************************
+ */
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       BLOCK HANDLER POINTER
+ *
+ * Description : Pointer to a function that is called by sd_ReadMultipleBlocks
+ *               each time a block has been loaded into the block array.
+ * 
+ * Arguments   : blckArr      - pointer to the array holding the contents of
+ *                              the block that was just read.
+ *               handlerArg   - the handlerArg pointer that was passed to 
+ *                              sd_ReadMultipleBlocks.
+ * 
+ * Returns     : 0 to continue reading blocks. Any other value will stop the 
+ *               read after the current block.
+ * ----------------------------------------------------------------------------
+ */
+typedef uint8_t (*BlockHandler)(uint8_t blckArr[], void *handlerArg);
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             BLOCK READ STATS
+ *
+ * Description : Counters of the block reads, returned by sd_GetStats.
+ * 
+ * Members     : tokenWaits   - bytes received while waiting for the start 
+ *                              block token, summed over all blocks read.
+ *               retries      - number of block reads that were retried.
+ *               cycles       - CPU cycles from sending the read command to
+ *                              receiving the last block. Time spent in a 
+ *                              BlockHandler is not included.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint32_t tokenWaits;
+  uint32_t retries;
+  uint32_t cycles;
+}
+SDStats;
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             ASYNC BLOCK READ
+ *
+ * Description : State of a single block read that is performed a chunk at a
+ *               time by sd_PollRead. See sd_StartRead.
+ * 
+ * Members     : blckAddr     - address of the data block being read.
+ *               blckArr      - pointer to the array being loaded with the 
+ *                              contents of the block.
+ *               pos          - number of bytes of the block received.
+ *               crc          - CRC16 of the bytes received so far.
+ *               err          - Read Block Error and R1 Response of the read,
+ *                              set when the read is done.
+ *               r1           - R1 response to the read command.
+ *               state        - step of the read performed by the next call to
+ *                              sd_PollRead.
+ *               waitCnt      - bytes received while waiting for the start 
+ *                              block token.
+ *               crcRetries   - retries remaining at the current clock rate
+ *                              after a CRC error.
+ *               tknRetries   - retries remaining after a start block token
+ *                              timeout.
+ *
+ * Warnings    : Members of an instance of this struct should never be set
+ *               manually, but only by passing it to the async read functions.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint32_t blckAddr;
+  uint8_t  *blckArr;
+  uint16_t pos;
+  uint16_t crc;
+  uint16_t err;
+  uint8_t  r1;
+  uint8_t  state;
+  uint32_t waitCnt;
+  uint8_t  crcRetries;
+  uint8_t  tknRetries;
+}
+SDAsyncRead;
+
 /*
  ******************************************************************************
  *                               FUNCTIONS   
@@ -148,10 +329,157 @@
  *                            length BLOCK_LEN.
  * 
  * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).   
+ * 
+ * Notes       : 1) If the start block token is not received within 
+ *                  START_TOKEN_TIMEOUT_MS, the read is retried up to 
+ *                  SD_TOKEN_RETRIES times before START_TOKEN_TIMEOUT is 
+ *                  returned. This is card latency, so the clock rate is not
+ *                  changed.
+ *               2) If SD_DATA_CRC is set and the CRC of the block does not 
+ *                  match, or an error token is received in place of the start
+ *                  block token, the read is retried up to SD_CRC_RETRIES 
+ *                  times at the same clock rate, after which the rate is 
+ *                  lowered and the retries start again. DATA_CRC_ERROR or
+ *                  START_TOKEN_ERROR is returned if the rate can not be 
+ *                  lowered any further.
  * ----------------------------------------------------------------------------
  */
 uint16_t sd_ReadSingleBlock(uint32_t blckAddr, uint8_t blckArr[]);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   READ RANGE OF SINGLE BLOCK
+ * 
+ * Description : Reads len bytes, beginning at offset, of a single data block
+ *               from the SD card into an array. The other bytes of the block
+ *               are received but are not stored.
+ * 
+ * Arguments   : blckAddr   - address of the data block on the SD card.
+ *               offset     - position in the block of the first byte to read.
+ *               len        - number of bytes to read. offset + len must not 
+ *                            be greater than BLOCK_LEN.
+ *               buf        - pointer to the array to be loaded with the len
+ *                            bytes.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).
+ * 
+ * Notes       : 1) Used when only a few bytes of a block are needed, e.g. a 
+ *                  single FAT entry, so that a BLOCK_LEN array is not 
+ *                  required. The whole block is still sent by the card, so 
+ *                  the read takes the same time on the bus.
+ *               2) The CRC of the whole block is checked, and the read is 
+ *                  retried, the same as for sd_ReadSingleBlock.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_ReadBlockRange(uint32_t blckAddr, uint16_t offset, uint16_t len,
+                           uint8_t buf[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        READ MULTIPLE BLOCKS
+ * 
+ * Description : Reads consecutive data blocks from the SD card using a single
+ *               READ_MULTIPLE_BLOCK command, which is ended by sending the
+ *               STOP_TRANSMISSION command.
+ * 
+ * Arguments   : startBlckAddr   - address of the first data block to be read.
+ *               numOfBlcks      - number of blocks to read.
+ *               blckArr         - pointer to the array that will be loaded with
+ *                                 the contents of the data blocks. See notes.
+ *               blckHandler     - pointer to a BlockHandler function, or NULL.
+ *               handlerArg      - passed to blckHandler each time it is called.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).
+ * 
+ * Notes       : 1) If blckHandler is NULL then the blocks are loaded into 
+ *                  blckArr one after the other, so it must have a length of at
+ *                  least numOfBlcks * BLOCK_LEN.
+ *               2) If blckHandler is not NULL then blckArr must be of length 
+ *                  BLOCK_LEN. Each block is loaded into it and then passed to
+ *                  blckHandler before the next block is read. If blckHandler
+ *                  returns a non-zero value, no more blocks are read.
+ *               3) The address of the following blocks is incremented by the
+ *                  card, so startBlckAddr must be the address of a block as 
+ *                  required by the card type, i.e. SDSC is byte addressable.
+ *               4) If the start block token is not received, or a block fails
+ *                  the CRC check, the transfer is retried and the clock rate
+ *                  lowered the same as for sd_ReadSingleBlock, unless a block
+ *                  has already been passed to blckHandler. A block that fails
+ *                  the CRC check is not passed to blckHandler.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_ReadMultipleBlocks(uint32_t startBlckAddr, uint32_t numOfBlcks,
+                               uint8_t blckArr[], BlockHandler blckHandler,
+                               void *handlerArg);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             START ASYNC READ
+ * 
+ * Description : Sets an SDAsyncRead instance to read a single data block into
+ *               an array without blocking. Nothing is sent to the card until
+ *               the read is advanced by sd_PollRead.
+ * 
+ * Arguments   : rd         - pointer to the SDAsyncRead instance to be set.
+ *               blckAddr   - address of the data block on the SD card that 
+ *                            will be read into the array.
+ *               blckArr    - pointer to the array to be loaded with the 
+ *                            contents of the data block at blckAddr. Must be 
+ *                            length BLOCK_LEN.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : 1) The card is selected from the first call to sd_PollRead 
+ *                  until the read is done. No other SD card function may be
+ *                  called while the read is in progress.
+ *               2) blckArr must not be used by the application until the 
+ *                  read is done.
+ * ----------------------------------------------------------------------------
+ */
+void sd_StartRead(SDAsyncRead *rd, uint32_t blckAddr, uint8_t blckArr[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              POLL ASYNC READ
+ * 
+ * Description : Advances a read started by sd_StartRead by one step, and 
+ *               returns without waiting on the card. Each step sends the read
+ *               command, or transfers up to SD_ASYNC_CHUNK_LEN bytes of the 
+ *               wait for the start block token or of the data block.
+ * 
+ * Arguments   : rd   - pointer to an SDAsyncRead instance set by 
+ *                      sd_StartRead.
+ * 
+ * Returns     : SD_READ_BUSY if the read is still in progress, or 
+ *               SD_READ_DONE, in which case the result is returned by 
+ *               sd_CompleteRead.
+ * 
+ * Notes       : 1) This is intended to be called from the application's main
+ *                  loop, between its other tasks. It may also be called from
+ *                  a timer interrupt, but not while the main loop uses the 
+ *                  SPI port.
+ *               2) Failed steps are retried, and the clock rate lowered, the
+ *                  same as for sd_ReadSingleBlock.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t sd_PollRead(SDAsyncRead *rd);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          COMPLETE ASYNC READ
+ * 
+ * Description : Returns the result of a read started by sd_StartRead. If the
+ *               read is not yet done, it is first polled until it is.
+ * 
+ * Arguments   : rd   - pointer to an SDAsyncRead instance set by 
+ *                      sd_StartRead.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte),
+ *               the same as sd_ReadSingleBlock.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_CompleteRead(SDAsyncRead *rd);
+
 /*
  * ----------------------------------------------------------------------------
  *                                                           PRINT SINGLE BLOCK
@@ -187,6 +515,33 @@ void sd_PrintSingleBlock(const uint8_t blckArr[]);
  */
 uint16_t sd_WriteSingleBlock(uint32_t blckAddr, const uint8_t dataArr[]);
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       WRITE MULTIPLE BLOCKS
+ * 
+ * Description : Writes the values in an array to consecutive SD card data 
+ *               blocks using a single WRITE_MULTIPLE_BLOCK command, which is
+ *               ended by sending the stop transmission token.
+ * 
+ * Arguments   : startBlckAddr   - address of the first data block to write.
+ *               numOfBlcks      - number of blocks to write.
+ *               dataArr         - pointer to an array holding the data that 
+ *                                 will be written to the blocks, one after 
+ *                                 the other. Must be at least numOfBlcks * 
+ *                                 BLOCK_LEN bytes long.
+ * 
+ * Returns     : Write Block Error (upper byte) and R1 Response (lower byte).
+ * 
+ * Notes       : 1) The address of the following blocks is incremented by the
+ *                  card, so startBlckAddr must be the address of a block as 
+ *                  required by the card type, i.e. SDSC is byte addressable.
+ *               2) If a block is not accepted, the transfer is stopped and the
+ *                  error of that block is returned.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_WriteMultipleBlocks(uint32_t startBlckAddr, uint32_t numOfBlcks,
+                                const uint8_t dataArr[]);
+
 /*
  * ----------------------------------------------------------------------------
  *                                                                 ERASE BLOCKS
@@ -248,4 +603,38 @@ void sd_PrintWriteError(uint16_t err);
  */
 void sd_PrintEraseError(uint16_t err);
 
+#if SD_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         GET BLOCK READ STATS
+ * 
+ * Description : Loads the block read counters into stats.
+ * 
+ * Arguments   : stats   - pointer to the SDStats instance to be loaded.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void sd_GetStats(SDStats *stats);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       RESET BLOCK READ STATS
+ * 
+ * Description : Sets the block read counters to 0, and starts Timer 3 if it
+ *               is not already running.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * 
+ * Notes       : This must be called once before the cycles are measured, 
+ *               e.g. after sd_InitModeSPI.
+ * ----------------------------------------------------------------------------
+ */
+void sd_ResetStats(void);
+
+#endif//SD_STATS
+
 #endif // SD_SPI_RWE_H
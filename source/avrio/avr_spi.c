@@ -13,6 +13,31 @@
 #include <avr/io.h>
 #include "avr_spi.h"
 
+/*
+ ******************************************************************************
+ *                          "PRIVATE" CRC16 NIBBLE TABLE
+ ******************************************************************************
+ */
+
+//
+// CRC16-CCITT (x^16 + x^12 + x^5 + 1) of each of the 16 possible values of 
+// the upper nibble of the CRC register, so that the CRC can be updated four
+// bits at a time with only 32 bytes of table.
+//
+static const uint16_t crc16NibbleTbl[16] = 
+{
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+// update the CRC16 with one data byte, upper nibble first.
+static inline uint16_t pvt_CRC16Byte(uint16_t crc, uint8_t byte)
+{
+  crc = crc << 4 ^ crc16NibbleTbl[(crc >> 12 ^ byte >> 4) & 0x0F];
+  crc = crc << 4 ^ crc16NibbleTbl[(crc >> 12 ^ byte) & 0x0F];
+  return crc;
+}
+
 /*
  ******************************************************************************
  *                                  FUNCTIONS
@@ -48,12 +73,64 @@ void spi_MasterInit(void)
   // PRSPI in PPR0 must be 0 to enable SPI. Should be 0 by default.
   PRR0 &= ~(1 << PRSPI);
 
-  //Enable SPI in master mode. Set clock rate: ck/64 = 16MHz/64 = 250KHz.
-  //SPCR: SPIE=0, SPE=1, DORD=0, MSTR=1, CPOL=0, CPHA=0, SPR1=1, SPR0=0
-  SPCR = 1 << SPE | 1 << MSTR | 1 << SPR1;
+  //Enable SPI in master mode.
+  //SPCR: SPIE=0, SPE=1, DORD=0, MSTR=1, CPOL=0, CPHA=0
+  SPCR = 1 << SPE | 1 << MSTR;
+
+  // Set clock rate: ck/64 = 16MHz/64 = 250KHz. SPR1=1, SPR0=0, SPI2X=0
+  spi_SetClockRate(SPI_CLK_DIV_64);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SET SPI CLOCK RATE
+ * 
+ * Description : Sets the clock rate of the SPI port.
+ *
+ * Arguments   : clkRate   - One of the SPI CLOCK RATES, e.g. SPI_CLK_DIV_2.
+ *                           Values slower than SPI_CLK_SLOWEST are set to
+ *                           SPI_CLK_SLOWEST.
+ * ----------------------------------------------------------------------------
+ */
+void spi_SetClockRate(uint8_t clkRate)
+{
+  if (clkRate > SPI_CLK_SLOWEST)
+    clkRate = SPI_CLK_SLOWEST;
 
-  //SPI2X = 0. Set to 1 to double clock rate.
-  SPSR &= ~(1 << SPI2X);
+  //
+  // Each pair of rates shares the same SPR1:0 bits, with SPI2X set for the 
+  // faster of the two. ck/128 is the exception, as SPR1:0 = 11 with SPI2X set
+  // is the same as ck/64.
+  //
+  uint8_t spr = clkRate >> 1;
+  uint8_t spi2x = !(clkRate & 1) && clkRate != SPI_CLK_DIV_128;
+  
+  SPCR = (SPCR & ~(1 << SPR1 | 1 << SPR0)) 
+       | (spr >> 1) << SPR1 | (spr & 1) << SPR0;
+  if (spi2x)
+    SPSR |= 1 << SPI2X;
+  else
+    SPSR &= ~(1 << SPI2X);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          GET SPI CLOCK RATE
+ * 
+ * Description : Gets the current clock rate setting of the SPI port.
+ *
+ * Returns     : One of the SPI CLOCK RATES.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t spi_GetClockRate(void)
+{
+  uint8_t spr = (SPCR >> SPR1 & 1) << 1 | (SPCR >> SPR0 & 1);
+  uint8_t spi2x = SPSR >> SPI2X & 1;
+
+  // SPR1:0 = 11 is ck/128, or ck/64 with SPI2X set.
+  if (spr == 3)
+    return spi2x ? SPI_CLK_DIV_64 : SPI_CLK_DIV_128;
+  return spr << 1 | !spi2x;
 }
 
 /*
@@ -88,3 +165,221 @@ void spi_MasterTransmit(uint8_t byte)
   while ( !(SPSR & 1 << SPIF))
     ;
 }
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           SPI RECEIVE BLOCK
+ * 
+ * Description : Receives len bytes via the SPI port into buf. SPI_FILL_BYTE 
+ *               is sent for each byte received.
+ * 
+ * Arguments   : buf   - array the received bytes are loaded into. Must be at
+ *                       least len bytes.
+ *               len   - number of bytes to receive.
+ * ----------------------------------------------------------------------------
+ */
+void spi_ReceiveBlock(uint8_t buf[], uint16_t len)
+{
+  if (!len)
+    return;
+
+  // start the transfer of the first byte.
+  SPDR = SPI_FILL_BYTE;
+
+  //
+  // as soon as a byte has been received, read it and start the transfer of 
+  // the next byte. The received byte is then stored while the next byte is
+  // being shifted in.
+  //
+  uint8_t *bufEnd = buf + len - 1;
+  while (buf < bufEnd)
+  {
+    while ( !(SPSR & 1 << SPIF))
+      ;
+    uint8_t byte = SPDR;
+    SPDR = SPI_FILL_BYTE;
+    *buf++ = byte;
+  }
+
+  // last byte. No further transfer is started.
+  while ( !(SPSR & 1 << SPIF))
+    ;
+  *buf = SPDR;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SPI TRANSMIT BLOCK
+ * 
+ * Description : Sends len bytes from buf via the SPI port. Received bytes are
+ *               discarded.
+ * 
+ * Arguments   : buf   - array holding the bytes to send.
+ *               len   - number of bytes to send.
+ * ----------------------------------------------------------------------------
+ */
+void spi_TransmitBlock(const uint8_t buf[], uint16_t len)
+{
+  if (!len)
+    return;
+
+  const uint8_t *bufEnd = buf + len;
+
+  // start the transfer of the first byte.
+  SPDR = *buf++;
+
+  // load the next byte while the previous one is shifted out.
+  while (buf < bufEnd)
+  {
+    uint8_t byte = *buf++;
+    while ( !(SPSR & 1 << SPIF))
+      ;
+    SPDR = byte;
+  }
+
+  // wait for the last byte to complete.
+  while ( !(SPSR & 1 << SPIF))
+    ;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              SPI SKIP BLOCK
+ * 
+ * Description : Receives len bytes via the SPI port without storing them.
+ *               SPI_FILL_BYTE is sent for each byte received.
+ * 
+ * Arguments   : len   - number of bytes to receive and discard.
+ * ----------------------------------------------------------------------------
+ */
+void spi_SkipBlock(uint16_t len)
+{
+  // nothing is stored, so each transfer starts as soon as the last is done.
+  for (; len; --len)
+  {
+    SPDR = SPI_FILL_BYTE;
+    while ( !(SPSR & 1 << SPIF))
+      ;
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 SPI RECEIVE BLOCK WITH CRC16
+ * 
+ * Description : Same as spi_ReceiveBlock, but also calculates the CRC16-CCITT
+ *               of the received bytes.
+ * 
+ * Arguments   : buf   - array the received bytes are loaded into. Must be at
+ *                       least len bytes.
+ *               len   - number of bytes to receive.
+ *               crc   - initial value of the CRC.
+ * 
+ * Returns     : CRC16 of the len bytes received, continued from crc.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t spi_ReceiveBlockCRC16(uint8_t buf[], uint16_t len, uint16_t crc)
+{
+  if (!len)
+    return crc;
+
+  // start the transfer of the first byte.
+  SPDR = SPI_FILL_BYTE;
+
+  // store and add each received byte to the CRC while the next is shifted in
+  uint8_t *bufEnd = buf + len - 1;
+  while (buf < bufEnd)
+  {
+    while ( !(SPSR & 1 << SPIF))
+      ;
+    uint8_t byte = SPDR;
+    SPDR = SPI_FILL_BYTE;
+    *buf++ = byte;
+    crc = pvt_CRC16Byte(crc, byte);
+  }
+
+  // last byte. No further transfer is started.
+  while ( !(SPSR & 1 << SPIF))
+    ;
+  *buf = SPDR;
+  return pvt_CRC16Byte(crc, *buf);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    SPI SKIP BLOCK WITH CRC16
+ * 
+ * Description : Same as spi_SkipBlock, but the discarded bytes are added to
+ *               the CRC16-CCITT.
+ * 
+ * Arguments   : len   - number of bytes to receive and discard.
+ *               crc   - initial value of the CRC.
+ * 
+ * Returns     : CRC16 of the len bytes received, continued from crc.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t spi_SkipBlockCRC16(uint16_t len, uint16_t crc)
+{
+  if (!len)
+    return crc;
+
+  // start the transfer of the first byte.
+  SPDR = SPI_FILL_BYTE;
+
+  // add each received byte to the CRC while the next is shifted in.
+  while (--len)
+  {
+    while ( !(SPSR & 1 << SPIF))
+      ;
+    uint8_t byte = SPDR;
+    SPDR = SPI_FILL_BYTE;
+    crc = pvt_CRC16Byte(crc, byte);
+  }
+
+  // last byte. No further transfer is started.
+  while ( !(SPSR & 1 << SPIF))
+    ;
+  return pvt_CRC16Byte(crc, SPDR);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                SPI TRANSMIT BLOCK WITH CRC16
+ * 
+ * Description : Same as spi_TransmitBlock, but also calculates the 
+ *               CRC16-CCITT of the bytes sent.
+ * 
+ * Arguments   : buf   - array holding the bytes to send.
+ *               len   - number of bytes to send.
+ * 
+ * Returns     : CRC16 of the len bytes sent, with an initial value of 0.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t spi_TransmitBlockCRC16(const uint8_t buf[], uint16_t len)
+{
+  uint16_t crc = 0;
+
+  if (!len)
+    return crc;
+
+  const uint8_t *bufEnd = buf + len;
+
+  // start the transfer of the first byte.
+  SPDR = *buf;
+  crc = pvt_CRC16Byte(crc, *buf++);
+
+  // add the next byte to the CRC while the previous one is shifted out.
+  while (buf < bufEnd)
+  {
+    uint8_t byte = *buf++;
+    crc = pvt_CRC16Byte(crc, byte);
+    while ( !(SPSR & 1 << SPIF))
+      ;
+    SPDR = byte;
+  }
+
+  // wait for the last byte to complete.
+  while ( !(SPSR & 1 << SPIF))
+    ;
+  return crc;
+}
@@ -11,8 +11,28 @@
  */
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "avr_usart.h"
 
+#if USART_TX_BUF_LEN
+/*
+ ******************************************************************************
+ *                          "PRIVATE" GLOBAL VARIABLES
+ ******************************************************************************
+ */
+
+#define TX_BUF_MASK    (USART_TX_BUF_LEN - 1)
+
+//
+// Transmit ring buffer. Bytes are loaded at txHead and sent from txTail by 
+// the UDRE interrupt. The buffer is empty when txHead == txTail, so it holds
+// at most USART_TX_BUF_LEN - 1 bytes.
+//
+static volatile uint8_t txBuf[USART_TX_BUF_LEN];
+static volatile uint8_t txHead;
+static volatile uint8_t txTail;
+#endif//USART_TX_BUF_LEN
+
 /*
  ******************************************************************************
  *                                  FUNCTIONS
@@ -39,6 +59,12 @@ void usart_Init(void)
   
   // Set USART - Asynch mode, no parity, data frame = 8 data, 1 stop
   UCSR0C = 1 << UCSZ01 | 1 << UCSZ00;
+
+#if USART_TX_BUF_LEN
+  // the buffered bytes are sent by the UDRE interrupt.
+  txHead = txTail = 0;
+  sei();
+#endif//USART_TX_BUF_LEN
 }
 
 /*
@@ -73,10 +99,108 @@ uint8_t usart_Receive(void)
  */
 void usart_Transmit(uint8_t data)
 {
+#if USART_TX_BUF_LEN
+  // wait for room in the transmit buffer.
+  while ( !usart_Write(&data, 1))
+    ;
+#else
   // poll Data Reg Empty Flag until it is set.
   while( !(UCSR0A & 1 << UDRE0))
     ;
   
   // load data into usart buffer which will transmit it.
   UDR0 = data;
+#endif//USART_TX_BUF_LEN
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 USART WRITE
+ *                                       
+ * Description : Loads as many bytes from an array as will fit into the 
+ *               transmit buffer, without waiting, to be sent via the USART.
+ * 
+ * Arguments   : data   - pointer to the array of bytes to send.
+ *               len    - number of bytes in data to send.
+ * 
+ * Returns     : Number of bytes loaded into the transmit buffer.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t usart_Write(const uint8_t data[], uint16_t len)
+{
+#if USART_TX_BUF_LEN
+  uint16_t cnt = 0;
+  uint8_t head = txHead;
+
+  // only the ISR changes txTail, so there is no need to disable interrupts.
+  for (; cnt < len; ++cnt)
+  {
+    uint8_t next = (head + 1) & TX_BUF_MASK;
+    if (next == txTail)                     // buffer is full
+      break;
+    txBuf[head] = data[cnt];
+    head = next;
+  }
+  txHead = head;
+
+  // 
+  // enable the UDRE interrupt to send the loaded bytes. The ISR disables it
+  // again when the buffer is empty, so this must not be interrupted.
+  //
+  if (cnt)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    UCSR0B |= 1 << UDRIE0;
+    SREG = sreg;
+  }
+  return cnt;
+#else
+  for (uint16_t cnt = 0; cnt < len; ++cnt)
+    usart_Transmit(data[cnt]);
+  return len;
+#endif//USART_TX_BUF_LEN
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 USART FLUSH
+ *                                       
+ * Description : Waits until all bytes in the transmit buffer have been sent.
+ * 
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+void usart_Flush(void)
+{
+#if USART_TX_BUF_LEN
+  while (txHead != txTail)
+    ;
+#endif//USART_TX_BUF_LEN
+
+  // wait for the last byte to be moved from UDR0.
+  while( !(UCSR0A & 1 << UDRE0))
+    ;
+}
+
+#if USART_TX_BUF_LEN
+/*
+ * ----------------------------------------------------------------------------
+ *                                              USART DATA REGISTER EMPTY ISR
+ *                                       
+ * Description : Sends the next byte in the transmit buffer each time UDR0 is
+ *               ready for it. Disables itself when the buffer is empty.
+ * ----------------------------------------------------------------------------
+ */
+ISR(USART0_UDRE_vect)
+{
+  uint8_t tail = txTail;
+  if (tail == txHead)
+  {
+    UCSR0B &= ~(1 << UDRIE0);
+    return;
+  }
+  UDR0 = txBuf[tail];
+  txTail = (tail + 1) & TX_BUF_MASK;
 }
+#endif//USART_TX_BUF_LEN
@@ -9,10 +9,12 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include "prints.h"
 #include "fat_bpb.h"
 #include "fat.h"
+#include "fat_cache.h"
 #include "fat_to_disk_if.h"
 
 /*
@@ -21,16 +23,90 @@
  ******************************************************************************
  */
 
+//
+// Used by fat_FindNextEntry to reject directory entries that cannot match the
+// name being searched for before their long names are decoded. See 
+// pvt_SetNameFilter.
+//
+typedef struct
+{
+  const char *nameStr;                      // name being searched for
+  uint8_t nameLen;                          // strlen(nameStr)
+  uint8_t lnEntCnt;                         // num of ln entries for nameStr 
+  uint8_t isSn;                             // 1 if nameStr has an 8.3 form
+  char    snRaw[SN_NAME_CHAR_LEN + SN_EXT_CHAR_LEN]; // 8.3 form of nameStr
+  uint8_t addToCache;                       // 1 to cache the matching entry
+  uint32_t dirClusIndx;                     // dir first clus, if addToCache
+}
+NameFilter;
+
+// number of long name characters held in a single long name entry
+#define LN_CHARS_PER_ENT     13
+
+//
+// attributes that an entry is rejected for by the attrMask of 
+// pvt_IterNextEntry, unless they are also set in attrMask. Passing 
+// NO_ATTR_FILTER as attrMask returns entries with any attributes.
+//
+#define FILTERED_ATTR_MASK   (HIDDEN_ATTR | SYSTEM_ATTR | VOLUME_ID_ATTR  \
+                              | DIR_ENTRY_ATTR)
+#define NO_ATTR_FILTER       0xFF
+#define ATTR_REJECTED(ATTR, MASK)  ((ATTR) & ~(MASK) & FILTERED_ATTR_MASK)
+
+//
+// load the little endian 16 / 32-bit value at bytes. The entry fields are
+// little endian, as is the AVR, so the bytes are copied as a single value,
+// which the compiler turns into direct loads. There is no alignment to keep.
+//
+static inline uint16_t pvt_LoadLE16(const uint8_t bytes[])
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint16_t val;
+  memcpy(&val, bytes, sizeof(val));
+  return val;
+#else
+  return (uint16_t)bytes[1] << 8 | bytes[0];
+#endif//__BYTE_ORDER__
+}
+
+static inline uint32_t pvt_LoadLE32(const uint8_t bytes[])
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint32_t val;
+  memcpy(&val, bytes, sizeof(val));
+  return val;
+#else
+  return (uint32_t)pvt_LoadLE16(&bytes[2]) << 16 | pvt_LoadLE16(bytes);
+#endif//__BYTE_ORDER__
+}
+
+static void pvt_SetIterToEntry(FatDirIter *iter, const FatEntry *ent, 
+                               const BPB *bpb);
+static uint8_t pvt_IterNextEntry(FatDirIter *iter, FatEntry *ent,
+                                 const NameFilter *flt, uint8_t attrMask);
+static uint8_t pvt_IterLoadSec(FatDirIter *iter);
+static void pvt_IterNextSec(FatDirIter *iter);
+static void pvt_SetNameFilter(NameFilter *flt, const char nameStr[]);
+static uint8_t pvt_CheckLnFilter(const NameFilter *flt, const uint8_t lnEnt[]);
+static uint8_t pvt_MatchPattern(const char patStr[], const char nameStr[]);
 static void pvt_UpdateFatEntryMembers(FatEntry *ent, const char lnStr[], 
                 const uint8_t secArr[], uint16_t snPos,
-                uint8_t snEntSecNumInClus, uint32_t snEntClusIndx);
+                uint8_t snEntSecNumInClus, uint32_t snEntClusIndx,
+                const NameFilter *flt);
 static uint8_t pvt_CheckName(const char nameStr[]);
-static uint8_t pvt_SetDirToParent(FatDir *dir, const BPB *bpb);
+static uint8_t pvt_GetPathComp(const char **pathPtr, char compStr[]);
+static uint32_t pvt_GetFstClusIndx(const FatEntry *ent, const BPB *bpb);
+static void pvt_SetDotEntry(FatEntry *ent, uint32_t dirClusIndx, 
+                            const BPB *bpb);
+static uint8_t pvt_EnterDir(FatDir *dir, const FatEntry *ent, const BPB *bpb);
 static void pvt_LoadLongName(int lnFirstEnt, int lnLastEnt, 
                              const uint8_t secArr[], char lnStr[]);
-static uint32_t pvt_GetNextClusIndex(uint32_t clusIndex, const BPB *bpb);
-static void pvt_PrintEntFields(const uint8_t *byte, uint8_t flags);
-static uint8_t pvt_PrintFile(const uint8_t snEnt[], const BPB *bpb);
+static void pvt_LineEntFields(PrintLine *line, const FatEntry *ent, 
+                              uint8_t flags);
+static void pvt_LineDate(PrintLine *line, uint16_t date);
+static void pvt_LineTime(PrintLine *line, uint16_t time);
+static uint8_t pvt_PrintFile(const FatEntry *ent, const BPB *bpb);
+static uint8_t pvt_PrintSector(uint8_t secArr[], void *handlerArg);
 
 /*
  ******************************************************************************
@@ -52,11 +128,13 @@ static uint8_t pvt_PrintFile(const uint8_t snEnt[], const BPB *bpb);
  */
 void fat_SetDirToRoot(FatDir *dir, const BPB *bpb)
 {
+#if FAT_PATH_TRACKING
   // set string members to indicate root cluster
   strcpy(dir->snStr, "/");
   strcpy(dir->snPathStr, "");
   strcpy(dir->lnStr, "/");
   strcpy(dir->lnPathStr, "");
+#endif//FAT_PATH_TRACKING
   
   // set first cluster index to that of the root cluster
   dir->fstClusIndx = bpb->rootClus;
@@ -81,9 +159,11 @@ void fat_InitEntry(FatEntry *ent, const BPB *bpb)
   strcpy(ent->lnStr, "");
   strcpy(ent->snStr, "");
   
-  // fill short name entry array with 0's
-  for(uint8_t entByte = 0; entByte < ENTRY_LEN; ++entByte)
-    ent->snEnt[entByte] = 0;
+  // set short name entry fields to 0's
+  memset(&ent->fld, 0, sizeof(ent->fld));
+#if !FAT_COMPACT_ENTRY
+  memset(ent->snEnt, 0, ENTRY_LEN);
+#endif//FAT_COMPACT_ENTRY
 
   // set rest of the FatEntry members to 0. 
   ent->snEntSecNumInClus = 0;
@@ -109,185 +189,299 @@ void fat_InitEntry(FatEntry *ent, const BPB *bpb)
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_SetNextEntry(FatEntry *currEnt, const BPB *bpb)
-{  
-  //
-  // this section sets the initial values of the different nested loop
-  // counters for the first time they are entered during a single function 
-  // call. These are set according to the state of the currEnt members.
-  //
+{
+  FatDirIter iter;
+  pvt_SetIterToEntry(&iter, currEnt, bpb);
+  uint8_t err = pvt_IterNextEntry(&iter, currEnt, NULL, NO_ATTR_FILTER);
+  fat_CloseDirIter(&iter);
+  return err;
+}
 
-  // index of the cluster where the previous short name entry was found
-  uint32_t clusIndx = currEnt->snEntClusIndx;
-  // sector num in the cluster where the previous short name entry was found
-  uint8_t  secNumInClus = currEnt->snEntSecNumInClus;
-  // position of entry following previous short name entry in the sector
-  uint16_t entPos = currEnt->nextEntPos;
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    OPEN A DIRECTORY ITERATOR
+ *                                      
+ * Description : Sets a FatDirIter instance to the first entry of a directory.
+ * 
+ * Arguments   : iter   - Pointer to the FatDirIter instance to be set.
+ *               dir    - Pointer to a FatDir instance. This is the directory
+ *                        whose entries will be iterated over.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_OpenDirIter(FatDirIter *iter, const FatDir *dir, const BPB *bpb)
+{
+  iter->bpb = bpb;
+  iter->clusIndx = dir->fstClusIndx;
+  iter->secNumInClus = FIRST_SEC_POS_IN_CLUS;
+  iter->entPos = FIRST_ENT_POS_IN_SEC;
+  iter->secArr = NULL;
+}
 
-  //
-  // if previous short name entry occupied the last entry position of a sector
-  // then increment secNumInClus and set entPos to 0 so that the search for the
-  // next entry will begin on this function call at the first entry of the next
-  // sector. For the case when the the next sector is beyond the cluster limit 
-  // it will be handled in the nested loops.
-  //
-  if (entPos == SECTOR_LEN)
+/*
+ * ----------------------------------------------------------------------------
+ *                                         SET FAT ENTRY TO NEXT ITERATOR ENTRY
+ *                                      
+ * Description : Sets a FatEntry instance to the next entry of the directory
+ *               and advances the iterator past it.
+ * 
+ * Arguments   : iter   - Pointer to an open FatDirIter instance.
+ *               ent    - Pointer to the FatEntry instance that will be set
+ *                        to the next entry.
+ *
+ * Returns     : SUCCESS if ent was set to the next entry. END_OF_DIRECTORY if
+ *               there are no more entries, otherwise any other FAT Error Flag
+ *               returned while reading the directory.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_NextDirEntry(FatDirIter *iter, FatEntry *ent)
+{
+  return pvt_IterNextEntry(iter, ent, NULL, NO_ATTR_FILTER);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   CLOSE A DIRECTORY ITERATOR
+ *                                      
+ * Description : Closes a FatDirIter instance, returning the sector buffer it
+ *               holds to the sector pool.
+ * 
+ * Arguments   : iter   - Pointer to an open FatDirIter instance.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_CloseDirIter(FatDirIter *iter)
+{
+  if (iter->secArr != NULL)
   {
-    ++secNumInClus;
-    entPos = 0;
+    fat_ReleaseSector(iter->secArr);
+    iter->secArr = NULL;
   }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              FIND NEXT ENTRY MATCHING A NAME
+ *                                      
+ * Description : Updates a FatEntry instance to point to the next entry in its
+ *               directory whose name matches nameStr.
+ * 
+ * Arguments   : currEnt   - Pointer to a FatEntry instance. Its members will 
+ *                           be updated to point to the matching entry. 
+ *               nameStr   - Pointer to a string. This is the name to find.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS if a matching entry was found. END_OF_DIRECTORY if 
+ *               there is no matching entry after currEnt, otherwise any other
+ *               FAT Error Flag returned while reading the directory.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_FindNextEntry(FatEntry *currEnt, const char nameStr[], 
+                          const BPB *bpb)
+{
+  uint8_t err;
 
-  // loop over clusters beginning at clusIndx to search for next entry.
-  do 
+  // 
+  // If the search begins at the start of a directory, then currEnt's cluster
+  // index is the directory's first cluster, and the entry may be found in the
+  // directory entry cache without reading the directory.
+  //
+  uint8_t  fromDirStart = !currEnt->snEntSecNumInClus && !currEnt->nextEntPos;
+  uint32_t dirClusIndx = currEnt->snEntClusIndx;
+  if (fromDirStart)
   {
-    //
-    // loop over sectors in the cluster to find the next entry. If this loop is
-    // re-entered in a single function call then secNumInClus will be reset to
-    // 0 in the outer cluser loop. The first time it is entered it should be
-    // initialized to the value of the snEntSecNumInClus member of the currEnt
-    // instance of FatEntry.
-    //
-    for (; secNumInClus < bpb->secPerClus; ++secNumInClus)
+    const FatDirCacheEntry *cachedEnt = fat_FindDirCacheEntry(dirClusIndx, 
+                                                              nameStr);
+    if (cachedEnt != NULL)
     {
-      // calculate location of sector on the disk
-      uint32_t secNumOnDisk = secNumInClus + bpb->dataRegionFirstSector
-                            + (clusIndx - bpb->rootClus) 
-                            * bpb->secPerClus;
-      
-      // create and load array with data bytes from the disk sector
-      uint8_t secArr[bpb->bytesPerSec];  
-      if (FATtoDisk_ReadSingleSector(secNumOnDisk, secArr) 
-          == FAILED_READ_SECTOR)
-        return FAILED_READ_SECTOR;
+      pvt_UpdateFatEntryMembers(currEnt, nameStr, cachedEnt->snEnt, 0,
+                                cachedEnt->snEntSecNumInClus,
+                                cachedEnt->snEntClusIndx, NULL);
+      currEnt->nextEntPos = cachedEnt->snEntPos + ENTRY_LEN;
+      return SUCCESS;
+    }
+  }
 
-      //
-      // loop over entries in the sector to search for the next entry. If this 
-      // loop is re-entered in a single function call then entPos will be reset 
-      // to 0 in the sector loop. The first time it is entered entPos should be
-      // initialized to the value of the nextEntPos member of the currEnt
-      // instance of FatEntry.
-      //
-      for (; entPos < bpb->bytesPerSec; entPos += ENTRY_LEN)
-      {
-        // if first byte of an entry is 0, remaining entries should be empty
-        if (!secArr[entPos])                                                       
-          return END_OF_DIRECTORY;
+  // 
+  // The first match in the directory is cached for the next search. This is
+  // done by pvt_UpdateFatEntryMembers, while the raw entry is still loaded.
+  //
+  NameFilter flt;
+  pvt_SetNameFilter(&flt, nameStr);
+  flt.addToCache = fromDirStart;
+  flt.dirClusIndx = dirClusIndx;
+
+  // only entries that pass the filter are decoded and compared.
+  FatDirIter iter;
+  pvt_SetIterToEntry(&iter, currEnt, bpb);
+  while ((err = pvt_IterNextEntry(&iter, currEnt, &flt, NO_ATTR_FILTER))
+         == SUCCESS)
+    if (!strcmp(currEnt->lnStr, nameStr))
+      break;
+  fat_CloseDirIter(&iter);
+  return err;
+}
 
-        if (secArr[entPos] == DELETED_ENTRY_TOKEN)
-          continue;
+/*
+ * ----------------------------------------------------------------------------
+ *                                   FIND ENTRIES MATCHING A PATTERN AND FILTER
+ *                                      
+ * Description : Scans a directory once, calling entHandler for each entry 
+ *               whose name matches a wildcard pattern and whose attributes 
+ *               pass attrMask.
+ * 
+ * Arguments   : dir          - Pointer to a FatDir instance. This is the 
+ *                              directory that will be scanned.
+ *               patStr       - Pointer to the pattern string, or NULL to 
+ *                              match every name. See Notes.
+ *               attrMask     - The HIDDEN_ATTR, SYSTEM_ATTR, VOLUME_ID_ATTR
+ *                              and DIR_ENTRY_ATTR attributes an entry may 
+ *                              have. Entries with any of these attributes 
+ *                              that are not in attrMask are skipped. 
+ *               entHandler   - Pointer to the EntryHandler function called 
+ *                              for each matching entry.
+ *               handlerArg   - Passed to entHandler each time it is called.
+ *               bpb          - Pointer to the BPB struct instance.
+ *
+ * Returns     : END_OF_DIRECTORY if the whole directory was scanned. If 
+ *               entHandler returns a value other than SUCCESS, the scan stops
+ *               and that value is returned. Otherwise any other FAT Error Flag
+ *               returned while reading the directory.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_FindEntries(const FatDir *dir, const char patStr[], 
+                        uint8_t attrMask, EntryHandler entHandler,
+                        void *handlerArg, const BPB *bpb)
+{
+  uint8_t err;
 
-        // check attribute byte to see if entPos points to a long name entry
-        if ((secArr[entPos + ATTR_BYTE_OFFSET] & LN_ATTR_MASK) == LN_ATTR_MASK)
-        {
-          // entPos must be pointing to the last entry of a long name here.
-          if (!(secArr[entPos] & LN_LAST_ENTRY_FLAG))
-            return CORRUPT_FAT_ENTRY;
-          
-          // initialize empty long name string 
-          char lnStr[LN_STR_LEN_MAX] = {'\0'};   
-
-          // calculate position of short name relative to first byte in sector
-          uint16_t snPos = entPos + ENTRY_LEN * (LN_ORD_MASK & secArr[entPos]);
-
-          // enter if short name is in the next sector
-          if (snPos >= bpb->bytesPerSec)
-          {              
-            uint8_t nextSecArr[bpb->bytesPerSec]; 
-
-            //
-            // locate next sector. Depending on the number of the sector in the 
-            // cluster, the next sector will either be in the next cluster or 
-            // it will be the next sector in the cluster and on the disk.
-            //
-            if (secNumInClus == bpb->secPerClus - 1)  // next sec in next clus
-            {
-              // calculate location of next sector in next clus on the disk
-              secNumOnDisk = bpb->dataRegionFirstSector 
-                           + (pvt_GetNextClusIndex(clusIndx, bpb)
-                           - bpb->rootClus)
-                           * bpb->secPerClus;
-              secNumInClus = 0;
-            }
-            else                  // next sector is the next physical sector 
-            {
-              ++secNumOnDisk;
-              ++secNumInClus;
-            }
+  FatDirIter iter;
+  FatEntry ent;
+  fat_OpenDirIter(&iter, dir, bpb);
+  while ((err = pvt_IterNextEntry(&iter, &ent, NULL, attrMask)) == SUCCESS)
+  {
+    if (patStr != NULL && !pvt_MatchPattern(patStr, ent.lnStr)
+        && !pvt_MatchPattern(patStr, ent.snStr))
+      continue;
 
-            // load next sector into nextSecArr[].
-            if (FATtoDisk_ReadSingleSector(secNumOnDisk, nextSecArr) 
-                == FAILED_READ_SECTOR)
-              return FAILED_READ_SECTOR;
-            
-            // snPos to point to sn entry relative to first byte of next sector
-            snPos -= bpb->bytesPerSec;
-            
-            // verify snPos does not point to long name
-            if ((nextSecArr[snPos + ATTR_BYTE_OFFSET] & LN_ATTR_MASK) 
-                 == LN_ATTR_MASK)
-              return CORRUPT_FAT_ENTRY;
-            
-            //
-            // check if a ln spans the sector boundary. At this point, sn is in
-            // next sector, but if sn is not first entry (i.e. snPos != 0) then 
-            // entries for ln are in the current sector and next sector.
-            //
-            if (snPos)
-            {
-              // Entry preceeding short name must be first entry of long name      
-              if ((nextSecArr[snPos - ENTRY_LEN] & LN_ORD_MASK) != 1)
-                return CORRUPT_FAT_ENTRY;
+    err = entHandler(&ent, handlerArg);
+    if (err != SUCCESS)
+      break;
+  }
+  fat_CloseDirIter(&iter);
+  return err;
+}
 
-              // Call twice for both current and next sector.
-              pvt_LoadLongName(snPos - ENTRY_LEN, FIRST_ENT_POS_IN_SEC,
-                               nextSecArr, lnStr);
-              pvt_LoadLongName(LAST_ENTRY_POS_IN_SEC, entPos, secArr, lnStr);
-            }
-            else   // full ln in current sec, but sn is first ent in next sec
-            {
-              // Entry preceeding short name must be first entry of long name
-              if ((secArr[LAST_ENTRY_POS_IN_SEC] & LN_ORD_MASK) != 1)
-                return CORRUPT_FAT_ENTRY;
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        RESOLVE A PATH STRING
+ *                                      
+ * Description : Follows the path, pathStr, one component at a time and sets a
+ *               FatEntry instance to the entry of its last component.
+ * 
+ * Arguments   : dir       - Pointer to a FatDir instance. A relative path 
+ *                           begins at this directory.
+ *               pathStr   - Pointer to the path string.
+ *               ent       - Pointer to the FatEntry instance that will be set
+ *                           to the entry of the last component of the path.
+ *               pathDir   - Pointer to a FatDir instance that will be set to
+ *                           the directory holding the entry, or NULL.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, DIR_NOT_FOUND if any component other than the last 
+ *               is not a directory in the path, FILE_NOT_FOUND if the last 
+ *               component was not found, INVALID_NAME, or any other FAT Error
+ *               Flag returned while reading a directory.
+ * 
+ * Notes       : 1) A path beginning with '/' is absolute, otherwise it is
+ *                  relative to dir. Components are separated by '/', and may
+ *                  be "." or "..". The parent of the root directory is the 
+ *                  root directory.
+ *               2) Each component is found with fat_FindNextEntry, so only the
+ *                  directory sectors up to each matching entry are read, and
+ *                  components found in the directory entry cache are not read
+ *                  at all. The same FatEntry instance, ent, is used for every
+ *                  component.
+ *               3) The path strings of a FatDir are only built if pathDir is
+ *                  not NULL. pathDir may point to the same instance as dir. 
+ *                  If an error is returned then pathDir may have been set to
+ *                  any directory in the path.
+ *               4) If the path ends in a directory that is not found by an
+ *                  entry in its parent, e.g. "/", ".", or "dir/.", then ent is
+ *                  set to a "." entry of that directory. This entry has only
+ *                  the DIR_ENTRY_ATTR attribute and its first cluster index.
+ *               5) Names are case-sensitive, and must be a long name unless a
+ *                  long name for the entry does not exist, in which case it 
+ *                  must be a short name.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_ResolvePath(const FatDir *dir, const char pathStr[], FatEntry *ent,
+                        FatDir *pathDir, const BPB *bpb)
+{
+  uint8_t  err;
+  uint32_t dirClusIndx;
+  char     compStr[LN_STR_LEN_MAX];
 
-              pvt_LoadLongName(LAST_ENTRY_POS_IN_SEC, entPos, secArr, lnStr);
-            }
-            pvt_UpdateFatEntryMembers(currEnt, lnStr, nextSecArr, snPos,
-                                      secNumInClus, clusIndx);
-            return SUCCESS;
-          }
-          else          // Long and short name are in the current sector.
-          {   
-            // Verify snPos does not point to long name
-            if ((secArr[snPos + ATTR_BYTE_OFFSET] & LN_ATTR_MASK) 
-                 == LN_ATTR_MASK)
-              return CORRUPT_FAT_ENTRY;
+  // an absolute path begins at the root directory.
+  if (*pathStr == '/')
+  {
+    dirClusIndx = bpb->rootClus;
+    if (pathDir != NULL)
+      fat_SetDirToRoot(pathDir, bpb);
+  }
+  else
+  {
+    dirClusIndx = dir->fstClusIndx;
+    if (pathDir != NULL && pathDir != dir)
+      *pathDir = *dir;
+  }
+
+  // 
+  // ent is first set to the "." entry of the starting directory, so that a
+  // path without any names, e.g. "/", resolves to the starting directory.
+  //
+  pvt_SetDotEntry(ent, dirClusIndx, bpb);
+
+  while (*pathStr)
+  {
+    if (pvt_GetPathComp(&pathStr, compStr) == INVALID_NAME)
+      return INVALID_NAME;
+
+    // a path of only '/' chars has no names.
+    if (!strcmp(compStr, ""))
+      break;
+
+    // the previous component must be a directory to hold this component.
+    if (!(FAT_ENT_ATTR(ent) & DIR_ENTRY_ATTR))
+      return DIR_NOT_FOUND;
+
+    // only update the path strings of pathDir if one was passed.
+    if (pathDir != NULL && (err = pvt_EnterDir(pathDir, ent, bpb)) != SUCCESS)
+      return err;
     
-            // entry preceeding short name must be first entry of long name
-            if ((secArr[snPos - ENTRY_LEN] & LN_ORD_MASK) != 1)
-              return CORRUPT_FAT_ENTRY;
-            
-            pvt_LoadLongName(snPos - ENTRY_LEN, entPos, secArr, lnStr);
-            pvt_UpdateFatEntryMembers(currEnt, lnStr, secArr, snPos, 
-                                      secNumInClus, clusIndx);
-            return SUCCESS;                          
-          }                   
-        }
-        else            // Long name does not exist. Use short name instead.
-        {
-          // passing empty string for long name
-          pvt_UpdateFatEntryMembers(currEnt, "", secArr, entPos,
-                                    secNumInClus, clusIndx);
-          return SUCCESS;  
-        }
-      }
-      entPos = FIRST_ENT_POS_IN_SEC;      // reset counter for entry loop
+    dirClusIndx = pvt_GetFstClusIndx(ent, bpb);
+    if (!strcmp(compStr, "."))
+      pvt_SetDotEntry(ent, dirClusIndx, bpb);
+    else if (!strcmp(compStr, "..") && dirClusIndx == bpb->rootClus)
+      pvt_SetDotEntry(ent, dirClusIndx, bpb); // root dir does not have a ".."
+    else
+    {
+      // search the directory from its first entry, ignoring the Volume ID.
+      fat_InitEntry(ent, bpb);
+      ent->snEntClusIndx = dirClusIndx;
+      while ((err = fat_FindNextEntry(ent, compStr, bpb)) == SUCCESS
+             && (FAT_ENT_ATTR(ent) & VOLUME_ID_ATTR))
+        ;
+      if (err == END_OF_DIRECTORY)
+        return *pathStr ? DIR_NOT_FOUND : FILE_NOT_FOUND;
+      else if (err != SUCCESS)
+        return err;
     }
-    secNumInClus = FIRST_SEC_POS_IN_CLUS;// reset counter for sector loop
   }
-  // get index of next cluster and continue looping if not last cluster
-  while ((clusIndx = pvt_GetNextClusIndex(clusIndx, bpb)) != END_CLUSTER);
-
-  // return here if the end of the dir was reached without finding a next entry
-  return END_OF_DIRECTORY;
+  return SUCCESS;
 }
 
 /*
@@ -298,103 +492,62 @@ uint8_t fat_SetNextEntry(FatEntry *currEnt, const BPB *bpb)
  * 
  * Arguments   : dir         - Pointer to the FatDir instance to be set to the
  *                             new directory.             
- *               newDirStr   - Pointer to a string that specifies the name of 
+ *               newDirStr   - Pointer to a string that specifies the path of
  *                             the new directory.
  *               bpb         - Pointer to the BPB struct instance.
  * 
  * Returns     : A FAT Error Flag. If any value other than SUCCESS is returned 
- *               then the function was unable to update the FatEntry. 
+ *               then the function was unable to update the FatDir. 
+ *               DIR_NOT_FOUND is returned if the path does not lead to a
+ *               directory.
  *  
- * Notes       : 1) This function can only set the directory to a child or the
- *                  parent of the FatDir instance (dir) when the function is
- *                  called, or reset the instance to the root directory.
- *               2) Paths (relative or absolute) should not be included in the 
- *                  newDirStr. newDirStr must be only be a directory name which
- *                  must be the name of a child, or the parent, directory of
- *                  the current directory.
- *               3) If ".." is passed as the newDirStr then the new directory
- *                  will be set to the parent of the current directory.               
+ * Notes       : 1) newDirStr can be a directory name, or a relative or 
+ *                  absolute path, e.g. "../docs" or "/docs/2021". See 
+ *                  fat_ResolvePath.
+ *               2) If ".." is passed as the newDirStr then the new directory
+ *                  will be set to the parent of the current directory.
+ *               3) If "~" is passed as the newDirStr then the new directory
+ *                  will be set to the root directory.
  *               4) newDirStr is case-sensitive.
- *               5) newDirStr must be a long name, unless a long name does not
- *                  exist for a directory, only then can it be a short name.
+ *               5) Each name in newDirStr must be a long name, unless a long
+ *                  name does not exist for a directory, only then can it be a
+ *                  short name.
+ *               6) dir is unchanged if any value other than SUCCESS is
+ *                  returned.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_SetDir(FatDir *dir, const char newDirStr[], const BPB *bpb)
 {
-  // for function return errors. This is the loop cond. and the return value.
+  // for function return errors.
   uint8_t err;                              
 
-  if (pvt_CheckName(newDirStr) == INVALID_NAME)  // if newDirStr is illegal
-    return INVALID_NAME;
-  else if (!strcmp(newDirStr, "."))         // if newDirStr is current dir
-    return SUCCESS;
-  else if (!strcmp(newDirStr, ".."))        // if newDirStr is parent dir
-    return pvt_SetDirToParent(dir, bpb);    // FAILED_READ_SECTOR or SUCCESS
-  else if (!strcmp(newDirStr, "~"))         // if newDirStr is "return to root"
+  if (!strcmp(newDirStr, "~"))              // if newDirStr is "return to root"
   {
     fat_SetDirToRoot(dir, bpb);
     return SUCCESS;
   }
 
   // 
-  // Create and initialize a FatEntry instance. This will set the snEntClusIndx
-  // member to the root directory and all other members to 0 or null strings, 
-  // then update the snEntClusIndx to point to the first cluster index of the 
-  // FatDir instance (dir).
+  // Resolve the path into newDir, which is then set to the directory holding
+  // the entry of the last directory in the path. dir is only updated once the
+  // whole path has been resolved, so that it is unchanged if this fails.
   //
   FatEntry ent;
-  fat_InitEntry(&ent, bpb);
-  ent.snEntClusIndx = dir->fstClusIndx;
-
-  // 
-  // Search FatDir directory to see if a child directory matches newDirStr.
-  // Done by repeatedly calling fat_SetNextEntry() to set a FatEntry instance
-  // to the next entry in the directory and then comparing the lnStr member of 
-  // the instance to newDirStr. Note that the lnStr member will be the same as
-  // the snStr if a lnStr does not exist for the entry, therefore, short names
-  // can only be used when a lnStr does not exist for the entry.
-  //
-  while ((err = fat_SetNextEntry(&ent, bpb)) == SUCCESS)
-  {
-    // if entry is not a directory entry, get next entry
-    if (!(ent.snEnt[ATTR_BYTE_OFFSET] & DIR_ENTRY_ATTR))
-      continue;
-
-    // if entry matches newDirStr 
-    if (!strcmp(ent.lnStr, newDirStr))
-    {
-      // get value of the first cluster index in the FAT for that entry.
-      dir->fstClusIndx = ent.snEnt[FST_CLUS_INDX_BYTE_OFFSET_3];
-      dir->fstClusIndx <<= 8;
-      dir->fstClusIndx |= ent.snEnt[FST_CLUS_INDX_BYTE_OFFSET_2];
-      dir->fstClusIndx <<= 8;
-      dir->fstClusIndx |= ent.snEnt[FST_CLUS_INDX_BYTE_OFFSET_1];
-      dir->fstClusIndx <<= 8;
-      dir->fstClusIndx |= ent.snEnt[FST_CLUS_INDX_BYTE_OFFSET_0];
-      
-      // fill short name array with its characters from the entry
-      char snStr[SN_NAME_CHAR_LEN + 1] = {'\0'};      
-      for (uint8_t strPos = 0; strPos < SN_NAME_CHAR_LEN; ++strPos)
-        snStr[strPos] = ent.snEnt[strPos];
-
-      // Append current directory name to the short and long name paths
-      strcat (dir->lnPathStr, dir->lnStr);
-      strcat (dir->snPathStr, dir->snStr);
-
-      // Update dir to new dir name. If current dir != root dir append '/'
-      if (strcmp(dir->lnStr, "/"))
-        strcat(dir->lnPathStr, "/"); 
-      strcpy(dir->lnStr, newDirStr);
-      
-      if (strcmp(dir->snStr, "/"))
-        strcat(dir->snPathStr, "/");
-      strcpy(dir->snStr, snStr);
-
-      return SUCCESS;
-    }
-  }
-  // No matching entry found. FatDir is unchanged.
-  return err;
+  FatDir   newDir;
+  err = fat_ResolvePath(dir, newDirStr, &ent, &newDir, bpb);
+  if (err == FILE_NOT_FOUND)
+    return DIR_NOT_FOUND;
+  else if (err != SUCCESS)
+    return err;
+
+  // last component in the path must be a directory.
+  if (!(FAT_ENT_ATTR(&ent) & DIR_ENTRY_ATTR))
+    return DIR_NOT_FOUND;
+
+  if ((err = pvt_EnterDir(&newDir, &ent, bpb)) != SUCCESS)
+    return err;
+  *dir = newDir;
+  return SUCCESS;
 }
 
 /*
@@ -431,44 +584,42 @@ uint8_t fat_PrintDir(const FatDir *dir, uint8_t entFlds, const BPB *bpb)
   uint8_t err;
 
   // 
-  // Create and initialize a FatEntry instance. This will set the snEntClusIndx
-  // member to the root directory and all other members to 0 or null strings, 
-  // then update the snEntClusIndx to point to the first cluster index of the 
-  // FatDir instance (dir).
+  // iterate over the entries of the directory, printing each entry and its
+  // fields according to entFlds. The iterator holds the current sector of 
+  // the directory, so each sector is only read once. After all entries in the
+  // dir have been loaded, fat_NextDirEntry will return END_OF_DIRECTORY.
   //
-  FatEntry ent;
-  fat_InitEntry(&ent, bpb);
-  ent.snEntClusIndx = dir->fstClusIndx;
-
-  // 
-  // set the ent FatEntry instance to the next entry in the directory, then 
-  // print the entry and fields according to entFlds. After all entries in the
-  // dir have been loaded, fat_SetNextEntry will return END_OF_DIRECTORY.
+  // The Volume ID entry, and hidden entries if the hidden filter flag is not
+  // set, are rejected by the iterator before their long names are loaded.
   //
-  while ((err = fat_SetNextEntry(&ent, bpb)) == SUCCESS)
+  // Each entry's fields are built up in line, which is printed in one go.
+  FatDirIter iter;
+  FatEntry ent;
+  PrintLine line;
+  line.len = 0;
+  uint8_t attrMask = SYSTEM_ATTR | DIR_ENTRY_ATTR;
+  if (entFlds & HIDDEN)
+    attrMask |= HIDDEN_ATTR;
+  fat_OpenDirIter(&iter, dir, bpb);
+  while ((err = pvt_IterNextEntry(&iter, &ent, NULL, attrMask)) == SUCCESS)
   { 
-    // Do not print entry if it is hidden and hidden filter flag is not set
-    if (ent.snEnt[ATTR_BYTE_OFFSET] & HIDDEN_ATTR && !(entFlds & HIDDEN))
-      continue;
-
-    // Do not print entry if it is the Volume ID entry
-    if (ent.snEnt[ATTR_BYTE_OFFSET] & VOLUME_ID_ATTR)
-      continue;
-    
     // Print short names if the SHORT_NAME filter flag is set.
     if ((entFlds & SHORT_NAME) == SHORT_NAME)
     {
-      pvt_PrintEntFields(ent.snEnt, entFlds);
-      print_Str(ent.snStr);
+      pvt_LineEntFields(&line, &ent, entFlds);
+      print_LineStr(&line, ent.snStr);
     }
 
     // Print long names if the LONG_NAME filter flag is set.
     if ((entFlds & LONG_NAME) == LONG_NAME)
     {
-      pvt_PrintEntFields(ent.snEnt, entFlds);
-      print_Str(ent.lnStr);
+      pvt_LineEntFields(&line, &ent, entFlds);
+      print_LineStr(&line, ent.lnStr);
     }
+    print_LineFlush(&line);
   }
+  fat_CloseDirIter(&iter);
+
   // return END_OF_DIRECTORY if successful. Any other value returned is error.
   return err;
 }
@@ -479,60 +630,42 @@ uint8_t fat_PrintDir(const FatDir *dir, uint8_t entFlds, const BPB *bpb)
  *                                       
  * Description : Prints the contents of any file entry to the screen. 
  * 
- * Arguments   : dir        - Pointer to a FatDir instance. This directory must
- *                            contain the entry for the file to be printed.
- *               fileStr    - Pointer to a string. This is the name of the file
- *                            who's contents will be printed.
+ * Arguments   : dir        - Pointer to a FatDir instance. A relative path in
+ *                            fileStr begins at this directory.
+ *               fileStr    - Pointer to a string. This is the name, or path, 
+ *                            of the file who's contents will be printed.
  *               bpb        - Pointer to the BPB struct instance.
  *
  * Returns     : FAT Error Flag. If any value other than END_OF_FILE is 
  *               returned, then an issue has occurred.
  *  
- * Notes       : fileStr must be a long name unless a long name for a given
- *               entry does not exist, in which case it must be a short name.
+ * Notes       : Each name in fileStr must be a long name unless a long name 
+ *               for a given entry does not exist, in which case it must be a 
+ *               short name. See fat_ResolvePath.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_PrintFile(const FatDir *dir, const char fileStr[], const BPB *bpb)
 {
-  // for function return errors. This is the loop cond. and the return value.
+  // for function return errors.
   uint8_t err;
-    
-  if (pvt_CheckName(fileStr) == INVALID_NAME)
-    return INVALID_NAME;
 
   // 
-  // Create and initialize a FatEntry instance. This will set the snEntClusIndx
-  // member to the root directory and all other members to 0 or null strings, 
-  // then, update the snEntClusIndx to point to the first cluster index of the 
-  // FatDir instance (dir).
+  // Resolve fileStr to its entry. fileStr may be a path, relative to dir. 
+  // Once a matching file is found then the "private" function, 
+  // pvt_PrintFile() is called to print this file.
   //
   FatEntry ent;
-  fat_InitEntry(&ent, bpb);
-  ent.snEntClusIndx = dir->fstClusIndx;
+  err = fat_ResolvePath(dir, fileStr, &ent, NULL, bpb);
+  if (err != SUCCESS)
+    return err;
 
-  // 
-  // Search for a file matching fileStr in the current directory. Do this
-  // by calling fat_SetNextEntry() to set the FatEntry instance to the next
-  // entry in the directory. This is repeated until a file name is returned
-  // that matches fileStr. Once a match is found then the "private"
-  // function, pvt_PrintFile() is called to print this file. If no matching 
-  // file is found, then the loop will exit once END_OF_DIRECTORY is returned.
-  //
-  while ((err = fat_SetNextEntry(&ent, bpb)) == SUCCESS) 
-  { 
-    // if entry is a directory, continue
-    if (ent.snEnt[ATTR_BYTE_OFFSET] & DIR_ENTRY_ATTR)
-      continue;
+  // if entry is a directory, the file was not found
+  if (FAT_ENT_ATTR(&ent) & DIR_ENTRY_ATTR)
+    return FILE_NOT_FOUND;
 
-    // if matching file is found print its contents
-    if (!strcmp(ent.lnStr, fileStr))
-    {
-      print_Str("\n\n\r");
-      err = pvt_PrintFile(ent.snEnt, bpb);  //END_OF_FILE or FAILED_READ_SECTOR
-      return err;
-    }
-  }
-  return err;                               // no matching file was found.
+  // matching file is found. Print its contents
+  print_Str("\n\n\r");
+  return pvt_PrintFile(&ent, bpb);          //END_OF_FILE or error flag
 }
 
 /*
@@ -574,6 +707,15 @@ void fat_PrintError (uint8_t err)
     case FAILED_READ_SECTOR:
       print_Str("\n\rFAILED_READ_SECTOR");
       break;
+    case FAILED_WRITE_SECTOR:
+      print_Str("\n\rFAILED_WRITE_SECTOR");
+      break;
+    case NO_FREE_CLUSTER:
+      print_Str("\n\rNO_FREE_CLUSTER");
+      break;
+    case NO_FREE_HANDLE:
+      print_Str("\n\rNO_FREE_HANDLE");
+      break;
     default:
       print_Str("\n\rUNKNOWN_ERROR");
   }
@@ -585,6 +727,469 @@ void fat_PrintError (uint8_t err)
  ******************************************************************************
  */
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                    (PRIVATE) SET ITERATOR TO FOLLOW AN ENTRY
+ *                                      
+ * Description : Sets a FatDirIter instance to the position that follows the
+ *               entry of a FatEntry instance in its directory.
+ * 
+ * Arguments   : iter   - Pointer to the FatDirIter instance to be set.
+ *               ent    - Pointer to a FatEntry instance.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : void
+ *
+ * Notes       : Used by fat_SetNextEntry and fat_FindNextEntry to continue
+ *               from a FatEntry. The iterator must be closed afterwards.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_SetIterToEntry(FatDirIter *iter, const FatEntry *ent,
+                               const BPB *bpb)
+{
+  iter->bpb = bpb;
+  iter->clusIndx = ent->snEntClusIndx;
+  iter->secNumInClus = ent->snEntSecNumInClus;
+  iter->entPos = ent->nextEntPos;
+  iter->secArr = NULL;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        (PRIVATE) SET FAT ENTRY TO NEXT ENTRY
+ *                                      
+ * Description : Implements fat_NextDirEntry, fat_SetNextEntry, 
+ *               fat_FindNextEntry and fat_FindEntries. Updates a FatEntry 
+ *               instance to point to the next entry of the iterator's 
+ *               directory that passes the name and attribute filters, and 
+ *               advances the iterator past it.
+ * 
+ * Arguments   : iter       - Pointer to an open FatDirIter instance.
+ *               ent        - Pointer to a FatEntry instance. Its members will
+ *                            be updated to point to the next entry. 
+ *               flt        - Pointer to a NameFilter set by 
+ *                            pvt_SetNameFilter, or NULL to return every entry.
+ *               attrMask   - An entry with any of the FILTERED_ATTR_MASK 
+ *                            attributes that are not set in attrMask is 
+ *                            rejected. NO_ATTR_FILTER rejects no entries.
+ *
+ * Returns     : A FAT Error Flag. If any value other than SUCCESS is returned 
+ *               then the function was unable to update the FatEntry.
+ * 
+ * Notes       : 1) Entries that are rejected by either filter are skipped 
+ *                  without their long names being decoded. The attributes 
+ *                  are checked in the raw short name entry. An entry that 
+ *                  passes the name filter may still not match, so its name 
+ *                  must be compared.
+ *               2) The iterator keeps the sector it is in, so a sector is 
+ *                  only loaded when the iterator moves into it.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_IterNextEntry(FatDirIter *iter, FatEntry *ent,
+                                 const NameFilter *flt, uint8_t attrMask)
+{
+  uint8_t err;
+
+  //
+  // loop over the entries of the directory, beginning at the iterator's
+  // position, to search for the next entry.
+  //
+  for (;; iter->entPos += ENTRY_LEN)
+  {
+    //
+    // move to the sector holding entPos. This is normally at most one sector,
+    // but if the filter skipped over a long name that continues in the next 
+    // sector, entPos is carried into that sector.
+    //
+    while (iter->entPos >= SECTOR_LEN)
+    {
+      iter->entPos -= SECTOR_LEN;
+      pvt_IterNextSec(iter);
+    }
+
+    // load the current sector if the iterator has moved into it.
+    err = pvt_IterLoadSec(iter);
+    if (err != SUCCESS)
+      return err;
+
+    const uint8_t *secArr = iter->secArr;
+    uint16_t entPos = iter->entPos;
+
+    // if first byte of an entry is 0, remaining entries should be empty
+    if (!secArr[entPos])                                                       
+      return END_OF_DIRECTORY;
+
+    if (secArr[entPos] == DELETED_ENTRY_TOKEN)
+      continue;
+
+    // check attribute byte to see if entPos points to a long name entry
+    if ((secArr[entPos + ATTR_BYTE_OFFSET] & LN_ATTR_MASK) == LN_ATTR_MASK)
+    {
+      // entPos must be pointing to the last entry of a long name here.
+      if (!(secArr[entPos] & LN_LAST_ENTRY_FLAG))
+        return CORRUPT_FAT_ENTRY;
+      
+      // calculate position of short name relative to first byte in sector
+      uint16_t snPos = entPos + ENTRY_LEN * (LN_ORD_MASK & secArr[entPos]);
+
+      //
+      // if long name cannot match the filter, or its short name entry is in
+      // this sector and has a rejected attribute, skip to its short name. 
+      // Otherwise the attributes are checked once the next sector is loaded.
+      //
+      if ((flt != NULL && !pvt_CheckLnFilter(flt, &secArr[entPos]))
+          || (snPos < SECTOR_LEN 
+              && ATTR_REJECTED(secArr[snPos + ATTR_BYTE_OFFSET], attrMask)))
+      {
+        iter->entPos = snPos;
+        continue;
+      }
+
+      // initialize empty long name string 
+      char lnStr[LN_STR_LEN_MAX] = {'\0'};   
+
+      // enter if short name is in the next sector
+      if (snPos >= SECTOR_LEN)
+      {              
+        //
+        // move the iterator into the next sector, which will either be the
+        // next sector in the cluster or the first sector of the next cluster.
+        // The current sector is kept until the long name has been loaded.
+        //
+        const uint8_t *prevSecArr = secArr;
+        uint8_t isRejected = 0;
+        iter->secArr = NULL;
+        pvt_IterNextSec(iter);
+        err = pvt_IterLoadSec(iter);
+
+        // a long name must not be the last entry of the directory.
+        if (err == END_OF_DIRECTORY)
+          err = CORRUPT_FAT_ENTRY;
+
+        if (err == SUCCESS)
+        {
+          // snPos to point to sn entry relative to first byte of next sector
+          snPos -= SECTOR_LEN;
+          secArr = iter->secArr;
+          
+          // verify snPos does not point to long name
+          if ((secArr[snPos + ATTR_BYTE_OFFSET] & LN_ATTR_MASK) 
+               == LN_ATTR_MASK)
+            err = CORRUPT_FAT_ENTRY;
+
+          // the long name is not loaded if the entry has a rejected attribute
+          else if (ATTR_REJECTED(secArr[snPos + ATTR_BYTE_OFFSET], attrMask))
+            isRejected = 1;
+          
+          //
+          // check if a ln spans the sector boundary. At this point, sn is in
+          // next sector, but if sn is not first entry (i.e. snPos != 0) then
+          // entries for ln are in the current sector and next sector.
+          //
+          else if (snPos)
+          {
+            // Entry preceeding short name must be first entry of long name
+            if ((secArr[snPos - ENTRY_LEN] & LN_ORD_MASK) != 1)
+              err = CORRUPT_FAT_ENTRY;
+            else
+            {
+              // Call twice for both current and next sector.
+              pvt_LoadLongName(snPos - ENTRY_LEN, FIRST_ENT_POS_IN_SEC,
+                               secArr, lnStr);
+              pvt_LoadLongName(LAST_ENTRY_POS_IN_SEC, entPos, prevSecArr, 
+                               lnStr);
+            }
+          }
+          else   // full ln in current sec, but sn is first ent in next sec
+          {
+            // Entry preceeding short name must be first entry of long name
+            if ((prevSecArr[LAST_ENTRY_POS_IN_SEC] & LN_ORD_MASK) != 1)
+              err = CORRUPT_FAT_ENTRY;
+            else
+              pvt_LoadLongName(LAST_ENTRY_POS_IN_SEC, entPos, prevSecArr,
+                               lnStr);
+          }
+        }
+        fat_ReleaseSector(prevSecArr);
+        if (err != SUCCESS)
+          return err;
+
+        // skip past the short name, which is in the iterator's sector now.
+        if (isRejected)
+        {
+          iter->entPos = snPos;
+          continue;
+        }
+      }
+      else          // Long and short name are in the current sector.
+      {   
+        // Verify snPos does not point to long name
+        if ((secArr[snPos + ATTR_BYTE_OFFSET] & LN_ATTR_MASK) == LN_ATTR_MASK)
+          return CORRUPT_FAT_ENTRY;
+
+        // entry preceeding short name must be first entry of long name
+        if ((secArr[snPos - ENTRY_LEN] & LN_ORD_MASK) != 1)
+          return CORRUPT_FAT_ENTRY;
+        
+        pvt_LoadLongName(snPos - ENTRY_LEN, entPos, secArr, lnStr);
+      }
+      pvt_UpdateFatEntryMembers(ent, lnStr, secArr, snPos, 
+                                iter->secNumInClus, iter->clusIndx, flt);
+      iter->entPos = snPos + ENTRY_LEN;
+      return SUCCESS;
+    }
+    else            // Long name does not exist. Use short name instead.
+    {
+      if (ATTR_REJECTED(secArr[entPos + ATTR_BYTE_OFFSET], attrMask))
+        continue;
+
+      // if filter is set, the short name must match its 8.3 form.
+      if (flt != NULL 
+          && (!flt->isSn || memcmp(&secArr[entPos], flt->snRaw, 
+                                   sizeof(flt->snRaw))))
+        continue;
+
+      // passing empty string for long name
+      pvt_UpdateFatEntryMembers(ent, "", secArr, entPos,
+                                iter->secNumInClus, iter->clusIndx, flt);
+      iter->entPos = entPos + ENTRY_LEN;
+      return SUCCESS;  
+    }
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                     (PRIVATE) LOAD ITERATOR'S CURRENT SECTOR
+ *                                      
+ * Description : Borrows the iterator's current sector from the sector pool if
+ *               the iterator does not already hold it.
+ * 
+ * Arguments   : iter   - Pointer to an open FatDirIter instance.
+ *
+ * Returns     : SUCCESS, END_OF_DIRECTORY if the iterator has moved past the
+ *               last cluster of the directory, or FAILED_READ_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_IterLoadSec(FatDirIter *iter)
+{
+  const BPB *bpb = iter->bpb;
+
+  if (iter->secArr != NULL)
+    return SUCCESS;
+
+  if (iter->clusIndx == END_CLUSTER)
+    return END_OF_DIRECTORY;
+  if (iter->clusIndx == FAILED_CLUS_INDX)
+    return FAILED_READ_SECTOR;
+
+  // calculate location of sector on the disk
+  uint32_t secNumOnDisk = iter->secNumInClus + bpb->dataRegionFirstSector
+                        + (iter->clusIndx - bpb->rootClus) * bpb->secPerClus;
+
+  FAT_SET_READ_CAT(READ_CAT_DIR);
+  iter->secArr = fat_GetSector(secNumOnDisk);
+  if (iter->secArr == NULL)
+    return FAILED_READ_SECTOR;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                   (PRIVATE) MOVE ITERATOR TO THE NEXT SECTOR
+ *                                      
+ * Description : Releases the iterator's current sector and moves it to the 
+ *               next sector of the directory. This is the next sector in the
+ *               cluster, or the first sector of the next cluster in the 
+ *               directory's cluster chain.
+ * 
+ * Arguments   : iter   - Pointer to an open FatDirIter instance.
+ *
+ * Returns     : void
+ *
+ * Notes       : The next sector is not loaded. If the current sector is the
+ *               last sector of the directory, clusIndx is set to END_CLUSTER,
+ *               or to FAILED_CLUS_INDX if the FAT could not be read.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_IterNextSec(FatDirIter *iter)
+{
+  fat_CloseDirIter(iter);
+
+  if (iter->clusIndx == END_CLUSTER || iter->clusIndx == FAILED_CLUS_INDX)
+    return;
+
+  if (++iter->secNumInClus == iter->bpb->secPerClus)
+  {
+    iter->secNumInClus = FIRST_SEC_POS_IN_CLUS;
+    iter->clusIndx = fat_GetNextClusIndex(iter->clusIndx, iter->bpb);
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                (PRIVATE) SET THE NAME FILTER
+ *  
+ * Description : Sets a NameFilter instance for the name, nameStr. This 
+ *               determines the number of long name entries a long name equal
+ *               to nameStr would occupy, and the 8.3 short name entry form of
+ *               nameStr, if it has one.
+ * 
+ * Arguments   : flt       - Pointer to the NameFilter instance to set.
+ *               nameStr   - Pointer to the name string.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_SetNameFilter(NameFilter *flt, const char nameStr[])
+{
+  size_t len = strlen(nameStr);
+
+  flt->nameStr = nameStr;
+  flt->nameLen = len > LN_STR_LEN_MAX ? LN_STR_LEN_MAX : len;
+  flt->lnEntCnt = (flt->nameLen + LN_CHARS_PER_ENT - 1) / LN_CHARS_PER_ENT;
+
+  // 
+  // 8.3 form is the name padded with spaces to 8 chars, followed by the ext
+  // padded to 3 chars. "." and ".." are stored as the name with no extension.
+  //
+  memset(flt->snRaw, ' ', sizeof(flt->snRaw));
+  flt->isSn = 0;
+
+  const char *extPtr = NULL;
+  size_t nameCharCnt = len;
+  size_t extCharCnt = 0;
+  if (strcmp(nameStr, ".") && strcmp(nameStr, ".."))
+  {
+    // the extension follows the '.'. There can only be one '.' in the name.
+    extPtr = strchr(nameStr, '.');
+    if (extPtr != NULL)
+    {
+      if (strchr(extPtr + 1, '.') != NULL)
+        return;
+      nameCharCnt = extPtr - nameStr;
+      extCharCnt = len - nameCharCnt - 1;
+      ++extPtr;
+    }
+  }
+  
+  // does not have an 8.3 form. If there is a '.' there must be an extension.
+  if (nameCharCnt == 0 || nameCharCnt > SN_NAME_CHAR_LEN 
+      || extCharCnt > SN_EXT_CHAR_LEN || (extPtr != NULL && !extCharCnt))
+    return;
+
+  memcpy(flt->snRaw, nameStr, nameCharCnt);
+  if (extCharCnt)
+    memcpy(&flt->snRaw[SN_NAME_CHAR_LEN], extPtr, extCharCnt);
+  flt->isSn = 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                   (PRIVATE) CHECK LONG NAME AGAINST A FILTER
+ *  
+ * Description : Determines, without decoding the long name, whether a long 
+ *               name could match the filter's name. This is done using the 
+ *               last (highest order) entry of the long name, which is the 
+ *               first entry of the long name in the directory.
+ * 
+ * Arguments   : flt     - Pointer to a NameFilter set by pvt_SetNameFilter.
+ *               lnEnt   - Pointer to the last entry of the long name.
+ * 
+ * Returns     : 0 if the long name cannot match. 1 if it may match.
+ * 
+ * Notes       : 1) The long name must occupy the same number of entries that
+ *                  the filter name would.
+ *               2) The characters held by the last entry are the end of the
+ *                  long name, and must equal those at the same position in 
+ *                  the filter name, followed by the null terminator if the 
+ *                  name does not fill the entry.
+ *               3) Any character outside of the standard ascii range cannot
+ *                  be compared here, so it is left for the full comparison.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_CheckLnFilter(const NameFilter *flt, const uint8_t lnEnt[])
+{
+  // byte offsets of the (UTF-16) characters in a long name entry
+  static const uint8_t lnCharPos[LN_CHARS_PER_ENT] = 
+                              {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+
+  uint8_t ord = lnEnt[0] & LN_ORD_MASK;
+  if (ord != flt->lnEntCnt)
+    return 0;
+
+  // position in the long name of the first character held by this entry
+  uint8_t namePos = (ord - 1) * LN_CHARS_PER_ENT;
+
+  for (uint8_t charNum = 0; charNum < LN_CHARS_PER_ENT; ++charNum, ++namePos)
+  {
+    uint8_t charLSB = lnEnt[lnCharPos[charNum]];
+    uint8_t charMSB = lnEnt[lnCharPos[charNum] + 1];
+
+    // character outside of standard ascii. Can't be compared here.
+    if (charMSB || charLSB > LAST_STD_ASCII_CHAR)
+      return 1;
+
+    // at end of the filter name, long name must be null terminated here.
+    if (namePos == flt->nameLen)
+      return charLSB == '\0';
+
+    if (charLSB != (uint8_t)flt->nameStr[namePos])
+      return 0;
+  }
+  return 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                    (PRIVATE) MATCH A NAME AGAINST A WILDCARD
+ *  
+ * Description : Determines whether a name matches a pattern, where '*' in 
+ *               the pattern matches any number of characters and '?' matches
+ *               any single character.
+ * 
+ * Arguments   : patStr    - Pointer to the pattern string.
+ *               nameStr   - Pointer to the name string.
+ * 
+ * Returns     : 1 if the name matches the pattern, otherwise 0.
+ * 
+ * Notes       : This does not recurse. On a mismatch after a '*', the match
+ *               resumes after that '*' with the '*' having matched one more 
+ *               character of the name.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_MatchPattern(const char patStr[], const char nameStr[])
+{
+  const char *starPat = NULL;               // pattern following the last '*'
+  const char *starName = NULL;              // name position matched by it
+
+  while (*nameStr)
+  {
+    if (*patStr == '*')
+    {
+      starPat = ++patStr;
+      starName = nameStr;
+    }
+    else if (*patStr == '?' || *patStr == *nameStr)
+    {
+      ++patStr;
+      ++nameStr;
+    }
+    else if (starPat != NULL)
+    {
+      patStr = starPat;
+      nameStr = ++starName;
+    }
+    else
+      return 0;
+  }
+
+  // remaining pattern can only be '*'s, which match the empty string.
+  while (*patStr == '*')
+    ++patStr;
+  return !*patStr;
+}
+
 /*
  * ----------------------------------------------------------------------------
  *                                                (PRIVATE) SET FAT ENTRY STATE
@@ -605,17 +1210,39 @@ void fat_PrintError (uint8_t err)
  *                                     the cluster.
  *               snEntClusIndx       - Fat cluster index where short name entry
  *                                     is located.
+ *               flt                 - ptr to the NameFilter the entry was 
+ *                                     found with, or NULL.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 static void pvt_UpdateFatEntryMembers(FatEntry *ent, const char lnStr[], 
                 const uint8_t secArr[], uint16_t snPos,
-                uint8_t snEntSecNumInClus, uint32_t snEntClusIndx)
+                uint8_t snEntSecNumInClus, uint32_t snEntClusIndx,
+                const NameFilter *flt)
 {
+  const uint8_t *snEnt = &secArr[snPos];
+
+  //
+  // decode the fields of the short name entry once, here, so that they are 
+  // read directly from the FatEntry members by the FAT_ENT_ accessors. The 
+  // first cluster index is split into two words that are not adjacent.
+  //
+  FatEntryFields *fld = &ent->fld;
+  fld->attr = snEnt[ATTR_BYTE_OFFSET];
+  fld->fstClusIndx = (uint32_t)pvt_LoadLE16(&snEnt[FST_CLUS_INDX_BYTE_OFFSET_2])
+                     << 16 | pvt_LoadLE16(&snEnt[FST_CLUS_INDX_BYTE_OFFSET_0]);
+  fld->fileSize = pvt_LoadLE32(&snEnt[FILE_SIZE_BYTE_OFFSET_0]);
+  fld->crtTime = pvt_LoadLE16(&snEnt[CREATION_TIME_BYTE_OFFSET_0]);
+  fld->crtDate = pvt_LoadLE16(&snEnt[CREATION_DATE_BYTE_OFFSET_0]);
+  fld->lstAccDate = pvt_LoadLE16(&snEnt[LAST_ACCESS_DATE_BYTE_OFFSET_0]);
+  fld->wrtTime = pvt_LoadLE16(&snEnt[WRITE_TIME_BYTE_OFFSET_0]);
+  fld->wrtDate = pvt_LoadLE16(&snEnt[WRITE_DATE_BYTE_OFFSET_0]);
+
+#if !FAT_COMPACT_ENTRY
   // copy short name entry bytes into *snEnt FatEntry member
-  for (uint8_t byteNum = 0; byteNum < ENTRY_LEN; ++byteNum)
-    ent->snEnt[byteNum] = secArr[snPos + byteNum];
+  memcpy(ent->snEnt, snEnt, ENTRY_LEN);
+#endif//FAT_COMPACT_ENTRY
   
   //
   // The section parses the short name name + ext chars in the short name 
@@ -629,18 +1256,18 @@ static void pvt_UpdateFatEntryMembers(FatEntry *ent, const char lnStr[],
 
   // load short name characters into array. skip spaces.
   for (uint8_t byteNum = 0; byteNum < SN_NAME_CHAR_LEN; ++byteNum)
-    if (ent->snEnt[byteNum] != ' ')
-      *snPtr++ = ent->snEnt[byteNum];
+    if (snEnt[byteNum] != ' ')
+      *snPtr++ = snEnt[byteNum];
 
   // if there is an extension add it to sn string here
-  if (ent->snEnt[SN_NAME_CHAR_LEN] != ' ')
+  if (snEnt[SN_NAME_CHAR_LEN] != ' ')
   {
     *snPtr++ = '.';
     // load extension chars into array. Skip spaces stop at end of ext chars.
     for (uint8_t byteNum = SN_NAME_CHAR_LEN; 
          byteNum < SN_CHAR_LEN - 1; ++byteNum)
-      if (ent->snEnt[byteNum] != ' ')
-        *snPtr++ = ent->snEnt[byteNum];
+      if (snEnt[byteNum] != ' ')
+        *snPtr++ = snEnt[byteNum];
   }
   strcpy(ent->snStr, sn);                   // load snStr FatEntry member.
 
@@ -658,6 +1285,11 @@ static void pvt_UpdateFatEntryMembers(FatEntry *ent, const char lnStr[],
   ent->snEntSecNumInClus = snEntSecNumInClus;
   ent->snEntClusIndx = snEntClusIndx;
   ent->nextEntPos = snPos + ENTRY_LEN;
+
+  // add the entry to the directory entry cache if it matches the filter name.
+  if (flt != NULL && flt->addToCache && !strcmp(ent->lnStr, flt->nameStr))
+    fat_AddDirCacheEntry(flt->dirClusIndx, flt->nameStr, snEnt, 
+                         snEntClusIndx, snEntSecNumInClus, snPos);
 }
 
 /*
@@ -675,7 +1307,7 @@ static void pvt_UpdateFatEntryMembers(FatEntry *ent, const char lnStr[],
 static uint8_t pvt_CheckName(const char nameStr[])
 {
   // check that long name is not too large for current settings
-  if (strlen(nameStr) > LN_STR_LEN_MAX) 
+  if (strlen(nameStr) >= LN_STR_LEN_MAX) 
     return INVALID_NAME;
   
   // illegal if empty string or begins with a space char
@@ -686,7 +1318,7 @@ static uint8_t pvt_CheckName(const char nameStr[])
   const char illCharsArr[] = {'\\','/',':','*','?','"','<','>','|','\0'};
   for (const char *namePtr = nameStr; *namePtr; ++namePtr)
     for (const char *illPtr = illCharsArr; *illPtr;)
-      if (*nameStr == *illPtr++)
+      if (*namePtr == *illPtr++)
         return INVALID_NAME;
 
   // illegal if all space characters
@@ -698,44 +1330,143 @@ static uint8_t pvt_CheckName(const char nameStr[])
 
 /*
  * ----------------------------------------------------------------------------
- *                                (PRIVATE) SET CURRENT DIRECTORY TO ITS PARENT
+ *                                         (PRIVATE) GET NEXT COMPONENT OF PATH
  *  
- *  Description : Sets a FatDir instance to its parent directory. 
+ * Description : Copies the next name (component) of a path string into 
+ *               compStr, and advances the path string pointer past it.
+ * 
+ * Arguments   : pathPtr   - Pointer to the path string pointer. This will be
+ *                           advanced past the component and any '/' chars
+ *                           that follow it.
+ *               compStr   - Pointer to an array of LN_STR_LEN_MAX chars. The
+ *                           component will be copied here.
+ * 
+ * Returns     : SUCCESS or INVALID_NAME. compStr is set to an empty string if
+ *               there are no components left in the path.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_GetPathComp(const char **pathPtr, char compStr[])
+{
+  const char *compPtr = *pathPtr;
+  size_t compLen;
+
+  while (*compPtr == '/')
+    ++compPtr;
+  
+  compLen = strcspn(compPtr, "/");
+  if (compLen >= LN_STR_LEN_MAX)
+    return INVALID_NAME;
+  memcpy(compStr, compPtr, compLen);
+  compStr[compLen] = '\0';
+  
+  for (compPtr += compLen; *compPtr == '/'; ++compPtr)
+    ;
+  *pathPtr = compPtr;
+
+  if (compLen && pvt_CheckName(compStr) == INVALID_NAME)
+    return INVALID_NAME;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                   (PRIVATE) GET FIRST CLUSTER INDEX OF ENTRY
+ *  
+ * Description : Returns the index of the first cluster of the file or dir of
+ *               a short name entry.
+ * 
+ * Arguments   : ent   - Pointer to the FatEntry instance of the entry.
+ *               bpb   - Pointer to the BPB struct instance.
+ * 
+ * Returns     : The first cluster index. 
+ * 
+ * Notes       : A ".." entry holds 0 as its first cluster index when the 
+ *               parent is the root directory. The root directory's first 
+ *               cluster index is returned in this case.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t pvt_GetFstClusIndx(const FatEntry *ent, const BPB *bpb)
+{
+  uint32_t fstClusIndx = FAT_ENT_FST_CLUS_INDX(ent);
+  return fstClusIndx ? fstClusIndx : bpb->rootClus;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           (PRIVATE) SET ENTRY TO A "." ENTRY
+ *  
+ * Description : Sets a FatEntry instance to a "." entry, i.e. an entry of the
+ *               directory itself, for the directory at dirClusIndx.
+ * 
+ * Arguments   : ent           - Pointer to the FatEntry instance to set.
+ *               dirClusIndx   - First cluster index of the directory.
+ *               bpb           - Pointer to the BPB struct instance.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : The root directory has no "." entry, so this is not read from
+ *               the disk. Passing ent to fat_SetNextEntry or fat_FindNextEntry
+ *               will begin at the first entry of the directory.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_SetDotEntry(FatEntry *ent, uint32_t dirClusIndx, 
+                            const BPB *bpb)
+{
+  uint8_t dotEnt[ENTRY_LEN] = {0};
+
+  memset(dotEnt, ' ', SN_NAME_CHAR_LEN + SN_EXT_CHAR_LEN);
+  dotEnt[0] = '.';
+  dotEnt[ATTR_BYTE_OFFSET] = DIR_ENTRY_ATTR;
+
+  // as in a ".." entry, the root directory is indicated by a cluster of 0.
+  if (dirClusIndx != bpb->rootClus)
+  {
+    dotEnt[FST_CLUS_INDX_BYTE_OFFSET_0] = dirClusIndx;
+    dotEnt[FST_CLUS_INDX_BYTE_OFFSET_1] = dirClusIndx >> 8;
+    dotEnt[FST_CLUS_INDX_BYTE_OFFSET_2] = dirClusIndx >> 16;
+    dotEnt[FST_CLUS_INDX_BYTE_OFFSET_3] = dirClusIndx >> 24;
+  }
+
+  // the next entry is the first entry of the directory.
+  pvt_UpdateFatEntryMembers(ent, "", dotEnt, 0, FIRST_SEC_POS_IN_CLUS, 
+                            dirClusIndx, NULL);
+  ent->nextEntPos = FIRST_ENT_POS_IN_SEC;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                       (PRIVATE) SET DIRECTORY TO A DIR ENTRY
+ *  
+ *  Description : Sets a FatDir instance to the directory of a directory 
+ *                entry found in it. This may be a child directory, or the 
+ *                "." or ".." entry.
  * 
  *  Arguments   : dir   - Pointer to a FatDir struct instance. The members of
- *                        this instance will be set to its parent directory.
+ *                        this instance will be set to the new directory.
+ *                ent   - Pointer to the FatEntry instance of the directory 
+ *                        entry. This must be an entry found in dir.
  *                bpb   - Pointer to the BPB struct instance.
  * 
- *  Returns     : SUCCESS or FAILED_READ_SECTOR
+ *  Returns     : SUCCESS, or INVALID_NAME if the new directory's path would
+ *                not fit in the path strings of dir.
+ * 
+ *  Notes       : If FAT_PATH_TRACKING is not set, only the first cluster 
+ *                index of dir is set.
  * ----------------------------------------------------------------------------
  */
-static uint8_t pvt_SetDirToParent(FatDir *dir, const BPB *bpb)
+static uint8_t pvt_EnterDir(FatDir *dir, const FatEntry *ent, const BPB *bpb)
 {
-  uint32_t parentDirFirstClus, secNumOnDisk;
-  uint8_t  secArr[bpb->bytesPerSec];
-
-  // sector number/address on disk
-  secNumOnDisk = bpb->dataRegionFirstSector 
-               + (dir->fstClusIndx - bpb->rootClus) 
-               * bpb->secPerClus;
-                
-  // load secArr with disk sector at secNumOnDisk
-  if (FATtoDisk_ReadSingleSector(secNumOnDisk, secArr) == FAILED_READ_SECTOR)
-   return FAILED_READ_SECTOR;
-
-  // load first cluster index of the parent directory.
-  parentDirFirstClus = secArr[FST_CLUS_INDX_BYTE_OFFSET_3 + ENTRY_LEN];
-  parentDirFirstClus <<= 8;
-  parentDirFirstClus |= secArr[FST_CLUS_INDX_BYTE_OFFSET_2 + ENTRY_LEN];
-  parentDirFirstClus <<= 8;
-  parentDirFirstClus |= secArr[FST_CLUS_INDX_BYTE_OFFSET_1 + ENTRY_LEN];
-  parentDirFirstClus <<= 8;
-  parentDirFirstClus |= secArr[FST_CLUS_INDX_BYTE_OFFSET_0 + ENTRY_LEN];
-
-  if (dir->fstClusIndx == bpb->rootClus);   // current dir is root dir.
-  else if (parentDirFirstClus == 0)         // parent dir is root dir
+  uint32_t fstClusIndx = pvt_GetFstClusIndx(ent, bpb);
+
+  if (!strcmp(ent->lnStr, "."))             // same directory
+    return SUCCESS;
+  else if (fstClusIndx == bpb->rootClus)    // parent dir is root dir
     fat_SetDirToRoot(dir, bpb);
-  else                                      // parent dir is a sub-dir
+#if !FAT_PATH_TRACKING
+  else                                      // no strings to update
+    dir->fstClusIndx = fstClusIndx;
+#else
+  else if (!strcmp(ent->lnStr, ".."))       // parent dir is a sub-dir
   { 
     // 
     // The parent dir is the dir in the path string between the last two '/'
@@ -746,8 +1477,8 @@ static uint8_t pvt_SetDirToParent(FatDir *dir, const BPB *bpb)
     // 
 
     // this will replace the ending '/' char in paths with a null
-    strlcpy(dir->snPathStr, dir->snPathStr, strlen(dir->snPathStr));
-    strlcpy(dir->lnPathStr, dir->lnPathStr, strlen(dir->lnPathStr));
+    dir->snPathStr[strlen(dir->snPathStr) - 1] = '\0';
+    dir->lnPathStr[strlen(dir->lnPathStr) - 1] = '\0';
     
     // ptrs to locations in path strings holding '/' prior to parent dir
     char *snLastDirInPathPtr = strrchr(dir->snPathStr, '/');
@@ -761,8 +1492,40 @@ static uint8_t pvt_SetDirToParent(FatDir *dir, const BPB *bpb)
     *snLastDirInPathPtr = '\0';
     *lnLastDirInPathPtr = '\0';
 
-    dir->fstClusIndx = parentDirFirstClus;
+    dir->fstClusIndx = fstClusIndx;
+  }
+  else                                      // child dir
+  {
+    // the path strings must hold the current path, name, '/' and null.
+    if (strlen(dir->lnPathStr) + strlen(dir->lnStr) + 1 >= PATH_STR_LEN_MAX
+        || strlen(dir->snPathStr) + strlen(dir->snStr) + 1 >= PATH_STR_LEN_MAX)
+      return INVALID_NAME;
+
+    // fill short name array with the name chars of the entry's short name
+    char snStr[SN_NAME_CHAR_LEN + 1] = {'\0'};      
+    for (uint8_t strPos = 0; strPos < SN_NAME_CHAR_LEN 
+                             && ent->snStr[strPos] != '.'; ++strPos)
+      snStr[strPos] = ent->snStr[strPos];
+
+    // Append current directory name to the short and long name paths. The
+    // lengths were checked above, so the names are copied with their null.
+    memcpy(&dir->lnPathStr[strlen(dir->lnPathStr)], dir->lnStr, 
+           strlen(dir->lnStr) + 1);
+    memcpy(&dir->snPathStr[strlen(dir->snPathStr)], dir->snStr, 
+           strlen(dir->snStr) + 1);
+
+    // Update dir to new dir name. If current dir != root dir append '/'
+    if (strcmp(dir->lnStr, "/"))
+      strcat(dir->lnPathStr, "/"); 
+    strcpy(dir->lnStr, ent->lnStr);
+    
+    if (strcmp(dir->snStr, "/"))
+      strcat(dir->snPathStr, "/");
+    strcpy(dir->snStr, snStr);
+
+    dir->fstClusIndx = fstClusIndx;
   }
+#endif//FAT_PATH_TRACKING
   return SUCCESS;
 }
 
@@ -783,12 +1546,18 @@ static uint8_t pvt_SetDirToParent(FatDir *dir, const BPB *bpb)
  * 
  * Returns     : void 
  * 
- * Notes       : Must be called twice if long name crosses sector boundary.
+ * Notes       : 1) Must be called twice if long name crosses sector boundary.
+ *               2) lnStr must point to the first char of an array of 
+ *                  LN_STR_LEN_MAX chars. The long name is truncated if it does
+ *                  not fit.
  * ----------------------------------------------------------------------------
  */
 static void pvt_LoadLongName(int lnFirstEnt, int lnLastEnt,
                              const uint8_t secArr[], char lnStr[])
 {
+  // last char of lnStr that can be loaded. The one after it is the null.
+  const char *lnEndPtr = lnStr + LN_STR_LEN_MAX - 2;
+
   //
   // set lnStr to point to first null char in array. This will be position 0 
   // except when function is called twice to load a long name that crosses 
@@ -802,261 +1571,137 @@ static void pvt_LoadLongName(int lnFirstEnt, int lnLastEnt,
   {                                              
     //
     // loops to load long name chars from a single entry. Skips any nulls and 
-    // any characters outside of the standard ascii range.
+    // any characters outside of the standard ascii range. Any chars that do
+    // not fit in lnStr are dropped.
     // 
     for (uint16_t byteNum = entPos + LN_CHAR_RANGE_1_BEGIN; 
          byteNum < entPos + LN_CHAR_RANGE_1_END; byteNum++)
-      if (secArr[byteNum] && secArr[byteNum] <= LAST_STD_ASCII_CHAR)
+      if (secArr[byteNum] && secArr[byteNum] <= LAST_STD_ASCII_CHAR
+          && lnStr <= lnEndPtr)
         *lnStr++ = secArr[byteNum];
 
     for (uint16_t byteNum = entPos + LN_CHAR_RANGE_2_BEGIN; 
          byteNum < entPos + LN_CHAR_RANGE_2_END; byteNum++)
-      if (secArr[byteNum] && secArr[byteNum] <= LAST_STD_ASCII_CHAR)
+      if (secArr[byteNum] && secArr[byteNum] <= LAST_STD_ASCII_CHAR
+          && lnStr <= lnEndPtr)
         *lnStr++ = secArr[byteNum];
     
     for (uint16_t byteNum = entPos + LN_CHAR_RANGE_3_BEGIN;
          byteNum < entPos + LN_CHAR_RANGE_3_END; byteNum++)
-      if (secArr[byteNum] && secArr[byteNum] <= LAST_STD_ASCII_CHAR)
+      if (secArr[byteNum] && secArr[byteNum] <= LAST_STD_ASCII_CHAR
+          && lnStr <= lnEndPtr)
         *lnStr++ = secArr[byteNum];    
   }
 }
 
 /*
  * ----------------------------------------------------------------------------
- *                              (PRIVATE) GET THE FAT INDEX OF THE NEXT CLUSTER
- * 
- * Description : Finds and returns the next FAT cluster index.
+ *                                        (PRIVATE) ADD FAT ENTRY FIELDS TO LINE
  * 
- * Arguments   : clusIndex   - The current cluster's FAT index.
- *               bpb         - Pointer to the BPB struct instance.
- * 
- * Returns     : A file or dir's next FAT cluster index. If END_CLUSTER is 
- *               returned, the current cluster is the last of the file or dir.
- * 
- * Notes       : The returned value locates the index in the FAT. The index is
- *               offset (typically by -2) from the actual cluster number in the
- *               data region. The root cluster is always cluster 0 in the data
- *               region, but its FAT index is 2 or higher.
- * ----------------------------------------------------------------------------
- */
-static uint32_t pvt_GetNextClusIndex(uint32_t clusIndx, const BPB *bpb)
-{
-  // calculate address of sector containing the current cluster index
-  uint16_t fatIndxsPerSec = bpb->bytesPerSec / BYTES_PER_INDEX;
-  uint32_t fatSectorToRead = (clusIndx / fatIndxsPerSec) + bpb->rsvdSecCnt;
-
-  // load current cluster's index sector into secArr
-  uint8_t secArr[bpb->bytesPerSec];
-  FATtoDisk_ReadSingleSector(fatSectorToRead, secArr);
-
-  // Value at the current cluster index is the index of the next cluster.
-  uint32_t nextClusIndx = 0;
-  uint16_t posNextClusIndxInSec = BYTES_PER_INDEX 
-                                  * (clusIndx % fatIndxsPerSec);
- 
-  // load the index of the next cluster.
-  for (uint8_t offset = BYTES_PER_INDEX - 1; offset > 0; --offset)
-  {
-    nextClusIndx |= secArr[posNextClusIndxInSec + offset];
-    nextClusIndx <<= 8;
-  }
-  nextClusIndx |= secArr[posNextClusIndxInSec];
-
-  return nextClusIndx;
-}
-
-/*
- * ----------------------------------------------------------------------------
- *                                      (PRIVATE) PRINT THE FIELDS OF FAT ENTRY
- * 
- * Description : Prints a FatEntry instance's fields according to flags param.
+ * Description : Adds a FatEntry instance's fields, formatted to fixed widths, 
+ *               to the end of a PrintLine according to flags param.
  *
- * Arguments   : secArr   - Pointer to an array holding then 32 bit short name
- *                          entry to be printed. Field values are located here.
- *               flags    - Entry Field Flags specifying which fields to print.
+ * Arguments   : line    - Pointer to the PrintLine the fields are added to.
+ *               ent     - Pointer to the FatEntry instance to be printed.
+ *               flags   - Entry Field Flags specifying which fields to print.
  * 
  * Returns     : void 
  * ----------------------------------------------------------------------------
  */
-static void pvt_PrintEntFields(const uint8_t secArr[], uint8_t flags)
+static void pvt_LineEntFields(PrintLine *line, const FatEntry *ent, 
+                              uint8_t flags)
 {
-  print_Str ("\n\r");
+  print_LineStr(line, "\n\r");
 
   // Print creation date and time 
   if (CREATION & flags)
   {
-    uint16_t createTime;
-    uint16_t createDate;
-
-    // load create date and time
-    createDate = secArr[CREATION_DATE_BYTE_OFFSET_1];
-    createDate <<= 8;
-    createDate |= secArr[CREATION_DATE_BYTE_OFFSET_0];
-    createTime = secArr[CREATION_TIME_BYTE_OFFSET_1];
-    createTime <<= 8;
-    createTime |= secArr[CREATION_TIME_BYTE_OFFSET_0];
-
-    // print month
-    print_Str("    ");
-    uint8_t month = MONTH_CALC(createDate);
-    if (month < 10)
-      print_Str("0");    
-    print_Dec(month);
-    print_Str("/");
-
-    // print day
-    uint8_t day = DAY_CALC(createDate);
-    if (day < 10)
-      print_Str("0");
-    print_Dec(day);
-    print_Str("/");
-
-    // print year
-    print_Dec((uint16_t)YEAR_CALC(createDate));
-    print_Str("  ");
-
-    // print hours
-    uint8_t hour = HOUR_CALC(createTime);
-    if (hour < 10) 
-      print_Str("0");
-    print_Dec(hour);
-    print_Str(":");
-
-    // print minutes
-    uint8_t min = MIN_CALC(createTime);
-    if (min < 10)
-      print_Str("0");
-    print_Dec(min);
-    print_Str(":");
-
-    // print seconds (resolution is 2 seconds).
-    uint8_t sec = SEC_CALC(createTime);
-    if (sec < 10) 
-      print_Str("0");
-    print_Dec(sec);
+    print_LineStr(line, "    ");
+    pvt_LineDate(line, FAT_ENT_CREATION_DATE(ent));
+    print_LineStr(line, "  ");
+    pvt_LineTime(line, FAT_ENT_CREATION_TIME(ent));
   }
 
   // Print last access date
   if (LAST_ACCESS & flags)
   {
-    uint16_t lastAccDate;
-
-    // load last access date
-    lastAccDate = secArr[LAST_ACCESS_DATE_BYTE_OFFSET_1];
-    lastAccDate <<= 8;
-    lastAccDate |= secArr[LAST_ACCESS_DATE_BYTE_OFFSET_0];
-
-    // print month
-    print_Str("     ");
-    uint8_t month = MONTH_CALC(lastAccDate);
-    if (month < 10)
-      print_Str("0");
-    print_Dec(month);
-    print_Str("/");
-
-    // print day
-    uint8_t day = DAY_CALC(lastAccDate);
-    if (day < 10)
-      print_Str("0");
-    print_Dec(day);
-    print_Str("/");
-
-    // print year
-    print_Dec((uint16_t)YEAR_CALC(lastAccDate));
+    print_LineStr(line, "     ");
+    pvt_LineDate(line, FAT_ENT_LAST_ACCESS_DATE(ent));
   }
 
   // Print last modified date / time
   if (LAST_MODIFIED & flags)
   {
-    uint16_t writeDate;
-    uint16_t writeTime;
-    
-    // Load last modified write date and time
-    writeDate = secArr[WRITE_DATE_BYTE_OFFSET_1];
-    writeDate <<= 8;
-    writeDate |= secArr[WRITE_DATE_BYTE_OFFSET_0];
-
-    writeTime = secArr[WRITE_TIME_BYTE_OFFSET_1];
-    writeTime <<= 8;
-    writeTime |= secArr[WRITE_TIME_BYTE_OFFSET_0];
-  
-    // print month
-    print_Str("     ");
-    uint8_t month = MONTH_CALC(writeDate);
-    if (month < 10) 
-      print_Str("0");
-    print_Dec(month);
-    print_Str("/");
-    
-    // print day
-    uint8_t day = DAY_CALC(writeDate);
-    if (day < 10) 
-      print_Str("0");
-    print_Dec(day);
-    print_Str("/");
-
-    // print year
-    print_Dec((uint16_t)YEAR_CALC(writeDate));
-    print_Str("  ");
-
-    // print hour
-    uint8_t hour = HOUR_CALC(writeTime);
-    if (hour < 10)
-      print_Str("0");
-    print_Dec(hour);
-    print_Str(":");
-
-    // print minute
-    uint8_t min = MIN_CALC(writeTime);   
-    if (min < 10) 
-      print_Str("0");
-    print_Dec(min);
-    print_Str(":");
-
-    // print second
-    uint8_t sec = SEC_CALC(writeTime);
-    if (sec < 10) 
-      print_Str("0");
-    print_Dec(sec);
+    print_LineStr(line, "     ");
+    pvt_LineDate(line, FAT_ENT_WRITE_DATE(ent));
+    print_LineStr(line, "  ");
+    pvt_LineTime(line, FAT_ENT_WRITE_TIME(ent));
   }
-  print_Str("     ");
+  print_LineStr(line, "     ");
 
-  // Print file size in bytes
+  // Print file size, right aligned, and the selected units
   if (FILE_SIZE & flags)
   {
-    uint32_t fileSize;    
-    
-    // load file size
-    fileSize = secArr[FILE_SIZE_BYTE_OFFSET_3];
-    fileSize <<= 8;
-    fileSize |= secArr[FILE_SIZE_BYTE_OFFSET_2];
-    fileSize <<= 8;
-    fileSize |= secArr[FILE_SIZE_BYTE_OFFSET_1];
-    fileSize <<= 8;
-    fileSize |= secArr[FILE_SIZE_BYTE_OFFSET_0];
-
-    // Print spaces for formatting output. Add 1 to prevent starting at 0.
-    for (uint64_t sp = 1 + fileSize / FS_UNIT; sp < GIGA / FS_UNIT; sp *= 10)
-      print_Str(" ");
-
-    // print file size and selected units
-    print_Dec(fileSize / FS_UNIT);
+    print_LineDec(line, FAT_ENT_FILE_SIZE(ent) / FS_UNIT, FS_FIELD_WIDTH, ' ');
     if (FS_UNIT == KILO)                               
-      print_Str("KB  ");
+      print_LineStr(line, "KB  ");
     else  
-      print_Str("B  ");
+      print_LineStr(line, "B  ");
   }
 
   // print entry type
   if (TYPE & flags)
   {
-    if (secArr[ATTR_BYTE_OFFSET] & DIR_ENTRY_ATTR) 
-      print_Str(" <DIR>   ");
+    if (FAT_ENT_ATTR(ent) & DIR_ENTRY_ATTR) 
+      print_LineStr(line, " <DIR>   ");
     else 
-      print_Str(" <FILE>  ");
+      print_LineStr(line, " <FILE>  ");
   }
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                (PRIVATE) ADD A DATE TO LINE
+ * 
+ * Description : Adds a FAT date field to a PrintLine as MM/DD/YYYY.
+ *
+ * Arguments   : line   - Pointer to the PrintLine the date is added to.
+ *               date   - Date field of a FAT entry.
+ * 
+ * Returns     : void 
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_LineDate(PrintLine *line, uint16_t date)
+{
+  print_LineDec(line, MONTH_CALC(date), 2, '0');
+  print_LineStr(line, "/");
+  print_LineDec(line, DAY_CALC(date), 2, '0');
+  print_LineStr(line, "/");
+  print_LineDec(line, YEAR_CALC(date), 4, '0');
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                (PRIVATE) ADD A TIME TO LINE
+ * 
+ * Description : Adds a FAT time field to a PrintLine as HH:MM:SS.
+ *
+ * Arguments   : line   - Pointer to the PrintLine the time is added to.
+ *               time   - Time field of a FAT entry. The resolution of the 
+ *                        seconds is 2 seconds.
+ * 
+ * Returns     : void 
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_LineTime(PrintLine *line, uint16_t time)
+{
+  print_LineDec(line, HOUR_CALC(time), 2, '0');
+  print_LineStr(line, ":");
+  print_LineDec(line, MIN_CALC(time), 2, '0');
+  print_LineStr(line, ":");
+  print_LineDec(line, SEC_CALC(time), 2, '0');
+}
+
 /*
  * ----------------------------------------------------------------------------
  *                                                   (PRIVATE) PRINT A FAT FILE
@@ -1064,84 +1709,127 @@ static void pvt_PrintEntFields(const uint8_t secArr[], uint8_t flags)
  * Description : Performs 'print file' operation. This will output the contents
  *               of any file to the screen.
  * 
- * Arguments   : snEnt   - Pointer to 32 byte array holding the sn entry.
- *               bpb     - Pointer to the BPB struct instance.
+ * Arguments   : ent   - Pointer to the FatEntry instance of the file.
+ *               bpb   - Pointer to the BPB struct instance.
+ * 
+ * Returns     : END_OF_FILE (success), FAILED_READ_SECTOR or CORRUPT_FAT_ENTRY
+ *               fat error flag.
  * 
- * Returns     : END_OF_FILE (success) or FAILED_READ_SECTOR fat error flag.
+ * Notes       : The number of bytes printed is the file size in the sn entry.
  * ----------------------------------------------------------------------------
  */
-static uint8_t pvt_PrintFile(const uint8_t snEnt[], const BPB *bpb)
+static uint8_t pvt_PrintFile(const FatEntry *ent, const BPB *bpb)
 {
   //get FAT index for file's first cluster
-  uint32_t clus; 
-  clus = snEnt[FST_CLUS_INDX_BYTE_OFFSET_3];
-  clus <<= 8;
-  clus |= snEnt[FST_CLUS_INDX_BYTE_OFFSET_2];
-  clus <<= 8;
-  clus |= snEnt[FST_CLUS_INDX_BYTE_OFFSET_1];
-  clus <<= 8;
-  clus |= snEnt[FST_CLUS_INDX_BYTE_OFFSET_0];
-
-  // loop over clusters to read in and print file
-  do
+  uint32_t clus = FAT_ENT_FST_CLUS_INDX(ent);
+
+  // number of bytes of the file remaining to be printed. Set to file size.
+  uint32_t remCnt = FAT_ENT_FILE_SIZE(ent);
+
+  // pool buffer used to load each sector of the file as it is streamed.
+  uint8_t *secArr = fat_GetSectorBuffer();
+  if (secArr == NULL)
+    return FAILED_READ_SECTOR;
+
+  // loop over runs of contiguous clusters to read in and print file
+  uint8_t err = END_OF_FILE;
+  while (remCnt)
   {
-    // loop over sectors in the cluster to read in and print file
-    for (uint32_t secNumInClus = 0; secNumInClus < bpb->secPerClus; 
-         ++secNumInClus)
+    // file size is larger than its cluster chain
+    if (clus == END_CLUSTER)
     {
-      // calculate address of the sector on the physical disk
-      uint32_t secNumOnDisk = secNumInClus + bpb->dataRegionFirstSector
-                          + (clus - bpb->rootClus) * bpb->secPerClus;
+      err = CORRUPT_FAT_ENTRY;
+      break;
+    }
+    if (clus == FAILED_CLUS_INDX)
+    {
+      err = FAILED_READ_SECTOR;
+      break;
+    }
 
-      // read disk sector into the sector array
-      uint8_t secArr[bpb->bytesPerSec];
-      if (FATtoDisk_ReadSingleSector(secNumOnDisk, secArr) 
-          == FAILED_READ_SECTOR)
-        return FAILED_READ_SECTOR;
+    //
+    // Find the number of clusters, beginning at clus, that are contiguous on
+    // the disk, up to the cluster holding the last byte of the file. The index
+    // of the cluster following the run is then the start of the next run, or
+    // END_CLUSTER.
+    //
+    uint32_t clusLen = (uint32_t)bpb->secPerClus * SECTOR_LEN;
+    uint32_t nextClus;
+    uint32_t runClusCnt = fat_GetClusRun(clus, &nextClus, 
+                                         (remCnt + clusLen - 1) / clusLen, bpb);
 
-      for (uint16_t byteNum = 0; byteNum < bpb->bytesPerSec; ++byteNum)
-      {
-        // end of file flag. Set to 1 if eof is detected.
-        uint8_t eof = 0;
+    // calculate address of the run's first sector on the physical disk
+    uint32_t secNumOnDisk = bpb->dataRegionFirstSector
+                          + (clus - bpb->rootClus) * bpb->secPerClus;
 
-        // 
-        // for output formatting. Currently reads are NOT text mode, so "\n\r"
-        // is not automatically printed when "\n" is present by itself.
-        //
-        if (secArr[byteNum] == '\n') 
-          print_Str ("\n\r");
-        
-        // else if not 0, just print the character directly to the screen.
-        else if (secArr[byteNum])
-        {
-          // two byte array for single char string, to use print_Str.
-          char str[2] = {secArr[byteNum], '\0'};
-          print_Str(str);
-        }
-        // else character is zero. Possible indicatin of eof.
-        else 
-        {
-          // assume eof and set flag
-          eof = 1;
-          
-          // confirm rest of bytes in the current sector are 0
-          for (++byteNum; byteNum < bpb->bytesPerSec; ++byteNum)
-          {
-            // if any byte is not 0 then not at eof. Reset eof to 0
-            if (secArr[byteNum]) 
-            { 
-              --byteNum;
-              eof = 0;
-              break;
-            }
-          }
-        }
-        if (eof)
-          return END_OF_FILE;
-      }
+    //
+    // stream all sectors of the run and print them as they are loaded. The
+    // read ends early if the last byte of the file is in the run.
+    //
+    FAT_SET_READ_CAT(READ_CAT_FILE);
+    if (FATtoDisk_ReadMultipleSectors(secNumOnDisk, 
+                                      runClusCnt * bpb->secPerClus, secArr,
+                                      pvt_PrintSector, &remCnt)
+        == FAILED_READ_SECTOR)
+    {
+      err = FAILED_READ_SECTOR;
+      break;
     }
+
+    clus = nextClus;
   } 
-  while ((clus = pvt_GetNextClusIndex(clus, bpb)) != END_CLUSTER);
-  
-  return END_OF_FILE;
+  fat_ReleaseSector(secArr);
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           (PRIVATE) PRINT A SECTOR OF A FILE
+ * 
+ * Description : SectorHandler used by pvt_PrintFile. Prints the contents of a
+ *               single sector of a file to the screen.
+ * 
+ * Arguments   : secArr       - Pointer to array holding the loaded sector.
+ *               handlerArg   - Pointer to the number of bytes of the file that
+ *                              remain to be printed. This is decremented by
+ *                              the number of bytes printed from the sector.
+ * 
+ * Returns     : 1 if the end of file was reached, ending the read. Else 0.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_PrintSector(uint8_t secArr[], void *handlerArg)
+{
+  uint32_t *remCnt = handlerArg;
+
+  // number of bytes of the file in this sector 
+  uint16_t byteCnt = SECTOR_LEN;
+  if (*remCnt < byteCnt)
+    byteCnt = *remCnt;
+
+  // 
+  // the chars are passed to the output sink a line buffer at a time, so they
+  // can be sent while the next sector is being read.
+  //
+  PrintLine line;
+  line.len = 0;
+  for (uint16_t byteNum = 0; byteNum < byteCnt; ++byteNum)
+  {
+    // 
+    // for output formatting. Currently reads are NOT text mode, so "\n\r"
+    // is not automatically printed when "\n" is present by itself.
+    //
+    if (secArr[byteNum] == '\n') 
+      print_LineStr(&line, "\n\r");
+    
+    // else if not 0, just print the character directly to the screen.
+    else if (secArr[byteNum])
+    {
+      // two byte array for single char string, to use print_LineStr.
+      char str[2] = {secArr[byteNum], '\0'};
+      print_LineStr(&line, str);
+    }
+  }
+  print_LineFlush(&line);
+  *remCnt -= byteCnt;
+  return *remCnt == 0;
 }
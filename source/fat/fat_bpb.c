@@ -12,8 +12,22 @@
 #include <string.h>
 #include "prints.h"
 #include "fat_bpb.h"
+#include "fat.h"
+#include "fat_cache.h"
 #include "fat_to_disk_if.h"
 
+/*
+ ******************************************************************************
+ *                      "PRIVATE" FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+static uint8_t pvt_LoadBPB(BPB *bpb, const uint8_t bootSecArr[],
+                           uint32_t bootSecAddr);
+static void pvt_LoadFSInfo(const BPB *bpb);
+static uint32_t pvt_GetWord32(const uint8_t arr[], uint16_t pos);
+static uint16_t pvt_GetChkSum(const BPBSnapshot *snap);
+
 /*
  ******************************************************************************
  *                                   FUNCTIONS   
@@ -39,27 +53,168 @@
  *               functions that access the FAT volume, therefore this function 
  *               should be called first, before implementing any other parts of
  *               the FAT module.
- * 
- * Limitation  : Currently will only work if Boot Sector is block 0 on SD Card.
  * ----------------------------------------------------------------------------
  */
 uint8_t fat_SetBPB(BPB *bpb)
 {
-  uint8_t bootSecArr[SECTOR_LEN], err; 
+  uint8_t err; 
+
+  // sectors and entries cached from a previously mounted volume are invalid
+  fat_InvalidateSecPool();
+  fat_InvalidateDirCache(DIR_CACHE_ALL);
 
   // Locate boot sector address on the disk. 
   uint32_t bootSecAddr = FATtoDisk_FindBootSector();
-  if (bootSecAddr != FAILED_FIND_BOOT_SECTOR)
-  {
-    // load data from boot sector into bootSecArr.
-    err = FATtoDisk_ReadSingleSector(bootSecAddr, bootSecArr);
-    if (err == FAILED_READ_SECTOR) 
-      return FAILED_READ_BPB;
-  }
-  else
+  if (bootSecAddr == FAILED_FIND_BOOT_SECTOR)
     return BPB_NOT_FOUND;
+
+  // borrow a pool buffer holding the boot sector
+  FAT_SET_READ_CAT(READ_CAT_BOOT);
+  uint8_t *bootSecArr = fat_GetSector(bootSecAddr);
+  if (bootSecArr == NULL) 
+    return FAILED_READ_BPB;
   
-  // 
+  err = pvt_LoadBPB(bpb, bootSecArr, bootSecAddr);
+  fat_ReleaseSector(bootSecArr);
+
+  if (err == BPB_VALID)
+    pvt_LoadFSInfo(bpb);
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                       PRINT BIOS PARAMETER BLOCK ERROR FLAGS 
+ * 
+ * Description : Print the Bios Parameter Block Error Flag. 
+ * 
+ * Arguments   : err     BPB error flag(s).
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_PrintErrorBPB(uint8_t err)
+{  
+  switch(err)
+  {
+    case BPB_VALID:
+      print_Str("BPB_VALID ");
+      break;
+    case CORRUPT_BPB:
+      print_Str("CORRUPT_BPB ");
+      break;
+    case NOT_BPB:
+      print_Str("NOT_BPB ");
+      break;
+    case INVALID_BYTES_PER_SECTOR:
+      print_Str("INVALID_BYTES_PER_SECTOR");
+      break;
+    case INVALID_SECTORS_PER_CLUSTER:
+      print_Str("INVALID_SECTORS_PER_CLUSTER");
+      break;
+    case BPB_NOT_FOUND:
+      print_Str("BPB_NOT_FOUND");
+      break;
+    case FAILED_READ_BPB:
+      print_Str("FAILED_READ_BPB");
+      break;
+    case INVALID_BPB_SNAPSHOT:
+      print_Str("INVALID_BPB_SNAPSHOT");
+      break;
+    default:
+      print_Str("UNKNOWN_ERROR");
+      break;
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SAVE A BPB SNAPSHOT
+ *
+ * Description : Sets a BPBSnapshot instance from a valid BPB struct instance.
+ * 
+ * Arguments   : bpb    - Pointer to a BPB struct instance set by fat_SetBPB.
+ *               snap   - Pointer to the BPBSnapshot instance to set.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_SaveBPB(const BPB *bpb, BPBSnapshot *snap)
+{
+  snap->bpb = *bpb;
+  snap->bootSecAddr = bpb->dataRegionFirstSector - bpb->rsvdSecCnt
+                    - bpb->numOfFats * bpb->fatSize32;
+  snap->chkSum = pvt_GetChkSum(snap);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  RESTORE BPB FROM A SNAPSHOT
+ *
+ * Description : Sets a BPB struct instance from a BPBSnapshot instance if the
+ *               snapshot is of the volume on the disk.
+ * 
+ * Arguments   : bpb    - Pointer to the BPB struct instance to set.
+ *               snap   - Pointer to a BPBSnapshot instance set by fat_SaveBPB.
+ * 
+ * Returns     : BPB_VALID, FAILED_READ_BPB or INVALID_BPB_SNAPSHOT.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_RestoreBPB(BPB *bpb, const BPBSnapshot *snap)
+{
+  // sectors and entries cached from a previously mounted volume are invalid
+  fat_InvalidateSecPool();
+  fat_InvalidateDirCache(DIR_CACHE_ALL);
+
+  // e.g. erased EEPROM, or a snapshot of a different version of the struct
+  if (pvt_GetChkSum(snap) != snap->chkSum)
+    return INVALID_BPB_SNAPSHOT;
+
+  //
+  // The volume serial number is checked to confirm the disk holds the same
+  // volume. The boot sector is left in the pool, as it is not needed again.
+  //
+  FAT_SET_READ_CAT(READ_CAT_BOOT);
+  uint8_t *bootSecArr = fat_GetSector(snap->bootSecAddr);
+  if (bootSecArr == NULL) 
+    return FAILED_READ_BPB;
+
+  uint8_t match = bootSecArr[SECTOR_LEN - 2] == BS_SIGN_1 
+               && bootSecArr[SECTOR_LEN - 1] == BS_SIGN_2
+               && pvt_GetWord32(bootSecArr, VOL_ID_POS) == snap->bpb.volId;
+  fat_ReleaseSector(bootSecArr);
+  if (!match)
+    return INVALID_BPB_SNAPSHOT;
+
+  *bpb = snap->bpb;
+  pvt_LoadFSInfo(bpb);
+  return BPB_VALID;
+}
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                   (PRIVATE) LOAD BPB FIELDS FROM BOOT SECTOR 
+ *
+ * Description : Checks that bootSecArr holds a Boot Sector and sets the 
+ *               members of the BPB struct instance from its fields.
+ *
+ * Arguments   : bpb           - Pointer to an instance of a BPB struct.
+ *               bootSecArr    - Array holding the contents of the sector.
+ *               bootSecAddr   - Address of the sector on the disk.
+ *
+ * Returns     : Boot Sector Error Flag. BPB_VALID if successful.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_LoadBPB(BPB *bpb, const uint8_t bootSecArr[],
+                           uint32_t bootSecAddr)
+{
+  //
   // Confirm the sector loaded is the Boot Sector by checking the signature
   // bytes - the last two bytes of sector. If true, then begin loading the 
   // necessary BPB field values into their respective BPB struct members.
@@ -114,6 +269,30 @@ uint8_t fat_SetBPB(BPB *bpb)
     //
     bpb->dataRegionFirstSector = bootSecAddr + bpb->rsvdSecCnt 
                                + bpb->numOfFats * bpb->fatSize32;
+
+    // Number of clusters in the Data Region, from the volume's total sectors
+    uint32_t totSec32 = bootSecArr[TOT_SEC32_POS4];
+    totSec32 <<= 8;
+    totSec32 |= bootSecArr[TOT_SEC32_POS3];
+    totSec32 <<= 8;
+    totSec32 |= bootSecArr[TOT_SEC32_POS2];
+    totSec32 <<= 8;
+    totSec32 |= bootSecArr[TOT_SEC32_POS1];
+    if (totSec32 <= bpb->dataRegionFirstSector - bootSecAddr)
+      return CORRUPT_BPB;
+    bpb->clusCnt = (totSec32 - (bpb->dataRegionFirstSector - bootSecAddr))
+                 / bpb->secPerClus;
+
+    // FSInfo sector number is relative to the boot sector. 0 if there is none
+    uint16_t fsInfo = bootSecArr[FS_INFO_POS_MSB];
+    fsInfo <<= 8;
+    fsInfo |= bootSecArr[FS_INFO_POS_LSB];
+    if (fsInfo == 0 || fsInfo >= bpb->rsvdSecCnt)
+      bpb->fsInfoSecNum = 0;
+    else
+      bpb->fsInfoSecNum = bootSecAddr + fsInfo;
+
+    bpb->volId = pvt_GetWord32(bootSecArr, VOL_ID_POS);
     return BPB_VALID;
   }
   else 
@@ -122,42 +301,100 @@ uint8_t fat_SetBPB(BPB *bpb)
 
 /*
  * ----------------------------------------------------------------------------
- *                                       PRINT BIOS PARAMETER BLOCK ERROR FLAGS 
- * 
- * Description : Print the Bios Parameter Block Error Flag. 
- * 
- * Arguments   : err     BPB error flag(s).
- * 
+ *                                                 (PRIVATE) LOAD FSINFO FIELDS
+ *
+ * Description : Reads the free cluster count and next free cluster hint from
+ *               the FSInfo sector and passes them to the cluster allocator.
+ *
+ * Arguments   : bpb   - Pointer to the BPB struct instance, already loaded.
+ *
  * Returns     : void
+ *
+ * Notes       : If the sector cannot be read, its signatures are not valid,
+ *               or a field is out of range for the volume, the field is
+ *               passed to fat_InitAlloc as FSI_UNKNOWN.
  * ----------------------------------------------------------------------------
  */
-void fat_PrintErrorBPB(uint8_t err)
-{  
-  switch(err)
+static void pvt_LoadFSInfo(const BPB *bpb)
+{
+  uint32_t freeCnt = FSI_UNKNOWN;
+  uint32_t nextFree = FSI_UNKNOWN;
+
+  FAT_SET_READ_CAT(READ_CAT_BOOT);
+  uint8_t *secArr = bpb->fsInfoSecNum ? fat_GetSector(bpb->fsInfoSecNum)
+                                      : NULL;
+  if (secArr != NULL)
   {
-    case BPB_VALID:
-      print_Str("BPB_VALID ");
-      break;
-    case CORRUPT_BPB:
-      print_Str("CORRUPT_BPB ");
-      break;
-    case NOT_BPB:
-      print_Str("NOT_BPB ");
-      break;
-    case INVALID_BYTES_PER_SECTOR:
-      print_Str("INVALID_BYTES_PER_SECTOR");
-      break;
-    case INVALID_SECTORS_PER_CLUSTER:
-      print_Str("INVALID_SECTORS_PER_CLUSTER");
-      break;
-    case BPB_NOT_FOUND:
-      print_Str("BPB_NOT_FOUND");
-      break;
-    case FAILED_READ_BPB:
-      print_Str("FAILED_READ_BPB");
-      break;
-    default:
-      print_Str("UNKNOWN_ERROR");
-      break;
+    if (pvt_GetWord32(secArr, FSI_LEAD_SIG_POS) == FSI_LEAD_SIG
+        && pvt_GetWord32(secArr, FSI_STRUC_SIG_POS) == FSI_STRUC_SIG
+        && pvt_GetWord32(secArr, FSI_TRAIL_SIG_POS) == FSI_TRAIL_SIG)
+    {
+      freeCnt = pvt_GetWord32(secArr, FSI_FREE_COUNT_POS);
+      nextFree = pvt_GetWord32(secArr, FSI_NXT_FREE_POS);
+      if (freeCnt > bpb->clusCnt)
+        freeCnt = FSI_UNKNOWN;
+      if (nextFree < 2 || nextFree > bpb->clusCnt + 1)
+        nextFree = FSI_UNKNOWN;
+    }
+    fat_ReleaseSector(secArr);
+  }
+  fat_InitAlloc(freeCnt, nextFree, bpb);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 (PRIVATE) GET A 32-BIT FIELD
+ *
+ * Description : Returns the little endian 32-bit value at pos in arr.
+ *
+ * Arguments   : arr   - Pointer to the array holding the value.
+ *               pos   - Position in arr of the value's least significant byte.
+ *
+ * Returns     : The 32-bit value.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t pvt_GetWord32(const uint8_t arr[], uint16_t pos)
+{
+  uint32_t val = arr[pos + 3];
+  val <<= 8;
+  val |= arr[pos + 2];
+  val <<= 8;
+  val |= arr[pos + 1];
+  val <<= 8;
+  val |= arr[pos];
+  return val;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              (PRIVATE) GET SNAPSHOT CHECKSUM
+ *
+ * Description : Calculates the checksum of the members of a BPBSnapshot 
+ *               instance, other than chkSum.
+ *
+ * Arguments   : snap   - Pointer to the BPBSnapshot instance.
+ *
+ * Returns     : The 16-bit checksum.
+ *
+ * Notes       : This is a Fletcher checksum with the first sum starting at 1,
+ *               so that a snapshot of all 0x00 or all 0xFF bytes, e.g. never
+ *               written EEPROM, is not valid.
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_GetChkSum(const BPBSnapshot *snap)
+{
+  uint16_t sum1 = 1, sum2 = 0;
+  const uint8_t *byte = (const uint8_t *)&snap->bpb;
+
+  for (uint8_t i = 0; i < sizeof(BPB); ++i)
+  {
+    sum1 = (sum1 + byte[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  for (uint8_t i = 0; i < 4; ++i)
+  {
+    sum1 = (sum1 + (uint8_t)(snap->bootSecAddr >> (8 * i))) % 255;
+    sum2 = (sum2 + sum1) % 255;
   }
+  return (sum2 << 8) | sum1;
 }
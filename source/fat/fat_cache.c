@@ -0,0 +1,1223 @@
+/*
+ * File       : FAT_CACHE.C
+ * Version    : 2.0
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of FAT_CACHE.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "fat_bpb.h"
+#include "fat.h"
+#include "fat_cache.h"
+#include "fat_to_disk_if.h"
+
+/*
+ ******************************************************************************
+ *                  "PRIVATE" FUNCTION PROTOTYPES and MACROS
+ ******************************************************************************
+ */
+
+static uint8_t pvt_GetReplSlot(void);
+static uint8_t pvt_WriteBackSlot(uint8_t slot);
+#if FAT_FREE_MAP_LEN
+static uint8_t pvt_IsRegionFull(uint32_t region);
+static void pvt_SetRegionFull(uint32_t region, uint8_t full);
+#endif//FAT_FREE_MAP_LEN
+
+// number of cluster indices held in a single FAT sector.
+#define INDXS_PER_FAT_SEC    (SECTOR_LEN / BYTES_PER_INDEX)
+
+// returned by pvt_GetReplSlot if every slot of the sector pool is locked.
+#define NO_FREE_SLOT         FAT_SEC_POOL_SLOTS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  (PRIVATE) SECTOR POOL SLOT
+ *
+ * Description : Holds a single sector buffer of the sector pool.
+ *
+ * Members     : secArr      - The sector buffer.
+ *               secNum      - Address on the disk of the sector in secArr.
+ *               lastUse     - Value of useCnt when the slot was last used.
+ *                             Used to find the least recently used slot.
+ *               valid       - 1 if secArr holds the sector at secNum.
+ *               lockCnt     - Number of borrowers currently holding secArr.
+ *                             A slot is only reused when this is 0.
+ *               dirty       - Number of copies of the sector that must be
+ *                             written to the disk before the slot is reused.
+ *                             0 if secArr matches the sector on the disk.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint8_t  secArr[SECTOR_LEN];
+  uint32_t secNum;
+  uint8_t  lastUse;
+  uint8_t  valid;
+  uint8_t  lockCnt;
+  uint8_t  dirty;
+}
+SecPoolSlot;
+
+static SecPoolSlot secPool[FAT_SEC_POOL_SLOTS];
+
+// number of sectors between the copies of a dirty sector, i.e. the FAT size.
+static uint32_t copyStride;
+
+// incremented each time a slot is used. Wraps, only differences are compared
+static uint8_t useCnt;
+
+// slot that was used by the last lookup. Checked first by fat_GetSector
+static uint8_t lastSlot;
+
+//
+// Cluster allocator state. Set from the FSInfo sector by fat_InitAlloc, and
+// kept up to date by fat_SetNextClusIndex and fat_AllocRun.
+//
+static uint32_t freeClusCnt = FSI_UNKNOWN;   // number of free clusters
+static uint32_t nextFreeClus = FSI_UNKNOWN;  // where to begin free search
+static uint32_t fsInfoSec;                   // FSInfo sector address, or 0
+static uint8_t  fsInfoChanged;               // 1 if FSInfo fields changed
+
+#if FAT_FREE_MAP_LEN
+// bit set for each region of FAT sectors known to hold no free clusters.
+static uint8_t  fullRegionMap[FAT_FREE_MAP_LEN];
+
+// number of FAT sectors in each region of fullRegionMap
+static uint32_t regionSecCnt;
+#endif//FAT_FREE_MAP_LEN
+
+#if FAT_DIR_CACHE_SLOTS
+static FatDirCacheEntry dirCache[FAT_DIR_CACHE_SLOTS];
+
+// incremented each time a directory cache slot is used.
+static uint8_t dirUseCnt;
+#endif//FAT_DIR_CACHE_SLOTS
+
+#if FAT_DISK_STATS
+// sector pool and directory cache counters. See DiskStats.
+static uint32_t poolGets;                    // calls to fat_GetSector
+static uint32_t poolMisses;                  // sectors that were not pooled
+static uint32_t dirCacheHits;
+static uint32_t dirCacheMisses;
+
+#define STATS_INC(cnt)     (++(cnt))
+#else
+#define STATS_INC(cnt)
+#endif//FAT_DISK_STATS
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               BORROW A SECTOR FROM THE POOL
+ *
+ * Description : Returns a pointer to a sector pool buffer holding the contents
+ *               of the disk sector at secNum. If the sector is not already in
+ *               the pool, it is read from the disk into an empty or the least
+ *               recently used unlocked slot.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *
+ * Returns     : Pointer to the buffer holding the sector, or NULL if the 
+ *               sector could not be read from the disk or all slots are 
+ *               locked.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_GetSector(uint32_t secNum)
+{
+  SecPoolSlot *slotPtr = &secPool[lastSlot];
+
+  STATS_INC(poolGets);
+
+  // fast path. Same sector as returned by the previous call.
+  if (!(slotPtr->valid && slotPtr->secNum == secNum))
+  {
+    uint8_t slot;
+    for (slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+      if (secPool[slot].valid && secPool[slot].secNum == secNum)
+        break;
+    
+    // sector is not in the pool. Load it into the slot being replaced.
+    if (slot == FAT_SEC_POOL_SLOTS)
+    {
+      STATS_INC(poolMisses);
+      slot = pvt_GetReplSlot();
+      if (slot == NO_FREE_SLOT)
+        return NULL;
+
+      slotPtr = &secPool[slot];
+      if (FATtoDisk_ReadSingleSector(secNum, slotPtr->secArr)
+          == FAILED_READ_SECTOR)
+      {
+        slotPtr->valid = 0;
+        return NULL;
+      }
+      slotPtr->secNum = secNum;
+      slotPtr->valid = 1;
+    }
+    slotPtr = &secPool[slot];
+    lastSlot = slot;
+  }
+  slotPtr->lastUse = ++useCnt;
+  ++slotPtr->lockCnt;
+  return slotPtr->secArr;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         BORROW A BLANK SECTOR FROM THE POOL
+ *
+ * Description : Returns a pointer to a sector pool buffer that is tagged with
+ *               the sector at secNum, but is filled with zeros instead of 
+ *               being read from the disk.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *
+ * Returns     : Pointer to the buffer, or NULL if all slots are locked.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_GetBlankSector(uint32_t secNum)
+{
+  // any pooled copy of the sector is replaced by the blank sector
+  fat_InvalidateSectors(secNum, 1);
+
+  uint8_t slot = pvt_GetReplSlot();
+  if (slot == NO_FREE_SLOT)
+    return NULL;
+
+  SecPoolSlot *slotPtr = &secPool[slot];
+  memset(slotPtr->secArr, 0, SECTOR_LEN);
+  slotPtr->secNum = secNum;
+  slotPtr->valid = 1;
+  slotPtr->lastUse = ++useCnt;
+  slotPtr->lockCnt = 1;
+  lastSlot = slot;
+  return slotPtr->secArr;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               BORROW A BUFFER FROM THE POOL
+ *
+ * Description : Returns a pointer to a sector pool buffer that is not tagged
+ *               with a sector, for use as a scratch buffer.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Pointer to the buffer, or NULL if all slots are locked.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_GetSectorBuffer(void)
+{
+  uint8_t slot = pvt_GetReplSlot();
+  if (slot == NO_FREE_SLOT)
+    return NULL;
+
+  SecPoolSlot *slotPtr = &secPool[slot];
+  slotPtr->valid = 0;
+  slotPtr->lockCnt = 1;
+  return slotPtr->secArr;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        BORROW A SECTOR ONLY IF IT IS POOLED
+ *
+ * Description : Returns a pointer to the sector pool buffer holding the disk
+ *               sector at secNum, if the sector is in the pool. Unlike 
+ *               fat_GetSector, the sector is never read from the disk.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *
+ * Returns     : Pointer to the buffer holding the sector, or NULL if the 
+ *               sector is not in the pool.
+ *
+ * ----------------------------------------------------------------------------
+ */
+uint8_t *fat_FindPooledSector(uint32_t secNum)
+{
+  STATS_INC(poolGets);
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+  {
+    SecPoolSlot *slotPtr = &secPool[slot];
+    if (slotPtr->valid && slotPtr->secNum == secNum)
+    {
+      slotPtr->lastUse = ++useCnt;
+      ++slotPtr->lockCnt;
+      lastSlot = slot;
+      return slotPtr->secArr;
+    }
+  }
+  STATS_INC(poolMisses);
+  return NULL;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               TAG A BORROWED SCRATCH BUFFER
+ *
+ * Description : Tags a buffer returned by fat_GetSectorBuffer with the disk
+ *               sector at secNum, after the sector has been loaded into it, 
+ *               so that it stays in the pool when the buffer is released.
+ *
+ * Arguments   : secArr   - Pointer returned by fat_GetSectorBuffer, holding 
+ *                          the contents of the sector at secNum.
+ *               secNum   - Address of the sector on the disk.
+ *
+ * Returns     : void
+ *
+ * ----------------------------------------------------------------------------
+ */
+void fat_TagSectorBuffer(const uint8_t secArr[], uint32_t secNum)
+{
+  SecPoolSlot *bufPtr = NULL;
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+  {
+    SecPoolSlot *slotPtr = &secPool[slot];
+    if (slotPtr->secArr == secArr)
+      bufPtr = slotPtr;
+    else if (slotPtr->valid && slotPtr->secNum == secNum)
+      return;                               // already pooled
+  }
+  if (bufPtr == NULL || bufPtr->valid)
+    return;
+
+  bufPtr->secNum = secNum;
+  bufPtr->valid = 1;
+  bufPtr->lastUse = ++useCnt;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           COPY A RANGE OF BYTES OF A SECTOR
+ *
+ * Description : Loads len bytes, beginning at offset, of the disk sector at
+ *               secNum into buf. The bytes are copied from the sector pool if
+ *               the sector is pooled, otherwise only the range is read from 
+ *               the disk with FATtoDisk_ReadSectorRange.
+ *
+ * Arguments   : secNum   - Address of the sector on the disk.
+ *               offset   - Position in the sector of the first byte to load.
+ *               len      - Number of bytes to load.
+ *               buf      - Pointer to the array that will be loaded with the
+ *                          len bytes.
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_GetSectorBytes(uint32_t secNum, uint16_t offset, uint16_t len,
+                           uint8_t buf[])
+{
+  STATS_INC(poolGets);
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+  {
+    SecPoolSlot *slotPtr = &secPool[slot];
+    if (slotPtr->valid && slotPtr->secNum == secNum)
+    {
+      memcpy(buf, slotPtr->secArr + offset, len);
+      slotPtr->lastUse = ++useCnt;
+      lastSlot = slot;
+      return SUCCESS;
+    }
+  }
+  STATS_INC(poolMisses);
+
+  // a pooled copy may be dirty, so the disk is only read if it is not pooled
+  if (FATtoDisk_ReadSectorRange(secNum, offset, len, buf) 
+      == FAILED_READ_SECTOR)
+    return FAILED_READ_SECTOR;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        RETURN A BORROWED BUFFER TO THE POOL
+ *
+ * Description : Releases a buffer returned by fat_GetSector or 
+ *               fat_GetSectorBuffer so that its slot can be reused.
+ *
+ * Arguments   : secArr   - Pointer returned by fat_GetSector or 
+ *                          fat_GetSectorBuffer.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_ReleaseSector(const uint8_t secArr[])
+{
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+    if (secPool[slot].secArr == secArr)
+    {
+      if (secPool[slot].lockCnt)
+        --secPool[slot].lockCnt;
+      return;
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  INVALIDATE THE SECTOR POOL
+ *
+ * Description : Marks all slots of the sector pool as empty and unlocked.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_InvalidateSecPool(void)
+{
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+  {
+    secPool[slot].valid = 0;
+    secPool[slot].lockCnt = 0;
+    secPool[slot].dirty = 0;
+  }
+  lastSlot = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               INVALIDATE A RANGE OF SECTORS
+ *
+ * Description : Removes any of the secCnt sectors beginning at fstSecNum from
+ *               the sector pool.
+ *
+ * Arguments   : fstSecNum   - Address of the first sector of the range.
+ *               secCnt      - Number of sectors in the range.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_InvalidateSectors(uint32_t fstSecNum, uint32_t secCnt)
+{
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+    if (secPool[slot].valid && secPool[slot].secNum - fstSecNum < secCnt)
+    {
+      secPool[slot].valid = 0;
+      secPool[slot].dirty = 0;
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  MARK A POOLED SECTOR DIRTY
+ *
+ * Description : Marks the sector held in a buffer returned by fat_GetSector
+ *               as modified, so that it is written back to the disk before
+ *               its slot is reused, or by fat_SyncSecPool.
+ *
+ * Arguments   : secArr   - Pointer returned by fat_GetSector.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_MarkSectorDirty(const uint8_t secArr[])
+{
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+    if (secPool[slot].secArr == secArr)
+    {
+      if (secPool[slot].valid && !secPool[slot].dirty)
+        secPool[slot].dirty = 1;
+      return;
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                            WRITE DIRTY SECTORS BACK TO DISK
+ *
+ * Description : Writes every dirty sector of the sector pool to the disk. A
+ *               dirty FAT sector is written to each copy of the FAT.
+ *
+ * Arguments   : void
+ *
+ * Returns     : SUCCESS or FAILED_WRITE_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SyncSecPool(void)
+{
+  uint8_t err = SUCCESS;
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+    if (secPool[slot].dirty)
+      err |= pvt_WriteBackSlot(slot);
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           GET THE INDEX OF THE NEXT CLUSTER
+ *
+ * Description : Finds and returns the FAT index of the cluster that follows
+ *               clusIndx in its cluster chain. The FAT sector holding the
+ *               index is borrowed from the sector pool, so it is only read
+ *               from the disk if it is not already in the pool.
+ *
+ * Arguments   : clusIndx    - The current cluster's FAT index.
+ *               bpb         - Pointer to the BPB struct instance.
+ *
+ * Returns     : A file or dir's next FAT cluster index. If END_CLUSTER is
+ *               returned, the current cluster is the last of the file or dir.
+ *               FAILED_CLUS_INDX is returned if the FAT could not be read.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_GetNextClusIndex(uint32_t clusIndx, const BPB *bpb)
+{
+  //
+  // The first FAT sector follows the reserved sectors of the volume, which
+  // begin at the boot sector. This is calculated from dataRegionFirstSector so
+  // that the location of the boot sector on the disk is accounted for.
+  //
+  uint32_t fatFirstSec = bpb->dataRegionFirstSector
+                       - bpb->numOfFats * bpb->fatSize32;
+
+  uint32_t fatSecNum = fatFirstSec + clusIndx / INDXS_PER_FAT_SEC;
+  uint16_t posNextClusIndxInSec = BYTES_PER_INDEX
+                                  * (clusIndx % INDXS_PER_FAT_SEC);
+  FAT_SET_READ_CAT(READ_CAT_FAT);
+
+#if FAT_LINK_RANGE_READ
+  // only the bytes of the current cluster's index are loaded
+  uint8_t linkArr[BYTES_PER_INDEX];
+  if (fat_GetSectorBytes(fatSecNum, posNextClusIndxInSec, BYTES_PER_INDEX,
+                         linkArr) != SUCCESS)
+    return FAILED_CLUS_INDX;
+#else
+  // load the sector of the FAT containing the current cluster's index
+  uint8_t *secArr = fat_GetSector(fatSecNum);
+  if (secArr == NULL)
+    return FAILED_CLUS_INDX;
+  const uint8_t *linkArr = secArr + posNextClusIndxInSec;
+#endif//FAT_LINK_RANGE_READ
+
+  // Value at the current cluster index is the index of the next cluster.
+  uint32_t nextClusIndx = 0;
+
+  // load the index of the next cluster.
+  for (uint8_t offset = BYTES_PER_INDEX - 1; offset > 0; --offset)
+  {
+    nextClusIndx |= linkArr[offset];
+    nextClusIndx <<= 8;
+  }
+  nextClusIndx |= linkArr[0];
+
+#if !FAT_LINK_RANGE_READ
+  fat_ReleaseSector(secArr);
+#endif//FAT_LINK_RANGE_READ
+  return nextClusIndx;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           SET THE INDEX OF THE NEXT CLUSTER
+ *
+ * Description : Links the cluster at clusIndx to nextClusIndx by setting its
+ *               entry in the FAT. The entry is only set in the pooled FAT
+ *               sector, which is marked dirty, and is written to each copy of
+ *               the FAT when the sector is written back.
+ *
+ * Arguments   : clusIndx       - FAT index of the cluster to link.
+ *               nextClusIndx   - FAT index of the cluster that will follow 
+ *                                clusIndx, or END_CLUSTER.
+ *               bpb            - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SetNextClusIndex(uint32_t clusIndx, uint32_t nextClusIndx,
+                             const BPB *bpb)
+{
+  uint32_t fatFirstSec = bpb->dataRegionFirstSector
+                       - bpb->numOfFats * bpb->fatSize32;
+
+  FAT_SET_READ_CAT(READ_CAT_FAT);
+  uint8_t *secArr = fat_GetSector(fatFirstSec + clusIndx / INDXS_PER_FAT_SEC);
+  if (secArr == NULL)
+    return FAILED_READ_SECTOR;
+
+  uint16_t pos = BYTES_PER_INDEX * (clusIndx % INDXS_PER_FAT_SEC);
+
+  // count clusters changing between free and used.
+  uint8_t wasFree = !(secArr[pos] | secArr[pos + 1] | secArr[pos + 2]
+                      | (secArr[pos + 3] & 0x0F));
+  uint8_t isFree = !(nextClusIndx & 0x0FFFFFFF);
+  if (wasFree != isFree)
+  {
+    if (freeClusCnt != FSI_UNKNOWN)
+      freeClusCnt += isFree ? 1 : -1;
+    fsInfoChanged = 1;
+#if FAT_FREE_MAP_LEN
+    if (isFree && regionSecCnt)
+      pvt_SetRegionFull(clusIndx / INDXS_PER_FAT_SEC / regionSecCnt, 0);
+#endif//FAT_FREE_MAP_LEN
+  }
+
+  // upper 4 bits of a FAT32 entry are reserved and must be preserved.
+  nextClusIndx = (nextClusIndx & 0x0FFFFFFF) 
+               | ((uint32_t)(secArr[pos + 3] & 0xF0) << 24);
+  for (uint8_t offset = 0; offset < BYTES_PER_INDEX; ++offset)
+  {
+    secArr[pos + offset] = nextClusIndx;
+    nextClusIndx >>= 8;
+  }
+
+  //
+  // Mark the slot dirty for every FAT copy. The copies follow each other, so
+  // the sector of copy n is n * fatSize32 past the sector of the first FAT.
+  //
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+    if (secPool[slot].secArr == secArr)
+      secPool[slot].dirty = bpb->numOfFats;
+  copyStride = bpb->fatSize32;
+
+  fat_ReleaseSector(secArr);
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                            GET A RUN OF CONTIGUOUS CLUSTERS
+ *
+ * Description : Follows the cluster chain beginning at fstClusIndx for as long
+ *               as each cluster is linked to the cluster that physically
+ *               follows it, up to maxCnt clusters, and returns the number of
+ *               clusters in this run.
+ *
+ * Arguments   : fstClusIndx    - FAT index of the first cluster of the run.
+ *               nextClusIndx   - Pointer to a uint32_t that will be set to
+ *                                the FAT index of the cluster that follows 
+ *                                the run, i.e. the first cluster of the next
+ *                                run, END_CLUSTER, or FAILED_CLUS_INDX if a 
+ *                                FAT sector could not be read.
+ *               maxCnt         - Maximum number of clusters to return. Must 
+ *                                be at least 1.
+ *               bpb            - Pointer to the BPB struct instance.
+ *
+ * Returns     : Number of clusters in the run. This is always at least 1.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_GetClusRun(uint32_t fstClusIndx, uint32_t *nextClusIndx,
+                        uint32_t maxCnt, const BPB *bpb)
+{
+  uint32_t fatFirstSec = bpb->dataRegionFirstSector
+                       - bpb->numOfFats * bpb->fatSize32;
+  uint32_t clusIndx = fstClusIndx;
+  uint32_t linkIndx;
+  uint16_t pos;
+
+  //
+  // scan the links directly in the pooled FAT sector. The sector only needs
+  // to be looked up again when the run crosses into the next FAT sector.
+  //
+  do
+  {
+    FAT_SET_READ_CAT(READ_CAT_FAT);
+    uint8_t *secArr = fat_GetSector(fatFirstSec 
+                                    + clusIndx / INDXS_PER_FAT_SEC);
+    if (secArr == NULL)
+    {
+      *nextClusIndx = FAILED_CLUS_INDX;
+      return clusIndx - fstClusIndx + 1;
+    }
+
+    // position of the current cluster's link in the sector
+    pos = BYTES_PER_INDEX * (clusIndx % INDXS_PER_FAT_SEC);
+    
+    for (; pos < SECTOR_LEN; pos += BYTES_PER_INDEX)
+    {
+      linkIndx = secArr[pos + 3];
+      linkIndx <<= 8;
+      linkIndx |= secArr[pos + 2];
+      linkIndx <<= 8;
+      linkIndx |= secArr[pos + 1];
+      linkIndx <<= 8;
+      linkIndx |= secArr[pos];
+
+      //
+      // end of run if next cluster is not the physically following cluster,
+      // or if maxCnt clusters have been counted. The link of the last cluster
+      // has then been read, so it is the index of the following cluster.
+      //
+      if (linkIndx != clusIndx + 1 || clusIndx - fstClusIndx + 1 >= maxCnt)
+        break;
+      ++clusIndx;
+    }
+    fat_ReleaseSector(secArr);
+  }
+  while (pos == SECTOR_LEN);              // run continues in next FAT sector
+
+  *nextClusIndx = linkIndx;
+  return clusIndx - fstClusIndx + 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 FIND A RUN OF FREE CLUSTERS
+ *
+ * Description : Searches the FAT, beginning at startClusIndx, for a run of 
+ *               up to maxCnt contiguous free clusters.
+ *
+ * Arguments   : startClusIndx   - FAT index of the cluster the search begins
+ *                                 at. The search wraps around to cluster 2
+ *                                 at the end of the FAT.
+ *               maxCnt          - Number of clusters wanted. Must be at 
+ *                                 least 1.
+ *               runCnt          - Pointer to a uint32_t that will be set to
+ *                                 the number of clusters in the run found.
+ *               bpb             - Pointer to the BPB struct instance.
+ *
+ * Returns     : FAT index of the first cluster of the run, END_CLUSTER if
+ *               there are no free clusters, or FAILED_CLUS_INDX if a FAT 
+ *               sector could not be read.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_FindFreeRun(uint32_t startClusIndx, uint32_t maxCnt,
+                         uint32_t *runCnt, const BPB *bpb)
+{
+  uint32_t fatFirstSec = bpb->dataRegionFirstSector
+                       - bpb->numOfFats * bpb->fatSize32;
+  uint32_t lastClusIndx = bpb->clusCnt + 1;
+  uint32_t fstIndx = END_CLUSTER, cnt = 0;
+  uint8_t  done = 0;
+#if FAT_FREE_MAP_LEN
+  uint8_t  wholeRegion = 0;      // current region was entered at its start
+  uint32_t regionClusCnt = regionSecCnt * INDXS_PER_FAT_SEC;
+#endif//FAT_FREE_MAP_LEN
+
+  if (startClusIndx < 2 || startClusIndx > lastClusIndx)
+    startClusIndx = 2;
+
+  uint32_t clusIndx = startClusIndx;
+  uint32_t remCnt = bpb->clusCnt;            // entries still to be checked
+  while (remCnt && !done)
+  {
+#if FAT_FREE_MAP_LEN
+    //
+    // At the start of a region, the previous region has been checked from 
+    // start to end without finding a free cluster, so it is marked full. The
+    // new region is skipped over if it is already known to be full.
+    //
+    if (regionClusCnt && cnt == 0
+        && (clusIndx % regionClusCnt == 0 || clusIndx == 2))
+    {
+      uint32_t region = clusIndx / regionClusCnt;
+      if (wholeRegion && region)
+        pvt_SetRegionFull(region - 1, 1);
+      wholeRegion = 1;
+
+      if (pvt_IsRegionFull(region))
+      {
+        uint32_t skipCnt = (region + 1) * regionClusCnt - clusIndx;
+        if (skipCnt > lastClusIndx + 1 - clusIndx)
+          skipCnt = lastClusIndx + 1 - clusIndx;
+        remCnt -= (skipCnt < remCnt) ? skipCnt : remCnt;
+        clusIndx += skipCnt;
+        if (clusIndx > lastClusIndx)
+        {
+          clusIndx = 2;
+          wholeRegion = 0;
+        }
+        continue;
+      }
+    }
+#endif//FAT_FREE_MAP_LEN
+
+    FAT_SET_READ_CAT(READ_CAT_FAT);
+    uint8_t *secArr = fat_GetSector(fatFirstSec 
+                                    + clusIndx / INDXS_PER_FAT_SEC);
+    if (secArr == NULL)
+    {
+      *runCnt = 0;
+      return FAILED_CLUS_INDX;
+    }
+
+    uint16_t pos = BYTES_PER_INDEX * (clusIndx % INDXS_PER_FAT_SEC);
+    for (; pos < SECTOR_LEN && remCnt; pos += BYTES_PER_INDEX)
+    {
+      // an entry is free if its lower 28 bits are 0
+      if (secArr[pos] | secArr[pos + 1] | secArr[pos + 2]
+          | (secArr[pos + 3] & 0x0F))
+      {
+        if (cnt)                            // end of the run
+        {
+          done = 1;
+          break;
+        }
+      }
+      else if (cnt++ == 0)
+        fstIndx = clusIndx;
+      --remCnt;
+
+      if (cnt == maxCnt)
+      {
+        done = 1;
+        break;
+      }
+
+      // a run cannot continue past the last cluster, so wrap and start over
+      if (++clusIndx > lastClusIndx)
+      {
+#if FAT_FREE_MAP_LEN
+        if (regionClusCnt && wholeRegion && cnt == 0)
+          pvt_SetRegionFull(lastClusIndx / regionClusCnt, 1);
+        wholeRegion = 0;
+#endif//FAT_FREE_MAP_LEN
+        clusIndx = 2;
+        done = (cnt != 0);
+        break;
+      }
+    }
+    fat_ReleaseSector(secArr);
+  }
+
+  *runCnt = cnt;
+  return fstIndx;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                            INITIALIZE THE CLUSTER ALLOCATOR
+ *
+ * Description : Sets the free cluster count and next free cluster hint of the
+ *               cluster allocator for a newly mounted volume, and clears the
+ *               map of full FAT regions.
+ *
+ * Arguments   : freeCnt    - Free cluster count from the FSInfo sector, or
+ *                            FSI_UNKNOWN.
+ *               nextFree   - Next free cluster hint from the FSInfo sector, 
+ *                            or FSI_UNKNOWN.
+ *               bpb        - Pointer to the BPB struct instance.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_InitAlloc(uint32_t freeCnt, uint32_t nextFree, const BPB *bpb)
+{
+  freeClusCnt = freeCnt;
+  nextFreeClus = nextFree;
+  fsInfoSec = bpb->fsInfoSecNum;
+  fsInfoChanged = 0;
+
+#if FAT_FREE_MAP_LEN
+  // regions are sized so that the whole FAT is covered by the map.
+  regionSecCnt = (bpb->fatSize32 + FAT_FREE_MAP_LEN * 8 - 1) 
+               / (FAT_FREE_MAP_LEN * 8);
+  memset(fullRegionMap, 0, FAT_FREE_MAP_LEN);
+#endif//FAT_FREE_MAP_LEN
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  ALLOCATE A RUN OF CLUSTERS
+ *
+ * Description : Hands out a run of up to maxCnt contiguous free clusters. If
+ *               the cluster at prefClusIndx is free the run begins there,
+ *               otherwise the search begins at the next free cluster hint.
+ *
+ * Arguments   : prefClusIndx   - FAT index of the cluster the run should 
+ *                                begin at, e.g. the cluster following the
+ *                                last cluster of a file, or 0 for none.
+ *               maxCnt         - Number of clusters wanted. Must be at 
+ *                                least 1.
+ *               runCnt         - Pointer to a uint32_t that will be set to
+ *                                the number of clusters in the run.
+ *               bpb            - Pointer to the BPB struct instance.
+ *
+ * Returns     : FAT index of the first cluster of the run, END_CLUSTER if
+ *               there are no free clusters, or FAILED_CLUS_INDX if a FAT 
+ *               sector could not be read.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_AllocRun(uint32_t prefClusIndx, uint32_t maxCnt, 
+                      uint32_t *runCnt, const BPB *bpb)
+{
+  uint32_t startClusIndx = nextFreeClus;
+
+  // the preferred cluster is only used if it is free.
+  if (prefClusIndx >= 2 && prefClusIndx <= bpb->clusCnt + 1
+      && !(fat_GetNextClusIndex(prefClusIndx, bpb) & 0x0FFFFFFF))
+    startClusIndx = prefClusIndx;
+
+  uint32_t fstClusIndx = fat_FindFreeRun(startClusIndx, maxCnt, runCnt, bpb);
+  if (*runCnt)
+  {
+    // the next search begins after the run, so it is not handed out again.
+    nextFreeClus = fstClusIndx + *runCnt;
+    if (nextFreeClus > bpb->clusCnt + 1)
+      nextFreeClus = 2;
+
+    // a free cluster was found, so a count of 0 was wrong.
+    if (freeClusCnt == 0)
+      freeClusCnt = FSI_UNKNOWN;
+    fsInfoChanged = 1;
+  }
+  else if (fstClusIndx == END_CLUSTER && freeClusCnt != 0)
+  {
+    // the whole FAT was searched, so there are no free clusters.
+    freeClusCnt = 0;
+    fsInfoChanged = 1;
+  }
+  return fstClusIndx;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  GET THE FREE CLUSTER COUNT
+ *
+ * Description : Returns the number of free clusters on the volume.
+ *
+ * Arguments   : void
+ *
+ * Returns     : The count of free clusters, or FSI_UNKNOWN if not known.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t fat_GetFreeClusCnt(void)
+{
+  return freeClusCnt;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    UPDATE THE FSINFO SECTOR
+ *
+ * Description : Sets the free cluster count and next free cluster fields of
+ *               the pooled FSInfo sector, if they have changed, and marks it
+ *               dirty.
+ *
+ * Arguments   : void
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SyncFSInfo(void)
+{
+  if (!fsInfoSec || !fsInfoChanged)
+    return SUCCESS;
+
+  FAT_SET_READ_CAT(READ_CAT_BOOT);
+  uint8_t *secArr = fat_GetSector(fsInfoSec);
+  if (secArr == NULL)
+    return FAILED_READ_SECTOR;
+
+  uint32_t freeCnt = freeClusCnt, nextFree = nextFreeClus;
+  for (uint8_t offset = 0; offset < 4; ++offset)
+  {
+    secArr[FSI_FREE_COUNT_POS + offset] = freeCnt;
+    secArr[FSI_NXT_FREE_POS + offset] = nextFree;
+    freeCnt >>= 8;
+    nextFree >>= 8;
+  }
+  fat_MarkSectorDirty(secArr);
+  fat_ReleaseSector(secArr);
+  fsInfoChanged = 0;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  FIND DIRECTORY CACHE ENTRY
+ *
+ * Description : Searches the directory entry cache for an entry that was 
+ *               found by the name, nameStr, in the directory whose first
+ *               cluster index is dirClusIndx.
+ *
+ * Arguments   : dirClusIndx   - First cluster index of the directory.
+ *               nameStr       - Pointer to the name string.
+ *
+ * Returns     : Pointer to the cached entry, or NULL if it is not cached.
+ * ----------------------------------------------------------------------------
+ */
+const FatDirCacheEntry *fat_FindDirCacheEntry(uint32_t dirClusIndx,
+                                              const char nameStr[])
+{
+#if FAT_DIR_CACHE_SLOTS
+  for (uint8_t slot = 0; slot < FAT_DIR_CACHE_SLOTS; ++slot)
+  {
+    FatDirCacheEntry *slotPtr = &dirCache[slot];
+    if (slotPtr->valid && slotPtr->dirClusIndx == dirClusIndx
+        && !strcmp(slotPtr->nameStr, nameStr))
+    {
+      slotPtr->lastUse = ++dirUseCnt;
+      STATS_INC(dirCacheHits);
+      return slotPtr;
+    }
+  }
+#endif//FAT_DIR_CACHE_SLOTS
+  STATS_INC(dirCacheMisses);
+  return NULL;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   ADD DIRECTORY CACHE ENTRY
+ *
+ * Description : Adds a directory entry that was found by name to the directory
+ *               entry cache. If the cache is full, the least recently used 
+ *               slot is replaced.
+ *
+ * Arguments   : dirClusIndx         - First cluster index of the directory.
+ *               nameStr             - Name the entry was found by.
+ *               snEnt               - The 32 bytes of the sn entry.
+ *               snEntClusIndx       - Cluster index of the sn entry.
+ *               snEntSecNumInClus   - Sector number in cluster of sn entry.
+ *               snEntPos            - Position of the sn entry in its sector.
+ *
+ * Returns     : void
+ *
+ * Notes       : The entry is not added if nameStr is longer than 
+ *               FAT_DIR_CACHE_NAME_LEN.
+ * ----------------------------------------------------------------------------
+ */
+void fat_AddDirCacheEntry(uint32_t dirClusIndx, const char nameStr[],
+                          const uint8_t snEnt[], uint32_t snEntClusIndx,
+                          uint8_t snEntSecNumInClus, uint16_t snEntPos)
+{
+#if FAT_DIR_CACHE_SLOTS
+  // names that do not fit in a slot are not cached.
+  if (strlen(nameStr) > FAT_DIR_CACHE_NAME_LEN)
+    return;
+
+  // 
+  // find the slot to use. This is the slot already holding the entry if there
+  // is one, else an empty slot, else the least recently used slot.
+  //
+  uint8_t replSlot = 0;
+  uint8_t replAge = 0;
+  for (uint8_t slot = 0; slot < FAT_DIR_CACHE_SLOTS; ++slot)
+  {
+    FatDirCacheEntry *slotPtr = &dirCache[slot];
+    if (!slotPtr->valid)
+    {
+      if (replAge != 0xFF)
+      {
+        replAge = 0xFF;
+        replSlot = slot;
+      }
+    }
+    else if (slotPtr->dirClusIndx == dirClusIndx
+             && !strcmp(slotPtr->nameStr, nameStr))
+    {
+      replSlot = slot;
+      break;
+    }
+    else if (replAge != 0xFF
+             && (uint8_t)(dirUseCnt - slotPtr->lastUse) >= replAge)
+    {
+      replAge = dirUseCnt - slotPtr->lastUse;
+      replSlot = slot;
+    }
+  }
+
+  FatDirCacheEntry *slotPtr = &dirCache[replSlot];
+  slotPtr->dirClusIndx = dirClusIndx;
+  strcpy(slotPtr->nameStr, nameStr);
+  memcpy(slotPtr->snEnt, snEnt, ENTRY_LEN);
+  slotPtr->snEntClusIndx = snEntClusIndx;
+  slotPtr->snEntSecNumInClus = snEntSecNumInClus;
+  slotPtr->snEntPos = snEntPos;
+  slotPtr->lastUse = ++dirUseCnt;
+  slotPtr->valid = 1;
+#endif//FAT_DIR_CACHE_SLOTS
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              INVALIDATE THE DIRECTORY CACHE
+ *
+ * Description : Removes the cached entries of a directory from the directory
+ *               entry cache.
+ *
+ * Arguments   : dirClusIndx   - First cluster index of the directory, or 
+ *                               DIR_CACHE_ALL to remove all cached entries.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_InvalidateDirCache(uint32_t dirClusIndx)
+{
+#if FAT_DIR_CACHE_SLOTS
+  for (uint8_t slot = 0; slot < FAT_DIR_CACHE_SLOTS; ++slot)
+    if (dirClusIndx == DIR_CACHE_ALL 
+        || dirCache[slot].dirClusIndx == dirClusIndx)
+      dirCache[slot].valid = 0;
+#endif//FAT_DIR_CACHE_SLOTS
+}
+
+#if FAT_DISK_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          GET FAT READ STATS
+ *
+ * Description : Loads the disk implementation's counters, and the sector pool
+ *               and directory cache counters, into stats.
+ *
+ * Arguments   : stats   - Pointer to the DiskStats instance to load.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_GetStats(DiskStats *stats)
+{
+  FATtoDisk_GetStats(stats);
+  stats->poolHits = poolGets - poolMisses;
+  stats->poolMisses = poolMisses;
+  stats->dirCacheHits = dirCacheHits;
+  stats->dirCacheMisses = dirCacheMisses;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        RESET FAT READ STATS
+ *
+ * Description : Sets all of the DiskStats counters to 0.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_ResetStats(void)
+{
+  FATtoDisk_ResetStats();
+  poolGets = 0;
+  poolMisses = 0;
+  dirCacheHits = 0;
+  dirCacheMisses = 0;
+}
+
+#endif//FAT_DISK_STATS
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                      (PRIVATE) FIND SECTOR POOL SLOT TO USE
+ *
+ * Description : Finds the slot of the sector pool that should be used to load
+ *               a new sector. This is an empty slot if there is one, otherwise
+ *               the least recently used clean slot, otherwise the least
+ *               recently used dirty slot, which is first written back to the
+ *               disk. Locked slots are never chosen.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Index of the slot, or NO_FREE_SLOT if all slots are locked
+ *               or a dirty slot could not be written back.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_GetReplSlot(void)
+{
+  uint8_t replSlot = NO_FREE_SLOT, dirtySlot = NO_FREE_SLOT;
+  uint8_t replAge = 0, dirtyAge = 0;
+  for (uint8_t slot = 0; slot < FAT_SEC_POOL_SLOTS; ++slot)
+  {
+    SecPoolSlot *slotPtr = &secPool[slot];
+    uint8_t age = useCnt - slotPtr->lastUse;
+    if (slotPtr->lockCnt)
+      continue;
+    if (!slotPtr->valid)                    // empty slot
+      return slot;
+    if (slotPtr->dirty)
+    {
+      if (age >= dirtyAge)
+      {
+        dirtyAge = age;
+        dirtySlot = slot;
+      }
+    }
+    else if (age >= replAge)
+    {
+      replAge = age;
+      replSlot = slot;
+    }
+  }
+
+  // every unlocked slot is dirty. Write the least recently used one back.
+  if (replSlot == NO_FREE_SLOT && dirtySlot != NO_FREE_SLOT
+      && pvt_WriteBackSlot(dirtySlot) == SUCCESS)
+    replSlot = dirtySlot;
+  return replSlot;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        (PRIVATE) WRITE A DIRTY SLOT TO DISK
+ *
+ * Description : Writes the sector held in a dirty slot to each of its copies
+ *               on the disk and marks the slot clean.
+ *
+ * Arguments   : slot   - Index of the slot.
+ *
+ * Returns     : SUCCESS or FAILED_WRITE_SECTOR. On failure the slot is left
+ *               dirty so that the write can be attempted again.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_WriteBackSlot(uint8_t slot)
+{
+  SecPoolSlot *slotPtr = &secPool[slot];
+  uint32_t secNum = slotPtr->secNum;
+
+  for (uint8_t copy = 0; copy < slotPtr->dirty; ++copy, secNum += copyStride)
+    if (FATtoDisk_WriteSingleSector(secNum, slotPtr->secArr)
+        == FAILED_WRITE_SECTOR)
+      return FAILED_WRITE_SECTOR;
+  slotPtr->dirty = 0;
+  return SUCCESS;
+}
+
+#if FAT_FREE_MAP_LEN
+/*
+ * ----------------------------------------------------------------------------
+ *                                         (PRIVATE) CHECK IF A REGION IS FULL
+ *
+ * Description : Returns the bit of fullRegionMap for a region of the FAT.
+ *
+ * Arguments   : region   - Index of the region of FAT sectors.
+ *
+ * Returns     : 1 if the region is known to hold no free clusters, else 0.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_IsRegionFull(uint32_t region)
+{
+  if (region >= FAT_FREE_MAP_LEN * 8)
+    return 0;
+  return (fullRegionMap[region / 8] >> (region % 8)) & 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                (PRIVATE) SET A REGION'S BIT
+ *
+ * Description : Sets or clears the bit of fullRegionMap for a region of the 
+ *               FAT.
+ *
+ * Arguments   : region   - Index of the region of FAT sectors.
+ *               full     - 1 if the region holds no free clusters, else 0.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_SetRegionFull(uint32_t region, uint8_t full)
+{
+  if (region >= FAT_FREE_MAP_LEN * 8)
+    return;
+  if (full)
+    fullRegionMap[region / 8] |= 1 << (region % 8);
+  else
+    fullRegionMap[region / 8] &= ~(1 << (region % 8));
+}
+#endif//FAT_FREE_MAP_LEN
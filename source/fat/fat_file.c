@@ -0,0 +1,773 @@
+/*
+ * File       : FAT_FILE.C
+ * Version    : 2.0
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of FAT_FILE.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "fat_bpb.h"
+#include "fat.h"
+#include "fat_cache.h"
+#include "fat_file.h"
+#include "fat_to_disk_if.h"
+
+/*
+ ******************************************************************************
+ *                  "PRIVATE" FUNCTION PROTOTYPES and MACROS
+ ******************************************************************************
+ */
+
+static uint8_t pvt_SetFileClus(FatFile *file, uint32_t clusNum);
+static void pvt_ScanFileRun(FatFile *file, uint32_t lastClusNum);
+static void pvt_AddCkpts(FatFile *file, uint32_t clusNum, uint32_t clusIndx,
+                         uint32_t clusCnt);
+static uint32_t pvt_GetDiskSecNum(const FatFile *file, uint32_t fileSecNum);
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    OPEN FILE
+ *
+ * Description : Finds a file by its name or path and, if found, sets a 
+ *               FatFile instance to the file with its cursor at the first 
+ *               byte.
+ *
+ * Arguments   : file      - Pointer to the FatFile instance to be set.
+ *               dir       - Pointer to a FatDir instance. A relative path in
+ *                           fileStr begins at this directory.
+ *               fileStr   - Pointer to a string. This is the name, or path, 
+ *                           of the file to open.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS if the file was opened, FILE_NOT_FOUND if there is no
+ *               file matching fileStr, or any other FAT Error Flag returned
+ *               by fat_ResolvePath.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenFile(FatFile *file, const FatDir *dir, const char fileStr[],
+                     const BPB *bpb)
+{
+  uint8_t err;
+
+  FatEntry ent;
+  if ((err = fat_ResolvePath(dir, fileStr, &ent, NULL, bpb)) != SUCCESS)
+    return err;
+  return fat_OpenEntry(file, &ent, bpb);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             OPEN FILE ENTRY
+ *
+ * Description : Sets a FatFile instance to the file of a FatEntry instance,
+ *               with its cursor at the first byte.
+ *
+ * Arguments   : file   - Pointer to the FatFile instance to be set.
+ *               ent    - Pointer to a FatEntry instance set to a file entry,
+ *                        e.g. by fat_ResolvePath or fat_FindNextEntry.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, or FILE_NOT_FOUND if the entry is not a file.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenEntry(FatFile *file, const FatEntry *ent, const BPB *bpb)
+{
+  // entry must not be a directory, or the Volume ID.
+  if (FAT_ENT_ATTR(ent) & (DIR_ENTRY_ATTR | VOLUME_ID_ATTR))
+    return FILE_NOT_FOUND;
+
+  // get the index of the file's first cluster and the file size
+  file->fstClusIndx = FAT_ENT_FST_CLUS_INDX(ent);
+  file->fileSize = FAT_ENT_FILE_SIZE(ent);
+
+  // set cursor to the first byte of the file.
+  file->bpb = bpb;
+  file->pos = 0;
+  file->clusIndx = file->fstClusIndx;
+  file->clusNum = 0;
+  file->nextRunIndx = 0;
+  file->err = SUCCESS;
+  file->ckptTbl = NULL;
+  file->ckptCnt = 0;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    READ FILE
+ *
+ * Description : Reads up to len bytes from the file, starting at its cursor,
+ *               into buf. The cursor is then advanced past the bytes read.
+ *
+ * Arguments   : file   - Pointer to an open FatFile instance.
+ *               buf    - Pointer to the array the bytes will be loaded into.
+ *                        Must be at least len bytes long.
+ *               len    - Maximum number of bytes to read.
+ *
+ * Returns     : The number of bytes loaded into buf.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_ReadFile(FatFile *file, uint8_t buf[], uint16_t len)
+{
+  const BPB *bpb = file->bpb;
+  uint16_t readCnt = 0;
+
+  // file is closed
+  if (bpb == NULL)
+    return 0;
+
+  // do not read beyond the end of the file.
+  if (len > file->fileSize - file->pos)
+    len = file->fileSize - file->pos;
+
+  file->err = SUCCESS;
+  while (readCnt < len)
+  {
+    // sector of the file that holds the cursor
+    uint32_t fileSecNum = file->pos / SECTOR_LEN;
+    uint16_t secPos = file->pos % SECTOR_LEN;
+    uint8_t  secNumInClus = fileSecNum % bpb->secPerClus;
+
+    // move the cluster cursor to the cluster holding the file cursor
+    file->err = pvt_SetFileClus(file, fileSecNum / bpb->secPerClus);
+    if (file->err != SUCCESS)
+      return readCnt;
+
+    // address of the sector on the disk
+    uint32_t secNumOnDisk = pvt_GetDiskSecNum(file, fileSecNum);
+
+    uint16_t remCnt = len - readCnt;          // remaining bytes to read
+    uint16_t cpyCnt;                          // bytes loaded this iteration
+
+    //
+    // If the cursor is on a sector boundary and at least one whole sector is
+    // still to be read, then load whole sectors directly into buf. These are
+    // limited to the sectors on the run of contiguous clusters beginning at
+    // the current cluster, so they can be read as a single multi-sector read.
+    // The run is only scanned as far as the last cluster these sectors need.
+    //
+    if (secPos == 0 && remCnt >= SECTOR_LEN)
+    {
+      uint32_t secCnt = remCnt / SECTOR_LEN;
+      pvt_ScanFileRun(file, file->clusNum 
+                            + (secNumInClus + secCnt - 1) / bpb->secPerClus);
+      uint32_t runSecCnt = (file->runEndNum - file->clusNum + 1) 
+                         * bpb->secPerClus - secNumInClus;
+      if (secCnt > runSecCnt)
+        secCnt = runSecCnt;
+
+      FAT_SET_READ_CAT(READ_CAT_FILE);
+      if (FATtoDisk_ReadMultipleSectors(secNumOnDisk, secCnt, &buf[readCnt],
+                                        NULL, NULL)
+          == FAILED_READ_SECTOR)
+      {
+        file->err = FAILED_READ_SECTOR;
+        return readCnt;
+      }
+      cpyCnt = secCnt * SECTOR_LEN;
+    }
+    // otherwise, borrow the sector from the sector pool and copy from there.
+    else
+    {
+      FAT_SET_READ_CAT(READ_CAT_FILE);
+      const uint8_t *secArr = fat_GetSector(secNumOnDisk);
+      if (secArr == NULL)
+      {
+        file->err = FAILED_READ_SECTOR;
+        return readCnt;
+      }
+      cpyCnt = SECTOR_LEN - secPos;
+      if (cpyCnt > remCnt)
+        cpyCnt = remCnt;
+      memcpy(&buf[readCnt], &secArr[secPos], cpyCnt);
+      fat_ReleaseSector(secArr);
+    }
+    readCnt += cpyCnt;
+    file->pos += cpyCnt;
+  }
+
+  if (file->pos == file->fileSize)
+    file->err = END_OF_FILE;
+  return readCnt;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   SEEK FILE
+ *
+ * Description : Moves the cursor of an open file to the byte at offset. The
+ *               next fat_ReadFile will begin reading at this byte.
+ *
+ * Arguments   : file     - Pointer to an open FatFile instance.
+ *               offset   - Byte offset in the file to move the cursor to.
+ *
+ * Returns     : SUCCESS, END_OF_FILE if offset is not less than the file size
+ *               (the cursor is then set to the end of the file),
+ *               CORRUPT_FAT_ENTRY if the cluster chain could not be followed 
+ *               to the offset, or FAILED_READ_SECTOR if the FAT could not be
+ *               read. FILE_NOT_FOUND is returned if file is closed.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_Seek(FatFile *file, uint32_t offset)
+{
+  // file is closed
+  if (file->bpb == NULL)
+    return FILE_NOT_FOUND;
+
+  if (offset >= file->fileSize)
+  {
+    file->pos = file->fileSize;
+    file->err = END_OF_FILE;
+    return END_OF_FILE;
+  }
+
+  // 
+  // move the cluster cursor now, rather than on the next read, so that an 
+  // invalid cluster chain is reported by the seek. 
+  //
+  file->err = pvt_SetFileClus(file, offset / SECTOR_LEN 
+                                    / file->bpb->secPerClus);
+  if (file->err == SUCCESS)
+    file->pos = offset;
+  return file->err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   SET SEEK CHECKPOINT TABLE
+ *
+ * Description : Gives a file a table in which to record a checkpoint every 
+ *               ckptIntvl clusters as its cluster chain is followed.
+ *
+ * Arguments   : file        - Pointer to an open FatFile instance.
+ *               ckptTbl     - Pointer to a caller supplied array. It is used by
+ *                             the file until it is closed or reopened.
+ *               tblLen      - Number of elements in ckptTbl.
+ *               ckptIntvl   - Number of clusters between checkpoints.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_SetSeekTable(FatFile *file, uint32_t ckptTbl[], uint8_t tblLen,
+                      uint16_t ckptIntvl)
+{
+  file->ckptCnt = 0;
+  if (ckptTbl == NULL || tblLen == 0 || ckptIntvl == 0)
+  {
+    file->ckptTbl = NULL;
+    return;
+  }
+  file->ckptTbl = ckptTbl;
+  file->ckptLen = tblLen;
+  file->ckptIntvl = ckptIntvl;
+
+  // the cluster cursor may already be past some of the checkpoints. Move back
+  // to the first cluster so these are recorded when the chain is followed.
+  file->clusIndx = file->fstClusIndx;
+  file->clusNum = 0;
+  file->nextRunIndx = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            OPEN READ AHEAD
+ *
+ * Description : Sets a FatReadAhead instance to read an open file, beginning
+ *               at the file's cursor, into two caller supplied buffers.
+ *
+ * Arguments   : ra       - Pointer to the FatReadAhead instance to be set.
+ *               file     - Pointer to an open FatFile instance.
+ *               bufA     - Pointer to the first buffer.
+ *               bufB     - Pointer to the second buffer.
+ *               bufLen   - Length of each buffer.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_OpenReadAhead(FatReadAhead *ra, FatFile *file, uint8_t bufA[], 
+                       uint8_t bufB[], uint16_t bufLen)
+{
+  ra->file = file;
+  ra->bufArr[0] = bufA;
+  ra->bufArr[1] = bufB;
+  ra->bufLen = bufLen;
+  ra->dataLen[0] = ra->dataLen[1] = 0;
+#if FAT_ASYNC_READ
+  ra->loading = 0;
+#endif//FAT_ASYNC_READ
+
+  // neither buffer is held, so the first to be filled and returned is bufA.
+  ra->curr = 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            FILL READ AHEAD
+ *
+ * Description : Loads the next part of the file into the buffer that is not
+ *               held by the application, if it is empty.
+ *
+ * Arguments   : ra   - Pointer to a FatReadAhead instance.
+ *
+ * Returns     : SUCCESS if the buffer is loaded, or was already loaded, 
+ *               READ_AHEAD_BUSY if the load is still in progress, END_OF_FILE
+ *               if there is no more of the file to read, or the FAT Error 
+ *               Flag of the read.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_FillReadAhead(FatReadAhead *ra)
+{
+  uint8_t next = ra->curr ^ 1;
+  if (ra->dataLen[next])
+    return SUCCESS;
+
+  //
+  // the file's cursor is always at the byte following the last buffer 
+  // loaded, so the next part of the file is read from its current cluster.
+  //
+#if FAT_ASYNC_READ
+  if (!ra->loading)
+  {
+    fat_StartReadFile(&ra->ard, ra->file, ra->bufArr[next], ra->bufLen);
+    ra->loading = 1;
+  }
+  if (fat_PollReadFile(&ra->ard))
+    return READ_AHEAD_BUSY;
+  ra->loading = 0;
+  ra->dataLen[next] = fat_CompleteReadFile(&ra->ard);
+#else
+  ra->dataLen[next] = fat_ReadFile(ra->file, ra->bufArr[next], ra->bufLen);
+#endif//FAT_ASYNC_READ
+  if (ra->dataLen[next])
+    return SUCCESS;
+  return ra->file->err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            NEXT READ AHEAD
+ *
+ * Description : Gets the buffer holding the next part of the file. The buffer
+ *               that was returned by the previous call is given back to be 
+ *               loaded by fat_FillReadAhead.
+ *
+ * Arguments   : ra    - Pointer to a FatReadAhead instance.
+ *               buf   - Set to point to the buffer holding the next bytes of
+ *                       the file.
+ *
+ * Returns     : The number of bytes of the file in buf.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_NextReadAhead(FatReadAhead *ra, const uint8_t **buf)
+{
+  // give back the buffer held by the application.
+  ra->dataLen[ra->curr] = 0;
+
+  // load the next buffer now if it was not filled ahead of time.
+  while (fat_FillReadAhead(ra) == READ_AHEAD_BUSY)
+    ;
+
+  ra->curr ^= 1;
+  *buf = ra->bufArr[ra->curr];
+  return ra->dataLen[ra->curr];
+}
+
+#if FAT_ASYNC_READ
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             START ASYNC READ
+ *
+ * Description : Sets a FatAsyncRead instance to read up to len bytes from an
+ *               open file, starting at its cursor, into buf. The read is then
+ *               performed by calls to fat_PollReadFile.
+ *
+ * Arguments   : ard    - Pointer to the FatAsyncRead instance to be set.
+ *               file   - Pointer to an open FatFile instance.
+ *               buf    - Pointer to the array the bytes will be loaded into.
+ *                        Must be at least len bytes long.
+ *               len    - Maximum number of bytes to read.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_StartReadFile(FatAsyncRead *ard, FatFile *file, uint8_t buf[], 
+                       uint16_t len)
+{
+  // nothing is read from a closed file, or beyond the end of the file.
+  if (file->bpb == NULL)
+    len = 0;
+  else if (len > file->fileSize - file->pos)
+    len = file->fileSize - file->pos;
+
+  ard->file = file;
+  ard->buf = buf;
+  ard->len = len;
+  ard->readCnt = 0;
+  ard->secArr = NULL;
+  ard->busy = 0;
+  file->err = SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              POLL ASYNC READ
+ *
+ * Description : Advances a read started by fat_StartReadFile. Each call 
+ *               advances the disk read of the current sector by one step, and
+ *               starts the read of the next sector when a sector is done.
+ *
+ * Arguments   : ard   - Pointer to a FatAsyncRead instance set by 
+ *                       fat_StartReadFile.
+ *
+ * Returns     : 1 if the read is still in progress, 0 when it is done.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_PollReadFile(FatAsyncRead *ard)
+{
+  FatFile *file = ard->file;
+  uint8_t err;
+
+  // wait for the sector being read, then take its bytes.
+  if (ard->busy)
+  {
+    if (FATtoDisk_PollReadSector() == READ_SECTOR_BUSY)
+      return 1;
+    ard->busy = 0;
+
+    err = FATtoDisk_CompleteReadSector();
+    if (ard->secArr != NULL)
+    {
+      // the sector stays in the pool for the next read of the same sector.
+      if (err == READ_SECTOR_SUCCESS)
+      {
+        fat_TagSectorBuffer(ard->secArr, ard->secNum);
+        memcpy(&ard->buf[ard->readCnt], &ard->secArr[ard->secPos], 
+               ard->cpyCnt);
+      }
+      fat_ReleaseSector(ard->secArr);
+      ard->secArr = NULL;
+    }
+    if (err == FAILED_READ_SECTOR)
+    {
+      file->err = FAILED_READ_SECTOR;
+      ard->len = ard->readCnt;
+      return 0;
+    }
+    ard->readCnt += ard->cpyCnt;
+    file->pos += ard->cpyCnt;
+  }
+
+  // done, or ended early by an error.
+  if (ard->readCnt == ard->len)
+  {
+    if (file->err == SUCCESS && file->pos == file->fileSize)
+      file->err = END_OF_FILE;
+    return 0;
+  }
+
+  // move the cluster cursor to the cluster holding the file cursor
+  uint32_t fileSecNum = file->pos / SECTOR_LEN;
+  file->err = pvt_SetFileClus(file, fileSecNum / file->bpb->secPerClus);
+  if (file->err != SUCCESS)
+  {
+    ard->len = ard->readCnt;
+    return 0;
+  }
+
+  uint32_t secNum = pvt_GetDiskSecNum(file, fileSecNum);
+  uint16_t secPos = file->pos % SECTOR_LEN;
+  uint16_t remCnt = ard->len - ard->readCnt;
+
+  //
+  // start the read of the next sector. A whole sector is loaded directly 
+  // into buf. Otherwise the bytes are copied from the pooled sector if it is
+  // in the pool, or else it is loaded into a pool buffer.
+  //
+  FAT_SET_READ_CAT(READ_CAT_FILE);
+  if (secPos == 0 && remCnt >= SECTOR_LEN)
+  {
+    ard->cpyCnt = SECTOR_LEN;
+    err = FATtoDisk_StartReadSector(secNum, &ard->buf[ard->readCnt]);
+  }
+  else
+  {
+    ard->secPos = secPos;
+    ard->cpyCnt = SECTOR_LEN - secPos;
+    if (ard->cpyCnt > remCnt)
+      ard->cpyCnt = remCnt;
+
+    const uint8_t *secArr = fat_FindPooledSector(secNum);
+    if (secArr != NULL)
+    {
+      memcpy(&ard->buf[ard->readCnt], &secArr[secPos], ard->cpyCnt);
+      fat_ReleaseSector(secArr);
+      ard->readCnt += ard->cpyCnt;
+      file->pos += ard->cpyCnt;
+      return 1;
+    }
+
+    ard->secArr = fat_GetSectorBuffer();
+    ard->secNum = secNum;
+    if (ard->secArr == NULL)
+      err = FAILED_READ_SECTOR;
+    else
+      err = FATtoDisk_StartReadSector(secNum, ard->secArr);
+  }
+
+  if (err == FAILED_READ_SECTOR)
+  {
+    if (ard->secArr != NULL)
+    {
+      fat_ReleaseSector(ard->secArr);
+      ard->secArr = NULL;
+    }
+    file->err = FAILED_READ_SECTOR;
+    ard->len = ard->readCnt;
+    return 0;
+  }
+  ard->busy = 1;
+  return 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          COMPLETE ASYNC READ
+ *
+ * Description : Ends a read started by fat_StartReadFile. If the read is not
+ *               yet done, it is first polled until it is.
+ *
+ * Arguments   : ard   - Pointer to a FatAsyncRead instance set by 
+ *                       fat_StartReadFile.
+ *
+ * Returns     : The number of bytes loaded into buf.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_CompleteReadFile(FatAsyncRead *ard)
+{
+  while (fat_PollReadFile(ard))
+    ;
+  return ard->readCnt;
+}
+
+#endif//FAT_ASYNC_READ
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   CLOSE FILE
+ *
+ * Description : Closes an open file.
+ *
+ * Arguments   : file   - Pointer to an open FatFile instance.
+ *
+ * Returns     : SUCCESS
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_Close(FatFile *file)
+{
+  file->bpb = NULL;
+  file->ckptTbl = NULL;
+  return SUCCESS;
+}
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         (PRIVATE) SET FILE'S CLUSTER CURSOR
+ *
+ * Description : Moves the clusIndx / clusNum cluster cursor of a FatFile
+ *               instance to the cluster at position clusNum in its chain.
+ *
+ * Arguments   : file      - Pointer to an open FatFile instance.
+ *               clusNum   - Position in the file's cluster chain of the
+ *                           cluster to move to. 0 is the first cluster.
+ *
+ * Returns     : SUCCESS, CORRUPT_FAT_ENTRY if the chain ends before clusNum,
+ *               or FAILED_READ_SECTOR if the FAT could not be read.
+ *
+ * Notes       : 1) The chain is followed from the nearest of the current 
+ *                  cluster cursor, the last seek checkpoint at or before
+ *                  clusNum, or the first cluster of the file.
+ *               2) The chain is followed one run of contiguous clusters at a
+ *                  time, and any checkpoints passed over are recorded. Each
+ *                  run is only scanned up to clusNum, and is kept in the file
+ *                  so it is not scanned again by the next move.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_SetFileClus(FatFile *file, uint32_t clusNum)
+{
+  // 
+  // find the nearest known cluster at or before clusNum to start from. If the
+  // cluster cursor is after clusNum, it cannot be used since the chain can
+  // only be followed forward.
+  //
+  if (file->ckptTbl != NULL)
+  {
+    uint32_t ckpt = clusNum / file->ckptIntvl;
+    if (ckpt > file->ckptCnt)
+      ckpt = file->ckptCnt;
+    
+    if (clusNum < file->clusNum || ckpt * file->ckptIntvl > file->clusNum)
+    {
+      file->clusNum = ckpt * file->ckptIntvl;
+      file->clusIndx = ckpt ? file->ckptTbl[ckpt - 1] : file->fstClusIndx;
+      file->nextRunIndx = 0;
+    }
+  }
+  else if (clusNum < file->clusNum)
+  {
+    file->clusIndx = file->fstClusIndx;
+    file->clusNum = 0;
+    file->nextRunIndx = 0;
+  }
+
+  // follow the chain, one run of contiguous clusters at a time
+  while (file->clusNum < clusNum)
+  {
+    pvt_ScanFileRun(file, clusNum);
+
+    if (clusNum <= file->runEndNum)         // clusNum is in the current run
+    {
+      file->clusIndx += clusNum - file->clusNum;
+      file->clusNum = clusNum;
+    }
+    else                                    // move to the next run
+    {
+      uint32_t nextClusIndx = file->nextRunIndx;
+      if (nextClusIndx == END_CLUSTER || nextClusIndx == FAILED_CLUS_INDX)
+      {
+        // reset so the cursor is never left at END_CLUSTER
+        file->clusIndx = file->fstClusIndx;
+        file->clusNum = 0;
+        file->nextRunIndx = 0;
+        return (nextClusIndx == END_CLUSTER) ? CORRUPT_FAT_ENTRY 
+                                             : FAILED_READ_SECTOR;
+      }
+      file->clusIndx = nextClusIndx;
+      file->clusNum = file->runEndNum + 1;
+      file->nextRunIndx = 0;
+    }
+  }
+  pvt_AddCkpts(file, file->clusNum, file->clusIndx, 1);
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           (PRIVATE) SCAN FILE'S CLUSTER RUN
+ *
+ * Description : Scans the FAT for the run of contiguous clusters beginning at
+ *               the cluster cursor of a FatFile instance, up to the cluster
+ *               at position lastClusNum in its chain, and keeps it in the 
+ *               file's runEndNum and nextRunIndx.
+ *
+ * Arguments   : file          - Pointer to an open FatFile instance.
+ *               lastClusNum   - Position in the file's chain of the last 
+ *                               cluster that is needed. Must not be less than
+ *                               the clusNum of the file.
+ *
+ * Returns     : void
+ *
+ * Notes       : 1) If the run is already known, the FAT is only read if the 
+ *                  run ends before lastClusNum because a previous scan was 
+ *                  stopped there. The run is then extended.
+ *               2) Any checkpoints on the clusters scanned are recorded.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_ScanFileRun(FatFile *file, uint32_t lastClusNum)
+{
+  uint32_t fstIndx, fstNum;
+
+  if (!file->nextRunIndx)                   // run not scanned yet
+  {
+    fstIndx = file->clusIndx;
+    fstNum = file->clusNum;
+  }
+  else if (file->runEndNum < lastClusNum
+           && file->nextRunIndx 
+              == file->clusIndx + (file->runEndNum - file->clusNum) + 1)
+  {
+    // the last scan was stopped before the end of the run.
+    fstIndx = file->nextRunIndx;
+    fstNum = file->runEndNum + 1;
+  }
+  else
+    return;
+
+  uint32_t runCnt = fat_GetClusRun(fstIndx, &file->nextRunIndx, 
+                                   lastClusNum - fstNum + 1, file->bpb);
+  pvt_AddCkpts(file, fstNum, fstIndx, runCnt);
+  file->runEndNum = fstNum + runCnt - 1;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              (PRIVATE) ADD SEEK CHECKPOINTS
+ *
+ * Description : Records any checkpoints that fall on a run of contiguous
+ *               clusters of a file in the file's checkpoint table.
+ *
+ * Arguments   : file       - Pointer to an open FatFile instance.
+ *               clusNum    - Position in the file's chain of the first cluster
+ *                            of the run.
+ *               clusIndx   - FAT index of the first cluster of the run.
+ *               clusCnt    - Number of clusters in the run.
+ *
+ * Returns     : void
+ *
+ * Notes       : Checkpoints are added to the table in order, so only the next
+ *               checkpoint that has not yet been recorded is checked for. 
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_AddCkpts(FatFile *file, uint32_t clusNum, uint32_t clusIndx,
+                         uint32_t clusCnt)
+{
+  if (file->ckptTbl == NULL)
+    return;
+
+  while (file->ckptCnt < file->ckptLen)
+  {
+    // cluster number of the next checkpoint to record
+    uint32_t ckptClusNum = (uint32_t)(file->ckptCnt + 1) * file->ckptIntvl;
+    if (ckptClusNum < clusNum || ckptClusNum >= clusNum + clusCnt)
+      return;
+    file->ckptTbl[file->ckptCnt++] = clusIndx + (ckptClusNum - clusNum);
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         (PRIVATE) GET SECTOR ADDRESS ON DISK
+ *
+ * Description : Returns the address on the disk of a sector of a file that is
+ *               in the cluster at the file's cluster cursor.
+ *
+ * Arguments   : file         - Pointer to an open FatFile instance.
+ *               fileSecNum   - Position of the sector in the file. 0 is the
+ *                              first sector.
+ *
+ * Returns     : Address of the sector on the disk.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t pvt_GetDiskSecNum(const FatFile *file, uint32_t fileSecNum)
+{
+  const BPB *bpb = file->bpb;
+  return bpb->dataRegionFirstSector + fileSecNum % bpb->secPerClus
+         + (file->clusIndx - bpb->rootClus) * bpb->secPerClus;
+}
@@ -0,0 +1,490 @@
+/*
+ * File       : FAT_HANDLE.C
+ * Version    : 2.0
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of FAT_HANDLE.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fat_bpb.h"
+#include "fat.h"
+#include "fat_file.h"
+#include "fat_handle.h"
+
+/*
+ ******************************************************************************
+ *                  "PRIVATE" FUNCTION PROTOTYPES and MACROS
+ ******************************************************************************
+ */
+
+#if FAT_HANDLE_SLOTS >= 255
+#error "FAT_HANDLE_SLOTS must be less than 255"
+#endif
+
+// values of the type member of a HandleSlot
+#define HANDLE_FREE          0
+#define HANDLE_FILE          1
+#define HANDLE_DIR           2
+
+// node member of a file HandleSlot that does not share a FileNode
+#define NO_NODE              0xFF
+
+//
+// The state shared by all handles open on the same file. The file is
+// identified by its first cluster index. refCnt is 0 if the node is unused.
+//
+typedef struct
+{
+  uint32_t fstClusIndx;
+  uint16_t ckptIntvl;
+  uint8_t  ckptCnt;                         // most checkpoints of any handle
+  uint8_t  refCnt;                          // num of handles open on file
+  uint32_t ckptTbl[FAT_HANDLE_CKPT_LEN];
+}
+FileNode;
+
+// A slot of the handle table. The handle is the slot's index in the table.
+typedef struct
+{
+  uint8_t type;
+  uint8_t node;                             // index in nodeTbl, or NO_NODE
+  union
+  {
+    FatFile    file;
+    FatDirIter iter;
+  }
+  cur;
+}
+HandleSlot;
+
+static HandleSlot *pvt_GetSlot(uint8_t hndl, uint8_t type);
+static uint8_t pvt_GetFreeSlot(void);
+static uint8_t pvt_ShareFileNode(HandleSlot *slot);
+static void pvt_SyncCkpts(HandleSlot *slot);
+static void pvt_ShareClusCursor(HandleSlot *slot, uint32_t offset);
+
+// handle table, and the nodes of the files open in it.
+static HandleSlot hndlTbl[FAT_HANDLE_SLOTS];
+static FileNode   nodeTbl[FAT_HANDLE_SLOTS];
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             OPEN FILE HANDLE
+ *
+ * Description : Finds a file by its name or path and, if found, opens a
+ *               handle to it with its cursor at the first byte.
+ *
+ * Arguments   : hndl      - Set to the handle of the open file.
+ *               dir       - Pointer to a FatDir instance. A relative path in
+ *                           fileStr begins at this directory.
+ *               fileStr   - Pointer to a string. This is the name, or path,
+ *                           of the file to open.
+ *               bpb       - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS if the file was opened, NO_FREE_HANDLE if all handle
+ *               slots are open, or any FAT Error Flag returned by
+ *               fat_OpenFile.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenFileHandle(uint8_t *hndl, const FatDir *dir,
+                           const char fileStr[], const BPB *bpb)
+{
+  uint8_t err;
+  uint8_t slotNum = pvt_GetFreeSlot();
+  if (slotNum == FAT_HANDLE_SLOTS)
+    return NO_FREE_HANDLE;
+
+  HandleSlot *slot = &hndlTbl[slotNum];
+  err = fat_OpenFile(&slot->cur.file, dir, fileStr, bpb);
+  if (err != SUCCESS)
+    return err;
+
+  slot->type = HANDLE_FILE;
+  slot->node = pvt_ShareFileNode(slot);
+  *hndl = slotNum;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        OPEN DIRECTORY HANDLE
+ *
+ * Description : Opens a handle to a directory with its cursor at the first
+ *               entry.
+ *
+ * Arguments   : hndl   - Set to the handle of the open directory.
+ *               dir    - Pointer to a FatDir instance. This is the directory
+ *                        whose entries will be read.
+ *               bpb    - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, or NO_FREE_HANDLE if all handle slots are open.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenDirHandle(uint8_t *hndl, const FatDir *dir, const BPB *bpb)
+{
+  uint8_t slotNum = pvt_GetFreeSlot();
+  if (slotNum == FAT_HANDLE_SLOTS)
+    return NO_FREE_HANDLE;
+
+  HandleSlot *slot = &hndlTbl[slotNum];
+  fat_OpenDirIter(&slot->cur.iter, dir, bpb);
+  slot->type = HANDLE_DIR;
+  slot->node = NO_NODE;
+  *hndl = slotNum;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             READ FILE HANDLE
+ *
+ * Description : Reads up to len bytes from the file of a handle, starting at
+ *               its cursor, into buf. See fat_ReadFile.
+ *
+ * Arguments   : hndl   - Handle of an open file.
+ *               buf    - Pointer to the array the bytes will be loaded into.
+ *                        Must be at least len bytes long.
+ *               len    - Maximum number of bytes to read.
+ *
+ * Returns     : The number of bytes loaded into buf. 0 if hndl is not the
+ *               handle of an open file.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_ReadHandle(uint8_t hndl, uint8_t buf[], uint16_t len)
+{
+  HandleSlot *slot = pvt_GetSlot(hndl, HANDLE_FILE);
+  if (slot == NULL)
+    return 0;
+
+  pvt_SyncCkpts(slot);
+  uint16_t readCnt = fat_ReadFile(&slot->cur.file, buf, len);
+  pvt_SyncCkpts(slot);
+  return readCnt;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             SEEK FILE HANDLE
+ *
+ * Description : Moves the cursor of the file of a handle to the byte at
+ *               offset. See fat_Seek.
+ *
+ * Arguments   : hndl     - Handle of an open file.
+ *               offset   - Byte offset in the file to move the cursor to.
+ *
+ * Returns     : Any FAT Error Flag returned by fat_Seek, or FILE_NOT_FOUND if
+ *               hndl is not the handle of an open file.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SeekHandle(uint8_t hndl, uint32_t offset)
+{
+  HandleSlot *slot = pvt_GetSlot(hndl, HANDLE_FILE);
+  if (slot == NULL)
+    return FILE_NOT_FOUND;
+
+  pvt_SyncCkpts(slot);
+  pvt_ShareClusCursor(slot, offset);
+  uint8_t err = fat_Seek(&slot->cur.file, offset);
+  pvt_SyncCkpts(slot);
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    GET FILE OF A FILE HANDLE
+ *
+ * Description : Returns the FatFile instance of the handle of an open file.
+ *
+ * Arguments   : hndl   - Handle of an open file.
+ *
+ * Returns     : Pointer to the handle's FatFile instance, or NULL if hndl is
+ *               not the handle of an open file.
+ * ----------------------------------------------------------------------------
+ */
+FatFile *fat_GetHandleFile(uint8_t hndl)
+{
+  HandleSlot *slot = pvt_GetSlot(hndl, HANDLE_FILE);
+  if (slot == NULL)
+    return NULL;
+  return &slot->cur.file;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  NEXT DIRECTORY HANDLE ENTRY
+ *
+ * Description : Sets a FatEntry instance to the next entry of the directory
+ *               of a handle, and advances the handle's cursor past it.
+ *
+ * Arguments   : hndl   - Handle of an open directory.
+ *               ent    - Pointer to the FatEntry instance that will be set
+ *                        to the next entry.
+ *
+ * Returns     : SUCCESS if ent was set to the next entry. END_OF_DIRECTORY if
+ *               there are no more entries, DIR_NOT_FOUND if hndl is not the
+ *               handle of an open directory, otherwise any other FAT Error
+ *               Flag returned while reading the directory.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_NextHandleEntry(uint8_t hndl, FatEntry *ent)
+{
+  HandleSlot *slot = pvt_GetSlot(hndl, HANDLE_DIR);
+  if (slot == NULL)
+    return DIR_NOT_FOUND;
+
+  //
+  // the iterator keeps its position when closed, so its sector is released
+  // after each entry rather than being held in the pool between calls.
+  //
+  uint8_t err = fat_NextDirEntry(&slot->cur.iter, ent);
+  fat_CloseDirIter(&slot->cur.iter);
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 CLOSE HANDLE
+ *
+ * Description : Closes an open file or directory handle, so that its slot
+ *               can be used by another handle.
+ *
+ * Arguments   : hndl   - Handle of an open file or directory.
+ *
+ * Returns     : SUCCESS, or FILE_NOT_FOUND if hndl is not an open handle.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_CloseHandle(uint8_t hndl)
+{
+  if (hndl >= FAT_HANDLE_SLOTS || hndlTbl[hndl].type == HANDLE_FREE)
+    return FILE_NOT_FOUND;
+
+  HandleSlot *slot = &hndlTbl[hndl];
+  if (slot->type == HANDLE_FILE)
+  {
+    if (slot->node != NO_NODE)
+      --nodeTbl[slot->node].refCnt;
+    fat_Close(&slot->cur.file);
+  }
+  else
+    fat_CloseDirIter(&slot->cur.iter);
+
+  slot->type = HANDLE_FREE;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            CLOSE ALL HANDLES
+ *
+ * Description : Closes every open file and directory handle.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void fat_CloseAllHandles(void)
+{
+  for (uint8_t hndl = 0; hndl < FAT_HANDLE_SLOTS; ++hndl)
+    fat_CloseHandle(hndl);
+}
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      (PRIVATE) GET OPEN SLOT
+ *
+ * Description : Returns the slot of a handle if it is open with the type.
+ *
+ * Arguments   : hndl   - The handle.
+ *               type   - HANDLE_FILE or HANDLE_DIR.
+ *
+ * Returns     : Pointer to the handle's slot, or NULL if hndl is not an open
+ *               handle of that type.
+ * ----------------------------------------------------------------------------
+ */
+static HandleSlot *pvt_GetSlot(uint8_t hndl, uint8_t type)
+{
+  if (hndl >= FAT_HANDLE_SLOTS || hndlTbl[hndl].type != type)
+    return NULL;
+  return &hndlTbl[hndl];
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    (PRIVATE) GET A FREE SLOT
+ *
+ * Description : Finds a slot of the handle table that is not open.
+ *
+ * Arguments   : void
+ *
+ * Returns     : The number of the free slot, or FAT_HANDLE_SLOTS if every
+ *               slot is open.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_GetFreeSlot(void)
+{
+  uint8_t slotNum = 0;
+  while (slotNum < FAT_HANDLE_SLOTS && hndlTbl[slotNum].type != HANDLE_FREE)
+    ++slotNum;
+  return slotNum;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         (PRIVATE) SHARE A FILE'S CHECKPOINTS
+ *
+ * Description : Gives the file of a newly opened slot the checkpoint table of
+ *               the node of its file. If no other handle is open on the file,
+ *               a free node is set up for it.
+ *
+ * Arguments   : slot   - Pointer to the slot of the newly opened file.
+ *
+ * Returns     : Index in nodeTbl of the file's node, or NO_NODE if the file
+ *               has no clusters.
+ *
+ * Notes       : 1) A node is always free here, as there are as many nodes as
+ *                  slots, and each open slot references at most one node.
+ *               2) The checkpoint interval is chosen so that the table covers
+ *                  the whole file. Every handle on the file uses the same
+ *                  interval, so checkpoint i is the same cluster for all of
+ *                  them, and any of them may record it.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_ShareFileNode(HandleSlot *slot)
+{
+  FatFile *file = &slot->cur.file;
+  if (!file->fstClusIndx)
+    return NO_NODE;
+
+  // find a node open on the same file, else the first free node.
+  uint8_t nodeNum = NO_NODE;
+  for (uint8_t num = 0; num < FAT_HANDLE_SLOTS; ++num)
+  {
+    if (nodeTbl[num].refCnt && nodeTbl[num].fstClusIndx == file->fstClusIndx)
+    {
+      nodeNum = num;
+      break;
+    }
+    if (!nodeTbl[num].refCnt && nodeNum == NO_NODE)
+      nodeNum = num;
+  }
+
+  FileNode *node = &nodeTbl[nodeNum];
+  if (!node->refCnt)
+  {
+    // bytes in a cluster, and the number of clusters of the file.
+    uint32_t clusLen = (uint32_t)file->bpb->secPerClus * SECTOR_LEN;
+    uint32_t clusCnt = (file->fileSize + clusLen - 1) / clusLen;
+    uint32_t ckptIntvl = (clusCnt + FAT_HANDLE_CKPT_LEN - 1)
+                       / FAT_HANDLE_CKPT_LEN;
+
+    node->fstClusIndx = file->fstClusIndx;
+    node->ckptIntvl = ckptIntvl > UINT16_MAX ? UINT16_MAX
+                    : ckptIntvl ? ckptIntvl : 1;
+    node->ckptCnt = 0;
+  }
+  ++node->refCnt;
+  fat_SetSeekTable(file, node->ckptTbl, FAT_HANDLE_CKPT_LEN, node->ckptIntvl);
+  file->ckptCnt = node->ckptCnt;
+  return nodeNum;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                     (PRIVATE) SYNC A FILE'S CHECKPOINT COUNT
+ *
+ * Description : Brings the checkpoint count of the file of a slot and of its
+ *               node up to the larger of the two.
+ *
+ * Arguments   : slot   - Pointer to the slot of an open file.
+ *
+ * Returns     : void
+ *
+ * Notes       : Called before each read or seek, so that the file can use the
+ *               checkpoints recorded by the other handles on the file, and
+ *               after it, so they can use the ones it recorded.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_SyncCkpts(HandleSlot *slot)
+{
+  if (slot->node == NO_NODE)
+    return;
+
+  FatFile *file = &slot->cur.file;
+  FileNode *node = &nodeTbl[slot->node];
+  if (node->ckptCnt > file->ckptCnt)
+    file->ckptCnt = node->ckptCnt;
+  else
+    node->ckptCnt = file->ckptCnt;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                       (PRIVATE) SHARE ANOTHER CLUSTER CURSOR
+ *
+ * Description : Before a seek, moves the cluster cursor of the file of a
+ *               slot to the cluster cursor of another handle on the same file
+ *               if it is nearer to, and not after, the offset than the
+ *               clusters the file already knows.
+ *
+ * Arguments   : slot     - Pointer to the slot of an open file.
+ *               offset   - Byte offset in the file that will be seeked to.
+ *
+ * Returns     : void
+ *
+ * Notes       : The seek then follows the chain from the nearest cluster
+ *               known to any handle. See pvt_SetFileClus in FAT_FILE.C, which
+ *               keeps a cluster cursor that is at or before the offset if it
+ *               is not before the last checkpoint at or before the offset.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_ShareClusCursor(HandleSlot *slot, uint32_t offset)
+{
+  if (slot->node == NO_NODE)
+    return;
+
+  FatFile *file = &slot->cur.file;
+  uint32_t clusNum = offset / SECTOR_LEN / file->bpb->secPerClus;
+
+  // nearest cluster at or before clusNum already known to this file.
+  uint32_t ckpt = clusNum / file->ckptIntvl;
+  if (ckpt > file->ckptCnt)
+    ckpt = file->ckptCnt;
+  uint32_t knownClusNum = ckpt * file->ckptIntvl;
+  if (file->clusNum <= clusNum && file->clusNum > knownClusNum)
+    knownClusNum = file->clusNum;
+
+  for (uint8_t hndl = 0; hndl < FAT_HANDLE_SLOTS; ++hndl)
+  {
+    const HandleSlot *other = &hndlTbl[hndl];
+    if (other == slot || other->type != HANDLE_FILE
+        || other->node != slot->node)
+      continue;
+
+    const FatFile *otherFile = &other->cur.file;
+    if (otherFile->clusNum <= clusNum && otherFile->clusNum > knownClusNum)
+    {
+      knownClusNum = otherFile->clusNum;
+      file->clusNum = otherFile->clusNum;
+      file->clusIndx = otherFile->clusIndx;
+      file->runEndNum = otherFile->runEndNum;
+      file->nextRunIndx = otherFile->nextRunIndx;
+    }
+  }
+}
@@ -0,0 +1,447 @@
+/*
+ * File       : FAT_LOG.C
+ * Version    : 2.0
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of FAT_LOG.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "fat_bpb.h"
+#include "fat.h"
+#include "fat_cache.h"
+#include "fat_log.h"
+#include "fat_to_disk_if.h"
+
+/*
+ ******************************************************************************
+ *                  "PRIVATE" FUNCTION PROTOTYPES and MACROS
+ ******************************************************************************
+ */
+
+static uint8_t pvt_NextLogClus(FatLog *log);
+static uint8_t pvt_LinkRun(FatLog *log);
+static uint8_t pvt_ReserveRun(FatLog *log);
+
+// largest size of a FAT32 file
+#define FILE_SIZE_MAX        0xFFFFFFFF
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                     OPEN LOG
+ *
+ * Description : Sets a FatLog instance to append to the file of a FatEntry
+ *               instance, and reserves a run of free clusters for it.
+ *
+ * Arguments   : log         - Pointer to the FatLog instance to be set.
+ *               ent         - Pointer to a FatEntry instance set to a file
+ *                             entry, e.g. by fat_ResolvePath.
+ *               ckptIntvl   - Number of bytes written between checkpoints.
+ *                             0 if checkpoints are only made by
+ *                             fat_SyncLog and fat_CloseLog.
+ *               bpb         - Pointer to the BPB struct instance.
+ *
+ * Returns     : SUCCESS, FILE_NOT_FOUND if the entry is not a file,
+ *               CORRUPT_FAT_ENTRY if the file's cluster chain is shorter than
+ *               its size, FAILED_READ_SECTOR if the FAT could not be read, or
+ *               NO_FREE_CLUSTER if no free cluster could be reserved.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_OpenLog(FatLog *log, const FatEntry *ent, uint32_t ckptIntvl,
+                    const BPB *bpb)
+{
+  uint8_t err;
+
+  log->bpb = NULL;
+
+  // entry must not be a directory, or the Volume ID.
+  if (FAT_ENT_ATTR(ent) & (DIR_ENTRY_ATTR | VOLUME_ID_ATTR))
+    return FILE_NOT_FOUND;
+
+  // location of the sn entry, so its size can be updated at checkpoints
+  log->entSecNum = bpb->dataRegionFirstSector + ent->snEntSecNumInClus
+                 + (ent->snEntClusIndx - bpb->rootClus) * bpb->secPerClus;
+  log->entPos = ent->nextEntPos - ENTRY_LEN;
+
+  log->fstClusIndx = FAT_ENT_FST_CLUS_INDX(ent);
+  log->fileSize = FAT_ENT_FILE_SIZE(ent);
+  log->ckptSize = log->fileSize;
+  log->ckptIntvl = ckptIntvl;
+  log->linkCnt = 0;
+  log->runClusCnt = 0;
+  log->clusIndx = 0;
+  log->clusNum = NO_LOG_CLUS;
+
+  //
+  // Follow the chain to its last cluster, one run at a time, and set the
+  // cursor to the cluster holding the last byte of the file. This is usually
+  // the last cluster, but the chain may have been allocated beyond the size.
+  //
+  if (log->fstClusIndx)
+  {
+    uint32_t lastClusNum = log->fileSize ? (log->fileSize - 1) / SECTOR_LEN
+                                           / bpb->secPerClus
+                                         : NO_LOG_CLUS;
+    uint32_t clusIndx = log->fstClusIndx;
+    do
+    {
+      uint32_t nextClusIndx;
+      uint32_t runCnt = fat_GetClusRun(clusIndx, &nextClusIndx, bpb->clusCnt,
+                                       bpb);
+
+      if (lastClusNum - log->linkCnt < runCnt)
+      {
+        log->clusIndx = clusIndx + (lastClusNum - log->linkCnt);
+        log->clusNum = lastClusNum;
+      }
+      log->linkCnt += runCnt;
+      log->tailClusIndx = clusIndx + runCnt - 1;
+      clusIndx = nextClusIndx;
+      if (clusIndx == FAILED_CLUS_INDX)
+        return FAILED_READ_SECTOR;
+
+      // chain is longer than the volume, so it must loop.
+      if (log->linkCnt > bpb->clusCnt)
+        return CORRUPT_FAT_ENTRY;
+    }
+    while (clusIndx != END_CLUSTER);
+  }
+  if (log->fileSize && log->clusNum == NO_LOG_CLUS)
+    return CORRUPT_FAT_ENTRY;
+
+  //
+  // reserve the first run now, so the free cluster search is not made while
+  // logging. If there are no free clusters the log is not opened, since the
+  // first write that needs a cluster would fail.
+  //
+  log->bpb = bpb;
+  if ((err = pvt_ReserveRun(log)) != SUCCESS)
+  {
+    log->bpb = NULL;
+    return err;
+  }
+  log->err = SUCCESS;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    WRITE LOG
+ *
+ * Description : Appends len bytes from buf to the end of the file.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *               buf   - Pointer to the array holding the bytes to write.
+ *               len   - Number of bytes to write.
+ *
+ * Returns     : The number of bytes written.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t fat_WriteLog(FatLog *log, const uint8_t buf[], uint16_t len)
+{
+  const BPB *bpb = log->bpb;
+  uint16_t wrCnt = 0;
+
+  // log is closed
+  if (bpb == NULL)
+    return 0;
+
+  // do not write beyond the largest file size.
+  if (len > FILE_SIZE_MAX - log->fileSize)
+    len = FILE_SIZE_MAX - log->fileSize;
+
+  log->err = SUCCESS;
+  while (wrCnt < len)
+  {
+    // sector of the file that the next byte is written to
+    uint32_t fileSecNum = log->fileSize / SECTOR_LEN;
+    uint16_t secPos = log->fileSize % SECTOR_LEN;
+    uint8_t  secNumInClus = fileSecNum % bpb->secPerClus;
+
+    // cursor's cluster is full. Move it to the next cluster of the file.
+    if (log->clusNum != fileSecNum / bpb->secPerClus)
+    {
+      log->err = pvt_NextLogClus(log);
+      if (log->err != SUCCESS)
+        return wrCnt;
+    }
+
+    // address of the sector on the disk
+    uint32_t secNumOnDisk = bpb->dataRegionFirstSector + secNumInClus
+                          + (log->clusIndx - bpb->rootClus)
+                          * bpb->secPerClus;
+
+    uint16_t remCnt = len - wrCnt;            // remaining bytes to write
+    uint16_t cpyCnt;                          // bytes written this iteration
+
+    //
+    // If the end of the file is on a sector boundary and at least one whole
+    // sector is still to be written, then write whole sectors directly from
+    // buf. These are limited to the rest of the current cluster and, if it
+    // is a reserved cluster, the rest of the reserved run, since these are
+    // consecutive on the disk.
+    //
+    if (secPos == 0 && remCnt >= SECTOR_LEN)
+    {
+      uint32_t secCnt = bpb->secPerClus - secNumInClus;
+      if (log->clusNum >= log->linkCnt)
+        secCnt += (log->linkCnt + log->runClusCnt - log->clusNum - 1)
+                * bpb->secPerClus;
+      if (secCnt > remCnt / SECTOR_LEN)
+        secCnt = remCnt / SECTOR_LEN;
+
+      fat_InvalidateSectors(secNumOnDisk, secCnt);
+      if (FATtoDisk_WriteMultipleSectors(secNumOnDisk, secCnt, &buf[wrCnt])
+          == FAILED_WRITE_SECTOR)
+      {
+        log->err = FAILED_WRITE_SECTOR;
+        return wrCnt;
+      }
+      cpyCnt = secCnt * SECTOR_LEN;
+
+      // move the cursor to the cluster holding the last byte written.
+      uint32_t lastClusNum = (fileSecNum + secCnt - 1) / bpb->secPerClus;
+      log->clusIndx += lastClusNum - log->clusNum;
+      log->clusNum = lastClusNum;
+    }
+    //
+    // otherwise, copy into the sector in the sector pool. The sector is past
+    // the end of the file, so if it is being started it doesn't need to be
+    // read from the disk.
+    //
+    else
+    {
+      FAT_SET_READ_CAT(READ_CAT_FILE);
+      uint8_t *secArr = secPos ? fat_GetSector(secNumOnDisk)
+                               : fat_GetBlankSector(secNumOnDisk);
+      if (secArr == NULL)
+      {
+        log->err = FAILED_READ_SECTOR;
+        return wrCnt;
+      }
+      cpyCnt = SECTOR_LEN - secPos;
+      if (cpyCnt > remCnt)
+        cpyCnt = remCnt;
+      memcpy(&secArr[secPos], &buf[wrCnt], cpyCnt);
+      fat_MarkSectorDirty(secArr);
+      fat_ReleaseSector(secArr);
+    }
+    wrCnt += cpyCnt;
+    log->fileSize += cpyCnt;
+
+    if (log->ckptIntvl && log->fileSize - log->ckptSize >= log->ckptIntvl)
+    {
+      log->err = fat_SyncLog(log);
+      if (log->err != SUCCESS)
+        return wrCnt;
+    }
+  }
+  return wrCnt;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                     SYNC LOG
+ *
+ * Description : Makes a checkpoint. The clusters written since the last
+ *               checkpoint are linked into the file's cluster chain, and the
+ *               file size in its directory entry is updated, so that all of
+ *               the data written is part of the file on the disk.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS, FAILED_READ_SECTOR or FAILED_WRITE_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_SyncLog(FatLog *log)
+{
+  uint8_t err;
+
+  // log is closed
+  if (log->bpb == NULL)
+    return FILE_NOT_FOUND;
+
+  // write the data and FAT sectors first.
+  if ((err = pvt_LinkRun(log)) != SUCCESS
+      || (err = fat_SyncSecPool()) != SUCCESS)
+    return err;
+
+  if (log->fileSize == log->ckptSize)
+    return SUCCESS;
+
+  // update the first cluster and file size in the sn entry.
+  FAT_SET_READ_CAT(READ_CAT_DIR);
+  uint8_t *secArr = fat_GetSector(log->entSecNum);
+  if (secArr == NULL)
+    return FAILED_READ_SECTOR;
+
+  uint8_t *snEnt = &secArr[log->entPos];
+  snEnt[FST_CLUS_INDX_BYTE_OFFSET_0] = log->fstClusIndx;
+  snEnt[FST_CLUS_INDX_BYTE_OFFSET_1] = log->fstClusIndx >> 8;
+  snEnt[FST_CLUS_INDX_BYTE_OFFSET_2] = log->fstClusIndx >> 16;
+  snEnt[FST_CLUS_INDX_BYTE_OFFSET_3] = log->fstClusIndx >> 24;
+  snEnt[FILE_SIZE_BYTE_OFFSET_0] = log->fileSize;
+  snEnt[FILE_SIZE_BYTE_OFFSET_1] = log->fileSize >> 8;
+  snEnt[FILE_SIZE_BYTE_OFFSET_2] = log->fileSize >> 16;
+  snEnt[FILE_SIZE_BYTE_OFFSET_3] = log->fileSize >> 24;
+  fat_MarkSectorDirty(secArr);
+  fat_ReleaseSector(secArr);
+
+  if ((err = fat_SyncSecPool()) != SUCCESS)
+    return err;
+
+  // the directory cache may hold a copy of the entry with the old size.
+  fat_InvalidateDirCache(DIR_CACHE_ALL);
+  log->ckptSize = log->fileSize;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    CLOSE LOG
+ *
+ * Description : Makes a final checkpoint and closes the log.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS, FAILED_READ_SECTOR or FAILED_WRITE_SECTOR.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t fat_CloseLog(FatLog *log)
+{
+  uint8_t err = fat_SyncLog(log);
+
+  // free cluster count and hint are only written to FSInfo on closing.
+  if (err == SUCCESS)
+    err = fat_SyncFSInfo();
+  if (err == SUCCESS)
+    err = fat_SyncSecPool();
+  log->bpb = NULL;
+  return err;
+}
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              (PRIVATE) MOVE TO NEXT CLUSTER
+ *
+ * Description : Moves the cluster cursor of a FatLog instance to the next
+ *               cluster of the file. This is the next cluster in the file's
+ *               chain if there is one, otherwise the next reserved cluster.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS, CORRUPT_FAT_ENTRY, FAILED_READ_SECTOR, or 
+ *               NO_FREE_CLUSTER or the error of linking the run if a new run
+ *               had to be reserved.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_NextLogClus(FatLog *log)
+{
+  uint8_t  err;
+  uint32_t clusNum = log->clusNum + 1;      // NO_LOG_CLUS wraps to 0
+
+  // the chain was allocated past the end of the file
+  if (clusNum < log->linkCnt)
+  {
+    log->clusIndx = clusNum ? fat_GetNextClusIndex(log->clusIndx, log->bpb)
+                            : log->fstClusIndx;
+    log->clusNum = clusNum;
+    if (log->clusIndx == FAILED_CLUS_INDX)
+      return FAILED_READ_SECTOR;
+    return (log->clusIndx == END_CLUSTER) ? CORRUPT_FAT_ENTRY : SUCCESS;
+  }
+
+  //
+  // every reserved cluster has been written to. Link them to the file now,
+  // since only the run after them is held, and reserve another run.
+  //
+  if (clusNum - log->linkCnt >= log->runClusCnt)
+  {
+    if ((err = pvt_LinkRun(log)) != SUCCESS
+        || (err = pvt_ReserveRun(log)) != SUCCESS)
+      return err;
+  }
+  log->clusIndx = log->runClusIndx + (clusNum - log->linkCnt);
+  log->clusNum = clusNum;
+  return SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                          (PRIVATE) LINK WRITTEN RUN CLUSTERS
+ *
+ * Description : Links the reserved clusters that have been written to, up to
+ *               the cursor's cluster, to the end of the file's cluster chain
+ *               and marks the last of them as the end of the chain.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS or FAILED_READ_SECTOR.
+ *
+ * Notes       : The links are only made in the pooled FAT sectors. They are
+ *               written to the disk when the sectors are written back.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_LinkRun(FatLog *log)
+{
+  uint8_t err;
+
+  if (log->clusNum == NO_LOG_CLUS || log->clusNum < log->linkCnt)
+    return SUCCESS;
+
+  // the written clusters begin the run. Link them one after another.
+  while (log->linkCnt <= log->clusNum)
+  {
+    if (log->linkCnt == 0)
+      log->fstClusIndx = log->runClusIndx;
+    else if ((err = fat_SetNextClusIndex(log->tailClusIndx, log->runClusIndx,
+                                         log->bpb)) != SUCCESS)
+      return err;
+
+    log->tailClusIndx = log->runClusIndx++;
+    --log->runClusCnt;
+    ++log->linkCnt;
+  }
+  return fat_SetNextClusIndex(log->tailClusIndx, END_CLUSTER, log->bpb);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 (PRIVATE) RESERVE A NEW RUN
+ *
+ * Description : Reserves a run of up to FAT_LOG_PREALLOC_CLUS free clusters
+ *               from the cluster allocator, preferably beginning right after
+ *               the file's last cluster.
+ *
+ * Arguments   : log   - Pointer to an open FatLog instance.
+ *
+ * Returns     : SUCCESS, NO_FREE_CLUSTER, or FAILED_READ_SECTOR if the FAT 
+ *               could not be read.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_ReserveRun(FatLog *log)
+{
+  uint32_t prefClusIndx = log->linkCnt ? log->tailClusIndx + 1 : 0;
+
+  log->runClusIndx = fat_AllocRun(prefClusIndx, FAT_LOG_PREALLOC_CLUS,
+                                  &log->runClusCnt, log->bpb);
+  if (log->runClusIndx == FAILED_CLUS_INDX)
+    return FAILED_READ_SECTOR;
+  return log->runClusCnt ? SUCCESS : NO_FREE_CLUSTER;
+}
@@ -0,0 +1,582 @@
+/*
+ * File       : FAT_TO_IMAGE.C
+ * Version    : 2.0
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of FAT_TO_DISK_IF.H and FAT_TO_IMAGE.H for a disk image file
+ * on a host computer.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "fat_bpb.h"
+#include "fat.h"
+#include "fat_to_disk_if.h"
+#include "fat_to_image.h"
+#if FAT_IMAGE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif//FAT_IMAGE_MMAP
+
+/*
+ ******************************************************************************
+ *                  "PRIVATE" FUNCTION PROTOTYPES and MACROS
+ ******************************************************************************
+ */
+
+static uint8_t pvt_ReadBlock(uint32_t blkNum, uint16_t offset, uint16_t len,
+                             uint8_t blkArr[]);
+static uint8_t pvt_WriteBlock(uint32_t blkNum, const uint8_t blkArr[]);
+static uint8_t pvt_IsBootSector(const uint8_t blkArr[]);
+static uint32_t pvt_FindPartition(const uint8_t blkArr[]);
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   (PRIVATE) DISK IMAGE STATE
+ *
+ * Description : The image file that is accessed as the disk.
+ *
+ * Members     : fp / map      - The open file, or its memory mapping if
+ *                               FAT_IMAGE_MMAP is set. NULL if not open.
+ *               blkCnt        - Number of whole blocks in the image.
+ *               writable      - 1 if the image was opened IMAGE_WRITABLE.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+#if FAT_IMAGE_MMAP
+  uint8_t *map;
+#else
+  FILE    *fp;
+#endif//FAT_IMAGE_MMAP
+  uint32_t blkCnt;
+  uint8_t  writable;
+}
+DiskImage;
+
+static DiskImage img;
+
+#if FAT_ASYNC_READ
+// result of the sector read by FATtoDisk_StartReadSector.
+static uint8_t asyncErr;
+#endif//FAT_ASYNC_READ
+
+#if FAT_DISK_STATS
+// sectors read in each read category, and the category of the next reads.
+static uint32_t secReadCnt[READ_CAT_CNT];
+static uint8_t  readCat = READ_CAT_BOOT;
+#endif//FAT_DISK_STATS
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              OPEN DISK IMAGE
+ *
+ * Description : Opens the image file that the FATtoDisk functions will access
+ *               as the disk.
+ *
+ * Arguments   : path    - Path of the image file.
+ *               mode    - IMAGE_READ_ONLY or IMAGE_WRITABLE.
+ *
+ * Returns     : IMAGE_OPEN_SUCCESS or FAILED_OPEN_IMAGE.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoImage_Open(const char path[], uint8_t mode)
+{
+  FATtoImage_Close();
+  img.writable = (mode == IMAGE_WRITABLE);
+
+#if FAT_IMAGE_MMAP
+  int fd = open(path, img.writable ? O_RDWR : O_RDONLY);
+  if (fd < 0)
+    return FAILED_OPEN_IMAGE;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < SECTOR_LEN)
+  {
+    close(fd);
+    return FAILED_OPEN_IMAGE;
+  }
+  img.blkCnt = st.st_size / SECTOR_LEN;
+
+  // writes go to the file through the shared mapping
+  void *map = mmap(NULL, (size_t)img.blkCnt * SECTOR_LEN,
+                   img.writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return FAILED_OPEN_IMAGE;
+  img.map = map;
+#else
+  img.fp = fopen(path, img.writable ? "r+b" : "rb");
+  if (img.fp == NULL)
+    return FAILED_OPEN_IMAGE;
+
+  if (fseek(img.fp, 0, SEEK_END) != 0 || ftell(img.fp) < SECTOR_LEN)
+  {
+    FATtoImage_Close();
+    return FAILED_OPEN_IMAGE;
+  }
+  img.blkCnt = ftell(img.fp) / SECTOR_LEN;
+#endif//FAT_IMAGE_MMAP
+  return IMAGE_OPEN_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             CLOSE DISK IMAGE
+ *
+ * Description : Closes the image file opened by FATtoImage_Open.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoImage_Close(void)
+{
+#if FAT_IMAGE_MMAP
+  if (img.map != NULL)
+    munmap(img.map, (size_t)img.blkCnt * SECTOR_LEN);
+  img.map = NULL;
+#else
+  if (img.fp != NULL)
+    fclose(img.fp);
+  img.fp = NULL;
+#endif//FAT_IMAGE_MMAP
+  img.blkCnt = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             FIND BOOT SECTOR
+ *
+ * Description : Finds the address of the boot sector in the disk image.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Address of the boot sector in the image, or
+ *               FAILED_FIND_BOOT_SECTOR.
+ *
+ * Notes       : As for the SD card, block 0 is checked for the boot sector or
+ *               an MBR with a FAT32 partition first, and only then are the
+ *               FBS_MAX_NUM_BLKS_SEARCH_MAX blocks from FBS_SEARCH_START_BLOCK
+ *               searched.
+ * ----------------------------------------------------------------------------
+ */
+uint32_t FATtoDisk_FindBootSector(void)
+{
+  uint8_t blkArr[SECTOR_LEN];
+
+  FAT_SET_READ_CAT(READ_CAT_BOOT);
+  if (pvt_ReadBlock(0, 0, SECTOR_LEN, blkArr) == READ_SECTOR_SUCCESS)
+  {
+    if (pvt_IsBootSector(blkArr))
+      return 0;
+
+    uint32_t partBlk = pvt_FindPartition(blkArr);
+    if (partBlk != FAILED_FIND_BOOT_SECTOR
+        && pvt_ReadBlock(partBlk, 0, SECTOR_LEN, blkArr) == READ_SECTOR_SUCCESS
+        && pvt_IsBootSector(blkArr))
+      return partBlk;
+  }
+
+  for (uint32_t blkCnt = 0; blkCnt < FBS_MAX_NUM_BLKS_SEARCH_MAX; ++blkCnt)
+  {
+    if (pvt_ReadBlock(FBS_SEARCH_START_BLOCK + blkCnt, 0, SECTOR_LEN, blkArr)
+        != READ_SECTOR_SUCCESS)
+      break;
+    if (pvt_IsBootSector(blkArr))
+      return FBS_SEARCH_START_BLOCK + blkCnt;
+  }
+  return FAILED_FIND_BOOT_SECTOR;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 READ SINGLE SECTOR FROM DISK
+ *
+ * Description : Loads the contents of the sector at the specified address in
+ *               the image into the array, blkArr.
+ *
+ * Arguments   : blkNum    - Address of the sector in the image.
+ *               blkArr    - Pointer to the array that will be loaded with the
+ *                           contents of the sector.
+ *
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadSingleSector(uint32_t blkNum, uint8_t blkArr[])
+{
+  return pvt_ReadBlock(blkNum, 0, SECTOR_LEN, blkArr);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        READ RANGE OF SINGLE SECTOR FROM DISK
+ *
+ * Description : Loads len bytes, beginning at offset, of the sector at the
+ *               specified address in the image into buf.
+ *
+ * Arguments   : blkNum    - Address of the sector in the image.
+ *               offset    - Position in the sector of the first byte to load.
+ *               len       - Number of bytes to load.
+ *               buf       - Pointer to the array that will be loaded with the
+ *                           len bytes.
+ *
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadSectorRange(uint32_t blkNum, uint16_t offset, 
+                                  uint16_t len, uint8_t buf[])
+{
+  if (offset + len > SECTOR_LEN)
+    return FAILED_READ_SECTOR;
+  return pvt_ReadBlock(blkNum, offset, len, buf);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              READ MULTIPLE SECTORS FROM DISK
+ *
+ * Description : Reads numOfBlks consecutive sectors, beginning at the
+ *               specified address in the image.
+ *
+ * Arguments   : startBlkNum   - Address of the first sector to be read.
+ *               numOfBlks     - Number of consecutive sectors to read.
+ *               blkArr        - Pointer to the array that will be loaded with
+ *                               the contents of the sectors.
+ *               blkHandler    - Pointer to a SectorHandler function, or NULL.
+ *               handlerArg    - Passed to blkHandler each time it is called.
+ *
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadMultipleSectors(uint32_t startBlkNum, uint32_t numOfBlks,
+                                      uint8_t blkArr[], SectorHandler blkHandler,
+                                      void *handlerArg)
+{
+  for (uint32_t blkCnt = 0; blkCnt < numOfBlks; ++blkCnt)
+  {
+    // without a handler the sectors are loaded one after the other.
+    uint8_t *secArr = blkHandler ? blkArr : blkArr + blkCnt * SECTOR_LEN;
+    if (pvt_ReadBlock(startBlkNum + blkCnt, 0, SECTOR_LEN, secArr)
+        != READ_SECTOR_SUCCESS)
+      return FAILED_READ_SECTOR;
+    if (blkHandler != NULL && blkHandler(secArr, handlerArg))
+      break;
+  }
+  return READ_SECTOR_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  WRITE SINGLE SECTOR TO DISK
+ *
+ * Description : Writes the contents of an array to the sector at the
+ *               specified address in the image.
+ *
+ * Arguments   : blkNum    - Address of the sector in the image.
+ *               blkArr    - Pointer to the array holding the contents that
+ *                           will be written to the sector.
+ *
+ * Returns     : WRITE_SECTOR_SUCCESS if successful.
+ *               FAILED_WRITE_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_WriteSingleSector(uint32_t blkNum, const uint8_t blkArr[])
+{
+  return pvt_WriteBlock(blkNum, blkArr);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE MULTIPLE SECTORS TO DISK
+ *
+ * Description : Writes numOfBlks consecutive sectors, beginning at the
+ *               specified address in the image.
+ *
+ * Arguments   : startBlkNum   - Address of the first sector to be written.
+ *               numOfBlks     - Number of consecutive sectors to write.
+ *               blkArr        - Pointer to the array holding the contents of
+ *                               the sectors, one after the other.
+ *
+ * Returns     : WRITE_SECTOR_SUCCESS if successful.
+ *               FAILED_WRITE_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_WriteMultipleSectors(uint32_t startBlkNum,
+                                       uint32_t numOfBlks,
+                                       const uint8_t blkArr[])
+{
+  for (uint32_t blkCnt = 0; blkCnt < numOfBlks; ++blkCnt)
+    if (pvt_WriteBlock(startBlkNum + blkCnt, blkArr + blkCnt * SECTOR_LEN)
+        != WRITE_SECTOR_SUCCESS)
+      return FAILED_WRITE_SECTOR;
+  return WRITE_SECTOR_SUCCESS;
+}
+
+#if FAT_ASYNC_READ
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      START ASYNC SECTOR READ
+ *
+ * Description : Reads the sector at the specified address in the image into
+ *               the array, blkArr. The image is read without blocking on a 
+ *               device, so the read is done here.
+ *
+ * Arguments   : blkNum    - Address of the sector in the image.
+ *               blkArr    - Pointer to the array that will be loaded with the
+ *                           contents of the sector.
+ *
+ * Returns     : READ_SECTOR_SUCCESS. The result of the read is returned by
+ *               FATtoDisk_CompleteReadSector.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_StartReadSector(uint32_t blkNum, uint8_t blkArr[])
+{
+  asyncErr = pvt_ReadBlock(blkNum, 0, SECTOR_LEN, blkArr);
+  return READ_SECTOR_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       POLL ASYNC SECTOR READ
+ *
+ * Description : The read was done by FATtoDisk_StartReadSector, so it is 
+ *               never in progress.
+ *
+ * Arguments   : void
+ *
+ * Returns     : READ_SECTOR_SUCCESS
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_PollReadSector(void)
+{
+  return READ_SECTOR_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   COMPLETE ASYNC SECTOR READ
+ *
+ * Description : Returns the result of the read by FATtoDisk_StartReadSector.
+ *
+ * Arguments   : void
+ *
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_CompleteReadSector(void)
+{
+  return asyncErr;
+}
+
+#endif//FAT_ASYNC_READ
+
+#if FAT_DISK_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        SET THE READ CATEGORY
+ *
+ * Description : Sets the category that the following sector reads are counted
+ *               in. Called through FAT_SET_READ_CAT.
+ *
+ * Arguments   : cat   - One of the READ_CAT_ values.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_SetReadCategory(uint8_t cat)
+{
+  if (cat < READ_CAT_CNT)
+    readCat = cat;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          GET DISK READ STATS
+ *
+ * Description : Loads the sector read counts into stats.
+ *
+ * Arguments   : stats   - Pointer to the DiskStats instance to load.
+ *
+ * Returns     : void
+ *
+ * Notes       : There is no SD card, so tokenWaits, retries and cycles are 
+ *               always 0.
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_GetStats(DiskStats *stats)
+{
+  for (uint8_t cat = 0; cat < READ_CAT_CNT; ++cat)
+    stats->secReadCnt[cat] = secReadCnt[cat];
+  stats->tokenWaits = 0;
+  stats->retries = 0;
+  stats->cycles = 0;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        RESET DISK READ STATS
+ *
+ * Description : Sets the sector read counts to 0.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_ResetStats(void)
+{
+  for (uint8_t cat = 0; cat < READ_CAT_CNT; ++cat)
+    secReadCnt[cat] = 0;
+}
+
+#endif//FAT_DISK_STATS
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        READ BLOCK FROM IMAGE
+ *
+ * Description : Copies len bytes, beginning at offset, of a block of the
+ *               image into blkArr.
+ *
+ * Arguments   : blkNum    - Address of the block in the image.
+ *               offset    - Position in the block of the first byte to copy.
+ *               len       - Number of bytes to copy.
+ *               blkArr    - Pointer to an array of at least len bytes.
+ *
+ * Returns     : READ_SECTOR_SUCCESS, or FAILED_READ_SECTOR if the image is
+ *               not open or the block is past its end.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_ReadBlock(uint32_t blkNum, uint16_t offset, uint16_t len,
+                             uint8_t blkArr[])
+{
+  if (blkNum >= img.blkCnt)
+    return FAILED_READ_SECTOR;
+
+#if FAT_IMAGE_MMAP
+  memcpy(blkArr, img.map + (size_t)blkNum * SECTOR_LEN + offset, len);
+#else
+  if (fseek(img.fp, (long)blkNum * SECTOR_LEN + offset, SEEK_SET) != 0
+      || fread(blkArr, 1, len, img.fp) != len)
+    return FAILED_READ_SECTOR;
+#endif//FAT_IMAGE_MMAP
+
+#if FAT_DISK_STATS
+  ++secReadCnt[readCat];
+#endif//FAT_DISK_STATS
+  return READ_SECTOR_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         WRITE BLOCK TO IMAGE
+ *
+ * Description : Copies blkArr into a block of the image.
+ *
+ * Arguments   : blkNum    - Address of the block in the image.
+ *               blkArr    - Pointer to a SECTOR_LEN byte array.
+ *
+ * Returns     : WRITE_SECTOR_SUCCESS, or FAILED_WRITE_SECTOR if the image is
+ *               not open for writing or the block is past its end.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_WriteBlock(uint32_t blkNum, const uint8_t blkArr[])
+{
+  if (!img.writable || blkNum >= img.blkCnt)
+    return FAILED_WRITE_SECTOR;
+
+#if FAT_IMAGE_MMAP
+  memcpy(img.map + (size_t)blkNum * SECTOR_LEN, blkArr, SECTOR_LEN);
+#else
+  if (fseek(img.fp, (long)blkNum * SECTOR_LEN, SEEK_SET) != 0
+      || fwrite(blkArr, 1, SECTOR_LEN, img.fp) != SECTOR_LEN)
+    return FAILED_WRITE_SECTOR;
+#endif//FAT_IMAGE_MMAP
+  return WRITE_SECTOR_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       IS BLOCK A BOOT SECTOR
+ *
+ * Description : Checks if the loaded block is a FAT boot sector.
+ *
+ * Arguments   : blkArr   - Pointer to array holding the loaded block.
+ *
+ * Returns     : 1 if the block is a boot sector. Else 0.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_IsBootSector(const uint8_t blkArr[])
+{
+  // confirm JMP BOOT and BOOT SIGNATURE bytes those of a FAT boot sector.
+  return ((blkArr[0] == JMP_BOOT_1A && blkArr[2] == JMP_BOOT_3A)
+           || blkArr[0] == JMP_BOOT_1B)
+         && (blkArr[SECTOR_LEN - 2] == BS_SIGN_1
+         &&  blkArr[SECTOR_LEN - 1] == BS_SIGN_2);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   FIND FIRST FAT32 PARTITION
+ *
+ * Description : Checks if the loaded block is a Master Boot Record and, if it
+ *               is, returns the first block of the first FAT32 partition in
+ *               its partition table.
+ *
+ * Arguments   : blkArr   - Pointer to array holding block 0 of the image.
+ *
+ * Returns     : Block address of the partition, or FAILED_FIND_BOOT_SECTOR
+ *               if there is no MBR or it has no FAT32 partition.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t pvt_FindPartition(const uint8_t blkArr[])
+{
+  if (blkArr[SECTOR_LEN - 2] != BS_SIGN_1
+      || blkArr[SECTOR_LEN - 1] != BS_SIGN_2)
+    return FAILED_FIND_BOOT_SECTOR;
+
+  for (uint8_t part = 0; part < MBR_PART_CNT; ++part)
+  {
+    const uint8_t *ent = blkArr + MBR_PART_TBL_POS + part * MBR_PART_ENT_LEN;
+    if (ent[MBR_PART_TYPE_POS] != MBR_TYPE_FAT32_CHS
+        && ent[MBR_PART_TYPE_POS] != MBR_TYPE_FAT32_LBA)
+      continue;
+
+    uint32_t lba = ent[MBR_PART_LBA_POS + 3];
+    lba <<= 8;
+    lba |= ent[MBR_PART_LBA_POS + 2];
+    lba <<= 8;
+    lba |= ent[MBR_PART_LBA_POS + 1];
+    lba <<= 8;
+    lba |= ent[MBR_PART_LBA_POS];
+    if (lba != 0)
+      return lba;
+  }
+  return FAILED_FIND_BOOT_SECTOR;
+}
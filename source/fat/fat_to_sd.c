@@ -9,6 +9,7 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include "prints.h"
 #include "avr_spi.h"
 #include "sd_spi_base.h"
@@ -23,6 +24,13 @@
  ******************************************************************************
  */
 static uint8_t pvt_GetCardType(void);
+static void pvt_SetAddrMult(void);
+static uint8_t pvt_IsBootSector(const uint8_t blckArr[]);
+static uint32_t pvt_FindPartition(const uint8_t blckArr[]);
+static uint8_t pvt_CheckBootSector(uint8_t blckArr[], void *handlerArg);
+#if FAT_DISK_STATS
+static uint8_t pvt_CountSector(uint8_t blckArr[], void *handlerArg);
+#endif//FAT_DISK_STATS
 
 // macros used in by pvt_GetCardType
 #define GET_CARD_TYPE_ERROR 0xFF
@@ -31,6 +39,65 @@ static uint8_t pvt_GetCardType(void);
 #define CSD_VSN_2           0x40
 #define CSD_BYTE_LEN        16
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                   (PRIVATE) SD DISK SESSION
+ *
+ * Description : Holds the card parameters that are needed for every disk 
+ *               access but only need to be determined once per mount. 
+ *
+ * Members     : addrMult      - Multiplier used to convert a block number to
+ *                               the address sent to the card. 1 for SDHC
+ *                               (block addressable), BLOCK_LEN for SDSC (byte
+ *                               addressable).
+ *               cardTypeSet   - Set to 1 once addrMult has been determined
+ *                               from the card's CSD register.
+ *
+ * Notes       : The session is (re)set each time FATtoDisk_FindBootSector is
+ *               called, i.e. when the volume is mounted by fat_SetBPB.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct
+{
+  uint16_t addrMult;
+  uint8_t  cardTypeSet;
+}
+SDSession;
+
+static SDSession sdSession = {1, 0};
+
+#if FAT_ASYNC_READ
+// the async read started by FATtoDisk_StartReadSector.
+static SDAsyncRead asyncRd;
+#endif//FAT_ASYNC_READ
+
+// used to pass the boot sector search state to pvt_CheckBootSector
+typedef struct
+{
+  uint32_t blkCnt;                          // blocks checked before BS
+  uint8_t  found;                           // set to 1 when BS is found
+}
+BootSectorSearch;
+
+#if FAT_DISK_STATS
+// sectors read in each read category, and the category of the next reads.
+static uint32_t secReadCnt[READ_CAT_CNT];
+static uint8_t  readCat = READ_CAT_BOOT;
+
+// used to pass the caller's handler to pvt_CountSector
+typedef struct
+{
+  SectorHandler blkHandler;
+  void         *handlerArg;
+  uint32_t      blkCnt;                     // blocks passed to blkHandler
+}
+CountedRead;
+
+#define STATS_COUNT_READS(cnt)   (secReadCnt[readCat] += (cnt))
+#else
+#define STATS_COUNT_READS(cnt)
+#endif//FAT_DISK_STATS
+
 /*
  ******************************************************************************
  *                                 FUNCTIONS
@@ -48,79 +115,68 @@ static uint8_t pvt_GetCardType(void);
  * 
  * Returns     : Address of the boot sector on the SD card.
  * 
- * Notes       : The search for the boot sector will begin at
- *               FBS_SEARCH_START_BLOCK, and search a total of 
- *               FBS_MAX_NUM_BLKS_SEARCH_MAX blocks. 
+ * Notes       : 1) Block 0 is read first. If it is the boot sector, or it is
+ *                  an MBR whose partition table points to a FAT32 partition
+ *                  that starts with the boot sector, the boot sector is found
+ *                  with at most two single block reads.
+ *               2) Otherwise the search for the boot sector will begin at
+ *                  FBS_SEARCH_START_BLOCK, and search a total of 
+ *                  FBS_MAX_NUM_BLKS_SEARCH_MAX blocks. 
  * ----------------------------------------------------------------------------
  */
 uint32_t FATtoDisk_FindBootSector(void)
 {
   //
-  // Determine card type. If SDHC then the SD card is block addressable and
-  // the block number will be the address of the block. If SDSC then card is
-  // byte addressable, in which case the address of the block is the address
-  // of the first byte in the block, thus the address would be found by
-  // multiplying the number of the first byte in the block by BLOCK_LEN.
-  // 
-  uint16_t addrMult = 1;                    // init for SDHC. Block addressable
-  if (pvt_GetCardType() == SDSC)            // SDSC is byte addressable
-    addrMult = BLOCK_LEN;
-  
-  // Send the READ MULTIPLE BLOCK command and confirm R1 Response is good.
-  CS_SD_LOW;
-  sd_SendCommand(READ_MULTIPLE_BLOCK, FBS_SEARCH_START_BLOCK * addrMult); 
-  if (sd_GetR1() != OUT_OF_IDLE)
+  // This is the mount point of the volume, so (re)probe the card type here
+  // and store the address multiplier in the session. All later sector reads
+  // will use the stored value instead of requesting the CSD again.
+  //
+  sdSession.cardTypeSet = 0;
+  pvt_SetAddrMult();
+  FAT_SET_READ_CAT(READ_CAT_BOOT);
+
+  uint8_t  blckArr[BLOCK_LEN];              // to hold the block data bytes
+
+  //
+  // Block 0 is either the boot sector of an unpartitioned disk, or the MBR.
+  // If it is the MBR, go straight to the first FAT32 partition instead of
+  // searching for the boot sector.
+  //
+  if (sd_ReadSingleBlock(0, blckArr) == READ_SUCCESS)
   {
-    CS_SD_HIGH;
-    return FAILED_FIND_BOOT_SECTOR;
-  }
+    STATS_COUNT_READS(1);
+    if (pvt_IsBootSector(blckArr))
+      return 0;
 
-  // loop to search for the boot sector and set blkNum to its address.
-  for (uint32_t blkNum = FBS_SEARCH_START_BLOCK * addrMult;
-       blkNum < FBS_SEARCH_START_BLOCK + FBS_MAX_NUM_BLKS_SEARCH_MAX;
-       ++blkNum)
-  {   
-    uint8_t  blckArr[BLOCK_LEN];            // to hold the block data bytes
-
-    //
-    // loop until the 'Start Block Token' has been received from the SD card,
-    // which indicates data from requested block is about to be sent.
-    //
-    for (uint16_t timeout = 0; sd_ReceiveByteSPI() != START_BLOCK_TKN;)
-      if (++timeout >= TIMEOUT_LIMIT)
-      {
-        CS_SD_HIGH;
-        print_Str("\n\rSTART_TOKEN_TIMEOUT");
-        return FAILED_FIND_BOOT_SECTOR;
-      }
-
-    // load all bytes of the sector into the block array
-    for (uint16_t byteNum = 0; byteNum < BLOCK_LEN; ++byteNum) 
-      blckArr[byteNum] = sd_ReceiveByteSPI();
-    
-    // 16-bit CRC. CRC is off (default) so these values do not matter.
-    sd_ReceiveByteSPI(); 
-    sd_ReceiveByteSPI(); 
-
-    // confirm JMP BOOT and BOOT SIGNATURE bytes those of a FAT boot sector.
-    if (((blckArr[0] == JMP_BOOT_1A && blckArr[2] == JMP_BOOT_3A) 
-          || blckArr[0] == JMP_BOOT_1B)
-          && (blckArr[BLOCK_LEN - 2] == BS_SIGN_1 
-          &&  blckArr[BLOCK_LEN - 1] == BS_SIGN_2))
+    uint32_t partBlk = pvt_FindPartition(blckArr);
+    if (partBlk != FAILED_FIND_BOOT_SECTOR
+        && sd_ReadSingleBlock(partBlk * sdSession.addrMult, blckArr) 
+           == READ_SUCCESS)
     {
-      // Boot Sector has been found!
-      sd_SendCommand(STOP_TRANSMISSION, 0); // stop sending data blocks.
-      sd_ReceiveByteSPI();                  // R1B resp. Don't care.
-      CS_SD_HIGH;
-      return blkNum;                        // return success!
+      STATS_COUNT_READS(1);
+      if (pvt_IsBootSector(blckArr))
+        return partBlk;
     }
   }
 
-  // FAILED to find BS in the set block range.
-  sd_SendCommand(STOP_TRANSMISSION, 0);     // stop sending data blocks.
-  sd_ReceiveByteSPI();                      // R1B resp. Don't care.
-  CS_SD_HIGH;
-  return FAILED_FIND_BOOT_SECTOR;           // return failed token
+  //
+  // Read the search range with a single READ MULTIPLE BLOCK transfer. The
+  // handler counts the blocks read and ends the transfer when the boot 
+  // sector is found.
+  //
+  BootSectorSearch bss = {0, 0};
+
+  uint16_t err = sd_ReadMultipleBlocks(FBS_SEARCH_START_BLOCK 
+                                       * sdSession.addrMult,
+                                       FBS_MAX_NUM_BLKS_SEARCH_MAX, blckArr,
+                                       pvt_CheckBootSector, &bss);
+  STATS_COUNT_READS(bss.blkCnt + bss.found);
+  if (err != READ_SUCCESS)
+    return FAILED_FIND_BOOT_SECTOR;
+
+  if (bss.found)
+    return FBS_SEARCH_START_BLOCK + bss.blkCnt;   // return success!
+  return FAILED_FIND_BOOT_SECTOR;           // BS not in the set block range.
 }
 
 /* 
@@ -143,29 +199,470 @@ uint32_t FATtoDisk_FindBootSector(void)
  */
 uint8_t FATtoDisk_ReadSingleSector(uint32_t blkNum, uint8_t blkArr[])
 {
-  //
-  // Determine card type. If SDHC then the SD card is block addressable and
-  // the block number will be the address of the block. If SDSC then the card
-  // is byte addressable, in which case the address of the block is the number
-  // of the first byte in the block, thus the address would be found by
-  // multiplying the number of the first byte in the block by BLOCK_LEN (=512).
-  // 
-  uint16_t addrMult = 1;                    // init for SDHC. Block addressable
-  if (pvt_GetCardType() == SDSC)            // SDSC is block addressable
-    addrMult = BLOCK_LEN;
+  // card type is only probed here if it has not been set by a mount.
+  if (!sdSession.cardTypeSet)
+    pvt_SetAddrMult();
 
   // Load data block into array by passing the array to the Read Block function
-  if (sd_ReadSingleBlock(blkNum * addrMult, blkArr) == READ_SUCCESS)
+  if (sd_ReadSingleBlock(blkNum * sdSession.addrMult, blkArr) == READ_SUCCESS)
+  {
+    STATS_COUNT_READS(1);
     return READ_SECTOR_SUCCESS; 
+  }
   return FAILED_READ_SECTOR;
 };
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                       READ RANGE OF SINGLE SECTOR FROM DISK
+ *                                       
+ * Description : Loads len bytes, beginning at offset, of the sector/block at
+ *               the specified address on the SD card into the array, buf.
+ *
+ * Arguments   : blkNum    - Block number address of the sector/block on the SD
+ *                           card.
+ *               offset    - Position in the sector of the first byte to load.
+ *               len       - Number of bytes to load.
+ *               buf       - Pointer to the array that will be loaded with the
+ *                           len bytes.
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadSectorRange(uint32_t blkNum, uint16_t offset, 
+                                  uint16_t len, uint8_t buf[])
+{
+  if (!sdSession.cardTypeSet)
+    pvt_SetAddrMult();
+
+  if (sd_ReadBlockRange(blkNum * sdSession.addrMult, offset, len, buf) 
+      == READ_SUCCESS)
+  {
+    STATS_COUNT_READS(1);
+    return READ_SECTOR_SUCCESS; 
+  }
+  return FAILED_READ_SECTOR;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                             READ MULTIPLE SECTORS FROM DISK
+ *                                       
+ * Description : Reads numOfBlks consecutive sectors/blocks, beginning at the
+ *               specified address, as a single sequential transfer.
+ *
+ * Arguments   : startBlkNum   - Block number address of the first sector to
+ *                               be read.
+ *               numOfBlks     - Number of consecutive sectors to read.
+ *               blkArr        - Pointer to the array that will be loaded with
+ *                               the contents of the sectors. See notes.
+ *               blkHandler    - Pointer to a SectorHandler function, or NULL.
+ *               handlerArg    - Passed to blkHandler each time it is called.
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if successful.
+ *               FAILED_READ_SECTOR if failure.
+ * 
+ * Notes       : Implemented with the SD card READ_MULTIPLE_BLOCK command, so
+ *               the command, R1 response and stop transmission are only sent
+ *               once for all of the blocks.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_ReadMultipleSectors(uint32_t startBlkNum, uint32_t numOfBlks,
+                                      uint8_t blkArr[], SectorHandler blkHandler,
+                                      void *handlerArg)
+{
+  if (!sdSession.cardTypeSet)
+    pvt_SetAddrMult();
+
+#if FAT_DISK_STATS
+  //
+  // count the sectors as they are passed to the handler, since the handler 
+  // can end the read early. Without a handler, all are read on success.
+  //
+  CountedRead cntRd = {blkHandler, handlerArg, 0};
+  if (blkHandler != NULL)
+  {
+    blkHandler = pvt_CountSector;
+    handlerArg = &cntRd;
+  }
+#endif//FAT_DISK_STATS
+
+  uint16_t err = sd_ReadMultipleBlocks(startBlkNum * sdSession.addrMult, 
+                                       numOfBlks, blkArr, blkHandler, 
+                                       handlerArg);
+
+#if FAT_DISK_STATS
+  if (cntRd.blkHandler != NULL)
+    STATS_COUNT_READS(cntRd.blkCnt);
+  else if (err == READ_SUCCESS)
+    STATS_COUNT_READS(numOfBlks);
+#endif//FAT_DISK_STATS
+
+  if (err == READ_SUCCESS)
+    return READ_SECTOR_SUCCESS;
+  return FAILED_READ_SECTOR;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE SINGLE SECTOR TO DISK
+ *                                       
+ * Description : Writes the contents of an array to the sector/block at the 
+ *               specified address on the SD card.
+ *
+ * Arguments   : blkNum    - Block number address of the sector/block on the SD
+ *                           card that will be written.
+ *               blkArr    - Pointer to the array holding the contents that 
+ *                           will be written to the sector/block.
+ * 
+ * Returns     : WRITE_SECTOR_SUCCESS if successful.
+ *               FAILED_WRITE_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_WriteSingleSector(uint32_t blkNum, const uint8_t blkArr[])
+{
+  if (!sdSession.cardTypeSet)
+    pvt_SetAddrMult();
+
+  if (sd_WriteSingleBlock(blkNum * sdSession.addrMult, blkArr) 
+      == DATA_WRITE_SUCCESS)
+    return WRITE_SECTOR_SUCCESS; 
+  return FAILED_WRITE_SECTOR;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                              WRITE MULTIPLE SECTORS TO DISK
+ *                                       
+ * Description : Writes numOfBlks consecutive sectors/blocks, beginning at the
+ *               specified address, as a single sequential transfer.
+ *
+ * Arguments   : startBlkNum   - Block number address of the first sector to
+ *                               be written.
+ *               numOfBlks     - Number of consecutive sectors to write.
+ *               blkArr        - Pointer to the array holding the contents of
+ *                               the sectors, one after the other.
+ * 
+ * Returns     : WRITE_SECTOR_SUCCESS if successful.
+ *               FAILED_WRITE_SECTOR if failure.
+ * 
+ * Notes       : Implemented with the SD card WRITE_MULTIPLE_BLOCK command, so
+ *               the command and R1 response are only sent once for all of the
+ *               blocks.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_WriteMultipleSectors(uint32_t startBlkNum, 
+                                       uint32_t numOfBlks, 
+                                       const uint8_t blkArr[])
+{
+  if (!sdSession.cardTypeSet)
+    pvt_SetAddrMult();
+
+  if (sd_WriteMultipleBlocks(startBlkNum * sdSession.addrMult, numOfBlks, 
+                             blkArr) == DATA_WRITE_SUCCESS)
+    return WRITE_SECTOR_SUCCESS;
+  return FAILED_WRITE_SECTOR;
+}
+
+#if FAT_ASYNC_READ
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                     START ASYNC SECTOR READ
+ *                                       
+ * Description : Starts a read of a single sector/block of the SD card into 
+ *               an array, that is performed by later calls to 
+ *               FATtoDisk_PollReadSector.
+ *
+ * Arguments   : blkNum    - Block number address of the sector/block on the SD
+ *                           card that should be read into blkArr.
+ *               blkArr    - Pointer to the array that will be loaded with the 
+ *                           contents of the sector/block.
+ * 
+ * Returns     : READ_SECTOR_SUCCESS
+ * 
+ * Notes       : Nothing is sent to the card until the first poll. See 
+ *               sd_StartRead.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_StartReadSector(uint32_t blkNum, uint8_t blkArr[])
+{
+  if (!sdSession.cardTypeSet)
+    pvt_SetAddrMult();
+
+  sd_StartRead(&asyncRd, blkNum * sdSession.addrMult, blkArr);
+  return READ_SECTOR_SUCCESS;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                      POLL ASYNC SECTOR READ
+ *                                       
+ * Description : Advances the read started by FATtoDisk_StartReadSector by one
+ *               step. See sd_PollRead.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : READ_SECTOR_BUSY if the read is still in progress, else 
+ *               READ_SECTOR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_PollReadSector(void)
+{
+  if (sd_PollRead(&asyncRd) == SD_READ_BUSY)
+    return READ_SECTOR_BUSY;
+  return READ_SECTOR_SUCCESS;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                  COMPLETE ASYNC SECTOR READ
+ *                                       
+ * Description : Ends the read started by FATtoDisk_StartReadSector, polling
+ *               it until it is done if it is still in progress.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : READ_SECTOR_SUCCESS if the sector was read.
+ *               FAILED_READ_SECTOR if failure.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t FATtoDisk_CompleteReadSector(void)
+{
+  if (sd_CompleteRead(&asyncRd) == READ_SUCCESS)
+  {
+    STATS_COUNT_READS(1);
+    return READ_SECTOR_SUCCESS;
+  }
+  return FAILED_READ_SECTOR;
+}
+
+#endif//FAT_ASYNC_READ
+
+#if FAT_DISK_STATS
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       SET THE READ CATEGORY
+ *                                       
+ * Description : Sets the category that the following sector reads are counted
+ *               in. Called through FAT_SET_READ_CAT.
+ *
+ * Arguments   : cat   - One of the READ_CAT_ values.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_SetReadCategory(uint8_t cat)
+{
+  if (cat < READ_CAT_CNT)
+    readCat = cat;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                         GET DISK READ STATS
+ *                                       
+ * Description : Loads the sector read counts, and the SD card block read 
+ *               counters, into stats.
+ *
+ * Arguments   : stats   - Pointer to the DiskStats instance to load.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : tokenWaits, retries and cycles are only measured if the SD
+ *               card module is also built with SD_STATS set. Otherwise they 
+ *               are set to 0.
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_GetStats(DiskStats *stats)
+{
+  for (uint8_t cat = 0; cat < READ_CAT_CNT; ++cat)
+    stats->secReadCnt[cat] = secReadCnt[cat];
+
+#if SD_STATS
+  SDStats sdStats;
+  sd_GetStats(&sdStats);
+  stats->tokenWaits = sdStats.tokenWaits;
+  stats->retries = sdStats.retries;
+  stats->cycles = sdStats.cycles;
+#else
+  stats->tokenWaits = 0;
+  stats->retries = 0;
+  stats->cycles = 0;
+#endif//SD_STATS
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       RESET DISK READ STATS
+ *                                       
+ * Description : Sets the sector read counts, and the SD card block read 
+ *               counters, to 0.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void FATtoDisk_ResetStats(void)
+{
+  for (uint8_t cat = 0; cat < READ_CAT_CNT; ++cat)
+    secReadCnt[cat] = 0;
+
+#if SD_STATS
+  sd_ResetStats();
+#endif//SD_STATS
+}
+
+#endif//FAT_DISK_STATS
+
 /*
  ******************************************************************************
- *                            "PRIVATE" FUNCTION        
+ *                            "PRIVATE" FUNCTIONS        
  ******************************************************************************
  */
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                 CHECK BLOCK FOR BOOT SECTOR
+ *                                       
+ * Description : SectorHandler used by FATtoDisk_FindBootSector. Checks if the 
+ *               loaded block is the boot sector.
+ * 
+ * Arguments   : blckArr      - Pointer to array holding the loaded block.
+ *               handlerArg   - Pointer to the BootSectorSearch instance.
+ * 
+ * Returns     : 1 if the block is the boot sector, ending the read. Else 0.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_CheckBootSector(uint8_t blckArr[], void *handlerArg)
+{
+  BootSectorSearch *bss = handlerArg;
+
+  if (pvt_IsBootSector(blckArr))
+  {
+    bss->found = 1;                         // Boot Sector has been found!
+    return 1;
+  }
+  ++bss->blkCnt;
+  return 0;
+}
+
+#if FAT_DISK_STATS
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                     COUNT SECTORS OF A READ
+ *                                       
+ * Description : SectorHandler used by FATtoDisk_ReadMultipleSectors to count
+ *               the sectors passed to the caller's handler.
+ * 
+ * Arguments   : blckArr      - Pointer to array holding the loaded block.
+ *               handlerArg   - Pointer to the CountedRead instance.
+ * 
+ * Returns     : The value returned by the caller's handler.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_CountSector(uint8_t blckArr[], void *handlerArg)
+{
+  CountedRead *cntRd = handlerArg;
+
+  ++cntRd->blkCnt;
+  return cntRd->blkHandler(blckArr, cntRd->handlerArg);
+}
+
+#endif//FAT_DISK_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      IS BLOCK A BOOT SECTOR
+ * 
+ * Description : Checks if the loaded block is a FAT boot sector.
+ * 
+ * Arguments   : blckArr   - Pointer to array holding the loaded block.
+ * 
+ * Returns     : 1 if the block is a boot sector. Else 0.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_IsBootSector(const uint8_t blckArr[])
+{
+  // confirm JMP BOOT and BOOT SIGNATURE bytes those of a FAT boot sector.
+  return ((blckArr[0] == JMP_BOOT_1A && blckArr[2] == JMP_BOOT_3A) 
+           || blckArr[0] == JMP_BOOT_1B)
+         && (blckArr[BLOCK_LEN - 2] == BS_SIGN_1 
+         &&  blckArr[BLOCK_LEN - 1] == BS_SIGN_2);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  FIND FIRST FAT32 PARTITION
+ * 
+ * Description : Checks if the loaded block is a Master Boot Record and, if it
+ *               is, returns the first block of the first FAT32 partition in
+ *               its partition table.
+ * 
+ * Arguments   : blckArr   - Pointer to array holding block 0 of the disk.
+ * 
+ * Returns     : Block address of the partition, or FAILED_FIND_BOOT_SECTOR
+ *               if there is no MBR or it has no FAT32 partition.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t pvt_FindPartition(const uint8_t blckArr[])
+{
+  if (blckArr[BLOCK_LEN - 2] != BS_SIGN_1 
+      || blckArr[BLOCK_LEN - 1] != BS_SIGN_2)
+    return FAILED_FIND_BOOT_SECTOR;
+
+  for (uint8_t part = 0; part < MBR_PART_CNT; ++part)
+  {
+    const uint8_t *ent = blckArr + MBR_PART_TBL_POS + part * MBR_PART_ENT_LEN;
+    if (ent[MBR_PART_TYPE_POS] != MBR_TYPE_FAT32_CHS
+        && ent[MBR_PART_TYPE_POS] != MBR_TYPE_FAT32_LBA)
+      continue;
+
+    uint32_t lba = ent[MBR_PART_LBA_POS + 3];
+    lba <<= 8;
+    lba |= ent[MBR_PART_LBA_POS + 2];
+    lba <<= 8;
+    lba |= ent[MBR_PART_LBA_POS + 1];
+    lba <<= 8;
+    lba |= ent[MBR_PART_LBA_POS];
+    if (lba != 0)
+      return lba;
+  }
+  return FAILED_FIND_BOOT_SECTOR;
+}
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                            SET SESSION'S ADDRESS MULTIPLIER
+ *                                       
+ * Description : Determines the card type and sets the addrMult member of the
+ *               SD session accordingly. If SDHC then the SD card is block 
+ *               addressable and the block number will be the address of the
+ *               block. If SDSC then the card is byte addressable, in which 
+ *               case the address of the block is the number of the first byte
+ *               in the block, i.e. the block number multiplied by BLOCK_LEN.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * 
+ * Notes       : If the card type could not be determined, addrMult is set for
+ *               SDHC but the session is not marked as set, so the card type 
+ *               will be requested again on the next read.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_SetAddrMult(void)
+{
+  uint8_t cardType = pvt_GetCardType();
+
+  sdSession.addrMult = (cardType == SDSC) ? BLOCK_LEN : 1;
+  sdSession.cardTypeSet = (cardType != GET_CARD_TYPE_ERROR);
+}
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                             GET SD CARD TYPE
@@ -11,6 +11,8 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 #include "avr_usart.h"
 #include "prints.h"
 
@@ -26,6 +28,30 @@
 //
 #define BIN_CHARS_GRP_SIZE    4           
 
+/*
+ ******************************************************************************
+ *                       "PRIVATE" FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+static void pvt_UsartSink(const char buf[], uint16_t len);
+static void pvt_Reverse(char digit[], int digitCnt);
+
+/*
+ ******************************************************************************
+ *                          "PRIVATE" GLOBAL VARIABLES
+ ******************************************************************************
+ */
+
+// the output of all print functions is passed to this sink.
+static PrintSink printSink = pvt_UsartSink;
+
+// powers of ten used by print_LineDec to find each digit without division.
+static const uint32_t pow10Tbl[DEC_CHAR_LEN_MAX] = 
+{
+  1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+};
+
 /*
  ******************************************************************************
  *                                  FUNCTIONS 
@@ -61,10 +87,9 @@ void print_Dec(uint32_t num)
 
   // print digits.
   if (digitCnt == 0)
-    usart_Transmit('0');
-  else
-    for (--digitCnt; digitCnt >= 0; digitCnt--)
-      usart_Transmit(digit[digitCnt]);
+    digit[digitCnt++] = '0';
+  pvt_Reverse(digit, digitCnt);
+  print_Buf(digit, digitCnt);
 }
 
 /*
@@ -100,14 +125,20 @@ void print_Bin(uint32_t num)
 
   // print digits.
   if (digitCnt == 0)
-    usart_Transmit('0');
+    print_Buf("0", 1);
   else
+  {
+    // digits in print order, with a space after each group.
+    char out[BIN_CHAR_LEN_MAX + BIN_CHAR_LEN_MAX / BIN_CHARS_GRP_SIZE + 1];
+    uint8_t outLen = 0;
     for (--digitCnt; digitCnt >= 0; digitCnt--)
     {
-      usart_Transmit(digit[digitCnt]);
+      out[outLen++] = digit[digitCnt];
       if (digitCnt % BIN_CHARS_GRP_SIZE == 0)         // print a space ?
-        usart_Transmit(' ');
+        out[outLen++] = ' ';
     }
+    print_Buf(out, outLen);
+  }
 }
 
 /*
@@ -145,10 +176,9 @@ void print_Hex(uint32_t num)
 
   // print digits.
   if (digitCnt == 0)
-    usart_Transmit('0');
-  else
-    for (--digitCnt; digitCnt >= 0; digitCnt--)
-      usart_Transmit(digit[digitCnt]);
+    digit[digitCnt++] = '0';
+  pvt_Reverse(digit, digitCnt);
+  print_Buf(digit, digitCnt);
 }    
 
 /*
@@ -167,7 +197,168 @@ void print_Hex(uint32_t num)
  */
 void print_Str(char *str)
 {
-  for (; *str; str++)
-    usart_Transmit(*str);
+  print_Buf(str, strlen(str));
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              SET OUTPUT SINK
+ *                                       
+ * Description : Sets the function that the output of all print functions is 
+ *               passed to.
+ * 
+ * Argument    : sink   - pointer to a PrintSink function, or NULL to restore
+ *                        the default USART output.
+ * ----------------------------------------------------------------------------
+ */
+void print_SetSink(PrintSink sink)
+{
+  printSink = (sink == NULL) ? pvt_UsartSink : sink;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 PRINT BUFFER
+ *                                       
+ * Description : Passes len chars of buf to the output sink in a single call.
+ * 
+ * Argument    : buf   - pointer to the chars to be printed.
+ *               len   - number of chars in buf to print.
+ * ----------------------------------------------------------------------------
+ */
+void print_Buf(const char buf[], uint16_t len)
+{
+  if (len)
+    printSink(buf, len);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     ADD C-STRING TO A LINE
+ *                                       
+ * Description : Adds the chars of a C-string to the end of a PrintLine. If 
+ *               the line becomes full, it is flushed and the remaining chars
+ *               are added to the emptied line.
+ * 
+ * Argument    : line   - pointer to the PrintLine instance.
+ *               str    - pointer to the null-terminated string to add.
+ * ----------------------------------------------------------------------------
+ */
+void print_LineStr(PrintLine *line, const char str[])
+{
+  for (; *str; ++str)
+  {
+    if (line->len >= PRINT_LINE_LEN)
+      print_LineFlush(line);
+    line->buf[line->len++] = *str;
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                              ADD DECIMAL INTEGER TO A LINE
+ *                                       
+ * Description : Adds the unsigned decimal form of num to the end of a 
+ *               PrintLine, padded on the left to a fixed width.
+ * 
+ * Argument    : line    - pointer to the PrintLine instance.
+ *               num     - unsigned integer to add.
+ *               width   - minimum number of chars to add. 
+ *               pad     - char used for padding, e.g. '0' or ' '.
+ * ----------------------------------------------------------------------------
+ */
+void print_LineDec(PrintLine *line, uint32_t num, uint8_t width, char pad)
+{
+  // index in pow10Tbl of the highest digit of num. 0 has one digit.
+  uint8_t pos = DEC_CHAR_LEN_MAX - 1;
+  while (pos > 0 && num >= pow10Tbl[pos - 1])
+    --pos;
+
+  // make sure the padded number fits in the line without being split.
+  uint8_t digitCnt = DEC_CHAR_LEN_MAX - pos;
+  if (width > DEC_CHAR_LEN_MAX)
+    width = DEC_CHAR_LEN_MAX;
+  if (line->len + (width > digitCnt ? width : digitCnt) > PRINT_LINE_LEN)
+    print_LineFlush(line);
+
+  for (; width > digitCnt; --width)
+    line->buf[line->len++] = pad;
+
+  // each digit is the number of times its power of ten can be subtracted.
+  for (; pos < DEC_CHAR_LEN_MAX; ++pos)
+  {
+    char digit = '0';
+    while (num >= pow10Tbl[pos])
+    {
+      num -= pow10Tbl[pos];
+      ++digit;
+    }
+    line->buf[line->len++] = digit;
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 FLUSH A LINE
+ *                                       
+ * Description : Passes the chars of a PrintLine to the output sink in one 
+ *               call, and empties the line.
+ * 
+ * Argument    : line   - pointer to the PrintLine instance.
+ * ----------------------------------------------------------------------------
+ */
+void print_LineFlush(PrintLine *line)
+{
+  print_Buf(line->buf, line->len);
+  line->len = 0;
+}
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   (PRIVATE) USART OUTPUT SINK
+ *                                       
+ * Description : The default output sink. Loads the chars into the USART's
+ *               transmit buffer, so they are sent while the caller continues.
+ *               This only waits if the buffer is full.
+ * 
+ * Argument    : buf   - pointer to the chars to be output.
+ *               len   - number of chars in buf to be output.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_UsartSink(const char buf[], uint16_t len)
+{
+  while (len)
+  {
+    uint16_t cnt = usart_Write((const uint8_t *)buf, len);
+    buf += cnt;
+    len -= cnt;
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   (PRIVATE) REVERSE DIGITS
+ *                                       
+ * Description : Reverses the order of the chars in an array. The number print
+ *               functions load the digits in reverse order.
+ * 
+ * Argument    : digit      - pointer to the array of chars.
+ *               digitCnt   - number of chars in the array.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_Reverse(char digit[], int digitCnt)
+{
+  for (int first = 0, last = digitCnt - 1; first < last; ++first, --last)
+  {
+    char tmp = digit[first];
+    digit[first] = digit[last];
+    digit[last] = tmp;
+  }
 }
 
@@ -0,0 +1,103 @@
+/*
+ * File       : HOST_USART.C
+ * Version    : 1.0
+ * Target     : Host (x86 / Linux)
+ * License    : GNU GPLv3
+ * Author     : Joshua Fain
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of AVR_USART.H for a host computer. The USART is replaced by
+ * the standard input and output streams, so that the PRINTS functions, and
+ * the AVR-FAT functions that print with them, can be used in a host build.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "avr_usart.h"
+
+/*
+ ******************************************************************************
+ *                                  FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             INITIALIZE USART
+ *
+ * Description : Nothing to initialize on the host.
+ *
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+void usart_Init(void)
+{
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 RECEIVE BYTE
+ *
+ * Description : Waits for and returns the next byte from standard input.
+ *
+ * Arguments   : void
+ *
+ * Returns     : The byte received, or 0 at the end of the input.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t usart_Receive(void)
+{
+  int data = getchar();
+  return (data == EOF) ? 0 : (uint8_t)data;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                TRANSMIT BYTE
+ *
+ * Description : Writes a byte to standard output.
+ *
+ * Arguments   : data   - The byte to be written.
+ *
+ * Notes       : Carriage returns are dropped, since the AVR-FAT module ends
+ *               lines with "\n\r" for a serial terminal.
+ * ----------------------------------------------------------------------------
+ */
+void usart_Transmit(uint8_t data)
+{
+  if (data != '\r')
+    putchar(data);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                  WRITE BYTES
+ *
+ * Description : Writes len bytes from data to standard output.
+ *
+ * Arguments   : data   - Pointer to the array of bytes to be written.
+ *               len    - Number of bytes to write.
+ *
+ * Returns     : The number of bytes written, always len.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t usart_Write(const uint8_t data[], uint16_t len)
+{
+  for (uint16_t i = 0; i < len; ++i)
+    usart_Transmit(data[i]);
+  return len;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 FLUSH OUTPUT
+ *
+ * Description : Flushes standard output.
+ *
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+void usart_Flush(void)
+{
+  fflush(stdout);
+}
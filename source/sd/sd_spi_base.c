@@ -22,6 +22,12 @@
 
 static uint8_t pvt_CRC7(uint64_t tca);
 
+// SPI clock rate used after initialization. See sd_SetClockRate.
+static uint8_t dataClkRate = SD_DATA_CLK_RATE;
+
+// set to 1 once the card has been initialized.
+static uint8_t initDone;
+
 /*
  ******************************************************************************
  *                                   FUNCTIONS   
@@ -58,12 +64,15 @@ uint32_t sd_InitModeSPI(CTV *ctv)
   spi_MasterInit();                        // initialize SPI port master mode.
 
   //
-  // if prevSuccessFlag is set, then initialization has previously completed 
-  // successfully so return. If not, proceed with rest of init.
+  // if initDone is set, then initialization has previously completed 
+  // successfully so set the data transfer clock rate and return. If not, 
+  // proceed with rest of init.
   //
-  static uint8_t prevSuccessFlag;
-  if (prevSuccessFlag)
+  if (initDone)
+  {
+    spi_SetClockRate(dataClkRate);
     return OUT_OF_IDLE;
+  }
 
   sd_WaitSendDummySPI(80);                 // wait 80 SPI CCs for power up
 
@@ -108,7 +117,11 @@ uint32_t sd_InitModeSPI(CTV *ctv)
   // Step 3: CRC_ON_OFF (CMD59)
   //
   CS_SD_LOW;
+#if SD_DATA_CRC
+  sd_SendCommand(CRC_ON_OFF, CRC_ON_ARG);
+#else
   sd_SendCommand(CRC_ON_OFF, CRC_OFF_ARG);
+#endif//SD_DATA_CRC
   r1 = sd_GetR1();
   CS_SD_HIGH;
   if (r1 != IN_IDLE_STATE) 
@@ -187,12 +200,72 @@ uint32_t sd_InitModeSPI(CTV *ctv)
     return (FAILED_READ_OCR | UNSUPPORTED_CARD_TYPE | r1);
   }
 
-  // Initialization success
+  // Initialization success. Raise the clock to the data transfer rate.
   CS_SD_HIGH;
-  prevSuccessFlag = 1;
+  initDone = 1;
+  spi_SetClockRate(dataClkRate);
   return OUT_OF_IDLE;
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  SET DATA TRANSFER CLOCK RATE
+ *
+ * Description : Sets the SPI clock rate used for accessing the SD card after
+ *               it has been initialized.
+ *
+ * Arguments   : clkRate   - One of the SPI CLOCK RATES in AVR_SPI.H, e.g. 
+ *                           SPI_CLK_DIV_2. Must not be slower than 
+ *                           SD_INIT_CLK_RATE.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void sd_SetClockRate(uint8_t clkRate)
+{
+  dataClkRate = (clkRate > SD_INIT_CLK_RATE) ? SD_INIT_CLK_RATE : clkRate;
+  if (initDone)
+    spi_SetClockRate(dataClkRate);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  GET DATA TRANSFER CLOCK RATE
+ *
+ * Description : Gets the SPI clock rate used for accessing the SD card after
+ *               it has been initialized.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : One of the SPI CLOCK RATES in AVR_SPI.H.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t sd_GetClockRate(void)
+{
+  return dataClkRate;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                LOWER DATA TRANSFER CLOCK RATE
+ *
+ * Description : Lowers the data transfer clock rate to the next slower SPI 
+ *               clock rate, down to SD_INIT_CLK_RATE.
+ *
+ * Arguments   : void
+ * 
+ * Returns     : 1 if the rate was lowered, or 0 if it is already at 
+ *               SD_INIT_CLK_RATE.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t sd_LowerClockRate(void)
+{
+  if (dataClkRate >= SD_INIT_CLK_RATE)
+    return 0;
+  sd_SetClockRate(dataClkRate + 1);
+  return 1;
+}
+
 /*
  * ----------------------------------------------------------------------------
  *                                                                    SEND BYTE
@@ -203,8 +276,10 @@ uint32_t sd_InitModeSPI(CTV *ctv)
  * 
  * Notes       : 1) Call as many times as required to send the complete data 
  *                  packet, token, command, etc...
- *               2) This function and sd_ReceiveByteSPI(), are the only direct
- *                  SPI interfacing functions in the SD card module.
+ *               2) This function, sd_ReceiveByteSPI(), and the block 
+ *                  functions sd_SendBlockSPI(), sd_ReceiveBlockSPI() and
+ *                  sd_SkipBlockSPI(), are the only direct SPI interfacing 
+ *                  functions in the SD card module.
  * ----------------------------------------------------------------------------
  */
 void sd_SendByteSPI(uint8_t byte)
@@ -222,8 +297,10 @@ void sd_SendByteSPI(uint8_t byte)
  * 
  * Notes       : 1) Call as many times as necessary to get the complete data
  *                  packet, token, error response, etc... from the SD card.
- *               2) This function and sd_SendByteSPI(), are the only direct
- *                  SPI interfacing functions in the SD card module.
+ *               2) This function, sd_SendByteSPI(), and the block functions
+ *                  sd_SendBlockSPI(), sd_ReceiveBlockSPI() and 
+ *                  sd_SkipBlockSPI(), are the only direct SPI interfacing 
+ *                  functions in the SD card module.
  * ----------------------------------------------------------------------------
  */
 uint8_t sd_ReceiveByteSPI(void)
@@ -232,6 +309,81 @@ uint8_t sd_ReceiveByteSPI(void)
   return spi_MasterReceive();          // return SD card's response
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   SEND BLOCK
+ * 
+ * Description : Sends len bytes from an array to the SD card via SPI.
+ * 
+ * Arguments   : byteArr   - pointer to the array holding the bytes to send.
+ *               len       - number of bytes to send.
+ * 
+ * Returns     : CRC16 of the bytes sent if SD_DATA_CRC is set, else 0.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_SendBlockSPI(const uint8_t byteArr[], uint16_t len)
+{
+#if SD_DATA_CRC
+  return spi_TransmitBlockCRC16(byteArr, len);
+#else
+  spi_TransmitBlock(byteArr, len);
+  return 0;
+#endif//SD_DATA_CRC
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                RECEIVE BLOCK
+ * 
+ * Description : Receives len bytes from the SD card via SPI into an array.
+ * 
+ * Arguments   : byteArr   - pointer to the array that will be loaded with the
+ *                           received bytes. Must be at least len bytes.
+ *               len       - number of bytes to receive.
+ *               crc       - initial value of the CRC. 0 for the first part of
+ *                           a data block, else the value returned for the 
+ *                           previous part.
+ * 
+ * Returns     : CRC16 of the bytes received, continued from crc, if 
+ *               SD_DATA_CRC is set, else 0.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_ReceiveBlockSPI(uint8_t byteArr[], uint16_t len, uint16_t crc)
+{
+#if SD_DATA_CRC
+  return spi_ReceiveBlockCRC16(byteArr, len, crc);
+#else
+  (void)crc;
+  spi_ReceiveBlock(byteArr, len);
+  return 0;
+#endif//SD_DATA_CRC
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   SKIP BLOCK
+ * 
+ * Description : Receives len bytes from the SD card via SPI without storing
+ *               them, e.g. the bytes of a data block that are not needed.
+ * 
+ * Arguments   : len   - number of bytes to receive and discard.
+ *               crc   - initial value of the CRC, as for sd_ReceiveBlockSPI.
+ * 
+ * Returns     : CRC16 of the bytes received, continued from crc, if 
+ *               SD_DATA_CRC is set, else 0.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_SkipBlockSPI(uint16_t len, uint16_t crc)
+{
+#if SD_DATA_CRC
+  return spi_SkipBlockCRC16(len, crc);
+#else
+  (void)crc;
+  spi_SkipBlock(len);
+  return 0;
+#endif//SD_DATA_CRC
+}
+
 /*
  * ----------------------------------------------------------------------------
  *                                                                 SEND COMMAND
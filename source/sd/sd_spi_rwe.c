@@ -9,11 +9,68 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include "avr_spi.h"
 #include "prints.h"
 #include "sd_spi_base.h"
 #include "sd_spi_rwe.h"
 
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+static uint16_t pvt_ReadBlockRange(uint32_t blckAddr, uint16_t offset, 
+                                   uint16_t len, uint8_t buf[]);
+static uint16_t pvt_ReadMultipleBlocks(uint32_t startBlckAddr, 
+                                       uint32_t numOfBlcks, uint8_t blckArr[],
+                                       BlockHandler blckHandler, 
+                                       void *handlerArg, uint32_t *blckCnt);
+static uint16_t pvt_WaitStartToken(void);
+static uint32_t pvt_TokenWaitLimit(void);
+static uint16_t pvt_ReceiveDataBlock(uint8_t blckArr[]);
+static uint16_t pvt_ReceiveDataRange(uint16_t offset, uint16_t len, 
+                                     uint8_t buf[]);
+static uint16_t pvt_CheckDataCRC(uint16_t crc);
+static void pvt_EndAsyncRead(SDAsyncRead *rd, uint16_t err);
+static uint8_t pvt_RetryRead(uint16_t err, uint8_t *crcRetries, 
+                             uint8_t *tknRetries);
+static uint16_t pvt_SendDataBlock(uint8_t startTkn, const uint8_t dataArr[]);
+static void pvt_StopTransmission(void);
+#if SD_STATS
+static void pvt_StatsMark(void);
+static void pvt_StatsAddCycles(void);
+static uint8_t pvt_StatsCountRetry(uint8_t retry);
+#endif//SD_STATS
+
+// steps of an async read. See SDAsyncRead.
+#define ASYNC_SEND_CMD         0
+#define ASYNC_WAIT_TKN         1
+#define ASYNC_RECV_DATA        2
+#define ASYNC_DONE             3
+
+#if SD_STATS
+static SDStats sdStats;
+
+// timer count at the start of the segment being timed.
+static uint16_t statsMark;
+
+// Timer 3 clock select for F_CPU / 8, and CPU cycles per timer count.
+#define STATS_TMR_CS           (1 << CS31)
+#define STATS_TMR_DIV          8
+
+#define STATS_MARK()           pvt_StatsMark()
+#define STATS_ADD_CYCLES()     pvt_StatsAddCycles()
+#define STATS_ADD_TOKEN_WAIT() (++sdStats.tokenWaits)
+#define STATS_COUNT_RETRY(r)   pvt_StatsCountRetry(r)
+#else
+#define STATS_MARK()
+#define STATS_ADD_CYCLES()
+#define STATS_ADD_TOKEN_WAIT()
+#define STATS_COUNT_RETRY(r)   (r)
+#endif//SD_STATS
+
 /*
  ******************************************************************************
  *                                 FUNCTIONS   
@@ -48,42 +105,265 @@
  */
 uint16_t sd_ReadSingleBlock(uint32_t blckAddr, uint8_t blckArr[])
 {
-  uint8_t r1;                               // for R1 responses
+  uint16_t err;
+  uint8_t  crcRetries = SD_CRC_RETRIES;
+  uint8_t  tknRetries = SD_TOKEN_RETRIES;
 
-  // request contents of a single data block at blckAddr on the SD card.
-  CS_SD_LOW;
-  sd_SendCommand(READ_SINGLE_BLOCK, blckAddr);
-  r1 = sd_GetR1();
-  if (r1 != OUT_OF_IDLE)
+  //
+  // if the start block token is not received in time the card is only slow,
+  // so the read is retried at the same clock rate. If the block keeps failing
+  // the CRC check, the rate may be too fast for the card or the wiring, so it
+  // is lowered until the read succeeds or it can not be lowered any further.
+  // See pvt_RetryRead.
+  //
+  do
   {
-    CS_SD_HIGH;
-    return (R1_ERROR | r1);
+    STATS_MARK();
+    err = pvt_ReadBlockRange(blckAddr, 0, BLOCK_LEN, blckArr);
+    STATS_ADD_CYCLES();
+  }
+  while (pvt_RetryRead(err, &crcRetries, &tknRetries));
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   READ RANGE OF SINGLE BLOCK
+ * 
+ * Description : Reads len bytes, beginning at offset, of a single data block
+ *               from the SD card into an array. The other bytes of the block
+ *               are received but are not stored.
+ * 
+ * Arguments   : blckAddr   - address of the data block on the SD card.
+ *               offset     - position in the block of the first byte to read.
+ *               len        - number of bytes to read. offset + len must not 
+ *                            be greater than BLOCK_LEN.
+ *               buf        - pointer to the array to be loaded with the len
+ *                            bytes.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_ReadBlockRange(uint32_t blckAddr, uint16_t offset, uint16_t len,
+                           uint8_t buf[])
+{
+  uint16_t err;
+  uint8_t  crcRetries = SD_CRC_RETRIES;
+  uint8_t  tknRetries = SD_TOKEN_RETRIES;
+
+  // retried the same as sd_ReadSingleBlock.
+  do
+  {
+    STATS_MARK();
+    err = pvt_ReadBlockRange(blckAddr, offset, len, buf);
+    STATS_ADD_CYCLES();
   }
+  while (pvt_RetryRead(err, &crcRetries, &tknRetries));
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        READ MULTIPLE BLOCKS
+ * 
+ * Description : Reads consecutive data blocks from the SD card using a single
+ *               READ_MULTIPLE_BLOCK command, which is ended by sending the
+ *               STOP_TRANSMISSION command.
+ * 
+ * Arguments   : startBlckAddr   - address of the first data block to be read.
+ *               numOfBlcks      - number of blocks to read.
+ *               blckArr         - pointer to the array that will be loaded with
+ *                                 the contents of the data blocks. See notes.
+ *               blckHandler     - pointer to a BlockHandler function, or NULL.
+ *               handlerArg      - passed to blckHandler each time it is called.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).
+ * 
+ * Notes       : 1) If blckHandler is NULL then the blocks are loaded into 
+ *                  blckArr one after the other, so it must have a length of at
+ *                  least numOfBlcks * BLOCK_LEN.
+ *               2) If blckHandler is not NULL then blckArr must be of length 
+ *                  BLOCK_LEN. Each block is loaded into it and then passed to
+ *                  blckHandler before the next block is read. If blckHandler
+ *                  returns a non-zero value, no more blocks are read.
+ *               3) The address of the following blocks is incremented by the
+ *                  card, so startBlckAddr must be the address of a block as 
+ *                  required by the card type, i.e. SDSC is byte addressable.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_ReadMultipleBlocks(uint32_t startBlckAddr, uint32_t numOfBlcks,
+                               uint8_t blckArr[], BlockHandler blckHandler,
+                               void *handlerArg)
+{
+  uint16_t err;
+  uint32_t blckCnt;
+  uint8_t  crcRetries = SD_CRC_RETRIES;
+  uint8_t  tknRetries = SD_TOKEN_RETRIES;
 
   //
-  // loop until the 'Start Block Token' has been received from the SD card,
-  // which indicates data from requested blckAddr is about to be sent.
+  // retried the same as sd_ReadSingleBlock. Blocks that have already been 
+  // passed to the handler can not be passed again, so the transfer is only 
+  // retried with a handler if it failed before the first block was read.
   //
-  for (uint8_t timeout = 0; sd_ReceiveByteSPI() != START_BLOCK_TKN; ++timeout)
-    if (timeout >= TIMEOUT_LIMIT)
+  do
+  {
+    STATS_MARK();
+    err = pvt_ReadMultipleBlocks(startBlckAddr, numOfBlcks, blckArr, 
+                                 blckHandler, handlerArg, &blckCnt);
+    STATS_ADD_CYCLES();
+  }
+  while ((blckHandler == NULL || !blckCnt) 
+         && pvt_RetryRead(err, &crcRetries, &tknRetries));
+  return err;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             START ASYNC READ
+ * 
+ * Description : Sets an SDAsyncRead instance to read a single data block into
+ *               an array without blocking. Nothing is sent to the card until
+ *               the read is advanced by sd_PollRead.
+ * 
+ * Arguments   : rd         - pointer to the SDAsyncRead instance to be set.
+ *               blckAddr   - address of the data block on the SD card that 
+ *                            will be read into the array.
+ *               blckArr    - pointer to the array to be loaded with the 
+ *                            contents of the data block at blckAddr. Must be 
+ *                            length BLOCK_LEN.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void sd_StartRead(SDAsyncRead *rd, uint32_t blckAddr, uint8_t blckArr[])
+{
+  rd->blckAddr = blckAddr;
+  rd->blckArr = blckArr;
+  rd->err = 0;
+  rd->crcRetries = SD_CRC_RETRIES;
+  rd->tknRetries = SD_TOKEN_RETRIES;
+  rd->state = ASYNC_SEND_CMD;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              POLL ASYNC READ
+ * 
+ * Description : Advances a read started by sd_StartRead by one step, and 
+ *               returns without waiting on the card. Each step sends the read
+ *               command, or transfers up to SD_ASYNC_CHUNK_LEN bytes of the 
+ *               wait for the start block token or of the data block.
+ * 
+ * Arguments   : rd   - pointer to an SDAsyncRead instance set by 
+ *                      sd_StartRead.
+ * 
+ * Returns     : SD_READ_BUSY if the read is still in progress, or 
+ *               SD_READ_DONE, in which case the result is returned by 
+ *               sd_CompleteRead.
+ * ----------------------------------------------------------------------------
+ */
+uint8_t sd_PollRead(SDAsyncRead *rd)
+{
+  if (rd->state == ASYNC_DONE)
+    return SD_READ_DONE;
+
+  STATS_MARK();
+  switch (rd->state)
+  {
+    // request the block. The R1 response follows within a few bytes.
+    case ASYNC_SEND_CMD:
+      CS_SD_LOW;
+      sd_SendCommand(READ_SINGLE_BLOCK, rd->blckAddr);
+      rd->r1 = sd_GetR1();
+      if (rd->r1 != OUT_OF_IDLE)
+      {
+        pvt_EndAsyncRead(rd, R1_ERROR | rd->r1);
+        break;
+      }
+      rd->pos = 0;
+      rd->crc = 0;
+      rd->waitCnt = 0;
+      rd->state = ASYNC_WAIT_TKN;
+      break;
+
+    //
+    // check up to a chunk of bytes for the start block token. The timeout is
+    // counted in bytes, the same as by pvt_WaitStartToken.
+    //
+    case ASYNC_WAIT_TKN:
     {
-      CS_SD_HIGH;
-      return (START_TOKEN_TIMEOUT | r1);
+      uint32_t limit = pvt_TokenWaitLimit();
+      for (uint16_t cnt = 0; cnt < SD_ASYNC_CHUNK_LEN; ++cnt)
+      {
+        uint8_t tkn = sd_ReceiveByteSPI();
+        if (tkn == START_BLOCK_TKN)
+        {
+          rd->state = ASYNC_RECV_DATA;
+          break;
+        }
+        if (tkn != DMY_TKN)
+        {
+          pvt_EndAsyncRead(rd, START_TOKEN_ERROR | rd->r1);
+          break;
+        }
+        STATS_ADD_TOKEN_WAIT();
+        if (++rd->waitCnt >= limit)
+        {
+          pvt_EndAsyncRead(rd, START_TOKEN_TIMEOUT | rd->r1);
+          break;
+        }
+      }
+      break;
     }
 
-  // Load SD card block into the array.         
-  for (uint16_t byte = 0; byte < BLOCK_LEN; ++byte)
-    blckArr[byte] = sd_ReceiveByteSPI();
+    //
+    // load the next chunk of the block, continuing its CRC. The card waits
+    // for the clock between chunks, so the main loop can run in between.
+    //
+    case ASYNC_RECV_DATA:
+    {
+      uint16_t len = BLOCK_LEN - rd->pos;
+      if (len > SD_ASYNC_CHUNK_LEN)
+        len = SD_ASYNC_CHUNK_LEN;
+      rd->crc = sd_ReceiveBlockSPI(&rd->blckArr[rd->pos], len, rd->crc);
+      rd->pos += len;
+      if (rd->pos == BLOCK_LEN)
+      {
+        uint16_t err = pvt_CheckDataCRC(rd->crc);
 
-  // Get 16-bit CRC. Don't need.
-  sd_ReceiveByteSPI();
-  sd_ReceiveByteSPI();
-  
-  // clear any remaining data from the SPDR
-  sd_ReceiveByteSPI();          
+        // clear any remaining data from the SPDR
+        sd_ReceiveByteSPI();
+        pvt_EndAsyncRead(rd, err | rd->r1);
+      }
+      break;
+    }
+  }
+  STATS_ADD_CYCLES();
 
-  CS_SD_HIGH;
-  return (READ_SUCCESS | r1);
+  if (rd->state == ASYNC_DONE)
+    return SD_READ_DONE;
+  return SD_READ_BUSY;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          COMPLETE ASYNC READ
+ * 
+ * Description : Returns the result of a read started by sd_StartRead. If the
+ *               read is not yet done, it is first polled until it is.
+ * 
+ * Arguments   : rd   - pointer to an SDAsyncRead instance set by 
+ *                      sd_StartRead.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte),
+ *               the same as sd_ReadSingleBlock.
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_CompleteRead(SDAsyncRead *rd)
+{
+  while (sd_PollRead(rd) == SD_READ_BUSY)
+    ;
+  return rd->err;
 }
 
 /*
@@ -179,7 +459,7 @@ void sd_PrintSingleBlock(const uint8_t blckArr[])
 uint16_t sd_WriteSingleBlock(uint32_t blckAddr, const uint8_t dataArr[])
 {
   uint8_t  r1;                              // for R1 response
-  uint8_t  dataRespTkn = 0;
+  uint16_t err;
 
   // send the Write Single Block command to write data to blckAddr on SD card.
   CS_SD_LOW;    
@@ -190,61 +470,68 @@ uint16_t sd_WriteSingleBlock(uint32_t blckAddr, const uint8_t dataArr[])
     return (R1_ERROR | r1);
   }
 
-  // send Start Block Token (0xFE) to initiate data transfer
-  sd_SendByteSPI(START_BLOCK_TKN); 
+  // send Start Block Token (0xFE) to initiate data transfer, then the data.
+  err = pvt_SendDataBlock(START_BLOCK_TKN, dataArr);
+  CS_SD_HIGH;
+  return (err | r1);
+}
 
-  // send data to write to SD card.
-  for (uint16_t pos = 0; pos < BLOCK_LEN; ++pos) 
-    sd_SendByteSPI (dataArr[pos]);
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       WRITE MULTIPLE BLOCKS
+ * 
+ * Description : Writes the values in an array to consecutive SD card data 
+ *               blocks using a single WRITE_MULTIPLE_BLOCK command, which is
+ *               ended by sending the stop transmission token.
+ * 
+ * Arguments   : startBlckAddr   - address of the first data block to write.
+ *               numOfBlcks      - number of blocks to write.
+ *               dataArr         - pointer to an array holding the data that 
+ *                                 will be written to the blocks. Must be at
+ *                                 least numOfBlcks * BLOCK_LEN bytes long.
+ * 
+ * Returns     : Write Block Error (upper byte) and R1 Response (lower byte).
+ * ----------------------------------------------------------------------------
+ */
+uint16_t sd_WriteMultipleBlocks(uint32_t startBlckAddr, uint32_t numOfBlcks,
+                                const uint8_t dataArr[])
+{
+  uint8_t  r1;                              // for R1 response
+  uint16_t err = DATA_WRITE_SUCCESS;
 
-  // Send 16-bit CRC. CRC should be off (default), so these do not matter.
-  sd_SendByteSPI(DMY_TKN);
-  sd_SendByteSPI(DMY_TKN);
-  
-  // loop until valid data response token received or function exits on timeout
-  for (uint8_t timeout = 0; 
-       dataRespTkn != DATA_ACCEPTED_TKN
-       && dataRespTkn != CRC_ERROR_TKN 
-       && dataRespTkn != WRITE_ERROR_TKN;)
+  if (!numOfBlcks)
+    return DATA_WRITE_SUCCESS;
+
+  // send the Write Multiple Block command, beginning at startBlckAddr.
+  CS_SD_LOW;    
+  sd_SendCommand(WRITE_MULTIPLE_BLOCK, startBlckAddr);
+  if ((r1 = sd_GetR1()) != OUT_OF_IDLE)
   {
-    dataRespTkn = sd_ReceiveByteSPI() & DATA_RESPONSE_TKN_MASK;
-    if (++timeout > TIMEOUT_LIMIT)
-    {
-      CS_SD_HIGH;
-      return (DATA_RESPONSE_TIMEOUT | r1);
-    }
+    CS_SD_HIGH;
+    return (R1_ERROR | r1);
   }
-  
+
+  // each block is preceded by the multiple block start token (0xFC).
+  for (; numOfBlcks; --numOfBlcks, dataArr += BLOCK_LEN)
+    if ((err = pvt_SendDataBlock(START_MULTI_BLOCK_TKN, dataArr))
+        != DATA_WRITE_SUCCESS)
+      break;
+
   //
-  // if SD card signals the data was accepted by returning the Data Accepted
-  // Token then the card will enter 'busy' state while it writes the data to 
-  // the block. While busy, the card will hold the DO line at 0. If the timeout
-  // limit is reached then the function will return CARD_BUSY_TIMEOUT.
+  // the stop token ends the transfer. The card is then busy while the final
+  // block is programmed.
   //
-  if (dataRespTkn == DATA_ACCEPTED_TKN)
-  { 
-    for (uint16_t timeout = 0; sd_ReceiveByteSPI() == 0; ++timeout)
-      if (timeout > 4 * TIMEOUT_LIMIT)      // increased timeout limit
-      {
-        CS_SD_HIGH;
-        return (CARD_BUSY_TIMEOUT | r1);
-      }
+  sd_SendByteSPI(STOP_TRAN_TKN);
+  sd_ReceiveByteSPI();                      // skip byte before busy signal
+  for (uint16_t timeout = 0; sd_ReceiveByteSPI() == 0; ++timeout)
+    if (timeout > 4 * TIMEOUT_LIMIT)
+    {
+      err = CARD_BUSY_TIMEOUT;
+      break;
+    }
 
-    CS_SD_HIGH;
-    return (DATA_WRITE_SUCCESS | r1);
-  }
-  else if (dataRespTkn == CRC_ERROR_TKN) 
-  {
-    CS_SD_HIGH;
-    return (CRC_ERROR_TKN_RECEIVED | r1);
-  }
-  else if (dataRespTkn == WRITE_ERROR_TKN)
-  {
   CS_SD_HIGH;
-  return (WRITE_ERROR_TKN_RECEIVED | r1);
-  }
-
-  return (INVALID_DATA_RESPONSE | r1) ;
+  return (err | r1);
 }
 
 /*
@@ -331,6 +618,12 @@ void sd_PrintReadError(uint16_t err)
     case START_TOKEN_TIMEOUT:
       print_Str("\n\r START_TOKEN_TIMEOUT");
       break;
+    case DATA_CRC_ERROR:
+      print_Str("\n\r DATA_CRC_ERROR");
+      break;
+    case START_TOKEN_ERROR:
+      print_Str("\n\r START_TOKEN_ERROR");
+      break;
     default:
       print_Str("\n\r UNKNOWN RESPONSE");
   }
@@ -413,3 +706,579 @@ void sd_PrintEraseError(uint16_t err)
       print_Str("\n\r UNKNOWN RESPONSE");
   }
 }
+
+#if SD_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         GET BLOCK READ STATS
+ * 
+ * Description : Loads the block read counters into stats.
+ * 
+ * Arguments   : stats   - pointer to the SDStats instance to be loaded.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void sd_GetStats(SDStats *stats)
+{
+  *stats = sdStats;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       RESET BLOCK READ STATS
+ * 
+ * Description : Sets the block read counters to 0, and starts Timer 3 if it
+ *               is not already running.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+void sd_ResetStats(void)
+{
+  sdStats.tokenWaits = 0;
+  sdStats.retries = 0;
+  sdStats.cycles = 0;
+
+  // normal mode, counting from 0 to 0xFFFF.
+  TCCR3A = 0;
+  TCCR3B = STATS_TMR_CS;
+}
+
+#endif//SD_STATS
+
+/*
+ ******************************************************************************
+ *                        "PRIVATE" FUNCTIONS DEFINITIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                         (PRIVATE) READ RANGE OF SINGLE BLOCK
+ * 
+ * Description : Implements sd_ReadSingleBlock and sd_ReadBlockRange. Reads len
+ *               bytes, beginning at offset, of a single data block from the SD
+ *               card into an array at the current clock rate.
+ * 
+ * Arguments   : blckAddr   - address of the data block on the SD card.
+ *               offset     - position in the block of the first byte to read.
+ *               len        - number of bytes to read.
+ *               buf        - pointer to the array to be loaded with the len
+ *                            bytes.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).   
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_ReadBlockRange(uint32_t blckAddr, uint16_t offset, 
+                                   uint16_t len, uint8_t buf[])
+{
+  uint8_t r1;                               // for R1 responses
+
+  // request contents of a single data block at blckAddr on the SD card.
+  CS_SD_LOW;
+  sd_SendCommand(READ_SINGLE_BLOCK, blckAddr);
+  r1 = sd_GetR1();
+  if (r1 != OUT_OF_IDLE)
+  {
+    CS_SD_HIGH;
+    return (R1_ERROR | r1);
+  }
+
+  //
+  // wait for the 'Start Block Token' from the SD card, which indicates data
+  // from requested blckAddr is about to be sent.
+  //
+  uint16_t err = pvt_WaitStartToken();
+  if (err != READ_SUCCESS)
+  {
+    CS_SD_HIGH;
+    return (err | r1);
+  }
+
+  // Load the range of the SD card block into the array and check its CRC.
+  err = pvt_ReceiveDataRange(offset, len, buf);
+  
+  // clear any remaining data from the SPDR
+  sd_ReceiveByteSPI();          
+
+  CS_SD_HIGH;
+  return (err | r1);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               (PRIVATE) READ MULTIPLE BLOCKS
+ * 
+ * Description : Implements sd_ReadMultipleBlocks at the current clock rate.
+ * 
+ * Arguments   : startBlckAddr   - address of the first data block to be read.
+ *               numOfBlcks      - number of blocks to read.
+ *               blckArr         - pointer to the array that will be loaded.
+ *               blckHandler     - pointer to a BlockHandler function, or NULL.
+ *               handlerArg      - passed to blckHandler each time it is called.
+ *               blckCnt         - set to the number of blocks that were read
+ *                                 before the transfer ended.
+ * 
+ * Returns     : Read Block Error (upper byte) and R1 Response (lower byte).
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_ReadMultipleBlocks(uint32_t startBlckAddr, 
+                                       uint32_t numOfBlcks, uint8_t blckArr[],
+                                       BlockHandler blckHandler, 
+                                       void *handlerArg, uint32_t *blckCnt)
+{
+  uint8_t r1;                               // for R1 responses
+
+  *blckCnt = 0;
+  if (!numOfBlcks)
+    return READ_SUCCESS;
+
+  // request the data blocks beginning at startBlckAddr on the SD card.
+  CS_SD_LOW;
+  sd_SendCommand(READ_MULTIPLE_BLOCK, startBlckAddr);
+  r1 = sd_GetR1();
+  if (r1 != OUT_OF_IDLE)
+  {
+    CS_SD_HIGH;
+    return (R1_ERROR | r1);
+  }
+
+  for (; *blckCnt < numOfBlcks; ++*blckCnt)
+  {
+    //
+    // wait for the 'Start Block Token' from the SD card, which indicates data
+    // from the next block is about to be sent.
+    //
+    uint16_t err = pvt_WaitStartToken();
+    if (err != READ_SUCCESS)
+    {
+      pvt_StopTransmission();
+      CS_SD_HIGH;
+      return (err | r1);
+    }
+
+    // Load SD card block into the array and check its CRC. 
+    if (pvt_ReceiveDataBlock(blckArr) != READ_SUCCESS)
+    {
+      pvt_StopTransmission();
+      CS_SD_HIGH;
+      return (DATA_CRC_ERROR | r1);
+    }
+
+    //
+    // With no handler, the next block is loaded into the next BLOCK_LEN bytes
+    // of the array. Otherwise pass the block to the handler, which can also 
+    // end the read early. The time spent in the handler is not counted.
+    //
+    if (blckHandler == NULL)
+      blckArr += BLOCK_LEN;
+    else
+    {
+      STATS_ADD_CYCLES();
+      uint8_t stop = blckHandler(blckArr, handlerArg);
+      STATS_MARK();
+      if (stop)
+        break;
+    }
+  }
+
+  pvt_StopTransmission();
+  CS_SD_HIGH;
+  return (READ_SUCCESS | r1);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        (PRIVATE) WAIT FOR START BLOCK TOKEN
+ * 
+ * Description : Receives bytes from the SD card until the start block token
+ *               is received, after a read command has been sent.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : READ_SUCCESS if the token was received, START_TOKEN_TIMEOUT
+ *               if it was not received within START_TOKEN_TIMEOUT_MS, or 
+ *               START_TOKEN_ERROR if any byte other than DMY_TKN was received
+ *               before it, i.e. a data error token or a corrupted token.
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_WaitStartToken(void)
+{
+  uint32_t limit = pvt_TokenWaitLimit();
+  uint8_t  tkn;
+
+  for (uint32_t timeout = 0; (tkn = sd_ReceiveByteSPI()) != START_BLOCK_TKN;
+       ++timeout)
+  {
+    if (tkn != DMY_TKN)
+      return START_TOKEN_ERROR;
+    STATS_ADD_TOKEN_WAIT();
+    if (timeout >= limit)
+      return START_TOKEN_TIMEOUT;
+  }
+  return READ_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  (PRIVATE) TOKEN WAIT LIMIT
+ * 
+ * Description : Gets the number of bytes received while waiting for the start
+ *               block token that takes START_TOKEN_TIMEOUT_MS at the current
+ *               SPI clock rate.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : the number of bytes.
+ * 
+ * Notes       : Each byte takes 8 SPI clocks and each SPI clock rate is a
+ *               divisor of 2 << rate, so at SPI_CLK_DIV_2 a byte takes 16 CPU
+ *               cycles, and the count halves with each slower rate.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t pvt_TokenWaitLimit(void)
+{
+  return (F_CPU / 16000 * START_TOKEN_TIMEOUT_MS) >> sd_GetClockRate();
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                (PRIVATE) RECEIVE DATA BLOCK
+ * 
+ * Description : Receives a data block and its 16-bit CRC from the SD card, 
+ *               after the start block token has been received.
+ * 
+ * Arguments   : blckArr   - pointer to the array to be loaded with the 
+ *                           contents of the data block. Must be length 
+ *                           BLOCK_LEN.
+ * 
+ * Returns     : READ_SUCCESS, or DATA_CRC_ERROR if SD_DATA_CRC is set and the
+ *               CRC of the received block does not match the card's CRC.
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_ReceiveDataBlock(uint8_t blckArr[])
+{
+  // the CRC of the block is calculated as the block is received.
+  return pvt_CheckDataCRC(sd_ReceiveBlockSPI(blckArr, BLOCK_LEN, 0));
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                           (PRIVATE) RECEIVE DATA BLOCK RANGE
+ * 
+ * Description : Receives a data block and its 16-bit CRC from the SD card, 
+ *               after the start block token has been received, but only 
+ *               stores len bytes of the block beginning at offset.
+ * 
+ * Arguments   : offset   - position in the block of the first byte to store.
+ *               len      - number of bytes to store.
+ *               buf      - pointer to the array to be loaded with the len 
+ *                          bytes.
+ * 
+ * Returns     : READ_SUCCESS, or DATA_CRC_ERROR if SD_DATA_CRC is set and the
+ *               CRC of the received block does not match the card's CRC.
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_ReceiveDataRange(uint16_t offset, uint16_t len, 
+                                     uint8_t buf[])
+{
+  // the bytes before and after the range are still added to the CRC.
+  uint16_t crc = sd_SkipBlockSPI(offset, 0);
+  crc = sd_ReceiveBlockSPI(buf, len, crc);
+  crc = sd_SkipBlockSPI(BLOCK_LEN - offset - len, crc);
+  return pvt_CheckDataCRC(crc);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     (PRIVATE) CHECK DATA CRC
+ * 
+ * Description : Receives the 16-bit CRC that follows a data block from the SD
+ *               card, and compares it to the CRC of the received block.
+ * 
+ * Arguments   : crc   - the CRC16 of the received block, as returned by 
+ *                       sd_ReceiveBlockSPI.
+ * 
+ * Returns     : READ_SUCCESS, or DATA_CRC_ERROR if SD_DATA_CRC is set and crc
+ *               does not match the card's CRC.
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_CheckDataCRC(uint16_t crc)
+{
+  // Get the card's 16-bit CRC, MSB first. Only checked if SD_DATA_CRC is set.
+  uint16_t blckCrc = (uint16_t)sd_ReceiveByteSPI() << 8;
+  blckCrc |= sd_ReceiveByteSPI();
+
+#if SD_DATA_CRC
+  if (crc != blckCrc)
+    return DATA_CRC_ERROR;
+#else
+  (void)crc;
+  (void)blckCrc;
+#endif//SD_DATA_CRC
+  return READ_SUCCESS;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                  (PRIVATE) RETRY BLOCK READ
+ * 
+ * Description : Determines if a failed block read should be retried, and 
+ *               lowers the clock rate when required.
+ * 
+ * Arguments   : err          - the error returned by the block read.
+ *               crcRetries   - pointer to the number of retries remaining at 
+ *                              the current clock rate after a CRC error. 
+ *                              Must be initialized to SD_CRC_RETRIES.
+ *               tknRetries   - pointer to the number of retries remaining 
+ *                              after a start block token timeout. Must be 
+ *                              initialized to SD_TOKEN_RETRIES.
+ * 
+ * Returns     : 1 if the read should be retried, otherwise 0.
+ * 
+ * Notes       : 1) If the start block token was not received in time, the
+ *                  card is only slow to respond, so the read is retried up
+ *                  to SD_TOKEN_RETRIES times and the clock rate is not 
+ *                  changed.
+ *               2) If the block failed the CRC check, or an error token was
+ *                  received in place of the start block token, the read is 
+ *                  first retried up to SD_CRC_RETRIES times at the same clock
+ *                  rate, as a single corrupted block may only be noise. If it
+ *                  still fails, then the rate is lowered and the retries 
+ *                  reset.
+ *               3) The read is not retried if the rate can not be lowered.
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_RetryRead(uint16_t err, uint8_t *crcRetries, 
+                             uint8_t *tknRetries)
+{
+  if (err & START_TOKEN_TIMEOUT)
+  {
+    if (!*tknRetries)
+      return 0;
+    --*tknRetries;
+    return STATS_COUNT_RETRY(1);
+  }
+
+  if (err & (DATA_CRC_ERROR | START_TOKEN_ERROR))
+  {
+    if (*crcRetries)
+    {
+      --*crcRetries;
+      return STATS_COUNT_RETRY(1);
+    }
+    *crcRetries = SD_CRC_RETRIES;
+    return STATS_COUNT_RETRY(sd_LowerClockRate());
+  }
+  return 0;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     (PRIVATE) END ASYNC READ
+ * 
+ * Description : Deselects the card at the end of an attempt of an async read,
+ *               and either restarts the read or sets it to done.
+ * 
+ * Arguments   : rd    - pointer to the SDAsyncRead instance.
+ *               err   - Read Block Error and R1 Response of the attempt.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : The read is retried, and the clock rate lowered, by the same
+ *               rules as sd_ReadSingleBlock. See pvt_RetryRead.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_EndAsyncRead(SDAsyncRead *rd, uint16_t err)
+{
+  CS_SD_HIGH;
+  if (pvt_RetryRead(err, &rd->crcRetries, &rd->tknRetries))
+    rd->state = ASYNC_SEND_CMD;
+  else
+  {
+    rd->err = err;
+    rd->state = ASYNC_DONE;
+  }
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   (PRIVATE) SEND DATA BLOCK
+ * 
+ * Description : Sends a start token and a data block to the SD card, followed
+ *               by its CRC, then waits for the data response and for the card
+ *               to finish writing the block. The command must already have
+ *               been sent.
+ * 
+ * Arguments   : startTkn   - the start token sent before the block, i.e. 
+ *                            START_BLOCK_TKN or START_MULTI_BLOCK_TKN.
+ *               dataArr    - pointer to the array holding the BLOCK_LEN bytes
+ *                            of the block.
+ * 
+ * Returns     : Write Block Error Flag, DATA_WRITE_SUCCESS if the block was 
+ *               written.
+ * ----------------------------------------------------------------------------
+ */
+static uint16_t pvt_SendDataBlock(uint8_t startTkn, const uint8_t dataArr[])
+{
+  uint8_t  dataRespTkn = 0;
+  uint16_t crc;
+
+  sd_SendByteSPI(startTkn); 
+
+  // send data to write to SD card.
+  crc = sd_SendBlockSPI(dataArr, BLOCK_LEN);
+
+  // 
+  // Send 16-bit CRC, MSB first. If SD_DATA_CRC is not set then CRC is off and
+  // these do not matter.
+  //
+#if SD_DATA_CRC
+  sd_SendByteSPI(crc >> 8);
+  sd_SendByteSPI(crc);
+#else
+  (void)crc;
+  sd_SendByteSPI(DMY_TKN);
+  sd_SendByteSPI(DMY_TKN);
+#endif//SD_DATA_CRC
+  
+  // loop until valid data response token received or function exits on timeout
+  for (uint8_t timeout = 0; 
+       dataRespTkn != DATA_ACCEPTED_TKN
+       && dataRespTkn != CRC_ERROR_TKN 
+       && dataRespTkn != WRITE_ERROR_TKN;)
+  {
+    dataRespTkn = sd_ReceiveByteSPI() & DATA_RESPONSE_TKN_MASK;
+    if (++timeout > TIMEOUT_LIMIT)
+      return DATA_RESPONSE_TIMEOUT;
+  }
+  
+  //
+  // if SD card signals the data was accepted by returning the Data Accepted
+  // Token then the card will enter 'busy' state while it writes the data to 
+  // the block. While busy, the card will hold the DO line at 0. If the timeout
+  // limit is reached then the function will return CARD_BUSY_TIMEOUT.
+  //
+  if (dataRespTkn == DATA_ACCEPTED_TKN)
+  { 
+    for (uint16_t timeout = 0; sd_ReceiveByteSPI() == 0; ++timeout)
+      if (timeout > 4 * TIMEOUT_LIMIT)      // increased timeout limit
+        return CARD_BUSY_TIMEOUT;
+    return DATA_WRITE_SUCCESS;
+  }
+  else if (dataRespTkn == CRC_ERROR_TKN) 
+    return CRC_ERROR_TKN_RECEIVED;
+  else if (dataRespTkn == WRITE_ERROR_TKN)
+    return WRITE_ERROR_TKN_RECEIVED;
+
+  return INVALID_DATA_RESPONSE;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           STOP TRANSMISSION
+ * 
+ * Description : Sends the STOP_TRANSMISSION command to end a multiple block
+ *               read and waits for the card to leave the busy state.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * 
+ * Notes       : CS must be asserted when this is called, and it is left 
+ *               asserted when it returns.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_StopTransmission(void)
+{
+  sd_SendCommand(STOP_TRANSMISSION, 0);
+
+  // first byte after the command is a stuff byte. Then get R1b. Don't care.
+  sd_ReceiveByteSPI();
+  sd_GetR1();
+
+  // card holds DO low while busy.
+  for (uint16_t timeout = 0; sd_ReceiveByteSPI() == 0; ++timeout)
+    if (timeout > STOP_TRAN_BUSY_TIMEOUT_LIMIT)
+      break;
+}
+
+
+#if SD_STATS
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    (PRIVATE) MARK STATS TIME
+ * 
+ * Description : Starts timing a segment of a block read.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * 
+ * Notes       : The overflow flag is cleared after the count is read, so an 
+ *               overflow between the two is seen by pvt_StatsAddCycles as a 
+ *               count lower than the mark instead of being counted twice.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_StatsMark(void)
+{
+  statsMark = TCNT3;
+  TIFR3 = (1 << TOV3);                      // cleared by writing 1.
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               (PRIVATE) ADD STATS TIME SPENT
+ * 
+ * Description : Adds the CPU cycles since the last mark to the cycles counter
+ *               and moves the mark to the current count.
+ * 
+ * Arguments   : void
+ * 
+ * Returns     : void
+ * 
+ * Notes       : A segment of up to two timer periods (65536 * 2 counts) is
+ *               measured. If the overflow flag is set and the count is not 
+ *               below the mark, then the timer has wrapped once in full. The
+ *               flag is read before the count for this to hold.
+ * ----------------------------------------------------------------------------
+ */
+static void pvt_StatsAddCycles(void)
+{
+  uint8_t  ovf = TIFR3 & (1 << TOV3);
+  uint16_t now = TCNT3;
+  uint32_t cnt = (uint16_t)(now - statsMark);
+  
+  if (ovf && now >= statsMark)
+    cnt += 0x10000;
+  sdStats.cycles += cnt * STATS_TMR_DIV;
+
+  // the next segment starts where this one ended.
+  statsMark = now;
+  TIFR3 = (1 << TOV3);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   (PRIVATE) COUNT READ RETRY
+ * 
+ * Description : Counts a block read retry.
+ * 
+ * Arguments   : retry   - value that will be returned by pvt_RetryRead.
+ * 
+ * Returns     : retry
+ * ----------------------------------------------------------------------------
+ */
+static uint8_t pvt_StatsCountRetry(uint8_t retry)
+{
+  if (retry)
+    ++sdStats.retries;
+  return retry;
+}
+
+#endif//SD_STATS
@@ -0,0 +1,426 @@
+/*
+ *                         Benchmark for AVR-FAT Module
+ *
+ * File       : AVR_FAT_BENCH.C
+ * Author     : Joshua Fain
+ * Target     : ATMega1280, or Host (x86 / Linux)
+ * Compiler   : AVR-GCC 9.3.0, or GCC
+ * Downloader : AVRDUDE 6.3
+ * License    : GNU GPLv3
+ * Copyright (c) 2020, 2021
+ *
+ * DESCRIPTION:
+ * Runs a fixed set of directory and file scenarios against a FAT32 volume and
+ * reports, for each run, the time taken, the number of sectors read, how many
+ * of those were FAT sectors, and the number of SD card commands issued. Built
+ * with MAKE.SH it runs on the AVR against an SD card, timed with Timer 1.
+ * Built with MAKE_HOST.SH it runs against an image file, passed as the only
+ * argument, timed with the host's monotonic clock.
+ *
+ * VOLUME LAYOUT:
+ * The scenarios expect the following on the volume. A scenario whose path is
+ * not found is still reported, with the error flag returned.
+ *   /BENCH/D10/              : directory of 10 files
+ *   /BENCH/D100/             : directory of 100 files
+ *   /BENCH/D1000/            : directory of 1000 files
+ *   /BENCH/C1/C2/.../C8/     : chain of 8 nested directories
+ *   /BENCH/SEQ.BIN           : file of contiguous clusters, e.g. 256 KB
+ *   /BENCH/FRAG.BIN          : file of the same size in fragmented clusters
+ *
+ * OUTPUT:
+ * Each scenario is run once after the sector pool and directory cache have
+ * been invalidated (cold), and then again (warm). One line per run is then
+ * printed with the columns:
+ *   scenario, cold/warm, time in us, sectors read, FAT sectors read, SD
+ *   commands, and the FAT error flag returned by the scenario.
+ *
+ * NOTES:
+ * (1)  The sectors read and commands are counted by wrapping the FATtoDisk
+ *      read functions, and on the AVR sd_SendCommand, with the linker's
+ *      --wrap option, so the module itself is not changed to be measured.
+ * (2)  On the host there is no SD card, so the commands column is the number
+ *      the SD card disk layer would send for the same reads: 1 for a single
+ *      sector and 2 (READ_MULTIPLE_BLOCK and STOP_TRANSMISSION) for a run.
+ * (3)  Output of fat_PrintDir and fat_PrintFile is discarded while a run is
+ *      timed, so the times do not include sending it to the terminal.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#ifdef __AVR__
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "sd_spi_base.h"
+#else
+#include <stdio.h>
+#include <time.h>
+#include "fat_to_image.h"
+#endif//__AVR__
+#include "avr_usart.h"
+#include "prints.h"
+#include "fat_bpb.h"
+#include "fat.h"
+#include "fat_cache.h"
+#include "fat_file.h"
+#include "fat_to_disk_if.h"
+
+#define SD_CARD_INIT_ATTEMPTS_MAX      5
+#define BENCH_RUNS                     2    // cold and warm
+
+// scenario kinds
+#define SCN_LS                         0    // fat_PrintDir of arg
+#define SCN_CD                         1    // fat_SetDir to arg, then to root
+#define SCN_PRINT                      2    // fat_PrintFile of arg
+#define SCN_READ                       3    // fat_ReadFile of arg to the end
+
+// depth of the directory chain, for the ".." steps of the cd scenario
+#define CD_CHAIN_DEPTH                 8
+
+typedef struct
+{
+  const char *name;
+  uint8_t     kind;
+  const char *arg;
+}
+Scenario;
+
+static const Scenario scenarios[] =
+{
+  {"ls D10",        SCN_LS,    "/BENCH/D10"},
+  {"ls D100",       SCN_LS,    "/BENCH/D100"},
+  {"ls D1000",      SCN_LS,    "/BENCH/D1000"},
+  {"cd C1-C8",      SCN_CD,    "/BENCH/C1/C2/C3/C4/C5/C6/C7/C8"},
+  {"print SEQ",     SCN_PRINT, "/BENCH/SEQ.BIN"},
+  {"print FRAG",    SCN_PRINT, "/BENCH/FRAG.BIN"},
+  {"read SEQ",      SCN_READ,  "/BENCH/SEQ.BIN"},
+  {"read FRAG",     SCN_READ,  "/BENCH/FRAG.BIN"},
+};
+
+#define SCENARIO_CNT   (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// counts collected while a scenario runs
+typedef struct
+{
+  uint32_t timeUs;
+  uint32_t secRead;
+  uint32_t fatSecRead;
+  uint32_t cmdCnt;
+  uint8_t  err;
+}
+BenchCount;
+
+static BenchCount cnt;
+
+// FAT sectors are those from fatFirstSec up to the data region
+static uint32_t fatFirstSec;
+static uint32_t dataFirstSec;
+
+static uint8_t runBuf[SECTOR_LEN];          // fat_ReadFile buffer
+
+static void pvt_RunScenario(const Scenario *scn, const BPB *bpb);
+static void pvt_PrintResult(const Scenario *scn, uint8_t run);
+static void pvt_NullSink(const char buf[], uint16_t len);
+static void pvt_TimerStart(void);
+static uint32_t pvt_TimerUs(void);
+
+/*
+ ******************************************************************************
+ *                        DISK FUNCTION COUNTING WRAPPERS
+ ******************************************************************************
+ */
+
+uint8_t __real_FATtoDisk_ReadSingleSector(uint32_t blkNum, uint8_t blkArr[]);
+uint8_t __real_FATtoDisk_ReadSectorRange(uint32_t blkNum, uint16_t offset,
+                                        uint16_t len, uint8_t buf[]);
+uint8_t __real_FATtoDisk_ReadMultipleSectors(uint32_t startBlkNum,
+                                             uint32_t numOfBlks,
+                                             uint8_t blkArr[],
+                                             SectorHandler blkHandler,
+                                             void *handlerArg);
+
+// counts one sector read at blkNum
+static void pvt_CountSector(uint32_t blkNum)
+{
+  ++cnt.secRead;
+  if (blkNum >= fatFirstSec && blkNum < dataFirstSec)
+    ++cnt.fatSecRead;
+}
+
+uint8_t __wrap_FATtoDisk_ReadSingleSector(uint32_t blkNum, uint8_t blkArr[])
+{
+#ifndef __AVR__
+  ++cnt.cmdCnt;
+#endif//__AVR__
+  pvt_CountSector(blkNum);
+  return __real_FATtoDisk_ReadSingleSector(blkNum, blkArr);
+}
+
+// a range read still transfers the whole sector, so it is counted as one
+uint8_t __wrap_FATtoDisk_ReadSectorRange(uint32_t blkNum, uint16_t offset,
+                                        uint16_t len, uint8_t buf[])
+{
+#ifndef __AVR__
+  ++cnt.cmdCnt;
+#endif//__AVR__
+  pvt_CountSector(blkNum);
+  return __real_FATtoDisk_ReadSectorRange(blkNum, offset, len, buf);
+}
+
+// the caller's handler and the next sector, to count sectors actually read
+typedef struct
+{
+  SectorHandler handler;
+  void         *handlerArg;
+  uint32_t      blkNum;
+}
+CountHandlerArg;
+
+static uint8_t pvt_CountHandler(uint8_t blkArr[], void *handlerArg)
+{
+  CountHandlerArg *arg = handlerArg;
+  pvt_CountSector(arg->blkNum++);
+  return arg->handler(blkArr, arg->handlerArg);
+}
+
+uint8_t __wrap_FATtoDisk_ReadMultipleSectors(uint32_t startBlkNum,
+                                             uint32_t numOfBlks,
+                                             uint8_t blkArr[],
+                                             SectorHandler blkHandler,
+                                             void *handlerArg)
+{
+#ifndef __AVR__
+  cnt.cmdCnt += 2;
+#endif//__AVR__
+  if (blkHandler == NULL)
+  {
+    for (uint32_t blk = 0; blk < numOfBlks; ++blk)
+      pvt_CountSector(startBlkNum + blk);
+    return __real_FATtoDisk_ReadMultipleSectors(startBlkNum, numOfBlks,
+                                                blkArr, NULL, NULL);
+  }
+
+  CountHandlerArg arg = {blkHandler, handlerArg, startBlkNum};
+  return __real_FATtoDisk_ReadMultipleSectors(startBlkNum, numOfBlks, blkArr,
+                                              pvt_CountHandler, &arg);
+}
+
+#ifdef __AVR__
+void __real_sd_SendCommand(uint8_t cmd, uint32_t arg);
+
+void __wrap_sd_SendCommand(uint8_t cmd, uint32_t arg)
+{
+  ++cnt.cmdCnt;
+  __real_sd_SendCommand(cmd, arg);
+}
+#endif//__AVR__
+
+/*
+ ******************************************************************************
+ *                                     MAIN
+ ******************************************************************************
+ */
+
+#ifdef __AVR__
+int main(void)
+#else
+int main(int argc, char *argv[])
+#endif//__AVR__
+{
+  usart_Init();
+
+#ifdef __AVR__
+  CTV ctv;
+  uint32_t sdInitResp = 0;
+
+  for (uint8_t att = 0; att < SD_CARD_INIT_ATTEMPTS_MAX; ++att)
+  {
+    sdInitResp = sd_InitModeSPI(&ctv);
+    if (sdInitResp == OUT_OF_IDLE)
+      break;
+  }
+  if (sdInitResp != OUT_OF_IDLE)
+  {
+    print_Str("\n\r FAILED TO INITIALIZE SD CARD");
+    for (;;)
+      ;
+  }
+#else
+  if (argc != 2 || FATtoImage_Open(argv[1], IMAGE_READ_ONLY)
+                   != IMAGE_OPEN_SUCCESS)
+  {
+    print_Str("\n\r usage: avr_fat_bench <FAT32 image file>\n\r");
+    return 1;
+  }
+#endif//__AVR__
+
+  BPB bpb;
+  uint8_t err = fat_SetBPB(&bpb);
+  if (err != BPB_VALID)
+  {
+    print_Str("\n\r fat_SetBPB() returned ");
+    fat_PrintErrorBPB(err);
+    print_Str("\n\r");
+#ifdef __AVR__
+    for (;;)
+      ;
+#else
+    return 1;
+#endif//__AVR__
+  }
+  dataFirstSec = bpb.dataRegionFirstSector;
+  fatFirstSec = dataFirstSec - bpb.numOfFats * bpb.fatSize32;
+
+  pvt_TimerStart();
+  print_Str("\n\r scenario      run      time_us    sectors   fat_secs"
+            "   commands  err");
+
+  for (uint8_t scn = 0; scn < SCENARIO_CNT; ++scn)
+  {
+    // cold run starts with nothing cached, warm run follows it
+    fat_InvalidateSecPool();
+    fat_InvalidateDirCache(DIR_CACHE_ALL);
+    for (uint8_t run = 0; run < BENCH_RUNS; ++run)
+    {
+      pvt_RunScenario(&scenarios[scn], &bpb);
+      pvt_PrintResult(&scenarios[scn], run);
+    }
+  }
+  print_Str("\n\r");
+  usart_Flush();
+
+#ifdef __AVR__
+  for (;;)
+    ;
+#else
+  FATtoImage_Close();
+  return 0;
+#endif//__AVR__
+}
+
+/*
+ ******************************************************************************
+ *                               LOCAL FUNCTIONS
+ ******************************************************************************
+ */
+
+// runs a scenario with its output discarded, and sets cnt.
+static void pvt_RunScenario(const Scenario *scn, const BPB *bpb)
+{
+  FatDir dir;
+  FatFile file;
+
+  memset(&cnt, 0, sizeof(cnt));
+  fat_SetDirToRoot(&dir, bpb);
+
+  print_SetSink(pvt_NullSink);
+  uint32_t startUs = pvt_TimerUs();
+  switch (scn->kind)
+  {
+    case SCN_LS:
+      cnt.err = fat_SetDir(&dir, scn->arg, bpb);
+      if (cnt.err == SUCCESS)
+        cnt.err = fat_PrintDir(&dir, LONG_NAME, bpb);
+      break;
+
+    case SCN_CD:
+      cnt.err = fat_SetDir(&dir, scn->arg, bpb);
+      for (uint8_t depth = 0; depth < CD_CHAIN_DEPTH && cnt.err == SUCCESS;
+           ++depth)
+        cnt.err = fat_SetDir(&dir, "..", bpb);
+      break;
+
+    case SCN_PRINT:
+      cnt.err = fat_PrintFile(&dir, scn->arg, bpb);
+      break;
+
+    case SCN_READ:
+      cnt.err = fat_OpenFile(&file, &dir, scn->arg, bpb);
+      if (cnt.err == SUCCESS)
+      {
+        while (fat_ReadFile(&file, runBuf, SECTOR_LEN) == SECTOR_LEN)
+          ;
+        cnt.err = fat_Close(&file);
+      }
+      break;
+  }
+  cnt.timeUs = pvt_TimerUs() - startUs;
+  print_SetSink(NULL);
+}
+
+// prints one line of the results table for the last run of scn.
+static void pvt_PrintResult(const Scenario *scn, uint8_t run)
+{
+  PrintLine line;
+  line.len = 0;
+
+  print_LineStr(&line, "\n\r ");
+  print_LineStr(&line, scn->name);
+  for (uint8_t pad = strlen(scn->name); pad < 14; ++pad)
+    print_LineStr(&line, " ");
+  print_LineStr(&line, run ? "warm" : "cold");
+  print_LineStr(&line, "   ");
+  print_LineDec(&line, cnt.timeUs, 10, ' ');
+  print_LineStr(&line, " ");
+  print_LineDec(&line, cnt.secRead, 10, ' ');
+  print_LineStr(&line, " ");
+  print_LineDec(&line, cnt.fatSecRead, 10, ' ');
+  print_LineStr(&line, " ");
+  print_LineDec(&line, cnt.cmdCnt, 10, ' ');
+  print_LineStr(&line, "  0x");
+  print_LineFlush(&line);
+  print_Hex(cnt.err);
+}
+
+// print sink that discards its output, for the timed part of a run.
+static void pvt_NullSink(const char buf[], uint16_t len)
+{
+  (void)buf;
+  (void)len;
+}
+
+#ifdef __AVR__
+// overflows of Timer 1, the upper 16 bits of the tick count
+static volatile uint16_t timerOvfCnt;
+
+ISR(TIMER1_OVF_vect)
+{
+  ++timerOvfCnt;
+}
+
+// starts Timer 1 free running with a prescaler of 64.
+static void pvt_TimerStart(void)
+{
+  TCCR1A = 0;
+  TCNT1 = 0;
+  TIMSK1 = 1 << TOIE1;
+  TCCR1B = (1 << CS11) | (1 << CS10);
+  sei();
+}
+
+// returns the time since pvt_TimerStart in microseconds.
+static uint32_t pvt_TimerUs(void)
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t ovfCnt = timerOvfCnt;
+  uint16_t ticks = TCNT1;
+
+  // an overflow that occurred after interrupts were disabled is not counted
+  if ((TIFR1 & (1 << TOV1)) && ticks < 0x8000)
+    ++ovfCnt;
+  SREG = sreg;
+  return (((uint32_t)ovfCnt << 16) | ticks) * 64 / (F_CPU / 1000000UL);
+}
+#else
+static void pvt_TimerStart(void)
+{
+}
+
+// returns the host's monotonic clock in microseconds.
+static uint32_t pvt_TimerUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000UL + ts.tv_nsec / 1000);
+}
+#endif//__AVR__
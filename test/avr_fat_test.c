@@ -22,6 +22,10 @@
  *  (2) ls <FIELDS>   : List directory contents based on specified <FILTERs>.
  *  (3) open <FILE>   : Print contents of <FILE> to a screen.
  *  (4) pwd           : Print the current working directory to screen.
+ *  (5) stats         : Print the disk read counters. 'stats reset' sets them
+ *                      to 0.
+ *  (6) find <PATTERN>: List the files and directories in cwd whose names 
+ *                      match <PATTERN>, e.g. "*.LOG".
  * 
  * NOTES: 
  * (1)  The module only has READ capabilities.
@@ -29,9 +33,11 @@
  *      a space exists in the name.
  * (3)  Directory and file name arguments are case sensitive.
  * (4)  'cd' cmd can be used to reset cwd (current working directory) to point
- *      to the ROOT directory or change it to a CHILD or the PARENT of the 
- *      current directory pointed at by cwd.
- * (5)  'open' will only work for files that are in the cwd directory. 
+ *      to the ROOT directory or change it to any directory by its path. The
+ *      path may be relative to cwd, e.g. "../docs", or absolute, beginning
+ *      with '/', e.g. "/docs/2021".
+ * (5)  'open' takes the name of a file in the cwd directory, or a path to 
+ *      the file as with 'cd'. 
  * (6)  Pass ".." (without quotes) as the argument to 'cd' to point cwd to
  *      its parent directory.
  * (7)  Pass "~" (without quotes) as the argument to 'cd' to reset cwd to point
@@ -50,12 +56,17 @@
  *       /LA : Print last access date.
  *       /A  : ALL - prints all entries and all fields.
  *
- * (10) Enter 'q' to exit the command-line. If the SD_CARD_READ_DATA macro is
+ * (10) 'stats' requires FAT_DISK_STATS, and SD_STATS for the start token 
+ *      waits, retries and cycles, to be set when the modules are built.
+ * (11) 'find' uses fat_FindEntries. '*' matches any number of characters and
+ *      '?' any single character. Hidden and system entries are not listed.
+ * (12) Enter 'q' to exit the command-line. If the SD_CARD_READ_DATA macro is
  *      set then there an SD Card raw data access section will also be entered.
  */
 
 #include <string.h>
 #include <avr/io.h>
+#include <avr/eeprom.h>
 #include "avr_usart.h"
 #include "prints.h"
 #include "sd_spi_base.h"
@@ -83,6 +94,15 @@
 static uint32_t enterBlockNumber();          
 #endif // SD_CARD_READ_DATA          
 
+#if FAT_DISK_STATS
+static void printStats(void);
+#endif//FAT_DISK_STATS
+
+static uint8_t printFoundEntry(const FatEntry *ent, void *handlerArg);
+
+// BPB of the last mounted volume, so it can be mounted quickly after a reset.
+static BPBSnapshot EEMEM bpbSnapEE;
+
 int main(void)
 {
   // Initializat usart and spi ports.
@@ -123,17 +143,35 @@ int main(void)
   {          
     uint8_t err;                            // for returned errors
     uint8_t quitCL = 0;                     // flag used to exit cmd line  
+
+#if FAT_DISK_STATS
+    // start counting with the reads that mount the volume.
+    fat_ResetStats();
+#endif//FAT_DISK_STATS
+
     //
     // Create and set Bios Parameter Block instance. Members of this instance
     // are used to calculate where on the disk, the FAT sectors are located. 
-    // This should only be set here.
+    // This should only be set here. If the disk holds the volume of the 
+    // snapshot in EEPROM, it is set from the snapshot. Otherwise it is set 
+    // from the boot sector, and its snapshot is saved to EEPROM.
     //
     BPB bpb;
-    err = fat_SetBPB(&bpb);
-    if (err != BPB_VALID)
+    BPBSnapshot bpbSnap;
+    eeprom_read_block(&bpbSnap, &bpbSnapEE, sizeof(BPBSnapshot));
+    if (fat_RestoreBPB(&bpb, &bpbSnap) != BPB_VALID)
     {
-      print_Str("\n\r fat_SetBPB() returned ");
-      fat_PrintErrorBPB(err);
+      err = fat_SetBPB(&bpb);
+      if (err != BPB_VALID)
+      {
+        print_Str("\n\r fat_SetBPB() returned ");
+        fat_PrintErrorBPB(err);
+      }
+      else
+      {
+        fat_SaveBPB(&bpb, &bpbSnap);
+        eeprom_update_block(&bpbSnap, &bpbSnapEE, sizeof(BPBSnapshot));
+      }
     }
 
     //
@@ -157,7 +195,9 @@ int main(void)
 
       // print cmd prompt to screen with cwd
       print_Str("\n\r");
+#if FAT_PATH_TRACKING
       print_Str(cwd.lnStr);
+#endif//FAT_PATH_TRACKING
       print_Str(" > ");
 
       // 
@@ -293,8 +333,38 @@ int main(void)
         else if (!strcmp(cmdStr, "pwd"))
         {
           print_Str("\n\r");
+#if FAT_PATH_TRACKING
           print_Str (cwd.lnPathStr);
           print_Str (cwd.lnStr);
+#else
+          print_Str ("pwd requires FAT_PATH_TRACKING");
+#endif//FAT_PATH_TRACKING
+        }
+
+        //
+        // Command: "stats" (print disk read counters)
+        //
+        else if (!strcmp(cmdStr, "stats"))
+        {
+#if FAT_DISK_STATS
+          if (splitPtr != NULL && !strcmp(argStr, "reset"))
+            fat_ResetStats();
+          else
+            printStats();
+#else
+          print_Str ("\n\rstats requires FAT_DISK_STATS");
+#endif//FAT_DISK_STATS
+        }
+
+        //
+        // Command: "find" (list entries matching a pattern)
+        //
+        else if (!strcmp(cmdStr, "find"))
+        {
+          err = fat_FindEntries(&cwd, splitPtr != NULL ? argStr : NULL,
+                                DIR_ENTRY_ATTR, printFoundEntry, NULL, &bpb);
+          if (err != END_OF_DIRECTORY) 
+            fat_PrintError (err);
         }
 
         //
@@ -445,3 +515,55 @@ static uint32_t enterBlockNumber()
   return blkNum;
 }
 #endif // SD_CARD_READ_DATA
+
+#if FAT_DISK_STATS
+//
+// local function used by the 'stats' command that prints the disk read
+// counters returned by fat_GetStats.
+//
+static void printStats(void)
+{
+  DiskStats stats;
+  fat_GetStats(&stats);
+
+  print_Str("\n\n\r SECTORS READ");
+  print_Str("\n\r   boot         : ");
+  print_Dec(stats.secReadCnt[READ_CAT_BOOT]);
+  print_Str("\n\r   FAT          : ");
+  print_Dec(stats.secReadCnt[READ_CAT_FAT]);
+  print_Str("\n\r   directory    : ");
+  print_Dec(stats.secReadCnt[READ_CAT_DIR]);
+  print_Str("\n\r   file data    : ");
+  print_Dec(stats.secReadCnt[READ_CAT_FILE]);
+  print_Str("\n\r SECTOR POOL");
+  print_Str("\n\r   hits         : ");
+  print_Dec(stats.poolHits);
+  print_Str("\n\r   misses       : ");
+  print_Dec(stats.poolMisses);
+  print_Str("\n\r DIRECTORY CACHE");
+  print_Str("\n\r   hits         : ");
+  print_Dec(stats.dirCacheHits);
+  print_Str("\n\r   misses       : ");
+  print_Dec(stats.dirCacheMisses);
+  print_Str("\n\r SD CARD");
+  print_Str("\n\r   token waits  : ");
+  print_Dec(stats.tokenWaits);
+  print_Str("\n\r   retries      : ");
+  print_Dec(stats.retries);
+  print_Str("\n\r   cycles       : ");
+  print_Dec(stats.cycles);
+}
+#endif//FAT_DISK_STATS
+
+//
+// local function used by the 'find' command as the EntryHandler passed to 
+// fat_FindEntries. Prints the long name of each entry found.
+//
+static uint8_t printFoundEntry(const FatEntry *ent, void *handlerArg)
+{
+  print_Str("\n\r ");
+  print_Buf(ent->lnStr, strlen(ent->lnStr));
+  if (FAT_ENT_ATTR(ent) & DIR_ENTRY_ATTR)
+    print_Str("/");
+  return SUCCESS;
+}